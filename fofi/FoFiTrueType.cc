@@ -21,7 +21,7 @@
 #include "gmem.h"
 #include "gmempp.h"
 #include "GString.h"
-#include "GHash.h"
+#include "GStrHash.h"
 #include "FoFiType1C.h"
 #include "FoFiTrueType.h"
 
@@ -2367,7 +2367,6 @@ void FoFiTrueType::parseDfont(int fontNum, int *offset, int *startPos) {
 }
 
 void FoFiTrueType::readPostTable() {
-  GString *name;
   int tablePos, postFmt, stringIdx, stringPos;
   GBool ok;
   int i, j, n, m;
@@ -2382,24 +2381,23 @@ void FoFiTrueType::readPostTable() {
     goto err;
   }
   if (postFmt == 0x00010000) {
-    nameToGID = new GHash(gTrue);
+    nameToGID = new GStrHash(258);
     for (i = 0; i < 258; ++i) {
-      nameToGID->add(new GString(macGlyphNames[i]), i);
+      nameToGID->add(macGlyphNames[i], i);
     }
   } else if (postFmt == 0x00020000) {
-    nameToGID = new GHash(gTrue);
     n = getU16BE(tablePos + 32, &ok);
     if (!ok) {
       goto err;
     }
+    nameToGID = new GStrHash(n < nGlyphs ? n : nGlyphs);
     stringIdx = 0;
     stringPos = tablePos + 34 + 2*n;
     for (i = 0; i < n && i < nGlyphs; ++i) {
       ok = gTrue;
       j = getU16BE(tablePos + 34 + 2*i, &ok);
       if (j < 258) {
-	nameToGID->removeInt(macGlyphNames[j]);
-	nameToGID->add(new GString(macGlyphNames[j]), i);
+	nameToGID->add(macGlyphNames[j], i);
       } else {
 	j -= 258;
 	if (j != stringIdx) {
@@ -2414,23 +2412,20 @@ void FoFiTrueType::readPostTable() {
 	if (!ok || !checkRegion(stringPos + 1, m)) {
 	  continue;
 	}
-	name = new GString((char *)&file[stringPos + 1], m);
-	nameToGID->removeInt(name);
-	nameToGID->add(name, i);
+	nameToGID->add((char *)&file[stringPos + 1], m, i);
 	++stringIdx;
 	stringPos += 1 + m;
       }
     }
   } else if (postFmt == 0x00028000) {
-    nameToGID = new GHash(gTrue);
+    nameToGID = new GStrHash(nGlyphs);
     for (i = 0; i < nGlyphs; ++i) {
       j = getU8(tablePos + 32 + i, &ok);
       if (!ok) {
 	continue;
       }
       if (j < 258) {
-	nameToGID->removeInt(macGlyphNames[j]);
-	nameToGID->add(new GString(macGlyphNames[j]), i);
+	nameToGID->add(macGlyphNames[j], i);
       }
     }
   }
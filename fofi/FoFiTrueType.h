@@ -19,7 +19,7 @@
 #include "FoFiBase.h"
 
 class GString;
-class GHash;
+class GStrHash;
 struct TrueTypeTable;
 struct TrueTypeCmap;
 
@@ -204,7 +204,7 @@ private:
   int nGlyphs;
   int locaFmt;
   int bbox[4];
-  GHash *nameToGID;
+  GStrHash *nameToGID;
   GBool openTypeCFF;
   GBool headlessCFF;
   GBool isDfont;
@@ -18,7 +18,7 @@
 #include "gmem.h"
 #include "gmempp.h"
 #include "GString.h"
-#include "GHash.h"
+#include "GStrHash.h"
 #include "FoFiEncodings.h"
 #include "FoFiType1C.h"
 
@@ -179,18 +179,18 @@ GString *FoFiType1C::getGlyphName(int gid) {
   return new GString(buf);
 }
 
-GHash *FoFiType1C::getNameToGIDMap() {
-  GHash *map;
+GStrHash *FoFiType1C::getNameToGIDMap() {
+  GStrHash *map;
   char name[256];
   GBool ok;
   int gid;
 
-  map = new GHash(gTrue);
+  map = new GStrHash(nGlyphs);
   for (gid = 0; gid < nGlyphs; ++gid) {
     ok = gTrue;
     getString(charset[gid], name, &ok);
     if (ok) {
-      map->add(new GString(name), gid);
+      map->add(name, gid);
     }
   }
   return map;
@@ -18,7 +18,7 @@
 #include "gtypes.h"
 #include "FoFiBase.h"
 
-class GHash;
+class GStrHash;
 class GString;
 
 //------------------------------------------------------------------------
@@ -172,7 +172,7 @@ public:
 
   // Returns a hash mapping glyph names to GIDs.  This is only useful
   // with 8-bit fonts.
-  GHash *getNameToGIDMap();
+  GStrHash *getNameToGIDMap();
 
   // Return the mapping from CIDs to GIDs, and return the number of
   // CIDs in *<nCIDs>.  This is only useful for CID fonts.
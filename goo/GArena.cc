@@ -0,0 +1,179 @@
+//========================================================================
+//
+// GArena.cc
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <limits.h>
+#include "gmem.h"
+#include "gmempp.h"
+#if defined(DEBUG_MEM) && MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "GArena.h"
+
+//------------------------------------------------------------------------
+
+struct GArenaChunk {
+  GArenaChunk *next;
+  size_t size;			// size of the data
+  // data follows
+};
+
+#define gArenaChunkData(chunk) ((char *)((chunk) + 1))
+
+// Allocations bigger than this fraction of the chunk size get their
+// own chunk.
+#define gArenaMaxSmallAllocFrac 4
+
+#ifdef DEBUG_MEM
+#if MULTITHREADED
+static GAtomicCounter gArenaTotalAllocs = 0;
+static GAtomicCounter gArenaTotalChunkAllocs = 0;
+#define gArenaCount(counter) gAtomicIncrement(&counter)
+#else
+static long gArenaTotalAllocs = 0;
+static long gArenaTotalChunkAllocs = 0;
+#define gArenaCount(counter) ++counter
+#endif
+#else
+#define gArenaCount(counter)
+#endif
+
+//------------------------------------------------------------------------
+// GArena
+//------------------------------------------------------------------------
+
+GArena::GArena(int chunkSizeA) {
+  chunkSize = chunkSizeA;
+  chunks = NULL;
+  ptr = end = NULL;
+  nAllocs = 0;
+  nChunkAllocs = 0;
+  size = maxSize = 0;
+}
+
+GArena::~GArena() {
+  GArenaChunk *chunk;
+
+  while ((chunk = chunks)) {
+    chunks = chunk->next;
+    gfree(chunk);
+  }
+}
+
+void *GArena::alloc(int sizeA) {
+  void *p;
+  int n;
+
+  if (sizeA < 0) {
+    gMemError("Invalid memory allocation size");
+  }
+  n = (sizeA + 7) & ~7;
+  if (n > end - ptr) {
+    return allocSlow(n);
+  }
+  p = ptr;
+  ptr += n;
+  ++nAllocs;
+  gArenaCount(gArenaTotalAllocs);
+  size += n;
+  if (size > maxSize) {
+    maxSize = size;
+  }
+  return p;
+}
+
+void *GArena::allocn(int nObjs, int objSize) {
+  if (nObjs == 0) {
+    return NULL;
+  }
+  if (objSize <= 0 || nObjs < 0 || nObjs >= INT_MAX / objSize) {
+    gMemError("Bogus memory allocation size");
+  }
+  return alloc(nObjs * objSize);
+}
+
+// Allocate <sizeA> (already rounded) bytes when the current chunk
+// doesn't have enough space.
+void *GArena::allocSlow(int sizeA) {
+  GArenaChunk *chunk;
+
+  if (sizeA > INT_MAX - (int)sizeof(GArenaChunk)) {
+    gMemError("Bogus memory allocation size");
+  }
+  ++nAllocs;
+  ++nChunkAllocs;
+  gArenaCount(gArenaTotalAllocs);
+  gArenaCount(gArenaTotalChunkAllocs);
+  size += sizeA;
+  if (size > maxSize) {
+    maxSize = size;
+  }
+
+  // large allocation: give it its own chunk, and link it in after the
+  // current chunk, so the rest of the current chunk can still be used
+  if (sizeA > chunkSize / gArenaMaxSmallAllocFrac) {
+    chunk = (GArenaChunk *)gmalloc((int)sizeof(GArenaChunk) + sizeA);
+    chunk->size = sizeA;
+    if (chunks) {
+      chunk->next = chunks->next;
+      chunks->next = chunk;
+    } else {
+      chunk->next = NULL;
+      chunks = chunk;
+      ptr = end = gArenaChunkData(chunk) + sizeA;
+    }
+    return gArenaChunkData(chunk);
+  }
+
+  // start a new chunk
+  chunk = (GArenaChunk *)gmalloc((int)sizeof(GArenaChunk) + chunkSize);
+  chunk->size = chunkSize;
+  chunk->next = chunks;
+  chunks = chunk;
+  ptr = gArenaChunkData(chunk) + sizeA;
+  end = gArenaChunkData(chunk) + chunkSize;
+  return gArenaChunkData(chunk);
+}
+
+void GArena::reset() {
+  GArenaChunk *chunk;
+
+  if (!chunks) {
+    return;
+  }
+
+  // keep the last chunk in the list (i.e., the first one allocated),
+  // unless it's a large-allocation chunk
+  while (chunks->next) {
+    chunk = chunks;
+    chunks = chunk->next;
+    gfree(chunk);
+  }
+  if (chunks->size != (size_t)chunkSize) {
+    gfree(chunks);
+    chunks = NULL;
+    ptr = end = NULL;
+  } else {
+    ptr = gArenaChunkData(chunks);
+    end = ptr + chunkSize;
+  }
+  size = 0;
+}
+
+#ifdef DEBUG_MEM
+void gArenaReport(FILE *f) {
+  fprintf(f, "%ld arena allocations in %ld chunk allocations\n",
+	  (long)gArenaTotalAllocs, (long)gArenaTotalChunkAllocs);
+}
+#endif
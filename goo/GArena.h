@@ -0,0 +1,97 @@
+//========================================================================
+//
+// GArena.h
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#ifndef GARENA_H
+#define GARENA_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <stdio.h>
+#include "gtypes.h"
+
+struct GArenaChunk;
+
+//------------------------------------------------------------------------
+// GArena
+//------------------------------------------------------------------------
+
+// A simple region allocator.  Memory is handed out sequentially from
+// large chunks, and is never freed individually -- everything
+// allocated from the arena is freed at once by reset() or by the
+// destructor.  This is intended for large numbers of small objects
+// with a common lifetime (e.g., everything belonging to one page).
+//
+// Arena memory is raw memory (like gmalloc): it's intended for
+// structs and for classes with no destructor; the caller is
+// responsible for initializing it.  Not thread-safe.
+class GArena {
+public:
+
+  // Create an empty arena.  Memory is allocated in chunks of
+  // <chunkSizeA> bytes.
+  GArena(int chunkSizeA = 65536);
+
+  // Destructor - frees all memory allocated from the arena.
+  ~GArena();
+
+  // Allocate <size> bytes, aligned to 8 bytes.
+  void *alloc(int size);
+
+  // Allocate <nObjs> * <objSize> bytes, with the same overflow check
+  // as gmallocn.
+  void *allocn(int nObjs, int objSize);
+
+  // Free everything allocated from the arena.  The first chunk is
+  // kept for reuse, so an arena which is reset once per page doesn't
+  // call malloc at all in the steady state.
+  void reset();
+
+  //----- statistics
+
+  // Number of allocations (since the arena was created).
+  int getNumAllocs() { return nAllocs; }
+
+  // Number of chunk allocations, i.e., calls to gmalloc (since the
+  // arena was created).
+  int getNumChunkAllocs() { return nChunkAllocs; }
+
+  // Number of bytes currently allocated from the arena.
+  size_t getSize() { return size; }
+
+  // Maximum value of getSize() (since the arena was created).
+  size_t getMaxSize() { return maxSize; }
+
+private:
+
+  void *allocSlow(int sizeA);
+
+  int chunkSize;		// normal chunk size
+  GArenaChunk *chunks;		// chunk list (current chunk first)
+  char *ptr;			// next free byte in the current chunk
+  char *end;			// end of the current chunk
+  int nAllocs;
+  int nChunkAllocs;
+  size_t size;
+  size_t maxSize;
+};
+
+#ifdef DEBUG_MEM
+// Report the total number of arena allocations, and the number of
+// chunk allocations they needed.  This goes with gMemReport, where
+// memory allocated from arenas shows up only as chunk allocations.
+extern void gArenaReport(FILE *f);
+#else
+#define gArenaReport(f)
+#endif
+
+#endif
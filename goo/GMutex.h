@@ -98,4 +98,21 @@ static inline GAtomicCounter gAtomicDecrement(GAtomicCounter *counter) {
   return newVal;
 }
 
+// Return the current value of *counter.
+static inline GAtomicCounter gAtomicRead(GAtomicCounter *counter) {
+  GAtomicCounter val;
+
+#if defined(_WIN32)
+  val = _InterlockedCompareExchange(counter, 0, 0);
+#elif defined(__GNUC__) || defined(__xlC__)
+  // __GNUC__ also covers LLVM/clang
+  val = __sync_fetch_and_add(counter, 0);
+#elif defined(__SUNPRO_CC)
+  val = (GAtomicCounter)atomic_add_long_nv((ulong_t *)counter, 0);
+#else
+#  error "gAtomicRead is not defined for this compiler/platform"
+#endif
+  return val;
+}
+
 #endif // GMUTEX_H
@@ -0,0 +1,260 @@
+//========================================================================
+//
+// GStrHash.cc
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#include "GString.h"
+#include "GStrHash.h"
+
+//------------------------------------------------------------------------
+
+// Minimum size of a string block.
+#define gStrHashChunkSize 4096
+
+struct GStrHashEntry {
+  const char *key;		// interned key, or NULL for an empty entry
+  int keyLen;
+  Guint h;			// full hash value of key
+  union {
+    void *p;
+    int i;
+  } val;
+};
+
+struct GStrHashChunk {
+  GStrHashChunk *next;
+  int size;			// size of the string data
+  int used;			// number of bytes used
+  // string data follows
+};
+
+//------------------------------------------------------------------------
+
+GStrHash::GStrHash(int sizeHint) {
+  int i;
+
+  // keep the load factor at or below 1/2
+  size = 8;
+  while (size < 2 * sizeHint && size < 0x40000000) {
+    size <<= 1;
+  }
+  tab = (GStrHashEntry *)gmallocn(size, sizeof(GStrHashEntry));
+  for (i = 0; i < size; ++i) {
+    tab[i].key = NULL;
+  }
+  len = 0;
+  chunks = NULL;
+}
+
+GStrHash::~GStrHash() {
+  GStrHashChunk *chunk;
+
+  while (chunks) {
+    chunk = chunks;
+    chunks = chunk->next;
+    gfree(chunk);
+  }
+  gfree(tab);
+}
+
+void GStrHash::add(const char *key, int keyLen, void *val) {
+  insert(key, keyLen)->val.p = val;
+}
+
+void GStrHash::add(const char *key, int keyLen, int val) {
+  insert(key, keyLen)->val.i = val;
+}
+
+void GStrHash::add(const char *key, void *val) {
+  insert(key, (int)strlen(key))->val.p = val;
+}
+
+void GStrHash::add(const char *key, int val) {
+  insert(key, (int)strlen(key))->val.i = val;
+}
+
+void GStrHash::add(GString *key, void *val) {
+  insert(key->getCString(), key->getLength())->val.p = val;
+}
+
+void GStrHash::add(GString *key, int val) {
+  insert(key->getCString(), key->getLength())->val.i = val;
+}
+
+void *GStrHash::lookup(const char *key) {
+  GStrHashEntry *e;
+  int keyLen;
+
+  keyLen = (int)strlen(key);
+  if (!(e = find(key, keyLen, hash(key, keyLen)))) {
+    return NULL;
+  }
+  return e->val.p;
+}
+
+int GStrHash::lookupInt(const char *key) {
+  GStrHashEntry *e;
+  int keyLen;
+
+  keyLen = (int)strlen(key);
+  if (!(e = find(key, keyLen, hash(key, keyLen)))) {
+    return 0;
+  }
+  return e->val.i;
+}
+
+void *GStrHash::lookup(GString *key) {
+  GStrHashEntry *e;
+
+  if (!(e = find(key->getCString(), key->getLength(),
+		 hash(key->getCString(), key->getLength())))) {
+    return NULL;
+  }
+  return e->val.p;
+}
+
+int GStrHash::lookupInt(GString *key) {
+  GStrHashEntry *e;
+
+  if (!(e = find(key->getCString(), key->getLength(),
+		 hash(key->getCString(), key->getLength())))) {
+    return 0;
+  }
+  return e->val.i;
+}
+
+GBool GStrHash::getNext(int *iter, const char **key, void **val) {
+  while (*iter < size) {
+    if (tab[*iter].key) {
+      *key = tab[*iter].key;
+      *val = tab[*iter].val.p;
+      ++*iter;
+      return gTrue;
+    }
+    ++*iter;
+  }
+  return gFalse;
+}
+
+GBool GStrHash::getNext(int *iter, const char **key, int *val) {
+  while (*iter < size) {
+    if (tab[*iter].key) {
+      *key = tab[*iter].key;
+      *val = tab[*iter].val.i;
+      ++*iter;
+      return gTrue;
+    }
+    ++*iter;
+  }
+  return gFalse;
+}
+
+GStrHashEntry *GStrHash::find(const char *key, int keyLen, Guint h) {
+  GStrHashEntry *e;
+  int i;
+
+  i = (int)(h & (Guint)(size - 1));
+  while ((e = &tab[i])->key) {
+    if (e->h == h && e->keyLen == keyLen && !memcmp(e->key, key, keyLen)) {
+      return e;
+    }
+    i = (i + 1) & (size - 1);
+  }
+  return NULL;
+}
+
+// Find the entry for [key], creating it if necessary.
+GStrHashEntry *GStrHash::insert(const char *key, int keyLen) {
+  GStrHashEntry *e;
+  Guint h;
+  int i;
+
+  h = hash(key, keyLen);
+  if ((e = find(key, keyLen, h))) {
+    return e;
+  }
+  if (len + 1 > size / 2) {
+    expand();
+  }
+  i = (int)(h & (Guint)(size - 1));
+  while (tab[i].key) {
+    i = (i + 1) & (size - 1);
+  }
+  e = &tab[i];
+  e->key = intern(key, keyLen);
+  e->keyLen = keyLen;
+  e->h = h;
+  ++len;
+  return e;
+}
+
+// Copy a key string into the string blocks.  The copy is
+// null-terminated, so it can be returned as a C string by getNext().
+char *GStrHash::intern(const char *key, int keyLen) {
+  GStrHashChunk *chunk;
+  char *s;
+  int n;
+
+  if (!chunks || chunks->size - chunks->used < keyLen + 1) {
+    n = keyLen + 1 > gStrHashChunkSize ? keyLen + 1 : gStrHashChunkSize;
+    chunk = (GStrHashChunk *)gmalloc((int)sizeof(GStrHashChunk) + n);
+    chunk->next = chunks;
+    chunk->size = n;
+    chunk->used = 0;
+    chunks = chunk;
+  }
+  s = (char *)(chunks + 1) + chunks->used;
+  memcpy(s, key, keyLen);
+  s[keyLen] = '\0';
+  chunks->used += keyLen + 1;
+  return s;
+}
+
+void GStrHash::expand() {
+  GStrHashEntry *oldTab;
+  int oldSize, i, j;
+
+  oldSize = size;
+  oldTab = tab;
+  size *= 2;
+  tab = (GStrHashEntry *)gmallocn(size, sizeof(GStrHashEntry));
+  for (i = 0; i < size; ++i) {
+    tab[i].key = NULL;
+  }
+  for (i = 0; i < oldSize; ++i) {
+    if (oldTab[i].key) {
+      j = (int)(oldTab[i].h & (Guint)(size - 1));
+      while (tab[j].key) {
+	j = (j + 1) & (size - 1);
+      }
+      tab[j] = oldTab[i];
+    }
+  }
+  gfree(oldTab);
+}
+
+// FNV-1a hash.
+Guint GStrHash::hash(const char *key, int keyLen) {
+  Guint h;
+  int i;
+
+  h = 2166136261U;
+  for (i = 0; i < keyLen; ++i) {
+    h ^= (Guint)(key[i] & 0xff);
+    h *= 16777619U;
+  }
+  return h;
+}
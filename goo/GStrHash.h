@@ -0,0 +1,95 @@
+//========================================================================
+//
+// GStrHash.h
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#ifndef GSTRHASH_H
+#define GSTRHASH_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+
+class GString;
+struct GStrHashEntry;
+struct GStrHashChunk;
+
+//------------------------------------------------------------------------
+// GStrHash
+//------------------------------------------------------------------------
+
+// A string-keyed hash table using open addressing, intended for
+// lookup-heavy tables (glyph names, resource names).  Unlike GHash,
+// there is no per-entry allocation: key strings are copied (interned)
+// into large string blocks owned by the table, and the entries, which
+// include the full hash value of each key, are stored in one flat
+// array, so a lookup typically touches a single cache line and only
+// compares strings when the full hashes match.
+//
+// Adding an existing key replaces its value.  Entries can't be
+// removed.
+class GStrHash {
+public:
+
+  // [sizeHint] is the expected number of entries.
+  GStrHash(int sizeHint = 0);
+  ~GStrHash();
+
+  void add(const char *key, int keyLen, void *val);
+  void add(const char *key, int keyLen, int val);
+  void add(const char *key, void *val);
+  void add(const char *key, int val);
+  void add(GString *key, void *val);
+  void add(GString *key, int val);
+
+  // Returns NULL (or 0) if [key] isn't in the table.
+  void *lookup(const char *key);
+  int lookupInt(const char *key);
+  void *lookup(GString *key);
+  int lookupInt(GString *key);
+
+  int getLength() { return len; }
+
+  // Iterate over the entries (in no particular order).  [*iter] must
+  // be initialized to 0.
+  GBool getNext(int *iter, const char **key, void **val);
+  GBool getNext(int *iter, const char **key, int *val);
+
+private:
+
+  GStrHashEntry *find(const char *key, int keyLen, Guint h);
+  GStrHashEntry *insert(const char *key, int keyLen);
+  char *intern(const char *key, int keyLen);
+  void expand();
+  static Guint hash(const char *key, int keyLen);
+
+  GStrHashEntry *tab;		// entries (size is a power of 2)
+  int size;			// number of entries in tab
+  int len;			// number of used entries
+  GStrHashChunk *chunks;	// interned key strings
+};
+
+#define deleteGStrHash(hash, T)                        \
+  do {                                                 \
+    GStrHash *_hash = (hash);                          \
+    {                                                  \
+      int _iter;                                       \
+      const char *_key;                                \
+      void *_p;                                        \
+      _iter = 0;                                       \
+      while (_hash->getNext(&_iter, &_key, &_p)) {     \
+        delete (T*)_p;                                 \
+      }                                                \
+      delete _hash;                                    \
+    }                                                  \
+  } while(0)
+
+#endif
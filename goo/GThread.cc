@@ -0,0 +1,117 @@
+//========================================================================
+//
+// GThread.cc
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#include <aconf.h>
+
+#if MULTITHREADED
+#  ifdef _WIN32
+#    include <windows.h>
+#  else
+#    include <pthread.h>
+#  endif
+#endif
+#include "gtypes.h"
+#include "gmem.h"
+#include "gmempp.h"
+#include "GThread.h"
+
+//------------------------------------------------------------------------
+
+#if MULTITHREADED
+
+struct GThreadJob {
+  void (*func)(void *data, int jobIdx);
+  void *data;
+  int jobIdx;
+};
+
+#ifdef _WIN32
+
+static DWORD WINAPI gThreadJobMain(LPVOID arg) {
+  GThreadJob *job = (GThreadJob *)arg;
+  (*job->func)(job->data, job->jobIdx);
+  return 0;
+}
+
+#else
+
+static void *gThreadJobMain(void *arg) {
+  GThreadJob *job = (GThreadJob *)arg;
+  (*job->func)(job->data, job->jobIdx);
+  return NULL;
+}
+
+#endif
+
+void gRunParallel(void (*func)(void *data, int jobIdx),
+		  void *data, int nJobs) {
+  GThreadJob *jobs;
+  GBool *started;
+  int i;
+
+  if (nJobs <= 1) {
+    if (nJobs == 1) {
+      (*func)(data, 0);
+    }
+    return;
+  }
+
+  jobs = (GThreadJob *)gmallocn(nJobs, sizeof(GThreadJob));
+  started = (GBool *)gmallocn(nJobs, sizeof(GBool));
+#ifdef _WIN32
+  HANDLE *threads = (HANDLE *)gmallocn(nJobs, sizeof(HANDLE));
+#else
+  pthread_t *threads = (pthread_t *)gmallocn(nJobs, sizeof(pthread_t));
+#endif
+
+  for (i = 1; i < nJobs; ++i) {
+    jobs[i].func = func;
+    jobs[i].data = data;
+    jobs[i].jobIdx = i;
+#ifdef _WIN32
+    threads[i] = CreateThread(NULL, 0, &gThreadJobMain, &jobs[i], 0, NULL);
+    started[i] = threads[i] != NULL;
+#else
+    started[i] = pthread_create(&threads[i], NULL,
+				&gThreadJobMain, &jobs[i]) == 0;
+#endif
+  }
+
+  (*func)(data, 0);
+
+  for (i = 1; i < nJobs; ++i) {
+    if (started[i]) {
+#ifdef _WIN32
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+#else
+      pthread_join(threads[i], NULL);
+#endif
+    } else {
+      (*func)(data, i);
+    }
+  }
+
+  gfree(threads);
+  gfree(started);
+  gfree(jobs);
+}
+
+#else // MULTITHREADED
+
+void gRunParallel(void (*func)(void *data, int jobIdx),
+		  void *data, int nJobs) {
+  int i;
+
+  for (i = 0; i < nJobs; ++i) {
+    (*func)(data, i);
+  }
+}
+
+#endif // MULTITHREADED
@@ -0,0 +1,25 @@
+//========================================================================
+//
+// GThread.h
+//
+// Run a set of independent jobs in parallel.
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#ifndef GTHREAD_H
+#define GTHREAD_H
+
+#include <aconf.h>
+
+// Call [func](data, i) for i = 0 .. [nJobs]-1, and wait for all of
+// the calls to finish.  Job 0 runs on the calling thread; each of
+// the others runs on its own thread.  If multithreading is disabled
+// (or a thread can't be started), the jobs are run sequentially.
+// The jobs must not depend on each other.
+extern void gRunParallel(void (*func)(void *data, int jobIdx),
+			 void *data, int nJobs);
+
+#endif
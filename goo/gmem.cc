@@ -20,6 +20,9 @@
 #if MULTITHREADED && defined(_WIN32)
 #  include <windows.h>
 #endif
+#ifndef _WIN32
+#  include <sys/resource.h>
+#endif
 #include "gmem.h"
 
 #ifdef DEBUG_MEM
@@ -394,3 +397,21 @@ char *copyString(const char *s) {
   strcpy(s1, s);
   return s1;
 }
+
+size_t gMemPeakUsage() {
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+  // ru_maxrss is in bytes on OS X, and in kilobytes elsewhere
+#  ifdef __APPLE__
+  return (size_t)usage.ru_maxrss;
+#  else
+  return (size_t)usage.ru_maxrss * 1024;
+#  endif
+#endif
+}
@@ -92,4 +92,10 @@ extern void gMemReport(FILE *f);
  */
 extern char *copyString(const char *s);
 
+/*
+ * Return the peak resident memory usage of the process, in bytes, or
+ * 0 if it isn't available on this system.
+ */
+extern size_t gMemPeakUsage();
+
 #endif
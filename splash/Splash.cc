@@ -19,6 +19,8 @@
 #include "gmem.h"
 #include "gmempp.h"
 #include "GString.h"
+#include "GList.h"
+#include "GThread.h"
 #include "SplashErrorCodes.h"
 #include "SplashMath.h"
 #include "SplashBitmap.h"
@@ -32,6 +34,14 @@
 #include "SplashGlyphBitmap.h"
 #include "Splash.h"
 
+#if (defined(__GNUC__) && defined(__SSE2__)) || \
+    (defined(_WIN32) && (_M_IX86_FP == 2 || defined(_M_X64)))
+#  include <emmintrin.h>
+#  define SPLASH_USE_SSE2 1
+#else
+#  define SPLASH_USE_SSE2 0
+#endif
+
 // the MSVC math.h doesn't define this
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -3127,71 +3137,385 @@ inline void Splash::transform(SplashCoord *matrix,
 }
 
 //------------------------------------------------------------------------
-// SplashImageCache
+// SplashImageCacheEntry
 //------------------------------------------------------------------------
 
-SplashImageCache::SplashImageCache() {
-  tag = NULL;
-  width = 0;
-  height = 0;
-  mode = splashModeRGB8;
-  alpha = gFalse;
-  interpolate = gFalse;
+// Max number of entries (including entries without data, which just
+// track use counts) in a SplashImageCache.
+#define splashImageCacheMaxEntries 256
+
+SplashImageCacheEntry::SplashImageCacheEntry(GString *aTag,
+					     int aWidth, int aHeight,
+					     SplashColorMode aMode,
+					     GBool aAlpha,
+					     GBool aInterpolate) {
+  tag = aTag->copy();
+  width = aWidth;
+  height = aHeight;
+  mode = aMode;
+  alpha = aAlpha;
+  interpolate = aInterpolate;
   colorData = NULL;
   alphaData = NULL;
+  size = 0;
+  useCount = 0;
+  filling = gFalse;
+  complete = gFalse;
   refCount = 1;
+  inCache = gTrue;
 }
 
-SplashImageCache::~SplashImageCache() {
-  if (tag) {
-    delete tag;
-  }
+SplashImageCacheEntry::~SplashImageCacheEntry() {
+  delete tag;
   gfree(colorData);
   gfree(alphaData);
 }
 
-GBool SplashImageCache::match(GString *aTag, int aWidth, int aHeight,
-			      SplashColorMode aMode, GBool aAlpha,
-			      GBool aInterpolate) {
-  return aTag && tag && !aTag->cmp(tag) &&
+GBool SplashImageCacheEntry::match(GString *aTag, int aWidth, int aHeight,
+				   SplashColorMode aMode, GBool aAlpha,
+				   GBool aInterpolate) {
+  return !aTag->cmp(tag) &&
 	 aWidth == width && aHeight == height &&
 	 aMode == mode && aAlpha == alpha &&
 	 aInterpolate == interpolate;
 }
 
-void SplashImageCache::reset(GString *aTag, int aWidth, int aHeight,
-			     SplashColorMode aMode, GBool aAlpha,
-			     GBool aInterpolate) {
-  if (tag) {
-    delete tag;
+//------------------------------------------------------------------------
+// SplashImageCache
+//------------------------------------------------------------------------
+
+SplashImageCache::SplashImageCache(size_t maxSizeA) {
+  entries = new GList();
+  size = 0;
+  maxSize = maxSizeA;
+  nHits = nMisses = nEvictions = 0;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+  refCount = 1;
+}
+
+SplashImageCache::~SplashImageCache() {
+  flush();
+  delete entries;
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+void SplashImageCache::lock() {
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+}
+
+void SplashImageCache::unlock() {
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+SplashImageCacheEntry *SplashImageCache::lookup(GString *aTag,
+						int aWidth, int aHeight,
+						SplashColorMode aMode,
+						GBool aAlpha,
+						GBool aInterpolate,
+						GBool *complete) {
+  SplashImageCacheEntry *entry;
+  int i;
+
+  *complete = gFalse;
+  if (!aTag) {
+    return NULL;
+  }
+  lock();
+  entry = NULL;
+  for (i = 0; i < entries->getLength(); ++i) {
+    entry = (SplashImageCacheEntry *)entries->get(i);
+    if (entry->match(aTag, aWidth, aHeight, aMode, aAlpha, aInterpolate)) {
+      if (i > 0) {
+	entries->del(i);
+	entries->insert(0, entry);
+      }
+      break;
+    }
+    entry = NULL;
   }
-  if (aTag) {
-    tag = aTag->copy();
+  if (entry && entry->complete) {
+    ++nHits;
+    *complete = gTrue;
   } else {
-    tag = NULL;
+    ++nMisses;
+  }
+  if (!entry) {
+    entry = new SplashImageCacheEntry(aTag, aWidth, aHeight,
+				      aMode, aAlpha, aInterpolate);
+    entries->insert(0, entry);
+    shrink();
+  }
+  ++entry->useCount;
+  ++entry->refCount;
+  unlock();
+  return entry;
+}
+
+GBool SplashImageCache::startFill(SplashImageCacheEntry *entry, int nComps) {
+  size_t lineSize, entrySize;
+
+  lock();
+  if (entry->complete || entry->filling || !entry->inCache) {
+    unlock();
+    return gFalse;
+  }
+  lineSize = (size_t)entry->width * nComps;
+  entrySize = lineSize * entry->height;
+  if (entry->alpha) {
+    entrySize += (size_t)entry->width * entry->height;
+  }
+  if (entrySize > maxSize) {
+    unlock();
+    return gFalse;
+  }
+  entry->colorData = (Guchar *)gmallocn(entry->height, (int)lineSize);
+  if (entry->alpha) {
+    entry->alphaData = (Guchar *)gmallocn(entry->height, entry->width);
+  }
+  entry->size = entrySize;
+  entry->filling = gTrue;
+  unlock();
+  return gTrue;
+}
+
+void SplashImageCache::finishFill(SplashImageCacheEntry *entry, GBool ok) {
+  lock();
+  entry->filling = gFalse;
+  if (ok) {
+    entry->complete = gTrue;
+    if (entry->inCache) {
+      size += entry->size;
+      shrink();
+    }
+  } else {
+    gfree(entry->colorData);
+    entry->colorData = NULL;
+    gfree(entry->alphaData);
+    entry->alphaData = NULL;
+    entry->size = 0;
+  }
+  unlock();
+}
+
+void SplashImageCache::releaseEntry(SplashImageCacheEntry *entry) {
+  lock();
+  if (--entry->refCount == 0) {
+    delete entry;
+  }
+  unlock();
+}
+
+void SplashImageCache::flush() {
+  lock();
+  while (entries->getLength() > 0) {
+    removeEntry(entries->getLength() - 1);
+  }
+  unlock();
+}
+
+// Remove an entry from the cache list, and drop the cache's reference
+// to it.  The caller must have locked the mutex.
+void SplashImageCache::removeEntry(int idx) {
+  SplashImageCacheEntry *entry;
+
+  entry = (SplashImageCacheEntry *)entries->del(idx);
+  entry->inCache = gFalse;
+  if (entry->complete) {
+    size -= entry->size;
+  }
+  if (--entry->refCount == 0) {
+    delete entry;
+  }
+}
+
+// Remove least recently used entries until the cache is under the
+// size and entry limits.  The caller must have locked the mutex.
+void SplashImageCache::shrink() {
+  SplashImageCacheEntry *entry;
+
+  while (entries->getLength() > 1 &&
+	 (size > maxSize ||
+	  entries->getLength() > splashImageCacheMaxEntries)) {
+    entry = (SplashImageCacheEntry *)entries->get(entries->getLength() - 1);
+    if (entry->complete) {
+      ++nEvictions;
+    }
+    removeEntry(entries->getLength() - 1);
   }
-  width = aWidth;
-  height = aHeight;
-  mode = aMode;
-  alpha = aAlpha;
-  interpolate = aInterpolate; 
-  gfree(colorData);
-  colorData = NULL;
-  gfree(alphaData);
-  alphaData = NULL;
 }
 
 void SplashImageCache::incRefCount() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCount);
+#else
   ++refCount;
+#endif
 }
 
 void SplashImageCache::decRefCount() {
-  --refCount;
-  if (refCount == 0) {
+  GBool done;
+
+#if MULTITHREADED
+  done = gAtomicDecrement(&refCount) == 0;
+#else
+  done = --refCount == 0;
+#endif
+  if (done) {
     delete this;
   }
 }
 
+//------------------------------------------------------------------------
+// image scaling kernels
+//------------------------------------------------------------------------
+
+// Images with at least this many source pixels are scaled using
+// multiple threads (if enabled).
+#define splashImageScalingMinThreadedPixels (1024 * 1024)
+
+// Max size (in bytes) of the source rows read in one band by the
+// threaded image scalers.
+#define splashImageScalingBandSize (16 * 1024 * 1024)
+
+// Add a row of [n] bytes to an accumulator row.
+static inline void splashAccumulateRow(Guint *acc, Guchar *row, int n) {
+  int i = 0;
+#if SPLASH_USE_SSE2
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i b = _mm_loadu_si128((const __m128i *)(row + i));
+    __m128i lo = _mm_unpacklo_epi8(b, zero);
+    __m128i hi = _mm_unpackhi_epi8(b, zero);
+    __m128i *a = (__m128i *)(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a),
+				      _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1),
+					  _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2),
+					  _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3),
+					  _mm_unpackhi_epi16(hi, zero)));
+  }
+#endif
+  for (; i < n; ++i) {
+    acc[i] += row[i];
+  }
+}
+
+// Box-filter a row of [srcWidth] accumulated pixels, with [nComps]
+// components each, down to [scaledWidth] pixels.  Each scaled pixel
+// covers xp or xp+1 source pixels (Bresenham-style, as driven by
+// [xq]), and [yStep] source rows.
+static void splashBoxFilterRow(Guint *acc, int nComps,
+			       int scaledWidth, int xp, int xq, int yStep,
+			       Guchar *out) {
+  int xt = 0;
+  switch (nComps) {
+  case 1:
+    for (int scaledIdx = 0; scaledIdx < scaledWidth; ++scaledIdx) {
+      int xStep = xp;
+      xt += xq;
+      if (xt >= scaledWidth) {
+	xt -= scaledWidth;
+	++xStep;
+      }
+      int a0 = 0;
+      for (int i = 0; i < xStep; ++i) {
+	a0 += acc[i];
+      }
+      acc += xStep;
+      *out++ = (Guchar)(a0 / (yStep * xStep));
+    }
+    break;
+  case 3:
+    for (int scaledIdx = 0; scaledIdx < scaledWidth; ++scaledIdx) {
+      int xStep = xp;
+      xt += xq;
+      if (xt >= scaledWidth) {
+	xt -= scaledWidth;
+	++xStep;
+      }
+      int a0 = 0, a1 = 0, a2 = 0;
+      for (int i = 0; i < xStep; ++i) {
+	a0 += acc[0];
+	a1 += acc[1];
+	a2 += acc[2];
+	acc += 3;
+      }
+      int nPixels = yStep * xStep;
+      out[0] = (Guchar)(a0 / nPixels);
+      out[1] = (Guchar)(a1 / nPixels);
+      out[2] = (Guchar)(a2 / nPixels);
+      out += 3;
+    }
+    break;
+  case 4:
+    for (int scaledIdx = 0; scaledIdx < scaledWidth; ++scaledIdx) {
+      int xStep = xp;
+      xt += xq;
+      if (xt >= scaledWidth) {
+	xt -= scaledWidth;
+	++xStep;
+      }
+      int a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+      for (int i = 0; i < xStep; ++i) {
+	a0 += acc[0];
+	a1 += acc[1];
+	a2 += acc[2];
+	a3 += acc[3];
+	acc += 4;
+      }
+      int nPixels = yStep * xStep;
+      out[0] = (Guchar)(a0 / nPixels);
+      out[1] = (Guchar)(a1 / nPixels);
+      out[2] = (Guchar)(a2 / nPixels);
+      out[3] = (Guchar)(a3 / nPixels);
+      out += 4;
+    }
+    break;
+  default: {
+    int colorAcc[splashMaxColorComps];
+    for (int scaledIdx = 0; scaledIdx < scaledWidth; ++scaledIdx) {
+      int xStep = xp;
+      xt += xq;
+      if (xt >= scaledWidth) {
+	xt -= scaledWidth;
+	++xStep;
+      }
+      for (int j = 0; j < nComps; ++j) {
+	colorAcc[j] = 0;
+      }
+      for (int i = 0; i < xStep; ++i) {
+	for (int j = 0; j < nComps; ++j) {
+	  colorAcc[j] += acc[j];
+	}
+	acc += nComps;
+      }
+      int nPixels = yStep * xStep;
+      for (int j = 0; j < nComps; ++j) {
+	out[j] = (Guchar)(colorAcc[j] / nPixels);
+      }
+      out += nComps;
+    }
+    break;
+  }
+  }
+}
+
+// Split [n] items into [nJobs] contiguous ranges, and return the
+// first item of range [jobIdx] (or [n], if [jobIdx] == [nJobs]).
+static inline int splashJobStart(int n, int nJobs, int jobIdx) {
+  return (int)(((long long)n * jobIdx) / nJobs);
+}
+
 //------------------------------------------------------------------------
 // ImageScaler
 //------------------------------------------------------------------------
@@ -3221,9 +3545,12 @@ public:
 class BasicImageScaler: public ImageScaler {
 public:
 
+  // If [aNThreads] is greater than one, large images are scaled
+  // using up to that many threads.
   BasicImageScaler(SplashImageSource aSrc, void *aSrcData,
 		   int aSrcWidth, int aSrcHeight, int aNComps, GBool aHasAlpha,
-		   int aScaledWidth, int aScaledHeight, GBool aInterpolate);
+		   int aScaledWidth, int aScaledHeight, GBool aInterpolate,
+		   int aNThreads = 1);
   virtual ~BasicImageScaler();
   virtual void nextLine();
   virtual Guchar *colorData() { return colorLine; }
@@ -3232,12 +3559,15 @@ public:
 protected:
 
   void vertDownscaleHorizDownscale();
+  void vertDownscaleHorizDownscaleThreaded();
   void vertDownscaleHorizUpscaleNoInterp();
   void vertDownscaleHorizUpscaleInterp();
   void vertUpscaleHorizDownscaleNoInterp();
   void vertUpscaleHorizDownscaleInterp();
   void vertUpscaleHorizUpscaleNoInterp();
   void vertUpscaleHorizUpscaleInterp();
+  void readBand();
+  static void scaleBandJob(void *data, int jobIdx);
 
   // source image data function
   SplashImageSource src;
@@ -3278,6 +3608,19 @@ protected:
   Guint *colorAccBuf;
   Guint *alphaAccBuf;
 
+  // state for threaded scaling: source rows for the current band, and
+  // the scaled rows computed from them
+  int nThreads;
+  int bandMaxSrcRows;		// max number of source rows in a band
+  int bandNRows;		// number of scaled rows in the current band
+  int bandNextRow;		// next scaled row to be returned
+  int *bandYStep;		// number of source rows for each scaled row
+  int *bandSrcRow;		// first source row for each scaled row
+  Guchar *bandColorSrc;
+  Guchar *bandAlphaSrc;
+  Guchar *bandColorOut;
+  Guchar *bandAlphaOut;
+
   // output of horizontal scaling
   Guchar *colorLine;
   Guchar *alphaLine;
@@ -3287,7 +3630,7 @@ BasicImageScaler::BasicImageScaler(SplashImageSource aSrc, void *aSrcData,
 				   int aSrcWidth, int aSrcHeight,
 				   int aNComps, GBool aHasAlpha,
 				   int aScaledWidth, int aScaledHeight,
-				   GBool aInterpolate) {
+				   GBool aInterpolate, int aNThreads) {
   colorTmpBuf0 = NULL;
   colorTmpBuf1 = NULL;
   colorTmpBuf2 = NULL;
@@ -3296,6 +3639,13 @@ BasicImageScaler::BasicImageScaler(SplashImageSource aSrc, void *aSrcData,
   alphaTmpBuf2 = NULL;
   colorAccBuf = NULL;
   alphaAccBuf = NULL;
+  nThreads = 1;
+  bandYStep = NULL;
+  bandSrcRow = NULL;
+  bandColorSrc = NULL;
+  bandAlphaSrc = NULL;
+  bandColorOut = NULL;
+  bandAlphaOut = NULL;
   colorLine = NULL;
   alphaLine = NULL;
 
@@ -3314,16 +3664,52 @@ BasicImageScaler::BasicImageScaler(SplashImageSource aSrc, void *aSrcData,
     yp = srcHeight / scaledHeight;
     yq = srcHeight % scaledHeight;
     yt = 0;
-    colorTmpBuf0 = (Guchar *)gmallocn(srcWidth, nComps);
-    colorAccBuf = (Guint *)gmallocn(srcWidth, nComps * (int)sizeof(Guint));
-    if (hasAlpha) {
-      alphaTmpBuf0 = (Guchar *)gmalloc(srcWidth);
-      alphaAccBuf = (Guint *)gmallocn(srcWidth, sizeof(Guint));
-    }
-    if (scaledWidth <= srcWidth) {
-      scalingFunc = &BasicImageScaler::vertDownscaleHorizDownscale;
+    if (scaledWidth <= srcWidth &&
+	aNThreads > 1 && scaledHeight > 1 &&
+	(double)srcWidth * (double)srcHeight
+	  >= splashImageScalingMinThreadedPixels) {
+      // the source rows for each band are read serially (the image
+      // source isn't thread-safe), and then the scaled rows are split
+      // among the threads -- each thread uses its own accumulator
+      nThreads = aNThreads < scaledHeight ? aNThreads : scaledHeight;
+      size_t srcRowSize = (size_t)srcWidth * (nComps + (hasAlpha ? 1 : 0));
+      bandMaxSrcRows = (int)(splashImageScalingBandSize / srcRowSize);
+      if (bandMaxSrcRows < yp + 1) {
+	bandMaxSrcRows = yp + 1;
+      }
+      int bandMaxRows = bandMaxSrcRows / yp;
+      if (bandMaxRows > scaledHeight) {
+	bandMaxRows = scaledHeight;
+      }
+      yScaledCur = 0;
+      bandNRows = 0;
+      bandNextRow = 0;
+      bandYStep = (int *)gmallocn(bandMaxRows, sizeof(int));
+      bandSrcRow = (int *)gmallocn(bandMaxRows, sizeof(int));
+      bandColorSrc = (Guchar *)gmallocn64(bandMaxSrcRows,
+					 (size_t)srcWidth * nComps);
+      bandColorOut = (Guchar *)gmallocn64(bandMaxRows,
+					 (size_t)scaledWidth * nComps);
+      colorAccBuf = (Guint *)gmallocn64(nThreads, (size_t)srcWidth * nComps
+						    * sizeof(Guint));
+      if (hasAlpha) {
+	bandAlphaSrc = (Guchar *)gmallocn64(bandMaxSrcRows, srcWidth);
+	bandAlphaOut = (Guchar *)gmallocn64(bandMaxRows, scaledWidth);
+	alphaAccBuf = (Guint *)gmallocn64(nThreads,
+					  (size_t)srcWidth * sizeof(Guint));
+      }
+      scalingFunc = &BasicImageScaler::vertDownscaleHorizDownscaleThreaded;
     } else {
-      if (aInterpolate) {
+      colorTmpBuf0 = (Guchar *)gmallocn(srcWidth, nComps);
+      colorAccBuf = (Guint *)gmallocn(srcWidth,
+				      nComps * (int)sizeof(Guint));
+      if (hasAlpha) {
+	alphaTmpBuf0 = (Guchar *)gmalloc(srcWidth);
+	alphaAccBuf = (Guint *)gmallocn(srcWidth, sizeof(Guint));
+      }
+      if (scaledWidth <= srcWidth) {
+	scalingFunc = &BasicImageScaler::vertDownscaleHorizDownscale;
+      } else if (aInterpolate) {
 	scalingFunc = &BasicImageScaler::vertDownscaleHorizUpscaleInterp;
       } else {
 	scalingFunc = &BasicImageScaler::vertDownscaleHorizUpscaleNoInterp;
@@ -3391,6 +3777,12 @@ BasicImageScaler::~BasicImageScaler() {
   gfree(alphaTmpBuf2);
   gfree(colorAccBuf);
   gfree(alphaAccBuf);
+  gfree(bandYStep);
+  gfree(bandSrcRow);
+  gfree(bandColorSrc);
+  gfree(bandAlphaSrc);
+  gfree(bandColorOut);
+  gfree(bandAlphaOut);
   gfree(colorLine);
   gfree(alphaLine);
 }
@@ -3414,53 +3806,104 @@ void BasicImageScaler::vertDownscaleHorizDownscale() {
   int nRowComps = srcWidth * nComps;
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, colorTmpBuf0, alphaTmpBuf0);
-    for (int j = 0; j < nRowComps; ++j) {
-      colorAccBuf[j] += colorTmpBuf0[j];
-    }
+    splashAccumulateRow(colorAccBuf, colorTmpBuf0, nRowComps);
     if (hasAlpha) {
-      for (int j = 0; j < srcWidth; ++j) {
-	alphaAccBuf[j] += alphaTmpBuf0[j];
-      }
+      splashAccumulateRow(alphaAccBuf, alphaTmpBuf0, srcWidth);
     }
   }
 
   //--- horiz downscale
-  int colorAcc[splashMaxColorComps];
-  int xt = 0;
-  int unscaledColorIdx = 0;
-  int unscaledAlphaIdx = 0;
-  int scaledColorIdx = 0;
+  splashBoxFilterRow(colorAccBuf, nComps, scaledWidth, xp, xq, yStep,
+		     colorLine);
+  if (hasAlpha) {
+    splashBoxFilterRow(alphaAccBuf, 1, scaledWidth, xp, xq, yStep,
+		       alphaLine);
+  }
+}
 
-  for (int scaledIdx = 0; scaledIdx < scaledWidth; ++scaledIdx) {
-    int xStep = xp;
-    xt += xq;
-    if (xt >= scaledWidth) {
-      xt -= scaledWidth;
-      ++xStep;
-    }
+void BasicImageScaler::vertDownscaleHorizDownscaleThreaded() {
+  if (bandNextRow >= bandNRows) {
+    readBand();
+    gRunParallel(&BasicImageScaler::scaleBandJob, this,
+		 nThreads < bandNRows ? nThreads : bandNRows);
+    bandNextRow = 0;
+  }
+  memcpy(colorLine,
+	 bandColorOut + (size_t)bandNextRow * scaledWidth * nComps,
+	 scaledWidth * nComps);
+  if (hasAlpha) {
+    memcpy(alphaLine, bandAlphaOut + (size_t)bandNextRow * scaledWidth,
+	   scaledWidth);
+  }
+  ++bandNextRow;
+}
 
-    for (int j = 0; j < nComps; ++j) {
-      colorAcc[j] = 0;
+// Read the source rows for the next band of scaled rows.
+void BasicImageScaler::readBand() {
+  int nSrcRows = 0;
+  bandNRows = 0;
+  while (yScaledCur < scaledHeight) {
+    int yStep = yp;
+    int ytNext = yt + yq;
+    if (ytNext >= scaledHeight) {
+      ytNext -= scaledHeight;
+      ++yStep;
     }
-    for (int i = 0; i < xStep; ++i) {
-      for (int j = 0; j < nComps; ++j) {
-	colorAcc[j] += colorAccBuf[unscaledColorIdx + j];
-      }
-      unscaledColorIdx += nComps;
+    if (nSrcRows + yStep > bandMaxSrcRows) {
+      break;
     }
-    int nPixels = yStep * xStep;
-    for (int j = 0; j < nComps; ++j) {
-      colorLine[scaledColorIdx + j] = (Guchar)(colorAcc[j] / nPixels);
-    }
-    scaledColorIdx += nComps;
-
-    if (hasAlpha) {
-      int alphaAcc = 0;
-      for (int i = 0; i < xStep; ++i) {
-	alphaAcc += alphaAccBuf[unscaledAlphaIdx];
-	++unscaledAlphaIdx;
-      }
-      alphaLine[scaledIdx] = (Guchar)(alphaAcc / nPixels);
+    yt = ytNext;
+    bandYStep[bandNRows] = yStep;
+    bandSrcRow[bandNRows] = nSrcRows;
+    nSrcRows += yStep;
+    ++bandNRows;
+    ++yScaledCur;
+  }
+  for (int i = 0; i < nSrcRows; ++i) {
+    (*src)(srcData, bandColorSrc + (size_t)i * srcWidth * nComps,
+	   hasAlpha ? bandAlphaSrc + (size_t)i * srcWidth : (Guchar *)NULL);
+  }
+}
+
+// Compute one thread's share of the scaled rows in the current band.
+void BasicImageScaler::scaleBandJob(void *data, int jobIdx) {
+  BasicImageScaler *scaler = (BasicImageScaler *)data;
+  int nJobs = scaler->nThreads < scaler->bandNRows ? scaler->nThreads
+                                                   : scaler->bandNRows;
+  int nRowComps = scaler->srcWidth * scaler->nComps;
+  Guint *colorAcc = scaler->colorAccBuf + (size_t)jobIdx * nRowComps;
+  Guint *alphaAcc = NULL;
+  if (scaler->hasAlpha) {
+    alphaAcc = scaler->alphaAccBuf + (size_t)jobIdx * scaler->srcWidth;
+  }
+  int row0 = splashJobStart(scaler->bandNRows, nJobs, jobIdx);
+  int row1 = splashJobStart(scaler->bandNRows, nJobs, jobIdx + 1);
+  for (int row = row0; row < row1; ++row) {
+    int yStep = scaler->bandYStep[row];
+    int srcRow = scaler->bandSrcRow[row];
+    memset(colorAcc, 0, nRowComps * sizeof(Guint));
+    for (int i = 0; i < yStep; ++i) {
+      splashAccumulateRow(colorAcc,
+			  scaler->bandColorSrc
+			    + (size_t)(srcRow + i) * nRowComps,
+			  nRowComps);
+    }
+    splashBoxFilterRow(colorAcc, scaler->nComps, scaler->scaledWidth,
+		       scaler->xp, scaler->xq, yStep,
+		       scaler->bandColorOut
+		         + (size_t)row * scaler->scaledWidth * scaler->nComps);
+    if (alphaAcc) {
+      memset(alphaAcc, 0, scaler->srcWidth * sizeof(Guint));
+      for (int i = 0; i < yStep; ++i) {
+	splashAccumulateRow(alphaAcc,
+			    scaler->bandAlphaSrc
+			      + (size_t)(srcRow + i) * scaler->srcWidth,
+			    scaler->srcWidth);
+      }
+      splashBoxFilterRow(alphaAcc, 1, scaler->scaledWidth,
+			 scaler->xp, scaler->xq, yStep,
+			 scaler->bandAlphaOut
+			   + (size_t)row * scaler->scaledWidth);
     }
   }
 }
@@ -3480,13 +3923,9 @@ void BasicImageScaler::vertDownscaleHorizUpscaleNoInterp() {
   int nRowComps = srcWidth * nComps;
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, colorTmpBuf0, alphaTmpBuf0);
-    for (int j = 0; j < nRowComps; ++j) {
-      colorAccBuf[j] += colorTmpBuf0[j];
-    }
+    splashAccumulateRow(colorAccBuf, colorTmpBuf0, nRowComps);
     if (hasAlpha) {
-      for (int j = 0; j < srcWidth; ++j) {
-	alphaAccBuf[j] += alphaTmpBuf0[j];
-      }
+      splashAccumulateRow(alphaAccBuf, alphaTmpBuf0, srcWidth);
     }
   }
 
@@ -3538,13 +3977,9 @@ void BasicImageScaler::vertDownscaleHorizUpscaleInterp() {
   int nRowComps = srcWidth * nComps;
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, colorTmpBuf0, alphaTmpBuf0);
-    for (int j = 0; j < nRowComps; ++j) {
-      colorAccBuf[j] += colorTmpBuf0[j];
-    }
+    splashAccumulateRow(colorAccBuf, colorTmpBuf0, nRowComps);
     if (hasAlpha) {
-      for (int j = 0; j < srcWidth; ++j) {
-	alphaAccBuf[j] += alphaTmpBuf0[j];
-      }
+      splashAccumulateRow(alphaAccBuf, alphaTmpBuf0, srcWidth);
     }
   }
   for (int j = 0; j < srcWidth * nComps; ++j) {
@@ -3839,34 +4274,50 @@ void BasicImageScaler::vertUpscaleHorizUpscaleInterp() {
 // SavingImageScaler
 //------------------------------------------------------------------------
 
-// Wrapper around BasicImageScaler that saves the scaled image for use
-// by ReplayImageScaler.
+// Wrapper around BasicImageScaler that saves the scaled image in a
+// SplashImageCache entry, for use by ReplayImageScaler.
 class SavingImageScaler: public BasicImageScaler {
 public:
 
   SavingImageScaler(SplashImageSource aSrc, void *aSrcData,
 		    int aSrcWidth, int aSrcHeight, int aNComps, GBool aHasAlpha,
 		    int aScaledWidth, int aScaledHeight, GBool aInterpolate,
-		    Guchar *aColorCache, Guchar *aAlphaCache);
+		    int aNThreads,
+		    SplashImageCache *aImageCache,
+		    SplashImageCacheEntry *aCacheEntry);
+  virtual ~SavingImageScaler();
   virtual void nextLine();
 
 private:
 
+  SplashImageCache *imageCache;
+  SplashImageCacheEntry *cacheEntry;
   Guchar *colorPtr;
   Guchar *alphaPtr;
+  int nLines;
 };
 
 SavingImageScaler::SavingImageScaler(SplashImageSource aSrc, void *aSrcData,
 				     int aSrcWidth, int aSrcHeight,
 				     int aNComps, GBool aHasAlpha,
 				     int aScaledWidth, int aScaledHeight,
-				     GBool aInterpolate,
-				     Guchar *aColorCache, Guchar *aAlphaCache):
+				     GBool aInterpolate, int aNThreads,
+				     SplashImageCache *aImageCache,
+				     SplashImageCacheEntry *aCacheEntry):
   BasicImageScaler(aSrc, aSrcData, aSrcWidth, aSrcHeight, aNComps, aHasAlpha,
-		   aScaledWidth, aScaledHeight, aInterpolate)
+		   aScaledWidth, aScaledHeight, aInterpolate, aNThreads)
 {
-  colorPtr = aColorCache;
-  alphaPtr = aAlphaCache;
+  imageCache = aImageCache;
+  cacheEntry = aCacheEntry;
+  colorPtr = cacheEntry->colorData;
+  alphaPtr = cacheEntry->alphaData;
+  nLines = 0;
+}
+
+SavingImageScaler::~SavingImageScaler() {
+  // the saved image is only usable if the caller read all of the lines
+  imageCache->finishFill(cacheEntry, nLines == scaledHeight);
+  imageCache->releaseEntry(cacheEntry);
 }
 
 void SavingImageScaler::nextLine() {
@@ -3877,6 +4328,7 @@ void SavingImageScaler::nextLine() {
     memcpy(alphaPtr, alphaData(), scaledWidth);
     alphaPtr += scaledWidth;
   }
+  ++nLines;
 }
 
 //------------------------------------------------------------------------
@@ -3889,7 +4341,9 @@ public:
 
   ReplayImageScaler(int aNComps, GBool aHasAlpha,
 		    int aScaledWidth,
-		    Guchar *aColorCache, Guchar *aAlphaCache);
+		    SplashImageCache *aImageCache,
+		    SplashImageCacheEntry *aCacheEntry);
+  virtual ~ReplayImageScaler();
   virtual void nextLine();
   virtual Guchar *colorData() { return colorLine; }
   virtual Guchar *alphaData() { return alphaLine; }
@@ -3899,6 +4353,8 @@ private:
   int nComps;
   GBool hasAlpha;
   int scaledWidth;
+  SplashImageCache *imageCache;
+  SplashImageCacheEntry *cacheEntry;
   Guchar *colorPtr;
   Guchar *alphaPtr;
   Guchar *colorLine;
@@ -3907,16 +4363,23 @@ private:
 
 ReplayImageScaler::ReplayImageScaler(int aNComps, GBool aHasAlpha,
 				     int aScaledWidth,
-				     Guchar *aColorCache, Guchar *aAlphaCache) {
+				     SplashImageCache *aImageCache,
+				     SplashImageCacheEntry *aCacheEntry) {
   nComps = aNComps;
   hasAlpha = aHasAlpha;
   scaledWidth = aScaledWidth;
-  colorPtr = aColorCache;
-  alphaPtr = aAlphaCache;
+  imageCache = aImageCache;
+  cacheEntry = aCacheEntry;
+  colorPtr = cacheEntry->colorData;
+  alphaPtr = cacheEntry->alphaData;
   colorLine = NULL;
   alphaLine = NULL;
 }
 
+ReplayImageScaler::~ReplayImageScaler() {
+  imageCache->releaseEntry(cacheEntry);
+}
+
 void ReplayImageScaler::nextLine() {
   colorLine = colorPtr;
   alphaLine = alphaPtr;
@@ -3936,11 +4399,13 @@ public:
   // Set up a MaskScaler to scale from [srcWidth]x[srcHeight] to
   // [scaledWidth]x[scaledHeight].  The [interpolate] flag controls
   // filtering on upsampling, and the [antialias] flag controls
-  // filtering on downsampling.
+  // filtering on downsampling.  If [aNThreads] is greater than one,
+  // large masks are scaled using up to that many threads.
   ImageMaskScaler(SplashImageMaskSource aSrc, void *aSrcData,
 		  int aSrcWidth, int aSrcHeight,
 		  int aScaledWidth, int aScaledHeight,
-		  GBool aInterpolate, GBool aAntialias);
+		  GBool aInterpolate, GBool aAntialias,
+		  int aNThreads = 1);
 
   ~ImageMaskScaler();
 
@@ -3956,6 +4421,7 @@ private:
 
   void vertDownscaleHorizDownscale();
   void vertDownscaleHorizDownscaleThresh();
+  void vertDownscaleHorizDownscaleThreaded();
   void vertDownscaleHorizUpscaleNoInterp();
   void vertDownscaleHorizUpscaleInterp();
   void vertDownscaleHorizUpscaleThresh();
@@ -3964,6 +4430,8 @@ private:
   void vertUpscaleHorizDownscaleThresh();
   void vertUpscaleHorizUpscaleNoInterp();
   void vertUpscaleHorizUpscaleInterp();
+  void readBand();
+  static void scaleBandJob(void *data, int jobIdx);
 
   // source image data function
   SplashImageMaskSource src;
@@ -3996,6 +4464,17 @@ private:
   Guchar *tmpBuf2;
   Guint *accBuf;
 
+  // state for threaded scaling (see BasicImageScaler)
+  int nThreads;
+  GBool thresh;
+  int bandMaxSrcRows;
+  int bandNRows;
+  int bandNextRow;
+  int *bandYStep;
+  int *bandSrcRow;
+  Guchar *bandSrc;
+  Guchar *bandOut;
+
   // output of horizontal scaling
   Guchar *line;
 };
@@ -4003,11 +4482,17 @@ private:
 ImageMaskScaler::ImageMaskScaler(SplashImageMaskSource aSrc, void *aSrcData,
 				 int aSrcWidth, int aSrcHeight,
 				 int aScaledWidth, int aScaledHeight,
-				 GBool aInterpolate, GBool aAntialias) {
+				 GBool aInterpolate, GBool aAntialias,
+				 int aNThreads) {
   tmpBuf0 = NULL;
   tmpBuf1 = NULL;
   tmpBuf2 = NULL;
   accBuf = NULL;
+  nThreads = 1;
+  bandYStep = NULL;
+  bandSrcRow = NULL;
+  bandSrc = NULL;
+  bandOut = NULL;
   line = NULL;
 
   src = aSrc;
@@ -4023,15 +4508,41 @@ ImageMaskScaler::ImageMaskScaler(SplashImageMaskSource aSrc, void *aSrcData,
     yp = srcHeight / scaledHeight;
     yq = srcHeight % scaledHeight;
     yt = 0;
-    tmpBuf0 = (Guchar *)gmalloc(srcWidth);
-    accBuf = (Guint *)gmallocn(srcWidth, sizeof(Guint));
-    if (scaledWidth <= srcWidth) {
+    if (scaledWidth <= srcWidth &&
+	aNThreads > 1 && scaledHeight > 1 &&
+	(double)srcWidth * (double)srcHeight
+	  >= splashImageScalingMinThreadedPixels) {
+      nThreads = aNThreads < scaledHeight ? aNThreads : scaledHeight;
+      thresh = !aAntialias;
+      bandMaxSrcRows = splashImageScalingBandSize / srcWidth;
+      if (bandMaxSrcRows < yp + 1) {
+	bandMaxSrcRows = yp + 1;
+      }
+      int bandMaxRows = bandMaxSrcRows / yp;
+      if (bandMaxRows > scaledHeight) {
+	bandMaxRows = scaledHeight;
+      }
+      yScaledCur = 0;
+      bandNRows = 0;
+      bandNextRow = 0;
+      bandYStep = (int *)gmallocn(bandMaxRows, sizeof(int));
+      bandSrcRow = (int *)gmallocn(bandMaxRows, sizeof(int));
+      bandSrc = (Guchar *)gmallocn64(bandMaxSrcRows, srcWidth);
+      bandOut = (Guchar *)gmallocn64(bandMaxRows, scaledWidth);
+      accBuf = (Guint *)gmallocn64(nThreads,
+				   (size_t)srcWidth * sizeof(Guint));
+      scalingFunc = &ImageMaskScaler::vertDownscaleHorizDownscaleThreaded;
+    } else if (scaledWidth <= srcWidth) {
+      tmpBuf0 = (Guchar *)gmalloc(srcWidth);
+      accBuf = (Guint *)gmallocn(srcWidth, sizeof(Guint));
       if (!aAntialias) {
 	scalingFunc = &ImageMaskScaler::vertDownscaleHorizDownscaleThresh;
       } else {
 	scalingFunc = &ImageMaskScaler::vertDownscaleHorizDownscale;
       }
     } else {
+      tmpBuf0 = (Guchar *)gmalloc(srcWidth);
+      accBuf = (Guint *)gmallocn(srcWidth, sizeof(Guint));
       if (!aAntialias) {
 	scalingFunc = &ImageMaskScaler::vertDownscaleHorizUpscaleThresh;
       } else if (aInterpolate) {
@@ -4092,6 +4603,10 @@ ImageMaskScaler::~ImageMaskScaler() {
   gfree(tmpBuf1);
   gfree(tmpBuf2);
   gfree(accBuf);
+  gfree(bandYStep);
+  gfree(bandSrcRow);
+  gfree(bandSrc);
+  gfree(bandOut);
   gfree(line);
 }
 
@@ -4110,9 +4625,7 @@ void ImageMaskScaler::vertDownscaleHorizDownscale() {
   memset(accBuf, 0, srcWidth * sizeof(Guint));
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, tmpBuf0);
-    for (int j = 0; j < srcWidth; ++j) {
-      accBuf[j] += tmpBuf0[j];
-    }
+    splashAccumulateRow(accBuf, tmpBuf0, srcWidth);
   }
 
   //--- horiz downscale
@@ -4147,9 +4660,7 @@ void ImageMaskScaler::vertDownscaleHorizDownscaleThresh() {
   memset(accBuf, 0, srcWidth * sizeof(Guint));
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, tmpBuf0);
-    for (int j = 0; j < srcWidth; ++j) {
-      accBuf[j] += tmpBuf0[j];
-    }
+    splashAccumulateRow(accBuf, tmpBuf0, srcWidth);
   }
 
   //--- horiz downscale
@@ -4173,6 +4684,86 @@ void ImageMaskScaler::vertDownscaleHorizDownscaleThresh() {
   }
 }
 
+void ImageMaskScaler::vertDownscaleHorizDownscaleThreaded() {
+  if (bandNextRow >= bandNRows) {
+    readBand();
+    gRunParallel(&ImageMaskScaler::scaleBandJob, this,
+		 nThreads < bandNRows ? nThreads : bandNRows);
+    bandNextRow = 0;
+  }
+  memcpy(line, bandOut + (size_t)bandNextRow * scaledWidth, scaledWidth);
+  ++bandNextRow;
+}
+
+// Read the source rows for the next band of scaled rows.
+void ImageMaskScaler::readBand() {
+  int nSrcRows = 0;
+  bandNRows = 0;
+  while (yScaledCur < scaledHeight) {
+    int yStep = yp;
+    int ytNext = yt + yq;
+    if (ytNext >= scaledHeight) {
+      ytNext -= scaledHeight;
+      ++yStep;
+    }
+    if (nSrcRows + yStep > bandMaxSrcRows) {
+      break;
+    }
+    yt = ytNext;
+    bandYStep[bandNRows] = yStep;
+    bandSrcRow[bandNRows] = nSrcRows;
+    nSrcRows += yStep;
+    ++bandNRows;
+    ++yScaledCur;
+  }
+  for (int i = 0; i < nSrcRows; ++i) {
+    (*src)(srcData, bandSrc + (size_t)i * srcWidth);
+  }
+}
+
+// Compute one thread's share of the scaled rows in the current band.
+void ImageMaskScaler::scaleBandJob(void *data, int jobIdx) {
+  ImageMaskScaler *scaler = (ImageMaskScaler *)data;
+  int nJobs = scaler->nThreads < scaler->bandNRows ? scaler->nThreads
+                                                   : scaler->bandNRows;
+  int srcWidth = scaler->srcWidth;
+  int scaledWidth = scaler->scaledWidth;
+  Guint *acc = scaler->accBuf + (size_t)jobIdx * srcWidth;
+  int row0 = splashJobStart(scaler->bandNRows, nJobs, jobIdx);
+  int row1 = splashJobStart(scaler->bandNRows, nJobs, jobIdx + 1);
+  for (int row = row0; row < row1; ++row) {
+    int yStep = scaler->bandYStep[row];
+    int srcRow = scaler->bandSrcRow[row];
+    memset(acc, 0, srcWidth * sizeof(Guint));
+    for (int i = 0; i < yStep; ++i) {
+      splashAccumulateRow(acc,
+			  scaler->bandSrc + (size_t)(srcRow + i) * srcWidth,
+			  srcWidth);
+    }
+    Guchar *out = scaler->bandOut + (size_t)row * scaledWidth;
+    int xt = 0;
+    int unscaledIdx = 0;
+    for (int scaledIdx = 0; scaledIdx < scaledWidth; ++scaledIdx) {
+      int xStep = scaler->xp;
+      xt += scaler->xq;
+      if (xt >= scaledWidth) {
+	xt -= scaledWidth;
+	++xStep;
+      }
+      int a = 0;
+      for (int i = 0; i < xStep; ++i) {
+	a += acc[unscaledIdx];
+	++unscaledIdx;
+      }
+      if (scaler->thresh) {
+	out[scaledIdx] = a > ((xStep * yStep) >> 1) ? (Guchar)255 : (Guchar)0;
+      } else {
+	out[scaledIdx] = (Guchar)((255 * a) / (xStep * yStep));
+      }
+    }
+  }
+}
+
 void ImageMaskScaler::vertDownscaleHorizUpscaleNoInterp() {
   //--- vert downscale
   int yStep = yp;
@@ -4184,9 +4775,7 @@ void ImageMaskScaler::vertDownscaleHorizUpscaleNoInterp() {
   memset(accBuf, 0, srcWidth * sizeof(Guint));
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, tmpBuf0);
-    for (int j = 0; j < srcWidth; ++j) {
-      accBuf[j] += tmpBuf0[j];
-    }
+    splashAccumulateRow(accBuf, tmpBuf0, srcWidth);
   }
 
   //--- horiz upscale
@@ -4218,9 +4807,7 @@ void ImageMaskScaler::vertDownscaleHorizUpscaleInterp() {
   memset(accBuf, 0, srcWidth * sizeof(Guint));
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, tmpBuf0);
-    for (int j = 0; j < srcWidth; ++j) {
-      accBuf[j] += tmpBuf0[j];
-    }
+    splashAccumulateRow(accBuf, tmpBuf0, srcWidth);
   }
   for (int j = 0; j < srcWidth; ++j) {
     accBuf[j] = (255 * accBuf[j]) / yStep;
@@ -4254,9 +4841,7 @@ void ImageMaskScaler::vertDownscaleHorizUpscaleThresh() {
   memset(accBuf, 0, srcWidth * sizeof(Guint));
   for (int i = 0; i < yStep; ++i) {
     (*src)(srcData, tmpBuf0);
-    for (int j = 0; j < srcWidth; ++j) {
-      accBuf[j] += tmpBuf0[j];
-    }
+    splashAccumulateRow(accBuf, tmpBuf0, srcWidth);
   }
 
   //--- horiz upscale
@@ -4507,6 +5092,7 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   minLineWidth = 0;
   clearModRegion();
   debugMode = gFalse;
+  imageScalingThreads = 1;
 
   if (imageCacheA) {
     imageCache = imageCacheA;
@@ -4536,6 +5122,7 @@ Splash::Splash(SplashBitmap *bitmapA, GBool vectorAntialiasA,
   minLineWidth = 0;
   clearModRegion();
   debugMode = gFalse;
+  imageScalingThreads = 1;
 
   if (imageCacheA) {
     imageCache = imageCacheA;
@@ -5755,7 +6342,6 @@ SplashError Splash::fillChar(SplashCoord x, SplashCoord y,
   SplashGlyphBitmap glyph;
   SplashCoord xt, yt;
   int x0, y0, xFrac, yFrac;
-  SplashError err;
 
   if (debugMode) {
     printf("fillChar: x=%.2f y=%.2f c=%3d=0x%02x='%c'\n",
@@ -5769,11 +6355,58 @@ SplashError Splash::fillChar(SplashCoord x, SplashCoord y,
   if (!font->getGlyph(c, xFrac, yFrac, &glyph)) {
     return splashErrNoGlyph;
   }
-  err = fillGlyph2(x0, y0, &glyph);
+  opClipRes = fillGlyph2(x0, y0, &glyph, NULL);
   if (glyph.freeData) {
     gfree(glyph.data);
   }
-  return err;
+  return splashOk;
+}
+
+SplashError Splash::fillChars(SplashCoord *xy, int *c, int n,
+			      SplashFont *font) {
+  SplashPipe pipe;
+  SplashGlyphBitmap glyph;
+  SplashCoord xt, yt;
+  SplashClipResult clipRes;
+  int x0, y0, xFrac, yFrac, i;
+  GBool gotGlyph, allInside, allOutside;
+
+  if (debugMode) {
+    printf("fillChars: n=%d\n", n);
+  }
+  pipeInit(&pipe, state->fillPattern,
+	   (Guchar)splashRound(state->fillAlpha * 255),
+	   gTrue, gFalse);
+  gotGlyph = gFalse;
+  allInside = allOutside = gTrue;
+  for (i = 0; i < n; ++i) {
+    transform(state->matrix, xy[2*i], xy[2*i+1], &xt, &yt);
+    x0 = splashFloor(xt);
+    xFrac = splashFloor((xt - x0) * splashFontFraction);
+    y0 = splashFloor(yt);
+    yFrac = splashFloor((yt - y0) * splashFontFraction);
+    if (!font->getGlyph(c[i], xFrac, yFrac, &glyph)) {
+      continue;
+    }
+    gotGlyph = gTrue;
+    clipRes = fillGlyph2(x0, y0, &glyph, &pipe);
+    if (clipRes != splashClipAllInside) {
+      allInside = gFalse;
+    }
+    if (clipRes != splashClipAllOutside) {
+      allOutside = gFalse;
+    }
+    if (glyph.freeData) {
+      gfree(glyph.data);
+    }
+  }
+  if (!gotGlyph) {
+    return splashErrNoGlyph;
+  }
+  opClipRes = allInside ? splashClipAllInside
+                        : allOutside ? splashClipAllOutside
+                                     : splashClipPartial;
+  return splashOk;
 }
 
 SplashError Splash::fillGlyph(SplashCoord x, SplashCoord y,
@@ -5784,11 +6417,16 @@ SplashError Splash::fillGlyph(SplashCoord x, SplashCoord y,
   transform(state->matrix, x, y, &xt, &yt);
   x0 = splashFloor(xt);
   y0 = splashFloor(yt);
-  return fillGlyph2(x0, y0, glyph);
+  opClipRes = fillGlyph2(x0, y0, glyph, NULL);
+  return splashOk;
 }
 
-SplashError Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph) {
-  SplashPipe pipe;
+// Composite a glyph bitmap at (x0, y0).  If <pipe> is NULL, a pipe
+// is set up here (if needed); otherwise <pipe> must already be
+// initialized for the current fill pattern.
+SplashClipResult Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph,
+				    SplashPipe *pipe) {
+  SplashPipe localPipe;
   SplashClipResult clipRes;
   Guchar alpha;
   Guchar *p;
@@ -5804,15 +6442,18 @@ SplashError Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph) {
   if ((clipRes = state->clip->testRect(xMin, yMin, xMax, yMax,
 				       state->strokeAdjust))
       != splashClipAllOutside) {
-    pipeInit(&pipe, state->fillPattern,
-	     (Guchar)splashRound(state->fillAlpha * 255),
-	     gTrue, gFalse);
+    if (!pipe) {
+      pipe = &localPipe;
+      pipeInit(pipe, state->fillPattern,
+	       (Guchar)splashRound(state->fillAlpha * 255),
+	       gTrue, gFalse);
+    }
     if (clipRes == splashClipAllInside) {
       if (glyph->aa) {
 	p = glyph->data;
 	for (y = yMin; y <= yMax; ++y) {
-	  (this->*pipe.run)(&pipe, xMin, xMax, y,
-			    glyph->data + (y - yMin) * glyph->w, NULL);
+	  (this->*pipe->run)(pipe, xMin, xMax, y,
+			     glyph->data + (y - yMin) * glyph->w, NULL);
 	}
       } else {
 	p = glyph->data;
@@ -5824,7 +6465,7 @@ SplashError Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph) {
 	      alpha = (Guchar)(alpha << 1);
 	    }
 	  }
-	  (this->*pipe.run)(&pipe, xMin, xMax, y, scanBuf + xMin, NULL);
+	  (this->*pipe->run)(pipe, xMin, xMax, y, scanBuf + xMin, NULL);
 	}
       }
     } else {
@@ -5847,7 +6488,7 @@ SplashError Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph) {
 	    memcpy(scanBuf + xMin, p, xMax - xMin + 1);
 	    state->clip->clipSpan(scanBuf, y, xMin, xMax,
 				  state->strokeAdjust);
-	    (this->*pipe.run)(&pipe, xMin, xMax, y, scanBuf + xMin, NULL);
+	    (this->*pipe->run)(pipe, xMin, xMax, y, scanBuf + xMin, NULL);
 	  }
 	} else {
 	  for (y = yMin; y <= yMax; ++y) {
@@ -5869,15 +6510,13 @@ SplashError Splash::fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph) {
 	    }
 	    state->clip->clipSpanBinary(scanBuf, y, xMin, xMax,
 					state->strokeAdjust);
-	    (this->*pipe.run)(&pipe, xMin, xMax, y, scanBuf + xMin, NULL);
+	    (this->*pipe->run)(pipe, xMin, xMax, y, scanBuf + xMin, NULL);
 	  }
 	}
       }
     }
   }
-  opClipRes = clipRes;
-
-  return splashOk;
+  return clipRes;
 }
 
 void Splash::getImageBounds(SplashCoord xyMin, SplashCoord xyMax,
@@ -6058,7 +6697,8 @@ SplashError Splash::fillImageMask(GString *imageTag,
       int scaledWidth = xMax - xMin;
       int scaledHeight = yMax - yMin;
       ImageMaskScaler scaler(src, srcData, w, h,
-			     scaledWidth, scaledHeight, interpolate, antialias);
+			     scaledWidth, scaledHeight, interpolate, antialias,
+			     imageScalingThreads);
       Guchar *tmpLine = NULL;
       if (horizFlip) {
 	tmpLine = (Guchar *)gmalloc(scaledWidth);
@@ -6105,7 +6745,8 @@ SplashError Splash::fillImageMask(GString *imageTag,
       int scaledWidth = yMax - yMin;
       int scaledHeight = xMax - xMin;
       ImageMaskScaler scaler(src, srcData, w, h,
-			     scaledWidth, scaledHeight, interpolate, antialias);
+			     scaledWidth, scaledHeight, interpolate, antialias,
+			     imageScalingThreads);
       Guchar *scaledMask = (Guchar *)gmallocn(scaledHeight, scaledWidth);
       Guchar *ptr = scaledMask;
       for (int y = 0; y < scaledHeight; ++y) {
@@ -6192,7 +6833,8 @@ SplashError Splash::fillImageMask(GString *imageTag,
     Guchar *scaledMask = (Guchar *)gmallocn(scaledHeight, scaledWidth);
     if (downscaling) {
       ImageMaskScaler scaler(src, srcData, w, h,
-			     scaledWidth, scaledHeight, interpolate, antialias);
+			     scaledWidth, scaledHeight, interpolate, antialias,
+			     imageScalingThreads);
       Guchar *ptr = scaledMask;
       for (int y = 0; y < scaledHeight; ++y) {
 	scaler.nextLine();
@@ -6679,10 +7321,10 @@ SplashError Splash::drawImage(GString *imageTag,
       int scaledWidth = yMax - yMin;
       int scaledHeight = xMax - xMin;
       Guchar *scaledColor, *scaledAlpha;
-      GBool freeScaledImage;
+      SplashImageCacheEntry *cacheEntry;
       getScaledImage(imageTag, src, srcData, w, h, nComps,
 		     scaledWidth, scaledHeight, srcMode, srcAlpha, interpolate,
-		     &scaledColor, &scaledAlpha, &freeScaledImage);
+		     &scaledColor, &scaledAlpha, &cacheEntry);
 
       // draw it
       Guchar *tmpLine = (Guchar *)gmallocn(scaledHeight, nComps);
@@ -6742,7 +7384,9 @@ SplashError Splash::drawImage(GString *imageTag,
 
       gfree(tmpLine);
       gfree(tmpAlphaLine);
-      if (freeScaledImage) {
+      if (cacheEntry) {
+	imageCache->releaseEntry(cacheEntry);
+      } else {
 	gfree(scaledColor);
 	gfree(scaledAlpha);
       }
@@ -6793,10 +7437,10 @@ SplashError Splash::drawImage(GString *imageTag,
                 + (invMat[1] + invMat[3]) * 0.5;
 
     Guchar *scaledColor, *scaledAlpha;
-    GBool freeScaledImage;
+    SplashImageCacheEntry *cacheEntry;
     getScaledImage(imageTag, src, srcData, w, h, nComps,
 		   scaledWidth, scaledHeight, srcMode, srcAlpha, interpolate,
-		   &scaledColor, &scaledAlpha, &freeScaledImage);
+		   &scaledColor, &scaledAlpha, &cacheEntry);
 
     // draw it
     if (interpolate) {
@@ -6814,7 +7458,9 @@ SplashError Splash::drawImage(GString *imageTag,
     }
 
     // free the downscaled/unscaled image
-    if (freeScaledImage) {
+    if (cacheEntry) {
+      imageCache->releaseEntry(cacheEntry);
+    } else {
       gfree(scaledColor);
       gfree(scaledAlpha);
     }
@@ -6829,49 +7475,76 @@ ImageScaler *Splash::getImageScaler(GString *imageTag,
 				    int scaledWidth, int scaledHeight,
 				    SplashColorMode srcMode,
 				    GBool srcAlpha, GBool interpolate) {
+  SplashImageCacheEntry *entry;
+  GBool complete;
+
   // Notes:
   //
   // * If the scaled image is more than 8 Mpixels, we don't cache it.
   //
-  // * Caching is done on the third consecutive use (second
-  //   consecutive reuse) of an image; this avoids overhead on the
-  //   common case of single-use images.
+  // * An image is saved on its second use (first reuse), and replayed
+  //   from the cache after that; this avoids overhead on the common
+  //   case of single-use images.
 
   if (scaledWidth < 8000000 / scaledHeight &&
-      imageCache->match(imageTag, scaledWidth, scaledHeight,
-			srcMode, srcAlpha, interpolate)) {
-    if (imageCache->colorData) {
+      (entry = imageCache->lookup(imageTag, scaledWidth, scaledHeight,
+				  srcMode, srcAlpha, interpolate,
+				  &complete))) {
+    if (complete) {
       return new ReplayImageScaler(nComps, srcAlpha, scaledWidth,
-				   imageCache->colorData,
-				   imageCache->alphaData);
-    } else {
-      int lineSize;
-      if (scaledWidth < INT_MAX / nComps) {
-	lineSize = scaledWidth * nComps;
-      } else {
-	lineSize = -1;
-      }
-      imageCache->colorData = (Guchar *)gmallocn(scaledHeight, lineSize);
-      if (srcAlpha) {
-	imageCache->alphaData = (Guchar *)gmallocn(scaledHeight, scaledWidth);
-      }
+				   imageCache, entry);
+    }
+    if (entry->useCount >= 2 && imageCache->startFill(entry, nComps)) {
       return new SavingImageScaler(src, srcData,
 				   w, h, nComps, srcAlpha,
 				   scaledWidth, scaledHeight,
-				   interpolate,
-				   imageCache->colorData,
-				   imageCache->alphaData);
+				   interpolate, imageScalingThreads,
+				   imageCache, entry);
+    }
+    imageCache->releaseEntry(entry);
+  }
+  return new BasicImageScaler(src, srcData,
+			      w, h, nComps, srcAlpha,
+			      scaledWidth, scaledHeight,
+			      interpolate, imageScalingThreads);
+}
+
+// Read and scale an image into [colorData] and [alphaData].
+static void scaleImageToBuffer(SplashImageSource src, void *srcData,
+			       int w, int h, int nComps,
+			       int scaledWidth, int scaledHeight,
+			       GBool srcAlpha, GBool interpolate,
+			       int nThreads,
+			       Guchar *colorData, Guchar *alphaData) {
+  Guchar *colorPtr = colorData;
+  Guchar *alphaPtr = alphaData;
+  if (scaledWidth == w && scaledHeight == h) {
+    for (int y = 0; y < scaledHeight; ++y) {
+      (*src)(srcData, colorPtr, alphaPtr);
+      colorPtr += scaledWidth * nComps;
+      if (srcAlpha) {
+	alphaPtr += scaledWidth;
+      }
     }
   } else {
-    imageCache->reset(imageTag, scaledWidth, scaledHeight,
-		      srcMode, srcAlpha, interpolate);
-    return new BasicImageScaler(src, srcData,
-				w, h, nComps, srcAlpha,
-				scaledWidth, scaledHeight,
-				interpolate);
+    BasicImageScaler scaler(src, srcData, w, h, nComps, srcAlpha,
+			    scaledWidth, scaledHeight, interpolate, nThreads);
+    for (int y = 0; y < scaledHeight; ++y) {
+      scaler.nextLine();
+      memcpy(colorPtr, scaler.colorData(), scaledWidth * nComps);
+      colorPtr += scaledWidth * nComps;
+      if (srcAlpha) {
+	memcpy(alphaPtr, scaler.alphaData(), scaledWidth);
+	alphaPtr += scaledWidth;
+      }
+    }
   }
 }
 
+// Returns the scaled image in *[scaledColor] and *[scaledAlpha].  If
+// the image came from the cache, *[cacheEntry] is set, and the caller
+// must call imageCache->releaseEntry(); otherwise *[cacheEntry] is
+// NULL, and the caller must free the buffers.
 void Splash::getScaledImage(GString *imageTag,
 			    SplashImageSource src, void *srcData,
 			    int w, int h, int nComps,
@@ -6879,100 +7552,57 @@ void Splash::getScaledImage(GString *imageTag,
 			    SplashColorMode srcMode,
 			    GBool srcAlpha, GBool interpolate,
 			    Guchar **scaledColor, Guchar **scaledAlpha,
-			    GBool *freeScaledImage) {
+			    SplashImageCacheEntry **cacheEntry) {
+  SplashImageCacheEntry *entry;
+  GBool complete;
+
   // Notes:
   //
   // * If the scaled image is more than 8 Mpixels, we don't cache it.
   //
   // * This buffers the whole image anyway, so there's no reason to
-  //   skip caching on the first reuse.
+  //   skip caching on the first use.
 
-  if (scaledWidth >= 8000000 / scaledHeight) {
-    int lineSize;
-    if (scaledWidth < INT_MAX / nComps) {
-      lineSize = scaledWidth * nComps;
-    } else {
-      lineSize = -1;
-    }
-    *scaledColor = (Guchar *)gmallocn(scaledHeight, lineSize);
-    if (srcAlpha) {
-      *scaledAlpha = (Guchar *)gmallocn(scaledHeight, scaledWidth);
-    } else {
-      *scaledAlpha = NULL;
-    }
-    *freeScaledImage = gTrue;
-    if (scaledWidth == w && scaledHeight == h) {
-      Guchar *colorPtr = *scaledColor;
-      Guchar *alphaPtr = *scaledAlpha;
-      for (int y = 0; y < scaledHeight; ++y) {
-	(*src)(srcData, colorPtr, alphaPtr);
-	colorPtr += scaledWidth * nComps;
-	if (srcAlpha) {
-	  alphaPtr += scaledWidth;
-	}
-      }
-    } else {
-      BasicImageScaler scaler(src, srcData, w, h, nComps, srcAlpha,
-			      scaledWidth, scaledHeight, interpolate);
-      Guchar *colorPtr = *scaledColor;
-      Guchar *alphaPtr = *scaledAlpha;
-      for (int y = 0; y < scaledHeight; ++y) {
-	scaler.nextLine();
-	memcpy(colorPtr, scaler.colorData(), scaledWidth * nComps);
-	colorPtr += scaledWidth * nComps;
-	if (srcAlpha) {
-	  memcpy(alphaPtr, scaler.alphaData(), scaledWidth);
-	  alphaPtr += scaledWidth;
-	}
-      }
-    }
-  } else {
-    if (!imageCache->match(imageTag, scaledWidth, scaledHeight,
-			  srcMode, srcAlpha, interpolate) ||
-	!imageCache->colorData) {
-      imageCache->reset(imageTag, scaledWidth, scaledHeight,
-			srcMode, srcAlpha, interpolate);
-      int lineSize;
-      if (scaledWidth < INT_MAX / nComps) {
-	lineSize = scaledWidth * nComps;
-      } else {
-	lineSize = -1;
-      }
-      imageCache->colorData = (Guchar *)gmallocn(scaledHeight, lineSize);
-      if (srcAlpha) {
-	imageCache->alphaData = (Guchar *)gmallocn(scaledHeight, scaledWidth);
-      }
-      if (scaledWidth == w && scaledHeight == h) {
-	Guchar *colorPtr = imageCache->colorData;
-	Guchar *alphaPtr = imageCache->alphaData;
-	for (int y = 0; y < scaledHeight; ++y) {
-	  (*src)(srcData, colorPtr, alphaPtr);
-	  colorPtr += scaledWidth * nComps;
-	  if (srcAlpha) {
-	    alphaPtr += scaledWidth;
-	  }
-	}
+  if (scaledWidth < 8000000 / scaledHeight &&
+      (entry = imageCache->lookup(imageTag, scaledWidth, scaledHeight,
+				  srcMode, srcAlpha, interpolate,
+				  &complete))) {
+    if (!complete) {
+      if (imageCache->startFill(entry, nComps)) {
+	scaleImageToBuffer(src, srcData, w, h, nComps,
+			   scaledWidth, scaledHeight, srcAlpha, interpolate,
+			   imageScalingThreads,
+			   entry->colorData, entry->alphaData);
+	imageCache->finishFill(entry, gTrue);
       } else {
-	SavingImageScaler scaler(src, srcData, w, h, nComps, srcAlpha,
-				 scaledWidth, scaledHeight, interpolate,
-				 imageCache->colorData, imageCache->alphaData);
-	Guchar *colorPtr = imageCache->colorData;
-	Guchar *alphaPtr = imageCache->alphaData;
-	for (int y = 0; y < scaledHeight; ++y) {
-	  scaler.nextLine();
-	  memcpy(colorPtr, scaler.colorData(), scaledWidth * nComps);
-	  colorPtr += scaledWidth * nComps;
-	  if (srcAlpha) {
-	    memcpy(alphaPtr, scaler.alphaData(), scaledWidth);
-	    alphaPtr += scaledWidth;
-	  }
-	}
+	imageCache->releaseEntry(entry);
+	entry = NULL;
       }
     }
-    *scaledColor = imageCache->colorData;
-    *scaledAlpha = imageCache->alphaData;
-    *freeScaledImage = gFalse;
+    if (entry) {
+      *scaledColor = entry->colorData;
+      *scaledAlpha = entry->alphaData;
+      *cacheEntry = entry;
+      return;
+    }
+  }
+
+  int lineSize;
+  if (scaledWidth < INT_MAX / nComps) {
+    lineSize = scaledWidth * nComps;
+  } else {
+    lineSize = -1;
   }
+  *scaledColor = (Guchar *)gmallocn(scaledHeight, lineSize);
+  if (srcAlpha) {
+    *scaledAlpha = (Guchar *)gmallocn(scaledHeight, scaledWidth);
+  } else {
+    *scaledAlpha = NULL;
+  }
+  scaleImageToBuffer(src, srcData, w, h, nComps,
+		     scaledWidth, scaledHeight, srcAlpha, interpolate,
+		     imageScalingThreads, *scaledColor, *scaledAlpha);
+  *cacheEntry = NULL;
 }
 
 void Splash::drawImageArbitraryNoInterp(Guchar *scaledColor,
@@ -7672,6 +8302,165 @@ SplashError Splash::compositeWithOverprint(SplashBitmap *src,
   return splashOk;
 }
 
+SplashError Splash::compositeTiled(SplashBitmap *src, int xDest, int yDest,
+				   int xStep, int yStep, int nx, int ny) {
+  SplashPipe pipe;
+  Guchar *lineBuf, *colorPtr, *alphaPtr, *p;
+  GBool *opaqueRows;
+  GBool direct;
+  Guchar b;
+  int w, h, x0, x1, y0, y1, x, y, tx, ty, n, t, i;
+
+  if (src->mode != bitmap->mode || bitmap->mode == splashModeMono1) {
+    return splashErrModeMismatch;
+  }
+  w = src->width;
+  h = src->height;
+  if (nx <= 0 || ny <= 0 || xStep < w || yStep < h) {
+    return splashOk;
+  }
+
+  // intersect the tiled area with the clip rectangle
+  x0 = xDest;
+  if ((t = state->clip->getXMinI(state->strokeAdjust)) > x0) {
+    x0 = t;
+  }
+  x1 = state->clip->getXMaxI(state->strokeAdjust) + 1;
+  if ((double)xDest + (double)(nx - 1) * xStep + w < (double)x1) {
+    x1 = xDest + (nx - 1) * xStep + w;
+  }
+  y0 = yDest;
+  if ((t = state->clip->getYMinI(state->strokeAdjust)) > y0) {
+    y0 = t;
+  }
+  y1 = state->clip->getYMaxI(state->strokeAdjust) + 1;
+  if ((double)yDest + (double)(ny - 1) * yStep + h < (double)y1) {
+    y1 = yDest + (ny - 1) * yStep + h;
+  }
+  if (x0 >= x1 || y0 >= y1) {
+    return splashOk;
+  }
+
+  pipeInit(&pipe, NULL,
+	   (Guchar)splashRound(state->fillAlpha * 255),
+	   gTrue, gFalse);
+
+  // opaque source pixels can be copied directly if the pipe would
+  // just copy them, i.e., no transparency, blending, overprint, or
+  // transfer functions
+  direct = pipe.shapeOnly && !state->blendFunc && !overprintMaskBitmap &&
+           xStep == w;
+  for (i = 0; direct && i < 256; ++i) {
+    switch (bitmap->mode) {
+    case splashModeMono1:
+      break;
+    case splashModeMono8:
+      direct = state->grayTransfer[i] == i;
+      break;
+    case splashModeRGB8:
+    case splashModeBGR8:
+      direct = state->rgbTransferR[i] == i &&
+	       state->rgbTransferG[i] == i &&
+	       state->rgbTransferB[i] == i;
+      break;
+#if SPLASH_CMYK
+    case splashModeCMYK8:
+      direct = state->cmykTransferC[i] == i &&
+	       state->cmykTransferM[i] == i &&
+	       state->cmykTransferY[i] == i &&
+	       state->cmykTransferK[i] == i;
+      break;
+#endif
+    }
+  }
+  opaqueRows = NULL;
+  if (direct) {
+    opaqueRows = (GBool *)gmallocn(h, sizeof(GBool));
+    for (ty = 0; ty < h; ++ty) {
+      opaqueRows[ty] = gTrue;
+      if (src->alpha) {
+	alphaPtr = src->alpha + ty * src->alphaRowSize;
+	for (tx = 0; tx < w; ++tx) {
+	  if (alphaPtr[tx] != 0xff) {
+	    opaqueRows[ty] = gFalse;
+	    break;
+	  }
+	}
+      }
+    }
+  }
+
+  lineBuf = (Guchar *)gmallocn(x1 - x0, bitmapComps);
+  for (y = y0; y < y1; ++y) {
+    ty = (y - yDest) % yStep;
+    if (ty >= h) {
+      continue;
+    }
+
+    // build the scan line: color values in lineBuf, shape values in
+    // scanBuf
+    colorPtr = src->data + ty * src->rowSize;
+    alphaPtr = src->alpha ? src->alpha + ty * src->alphaRowSize
+                          : (Guchar *)NULL;
+    for (x = x0; x < x1; x += n) {
+      tx = (x - xDest) % xStep;
+      if (tx < w) {
+	n = w - tx;
+	if (n > x1 - x) {
+	  n = x1 - x;
+	}
+	memcpy(lineBuf + (x - x0) * bitmapComps, colorPtr + tx * bitmapComps,
+	       n * bitmapComps);
+	if (alphaPtr) {
+	  memcpy(scanBuf + x, alphaPtr + tx, n);
+	} else {
+	  memset(scanBuf + x, 0xff, n);
+	}
+      } else {
+	n = xStep - tx;
+	if (n > x1 - x) {
+	  n = x1 - x;
+	}
+	memset(lineBuf + (x - x0) * bitmapComps, 0, n * bitmapComps);
+	memset(scanBuf + x, 0, n);
+      }
+    }
+
+    // copy directly, or run the pipe
+    if (direct && opaqueRows[ty] &&
+	state->clip->testRect(x0, y, x1 - 1, y, state->strokeAdjust)
+	  == splashClipAllInside) {
+      useDestRow(y);
+      memcpy(bitmap->data + y * bitmap->rowSize + x0 * bitmapComps,
+	     lineBuf, (x1 - x0) * bitmapComps);
+      if (bitmap->alpha) {
+	memset(bitmap->alpha + y * bitmap->alphaRowSize + x0, 0xff, x1 - x0);
+      }
+      updateModX(x0);
+      updateModX(x1 - 1);
+      updateModY(y);
+    } else {
+      // in BGR8 mode, pipeRun expects the source to be in RGB8
+      // format, so we need to swap bytes
+      if (bitmap->mode == splashModeBGR8) {
+	for (x = 0, p = lineBuf; x < x1 - x0; ++x, p += 3) {
+	  b = p[0];
+	  p[0] = p[2];
+	  p[2] = b;
+	}
+      }
+      state->clip->clipSpan(scanBuf, y, x0, x1 - 1, state->strokeAdjust);
+      // this uses shape instead of alpha, which isn't technically
+      // correct, but works out the same
+      (this->*pipe.run)(&pipe, x0, x1 - 1, y, scanBuf + x0, lineBuf);
+    }
+  }
+  gfree(lineBuf);
+  gfree(opaqueRows);
+
+  return splashOk;
+}
+
 void Splash::compositeBackground(SplashColorPtr color) {
   SplashColorPtr p;
   Guchar *q;
@@ -17,8 +17,12 @@
 
 #include "SplashTypes.h"
 #include "SplashClip.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
 
 class GString;
+class GList;
 class Splash;
 class SplashBitmap;
 struct SplashGlyphBitmap;
@@ -89,21 +93,21 @@ enum SplashGroupDestInitMode {
 // SplashImageCache
 //------------------------------------------------------------------------
 
-// This holds a cached image, and is shared by multiple Splash objects
-// in the same thread.
-class SplashImageCache {
+// Default memory limit for SplashImageCache.
+#define splashImageCacheDefaultSize (32 * 1024 * 1024)
+
+// A scaled image, stored in a SplashImageCache.  The color and alpha
+// data are valid only if <complete> is set.
+class SplashImageCacheEntry {
 public:
 
-  SplashImageCache();
-  ~SplashImageCache();
+  SplashImageCacheEntry(GString *aTag, int aWidth, int aHeight,
+			SplashColorMode aMode, GBool aAlpha,
+			GBool aInterpolate);
+  ~SplashImageCacheEntry();
   GBool match(GString *aTag, int aWidth, int aHeight,
 	      SplashColorMode aMode, GBool aAlpha,
 	      GBool aInterpolate);
-  void reset(GString *aTag, int aWidth, int aHeight,
-	     SplashColorMode aMode, GBool aAlpha,
-	     GBool aInterpolate);
-  void incRefCount();
-  void decRefCount();
 
   GString *tag;
   int width;
@@ -113,8 +117,80 @@ public:
   GBool interpolate;
   Guchar *colorData;
   Guchar *alphaData;
+  size_t size;			// size of colorData + alphaData
+  int useCount;			// number of lookups of this image
+  GBool filling;		// set while a SavingImageScaler is
+				//   generating the data
+  GBool complete;		// set once the data is valid
+
+  // these are protected by the SplashImageCache mutex
+  int refCount;			// number of users (including the cache)
+  GBool inCache;		// set if the entry is on the cache list
+};
+
+// This holds scaled images, keyed by a tag (which identifies the
+// image source, e.g., object number + rendering intent), the scaled
+// size, color mode, alpha, and interpolation flag.  The least
+// recently used images are discarded when the total size exceeds the
+// limit.  A SplashImageCache can be shared by multiple Splash objects,
+// including ones in different threads.
+class SplashImageCache {
+public:
+
+  SplashImageCache(size_t maxSizeA = splashImageCacheDefaultSize);
+  ~SplashImageCache();
+
+  // Find (or add) the entry for an image, and increment its use
+  // count.  The returned entry must be released by calling
+  // releaseEntry().  Returns NULL if <aTag> is NULL.
+  // *<complete> is set to true if the entry's data is valid.
+  SplashImageCacheEntry *lookup(GString *aTag, int aWidth, int aHeight,
+				SplashColorMode aMode, GBool aAlpha,
+				GBool aInterpolate, GBool *complete);
+
+  // Allocate the data buffers for an incomplete entry, and mark it as
+  // being filled.  Returns false if the entry is complete, is already
+  // being filled (by another thread), or is too large to be cached.
+  GBool startFill(SplashImageCacheEntry *entry, int nComps);
 
+  // Called after the entry's data has been generated.  If <ok> is
+  // false, the data is discarded.
+  void finishFill(SplashImageCacheEntry *entry, GBool ok);
+
+  // Release an entry returned by lookup().
+  void releaseEntry(SplashImageCacheEntry *entry);
+
+  // Discard all cached images (e.g., when switching documents).
+  void flush();
+
+  void incRefCount();
+  void decRefCount();
+
+  // Statistics.
+  int getNumHits() { return nHits; }
+  int getNumMisses() { return nMisses; }
+  int getNumEvictions() { return nEvictions; }
+  size_t getSize() { return size; }
+  size_t getMaxSize() { return maxSize; }
+
+private:
+
+  void lock();
+  void unlock();
+  void removeEntry(int idx);
+  void shrink();
+
+  GList *entries;		// [SplashImageCacheEntry], most recently
+				//   used first
+  size_t size;			// total size of complete entries
+  size_t maxSize;
+  int nHits, nMisses, nEvictions;
+#if MULTITHREADED
+  GMutex mutex;
+  GAtomicCounter refCount;
+#else
   int refCount;
+#endif
 };
 
 //------------------------------------------------------------------------
@@ -212,6 +288,12 @@ public:
   // Draw a character, using the current fill pattern.
   SplashError fillChar(SplashCoord x, SplashCoord y, int c, SplashFont *font);
 
+  // Draw a run of <n> characters, using the current fill pattern.
+  // The <xy> array holds 2*<n> coordinates.  This is equivalent to
+  // calling fillChar() for each char, but the compositing pipeline is
+  // only set up once.
+  SplashError fillChars(SplashCoord *xy, int *c, int n, SplashFont *font);
+
   // Draw a glyph, using the current fill pattern.  This function does
   // not free any data, i.e., it ignores glyph->freeData.
   SplashError fillGlyph(SplashCoord x, SplashCoord y,
@@ -274,6 +356,17 @@ public:
 				     int xDest, int yDest, int w, int h,
 				     GBool noClip, GBool nonIsolated);
 
+  // Composite <nx> x <ny> copies of <src> onto this Splash object,
+  // with the upper-left corners at (<xDest> + i * <xStep>, <yDest> +
+  // j * <yStep>).  The copies can't overlap, i.e., <xStep> and
+  // <yStep> must be at least the width and height of <src>.  This
+  // gives the same result as calling composite() (with clipping, and
+  // nonIsolated = false) for each copy, but it handles an entire
+  // scan line at a time.  Opaque scan lines inside a rectangular
+  // clip region are copied directly.  Mono1 mode isn't supported.
+  SplashError compositeTiled(SplashBitmap *src, int xDest, int yDest,
+			     int xStep, int yStep, int nx, int ny);
+
   // Composite this Splash object onto a background color.  The
   // background alpha is assumed to be 1.
   void compositeBackground(SplashColorPtr color);
@@ -331,6 +424,11 @@ public:
   // Toggle debug mode on or off.
   void setDebugMode(GBool debugModeA) { debugMode = debugModeA; }
 
+  // Set the max number of threads used to scale large images and
+  // image masks (1 = don't use extra threads).
+  void setImageScalingThreads(int n)
+    { imageScalingThreads = n < 1 ? 1 : n; }
+
   SplashImageCache *getImageCache() { return imageCache; }
 
 #if 1 //~tmp: turn off anti-aliasing temporarily
@@ -426,7 +524,8 @@ private:
 			      SplashPattern *pattern, SplashCoord alpha);
   SplashPath *tweakFillPath(SplashPath *path);
   GBool pathAllOutside(SplashPath *path);
-  SplashError fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph);
+  SplashClipResult fillGlyph2(int x0, int y0, SplashGlyphBitmap *glyph,
+			      SplashPipe *pipe);
   void getImageBounds(SplashCoord xyMin, SplashCoord xyMax,
 		      int *xyMinI, int *xyMaxI);
   void drawImageMaskArbitraryNoInterp(Guchar *scaledMask,
@@ -464,7 +563,7 @@ private:
 		      SplashColorMode srcMode,
 		      GBool srcAlpha, GBool interpolate,
 		      Guchar **scaledColor, Guchar **scaledAlpha,
-		      GBool *freeScaledImage);
+		      SplashImageCacheEntry **cacheEntry);
   void drawImageArbitraryNoInterp(Guchar *scaledColor, Guchar *scaledAlpha,
 				  SplashDrawImageRowData *dd,
 				  SplashDrawImageRowFunc drawRowFunc,
@@ -530,6 +629,7 @@ private:
   GBool vectorAntialias;
   GBool inShading;
   GBool debugMode;
+  int imageScalingThreads;
 
   SplashImageCache *imageCache;
 };
@@ -53,7 +53,10 @@ SplashFTFont::SplashFTFont(SplashFTFontFile *fontFileA, SplashCoord *matA,
 #endif
 
   face = fontFileA->face;
+  fontFileA->lockFace();
   if (FT_New_Size(face, &sizeObj)) {
+    sizeObj = NULL;
+    fontFileA->unlockFace();
     return;
   }
   face->size = sizeObj;
@@ -62,8 +65,10 @@ SplashFTFont::SplashFTFont(SplashFTFontFile *fontFileA, SplashCoord *matA,
     size = 1;
   }
   if (FT_Set_Pixel_Sizes(face, 0, size)) {
+    fontFileA->unlockFace();
     return;
   }
+  fontFileA->unlockFace();
   // if the textMat values are too small, FreeType's fixed point
   // arithmetic doesn't work so well
   textScale = splashDist(0, 0, textMat[2], textMat[3]) / size;
@@ -221,6 +226,16 @@ SplashFTFont::SplashFTFont(SplashFTFontFile *fontFileA, SplashCoord *matA,
 }
 
 SplashFTFont::~SplashFTFont() {
+  SplashFTFontFile *ff;
+
+  // free the size object now, rather than when the face is freed --
+  // the font file may be kept (and shared) by a SplashFontFileCache
+  if (sizeObj) {
+    ff = (SplashFTFontFile *)fontFile;
+    ff->lockFace();
+    FT_Done_Size(sizeObj);
+    ff->unlockFace();
+  }
 }
 
 GBool SplashFTFont::getGlyph(int c, int xFrac, int yFrac,
@@ -228,9 +243,23 @@ GBool SplashFTFont::getGlyph(int c, int xFrac, int yFrac,
   return SplashFont::getGlyph(c, xFrac, 0, bitmap);
 }
 
+// The FT_Face belongs to the font file, which may be shared by fonts
+// in other threads, so it's locked while the glyph is loaded.
 GBool SplashFTFont::makeGlyph(int c, int xFrac, int yFrac,
 			      SplashGlyphBitmap *bitmap) {
   SplashFTFontFile *ff;
+  GBool ok;
+
+  ff = (SplashFTFontFile *)fontFile;
+  ff->lockFace();
+  ok = makeGlyphLocked(c, xFrac, yFrac, bitmap);
+  ff->unlockFace();
+  return ok;
+}
+
+GBool SplashFTFont::makeGlyphLocked(int c, int xFrac, int yFrac,
+				    SplashGlyphBitmap *bitmap) {
+  SplashFTFontFile *ff;
   FT_Vector offset;
   FT_GlyphSlot slot;
   int gid;
@@ -326,6 +355,17 @@ struct SplashFTFontPath {
 };
 
 SplashPath *SplashFTFont::getGlyphPath(int c) {
+  SplashFTFontFile *ff;
+  SplashPath *path;
+
+  ff = (SplashFTFontFile *)fontFile;
+  ff->lockFace();
+  path = getGlyphPathLocked(c);
+  ff->unlockFace();
+  return path;
+}
+
+SplashPath *SplashFTFont::getGlyphPathLocked(int c) {
   static FT_Outline_Funcs outlineFuncs = {
 #if FREETYPE_MINOR <= 1
     (int (*)(FT_Vector *, void *))&glyphPathMoveTo,
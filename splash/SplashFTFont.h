@@ -49,6 +49,10 @@ public:
 
 private:
 
+  GBool makeGlyphLocked(int c, int xFrac, int yFrac,
+			SplashGlyphBitmap *bitmap);
+  SplashPath *getGlyphPathLocked(int c);
+
   FT_Size sizeObj;
   FT_Matrix matrix;
   FT_Matrix textMatrix;
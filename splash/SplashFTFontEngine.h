@@ -92,6 +92,7 @@ private:
 
   friend class SplashFTFontFile;
   friend class SplashFTFont;
+  friend class SplashFontFileCache;
 };
 
 #endif // HAVE_FREETYPE_H
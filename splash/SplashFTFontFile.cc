@@ -148,6 +148,9 @@ SplashFTFontFile::SplashFTFontFile(SplashFTFontEngine *engineA,
   face = faceA;
   codeToGID = codeToGIDA;
   codeToGIDLen = codeToGIDLenA;
+#if MULTITHREADED
+  gInitMutex(&faceMutex);
+#endif
 }
 
 SplashFTFontFile::~SplashFTFontFile() {
@@ -157,6 +160,21 @@ SplashFTFontFile::~SplashFTFontFile() {
   if (codeToGID) {
     gfree(codeToGID);
   }
+#if MULTITHREADED
+  gDestroyMutex(&faceMutex);
+#endif
+}
+
+void SplashFTFontFile::lockFace() {
+#if MULTITHREADED
+  gLockMutex(&faceMutex);
+#endif
+}
+
+void SplashFTFontFile::unlockFace() {
+#if MULTITHREADED
+  gUnlockMutex(&faceMutex);
+#endif
 }
 
 SplashFont *SplashFTFontFile::makeFont(SplashCoord *mat,
@@ -164,7 +182,6 @@ SplashFont *SplashFTFontFile::makeFont(SplashCoord *mat,
   SplashFont *font;
 
   font = new SplashFTFont(this, mat, textMat);
-  font->initCache();
   return font;
 }
 
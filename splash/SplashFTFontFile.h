@@ -20,6 +20,9 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include "SplashFontFile.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
 
 class SplashFontFileID;
 class SplashFTFontEngine;
@@ -69,6 +72,12 @@ public:
   virtual SplashFont *makeFont(SplashCoord *mat,
 			       SplashCoord *textMat);
 
+  // Lock/unlock the FT_Face.  A font file can be shared by several
+  // SplashFontEngines (via a SplashFontFileCache), and FreeType faces
+  // can only be used by one thread at a time.
+  void lockFace();
+  void unlockFace();
+
 private:
 
   SplashFTFontFile(SplashFTFontEngine *engineA,
@@ -86,6 +95,9 @@ private:
   FT_Face face;
   int *codeToGID;
   int codeToGIDLen;
+#if MULTITHREADED
+  GMutex faceMutex;
+#endif
 
   friend class SplashFTFont;
 };
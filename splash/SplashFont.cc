@@ -56,12 +56,20 @@ SplashFont::SplashFont(SplashFontFile *fontFileA, SplashCoord *matA,
 
   cache = NULL;
   cacheTags = NULL;
+  glyphSize = 0;
+  cacheSets = 0;
+  cacheAssoc = 0;
+  maxCacheSize = 0;
+  cacheWindowLookups = cacheWindowMisses = 0;
+  nCacheHits = nCacheMisses = nCacheEvictions = nCacheResizes = 0;
 
   xMin = yMin = xMax = yMax = 0;
 }
 
-void SplashFont::initCache() {
-  int i;
+void SplashFont::initCache(int maxCacheSizeA) {
+  int initCacheSize, i;
+
+  maxCacheSize = maxCacheSizeA;
 
   // this should be (max - min + 1), but we add some padding to
   // deal with rounding errors
@@ -73,8 +81,6 @@ void SplashFont::initCache() {
     // fall back to the uncached case
     glyphW = glyphH = 0;
     glyphSize = 0;
-    cacheSets = 0;
-    cacheAssoc = 0;
     return;
   }
   if (aa) {
@@ -83,11 +89,21 @@ void SplashFont::initCache() {
     glyphSize = ((glyphW + 7) >> 3) * glyphH;
   }
 
-  // set up the glyph pixmap cache
-  cacheAssoc = splashFontCacheAssoc;
+  // set up the glyph pixmap cache -- this starts out small (most
+  // fonts only use a few dozen glyphs), and is grown by getGlyph()
+  // if the miss rate is high; if the size limit is small, reduce the
+  // associativity so that at least one set fits
+  for (cacheAssoc = splashFontCacheAssoc;
+       cacheAssoc > 0 && glyphSize > maxCacheSize / cacheAssoc;
+       cacheAssoc >>= 1) ;
+  if (cacheAssoc == 0) {
+    return;
+  }
+  initCacheSize = splashFontCacheSize < maxCacheSize ? splashFontCacheSize
+                                                     : maxCacheSize;
   for (cacheSets = splashFontCacheMaxSets;
        cacheSets > 1 &&
-	 glyphSize > splashFontCacheSize / (cacheSets * cacheAssoc);
+	 glyphSize > initCacheSize / (cacheSets * cacheAssoc);
        cacheSets >>= 1) ;
   cache = (Guchar *)gmallocn(cacheSets * cacheAssoc, glyphSize);
   cacheTags = (SplashFontCacheTag *)gmallocn(cacheSets * cacheAssoc,
@@ -97,6 +113,55 @@ void SplashFont::initCache() {
   }
 }
 
+// Double the number of sets in the glyph cache, if that fits in the
+// size limit.  Each old set splits into two new sets; the cached
+// glyphs are moved to their new sets, keeping their MRU order.
+// Returns true if the cache was grown.
+GBool SplashFont::growCache() {
+  Guchar *newCache;
+  SplashFontCacheTag *newCacheTags, *tag;
+  int newCacheSets, set, mru, i, j, k, n;
+
+  if (cacheSets * cacheAssoc * glyphSize > maxCacheSize / 2) {
+    return gFalse;
+  }
+  newCacheSets = cacheSets * 2;
+  newCache = (Guchar *)gmallocn(newCacheSets * cacheAssoc, glyphSize);
+  newCacheTags = (SplashFontCacheTag *)gmallocn(newCacheSets * cacheAssoc,
+						sizeof(SplashFontCacheTag));
+  for (i = 0; i < cacheSets; ++i) {
+    for (k = 0; k < 2; ++k) {
+      set = i + k * cacheSets;
+      n = 0;
+      // valid entries always have the lowest MRU indexes in a set
+      for (mru = 0; mru < cacheAssoc; ++mru) {
+	for (j = 0; j < cacheAssoc; ++j) {
+	  tag = &cacheTags[i * cacheAssoc + j];
+	  if ((tag->mru & 0x80000000) &&
+	      (tag->mru & 0x7fffffff) == mru &&
+	      (tag->c & (newCacheSets - 1)) == set) {
+	    newCacheTags[set * cacheAssoc + n] = *tag;
+	    newCacheTags[set * cacheAssoc + n].mru = 0x80000000 | n;
+	    memcpy(newCache + (set * cacheAssoc + n) * glyphSize,
+		   cache + (i * cacheAssoc + j) * glyphSize, glyphSize);
+	    ++n;
+	  }
+	}
+      }
+      for (; n < cacheAssoc; ++n) {
+	newCacheTags[set * cacheAssoc + n].mru = n;
+      }
+    }
+  }
+  gfree(cache);
+  gfree(cacheTags);
+  cache = newCache;
+  cacheTags = newCacheTags;
+  cacheSets = newCacheSets;
+  ++nCacheResizes;
+  return gTrue;
+}
+
 SplashFont::~SplashFont() {
   fontFile->decRefCnt();
   if (cache) {
@@ -122,6 +187,9 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
 
   // check the cache
   if (cache) {
+    if (++cacheWindowLookups >= 4 * cacheSets * cacheAssoc) {
+      cacheWindowLookups = cacheWindowMisses = 0;
+    }
     i = (c & (cacheSets - 1)) * cacheAssoc;
     for (j = 0; j < cacheAssoc; ++j) {
       if ((cacheTags[i+j].mru & 0x80000000) &&
@@ -143,9 +211,20 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
 	bitmap->aa = aa;
 	bitmap->data = cache + (i+j) * glyphSize;
 	bitmap->freeData = gFalse;
+	++nCacheHits;
 	return gTrue;
       }
     }
+    ++nCacheMisses;
+
+    // if the cache has turned over completely with a high miss rate
+    // (more than one miss per four lookups), try to grow it
+    if (++cacheWindowMisses >= cacheSets * cacheAssoc) {
+      if (cacheWindowLookups < 4 * cacheSets * cacheAssoc && growCache()) {
+	i = (c & (cacheSets - 1)) * cacheAssoc;
+      }
+      cacheWindowLookups = cacheWindowMisses = 0;
+    }
   } else {
     i = 0; // make gcc happy
   }
@@ -171,6 +250,9 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
   p = NULL; // make gcc happy
   for (j = 0; j < cacheAssoc; ++j) {
     if ((cacheTags[i+j].mru & 0x7fffffff) == cacheAssoc - 1) {
+      if (cacheTags[i+j].mru & 0x80000000) {
+	++nCacheEvictions;
+      }
       cacheTags[i+j].mru = 0x80000000;
       cacheTags[i+j].c = c;
       cacheTags[i+j].xFrac = (short)xFrac;
@@ -44,8 +44,12 @@ public:
 	     SplashCoord *textMatA, GBool aaA);
 
   // This must be called after the constructor, so that the subclass
-  // constructor has a chance to compute the bbox.
-  void initCache();
+  // constructor has a chance to compute the bbox (SplashFontEngine
+  // does this after SplashFontFile::makeFont).  The glyph cache
+  // starts out small, and grows (up to <maxCacheSizeA> bytes) if the
+  // miss rate is high.  If <maxCacheSizeA> is zero, glyphs are not
+  // cached.
+  void initCache(int maxCacheSizeA);
 
   virtual ~SplashFont();
 
@@ -90,8 +94,17 @@ public:
   void getBBox(int *xMinA, int *yMinA, int *xMaxA, int *yMaxA)
     { *xMinA = xMin; *yMinA = yMin; *xMaxA = xMax; *yMaxA = yMax; }
 
+  // Glyph cache statistics.
+  int getNumCacheHits() { return nCacheHits; }
+  int getNumCacheMisses() { return nCacheMisses; }
+  int getNumCacheEvictions() { return nCacheEvictions; }
+  int getNumCacheResizes() { return nCacheResizes; }
+  int getCacheSize() { return cacheSets * cacheAssoc * glyphSize; }
+
 protected:
 
+  GBool growCache();
+
   SplashFontFile *fontFile;
   SplashCoord mat[4];		// font transform matrix
 				//   (text space -> device space)
@@ -106,6 +119,10 @@ protected:
   int glyphSize;		// size of glyph bitmaps, in bytes
   int cacheSets;		// number of sets in cache
   int cacheAssoc;		// cache associativity (glyphs per set)
+  int maxCacheSize;		// max size of glyph cache, in bytes
+  int cacheWindowLookups;	// lookups since the last miss rate check
+  int cacheWindowMisses;	// misses since the last miss rate check
+  int nCacheHits, nCacheMisses, nCacheEvictions, nCacheResizes;
 };
 
 #endif
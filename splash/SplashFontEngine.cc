@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #ifndef _WIN32
 #  include <unistd.h>
 #endif
@@ -25,6 +26,7 @@
 #include "SplashFTFontEngine.h"
 #include "SplashFontFile.h"
 #include "SplashFontFileID.h"
+#include "SplashFontFileCache.h"
 #include "SplashFont.h"
 #include "SplashFontEngine.h"
 
@@ -34,6 +36,49 @@ extern "C" int unlink(char *filename);
 #endif
 #endif
 
+//------------------------------------------------------------------------
+
+// FNV-1a hash, used for the parts of the shared font file cache key
+// which can be large (code-to-GID maps and encodings).
+#define splashFontHashInit 0xcbf29ce484222325ULL
+
+static unsigned long long hashBytes(unsigned long long h, Guchar *p, int n) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    h = (h ^ p[i]) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+//------------------------------------------------------------------------
+// SplashFontEngineSharedFile
+//------------------------------------------------------------------------
+
+// A font file from the shared font file cache, which is in use by a
+// SplashFontEngine.  If [id] is non-NULL, the font file was loaded
+// (by another SplashFontEngine) with a different ID, and [id] is the
+// ID used for it by this SplashFontEngine.
+class SplashFontEngineSharedFile {
+public:
+
+  SplashFontEngineSharedFile(SplashFontFileID *idA,
+			     SplashFontFile *fontFileA)
+    { id = idA; fontFile = fontFileA; }
+  ~SplashFontEngineSharedFile();
+  SplashFontFileID *getID() { return id ? id : fontFile->getID(); }
+
+  SplashFontFileID *id;
+  SplashFontFile *fontFile;
+};
+
+SplashFontEngineSharedFile::~SplashFontEngineSharedFile() {
+  if (id) {
+    delete id;
+  }
+  fontFile->decRefCnt();
+}
+
 //------------------------------------------------------------------------
 // SplashFontEngine
 //------------------------------------------------------------------------
@@ -50,8 +95,15 @@ SplashFontEngine::SplashFontEngine(
     fontCache[i] = NULL;
   }
   badFontFiles = new GList();
+  glyphCacheSize = splashFontDefaultGlyphCacheSize;
+  nGlyphCacheHits = nGlyphCacheMisses = 0;
+  nGlyphCacheEvictions = nGlyphCacheResizes = 0;
+  fontFileCache = NULL;
+  sharedFontFiles = new GList();
 
 #if HAVE_FREETYPE_H
+  ftAA = aa;
+  ftFlags = freeTypeFlags;
   if (enableFreeType) {
     ftEngine = SplashFTFontEngine::init(aa, freeTypeFlags);
   } else {
@@ -69,6 +121,7 @@ SplashFontEngine::~SplashFontEngine() {
     }
   }
   deleteGList(badFontFiles, SplashFontFileID);
+  deleteGList(sharedFontFiles, SplashFontEngineSharedFile);
 
 #if HAVE_FREETYPE_H
   if (ftEngine) {
@@ -77,14 +130,47 @@ SplashFontEngine::~SplashFontEngine() {
 #endif
 }
 
+void SplashFontEngine::setFontFileCache(SplashFontFileCache *fontFileCacheA) {
+  fontFileCache = fontFileCacheA;
+}
+
+void SplashFontEngine::getGlyphCacheStats(int *nHits, int *nMisses,
+					  int *nEvictions, int *nResizes) {
+  SplashFont *font;
+  int i;
+
+  *nHits = nGlyphCacheHits;
+  *nMisses = nGlyphCacheMisses;
+  *nEvictions = nGlyphCacheEvictions;
+  *nResizes = nGlyphCacheResizes;
+  for (i = 0; i < splashFontCacheSize; ++i) {
+    if ((font = fontCache[i])) {
+      *nHits += font->getNumCacheHits();
+      *nMisses += font->getNumCacheMisses();
+      *nEvictions += font->getNumCacheEvictions();
+      *nResizes += font->getNumCacheResizes();
+    }
+  }
+}
+
 SplashFontFile *SplashFontEngine::getFontFile(SplashFontFileID *id) {
+  SplashFontEngineSharedFile *sharedFile;
   SplashFontFile *fontFile;
   int i;
 
+  // font files from the shared cache are matched by the ID used in
+  // this engine, which may not be the font file's own ID
+  for (i = 0; i < sharedFontFiles->getLength(); ++i) {
+    sharedFile = (SplashFontEngineSharedFile *)sharedFontFiles->get(i);
+    if (sharedFile->getID()->matches(id)) {
+      return sharedFile->fontFile;
+    }
+  }
   for (i = 0; i < splashFontCacheSize; ++i) {
     if (fontCache[i]) {
       fontFile = fontCache[i]->getFontFile();
-      if (fontFile && fontFile->getID()->matches(id)) {
+      if (fontFile && !isSharedFontFile(fontFile) &&
+	  fontFile->getID()->matches(id)) {
 	return fontFile;
       }
     }
@@ -92,6 +178,38 @@ SplashFontFile *SplashFontEngine::getFontFile(SplashFontFileID *id) {
   return NULL;
 }
 
+GBool SplashFontEngine::isSharedFontFile(SplashFontFile *fontFile) {
+  int i;
+
+  for (i = 0; i < sharedFontFiles->getLength(); ++i) {
+    if (((SplashFontEngineSharedFile *)sharedFontFiles->get(i))->fontFile
+	== fontFile) {
+      return gTrue;
+    }
+  }
+  return gFalse;
+}
+
+// Release the shared font files which are no longer used by any font
+// in the font cache.  (They stay in the shared cache, so they can be
+// found again later.)
+void SplashFontEngine::pruneSharedFontFiles() {
+  SplashFontEngineSharedFile *sharedFile;
+  int i, j;
+
+  for (i = sharedFontFiles->getLength() - 1; i >= 0; --i) {
+    sharedFile = (SplashFontEngineSharedFile *)sharedFontFiles->get(i);
+    for (j = 0; j < splashFontCacheSize; ++j) {
+      if (fontCache[j] && fontCache[j]->getFontFile() == sharedFile->fontFile) {
+	break;
+      }
+    }
+    if (j == splashFontCacheSize) {
+      delete (SplashFontEngineSharedFile *)sharedFontFiles->del(i);
+    }
+  }
+}
+
 GBool SplashFontEngine::checkForBadFontFile(SplashFontFileID *id) {
   for (int i = 0; i < badFontFiles->getLength(); ++i) {
     if (((SplashFontFileID *)badFontFiles->get(i))->matches(id)) {
@@ -109,36 +227,13 @@ SplashFontFile *SplashFontEngine::loadType1Font(SplashFontFileID *idA,
 						GBool deleteFile,
 #endif
 						const char **enc) {
-  SplashFontFile *fontFile;
-
-  fontFile = NULL;
-#if HAVE_FREETYPE_H
-  if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadType1Font(idA,
+  return loadFont(splashFontType1, idA,
 #if LOAD_FONTS_FROM_MEM
-				       fontBuf,
+		  fontBuf,
 #else
-				       fileName, deleteFile,
-#endif
-				       enc);
-  }
+		  fileName, deleteFile,
 #endif
-
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32) && !defined(__ANDROID__)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
-
-  if (!fontFile) {
-    badFontFiles->append(idA);
-  }
-
-  return fontFile;
+		  0, NULL, 0, enc);
 }
 
 SplashFontFile *SplashFontEngine::loadType1CFont(SplashFontFileID *idA,
@@ -150,39 +245,13 @@ SplashFontFile *SplashFontEngine::loadType1CFont(SplashFontFileID *idA,
 #endif
 						 int *codeToGID,
 						 const char **enc) {
-  SplashFontFile *fontFile;
-
-  fontFile = NULL;
-  if (!fontFile) {
-    gfree(codeToGID);
-  }
-#if HAVE_FREETYPE_H
-  if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadType1CFont(idA,
+  return loadFont(splashFontType1C, idA,
 #if LOAD_FONTS_FROM_MEM
-					fontBuf,
+		  fontBuf,
 #else
-					fileName, deleteFile,
-#endif
-					enc);
-  }
-#endif
-
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32) && !defined(__ANDROID__)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
+		  fileName, deleteFile,
 #endif
-
-  if (!fontFile) {
-    badFontFiles->append(idA);
-  }
-
-  return fontFile;
+		  0, codeToGID, codeToGID ? 256 : 0, enc);
 }
 
 SplashFontFile *SplashFontEngine::loadOpenTypeT1CFont(SplashFontFileID *idA,
@@ -194,39 +263,13 @@ SplashFontFile *SplashFontEngine::loadOpenTypeT1CFont(SplashFontFileID *idA,
 #endif
 						      int *codeToGID,
 						      const char **enc) {
-  SplashFontFile *fontFile;
-
-  fontFile = NULL;
-  if (!fontFile) {
-    gfree(codeToGID);
-  }
-#if HAVE_FREETYPE_H
-  if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadOpenTypeT1CFont(idA,
+  return loadFont(splashFontOpenTypeT1C, idA,
 #if LOAD_FONTS_FROM_MEM
-					     fontBuf,
+		  fontBuf,
 #else
-					     fileName, deleteFile,
-#endif
-					     enc);
-  }
-#endif
-
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32) && !defined(__ANDROID__)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
+		  fileName, deleteFile,
 #endif
-
-  if (!fontFile) {
-    badFontFiles->append(idA);
-  }
-
-  return fontFile;
+		  0, codeToGID, codeToGID ? 256 : 0, enc);
 }
 
 SplashFontFile *SplashFontEngine::loadCIDFont(SplashFontFileID *idA,
@@ -238,40 +281,13 @@ SplashFontFile *SplashFontEngine::loadCIDFont(SplashFontFileID *idA,
 #endif
 					      int *codeToGID,
 					      int codeToGIDLen) {
-  SplashFontFile *fontFile;
-
-  fontFile = NULL;
-#if HAVE_FREETYPE_H
-  if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadCIDFont(idA,
+  return loadFont(splashFontCID, idA,
 #if LOAD_FONTS_FROM_MEM
-				     fontBuf,
+		  fontBuf,
 #else
-				     fileName, deleteFile,
+		  fileName, deleteFile,
 #endif
-				     codeToGID, codeToGIDLen);
-  }
-#endif
-
-  if (!fontFile) {
-    gfree(codeToGID);
-  }
-
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32) && !defined(__ANDROID__)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
-
-  if (!fontFile) {
-    badFontFiles->append(idA);
-  }
-
-  return fontFile;
+		  0, codeToGID, codeToGIDLen, NULL);
 }
 
 SplashFontFile *SplashFontEngine::loadOpenTypeCFFFont(SplashFontFileID *idA,
@@ -283,40 +299,13 @@ SplashFontFile *SplashFontEngine::loadOpenTypeCFFFont(SplashFontFileID *idA,
 #endif
 						      int *codeToGID,
 						      int codeToGIDLen) {
-  SplashFontFile *fontFile;
-
-  fontFile = NULL;
-#if HAVE_FREETYPE_H
-  if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadOpenTypeCFFFont(idA,
+  return loadFont(splashFontOpenTypeCFF, idA,
 #if LOAD_FONTS_FROM_MEM
-					     fontBuf,
+		  fontBuf,
 #else
-					     fileName, deleteFile,
+		  fileName, deleteFile,
 #endif
-					     codeToGID, codeToGIDLen);
-  }
-#endif
-
-  if (!fontFile) {
-    gfree(codeToGID);
-  }
-
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32) && !defined(__ANDROID__)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
-
-  if (!fontFile) {
-    badFontFiles->append(idA);
-  }
-
-  return fontFile;
+		  0, codeToGID, codeToGIDLen, NULL);
 }
 
 SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
@@ -330,18 +319,135 @@ SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
 						   int *codeToGID,
 						   int codeToGIDLen,
 						   char *fontName) {
+  return loadFont(splashFontTrueType, idA,
+#if LOAD_FONTS_FROM_MEM
+		  fontBuf,
+#else
+		  fileName, deleteFile,
+#endif
+		  fontNum, codeToGID, codeToGIDLen, NULL);
+}
+
+// Common code for the loadXXXFont functions.  If the font file ID
+// has a cache key, and there is a shared font file cache, the font
+// file is looked up in (or loaded into) the shared cache.
+SplashFontFile *SplashFontEngine::loadFont(SplashFontType fontType,
+					   SplashFontFileID *idA,
+#if LOAD_FONTS_FROM_MEM
+					   GString *fontBuf,
+#else
+					   char *fileName,
+					   GBool deleteFile,
+#endif
+					   int fontNum,
+					   int *codeToGID,
+					   int codeToGIDLen,
+					   const char **enc) {
   SplashFontFile *fontFile;
+  GString *key;
+#if HAVE_FREETYPE_H
+  SplashFTFontEngine *ft;
+#endif
 
   fontFile = NULL;
+  key = makeCacheKey(fontType, idA, fontNum, codeToGID, codeToGIDLen, enc);
+
+  // the 8-bit CFF loaders use the encoding, not the code-to-GID map
+  if (fontType == splashFontType1C || fontType == splashFontOpenTypeT1C) {
+    gfree(codeToGID);
+    codeToGID = NULL;
+    codeToGIDLen = 0;
+  }
+
+  // check the shared cache
+  if (key) {
+    fontFileCache->lock();
+    if ((fontFile = fontFileCache->lookup(key))) {
+      fontFileCache->unlock();
+      delete key;
+      gfree(codeToGID);
+#if LOAD_FONTS_FROM_MEM
+      delete fontBuf;
+#else
+      // nothing has the (temporary) font file open, so it can be
+      // deleted on any platform
+      if (deleteFile) {
+	unlink(fileName);
+      }
+#endif
+      // the cache's font file has some other ID -- keep track of the
+      // mapping from this ID (the cache lookup incremented the
+      // reference count for us)
+      sharedFontFiles->append(new SplashFontEngineSharedFile(idA, fontFile));
+      return fontFile;
+    }
+  }
+
 #if HAVE_FREETYPE_H
-  if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadTrueTypeFont(idA,
+  // font files in the shared cache have to be loaded with the cache's
+  // FreeType engine (with the cache locked)
+  if (key) {
+    ft = fontFileCache->getFTEngine(ftAA, ftFlags);
+  } else {
+    ft = ftEngine;
+  }
+  if (ft) {
+    switch (fontType) {
+    case splashFontType1:
+      fontFile = ft->loadType1Font(idA,
+#if LOAD_FONTS_FROM_MEM
+				   fontBuf,
+#else
+				   fileName, deleteFile,
+#endif
+				   enc);
+      break;
+    case splashFontType1C:
+      fontFile = ft->loadType1CFont(idA,
+#if LOAD_FONTS_FROM_MEM
+				    fontBuf,
+#else
+				    fileName, deleteFile,
+#endif
+				    enc);
+      break;
+    case splashFontOpenTypeT1C:
+      fontFile = ft->loadOpenTypeT1CFont(idA,
+#if LOAD_FONTS_FROM_MEM
+					 fontBuf,
+#else
+					 fileName, deleteFile,
+#endif
+					 enc);
+      break;
+    case splashFontCID:
+      fontFile = ft->loadCIDFont(idA,
 #if LOAD_FONTS_FROM_MEM
-					  fontBuf,
+				 fontBuf,
 #else
-					  fileName, deleteFile,
+				 fileName, deleteFile,
 #endif
-					  fontNum, codeToGID, codeToGIDLen);
+				 codeToGID, codeToGIDLen);
+      break;
+    case splashFontOpenTypeCFF:
+      fontFile = ft->loadOpenTypeCFFFont(idA,
+#if LOAD_FONTS_FROM_MEM
+					 fontBuf,
+#else
+					 fileName, deleteFile,
+#endif
+					 codeToGID, codeToGIDLen);
+      break;
+    case splashFontTrueType:
+      fontFile = ft->loadTrueTypeFont(idA,
+#if LOAD_FONTS_FROM_MEM
+				      fontBuf,
+#else
+				      fileName, deleteFile,
+#endif
+				      fontNum, codeToGID, codeToGIDLen);
+      break;
+    }
   }
 #endif
 
@@ -349,6 +455,18 @@ SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
     gfree(codeToGID);
   }
 
+  if (key) {
+    if (fontFile) {
+      // take this engine's reference first, so the cache can't
+      // discard the new font file
+      fontFile->incRefCnt();
+      sharedFontFiles->append(new SplashFontEngineSharedFile(NULL, fontFile));
+      fontFileCache->add(key, fontFile, idA->getCacheSize());
+    }
+    fontFileCache->unlock();
+    delete key;
+  }
+
 #if !LOAD_FONTS_FROM_MEM && !defined(_WIN32) && !defined(__ANDROID__)
   // delete the (temporary) font file -- with Unix hard link
   // semantics, this will remove the last link; otherwise it will
@@ -366,11 +484,57 @@ SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
   return fontFile;
 }
 
+// Build the shared font file cache key for a font file.  This
+// combines the ID's cache key (which identifies the font file
+// contents) with everything else that affects the loaded font.
+// Returns NULL if the font file can't be shared.
+GString *SplashFontEngine::makeCacheKey(SplashFontType fontType,
+					SplashFontFileID *idA,
+					int fontNum,
+					int *codeToGID, int codeToGIDLen,
+					const char **enc) {
+  unsigned long long codeToGIDHash, encHash;
+  const char *p;
+  int i;
+
+  if (!fontFileCache || !idA->getCacheKey()) {
+    return NULL;
+  }
+#if HAVE_FREETYPE_H
+  if (!ftEngine) {
+    return NULL;
+  }
+#endif
+  codeToGIDHash = hashBytes(splashFontHashInit,
+			    (Guchar *)codeToGID,
+			    codeToGID ? codeToGIDLen * (int)sizeof(int) : 0);
+  encHash = splashFontHashInit;
+  if (enc) {
+    for (i = 0; i < 256; ++i) {
+      if ((p = enc[i])) {
+	encHash = hashBytes(encHash, (Guchar *)p, (int)strlen(p) + 1);
+      } else {
+	encHash = hashBytes(encHash, (Guchar *)"\xff", 1);
+      }
+    }
+  }
+  return GString::format("{0:t}/{1:d}/{2:d}/{3:d}/{4:ullx}/{5:ullx}/{6:d}/{7:ux}",
+			 idA->getCacheKey(), (int)fontType, fontNum,
+			 codeToGIDLen, codeToGIDHash, encHash,
+#if HAVE_FREETYPE_H
+			 ftAA ? 1 : 0, ftFlags
+#else
+			 0, 0
+#endif
+			 );
+}
+
 SplashFont *SplashFontEngine::getFont(SplashFontFile *fontFile,
 				      SplashCoord *textMat,
 				      SplashCoord *ctm) {
   SplashCoord mat[4];
   SplashFont *font;
+  GBool evicted;
   int i, j;
 
   mat[0] = textMat[0] * ctm[0] + textMat[1] * ctm[2];
@@ -398,12 +562,28 @@ SplashFont *SplashFontEngine::getFont(SplashFontFile *fontFile,
     }
   }
   font = fontFile->makeFont(mat, textMat);
+  font->initCache(glyphCacheSize);
   if (fontCache[splashFontCacheSize - 1]) {
-    delete fontCache[splashFontCacheSize - 1];
+    deleteFont(fontCache[splashFontCacheSize - 1]);
+    evicted = gTrue;
+  } else {
+    evicted = gFalse;
   }
   for (j = splashFontCacheSize - 1; j > 0; --j) {
     fontCache[j] = fontCache[j-1];
   }
   fontCache[0] = font;
+  if (evicted && sharedFontFiles->getLength() > 0) {
+    pruneSharedFontFiles();
+  }
   return font;
 }
+
+// Delete a font, saving its glyph cache statistics.
+void SplashFontEngine::deleteFont(SplashFont *font) {
+  nGlyphCacheHits += font->getNumCacheHits();
+  nGlyphCacheMisses += font->getNumCacheMisses();
+  nGlyphCacheEvictions += font->getNumCacheEvictions();
+  nGlyphCacheResizes += font->getNumCacheResizes();
+  delete font;
+}
@@ -16,20 +16,24 @@
 #endif
 
 #include "gtypes.h"
+#include "SplashFontFile.h"
 class GString;
 class GList;
 
 class SplashFTFontEngine;
 class SplashDTFontEngine;
 class SplashDT4FontEngine;
-class SplashFontFile;
 class SplashFontFileID;
+class SplashFontFileCache;
 class SplashFont;
 
 //------------------------------------------------------------------------
 
 #define splashFontCacheSize 16
 
+// default limit on the size of each font's glyph cache, in bytes
+#define splashFontDefaultGlyphCacheSize (1024 * 1024)
+
 #if HAVE_FREETYPE_H
 #define splashFTNoHinting (1 << 0)
 #endif
@@ -51,6 +55,23 @@ public:
 
   ~SplashFontEngine();
 
+  // Use a shared font file cache.  Font files whose IDs have a cache
+  // key (see SplashFontFileID::setCacheKey) are looked up in, and
+  // loaded into, the shared cache -- so a font embedded in many
+  // documents is only parsed once.  The cache must outlive this
+  // SplashFontEngine.
+  void setFontFileCache(SplashFontFileCache *fontFileCacheA);
+
+  // Set the limit on the size of each font's glyph cache, in bytes.
+  // This only affects fonts created after the call.
+  void setGlyphCacheSize(int glyphCacheSizeA)
+    { glyphCacheSize = glyphCacheSizeA; }
+
+  // Get glyph cache statistics, totaled over all fonts created by
+  // this engine.
+  void getGlyphCacheStats(int *nHits, int *nMisses, int *nEvictions,
+			  int *nResizes);
+
   // Get a font file from the cache.  Returns NULL if there is no
   // matching entry in the cache.
   SplashFontFile *getFontFile(SplashFontFileID *id);
@@ -118,11 +139,40 @@ public:
 
 private:
 
+  SplashFontFile *loadFont(SplashFontType fontType,
+			   SplashFontFileID *idA,
+#if LOAD_FONTS_FROM_MEM
+			   GString *fontBuf,
+#else
+			   char *fileName, GBool deleteFile,
+#endif
+			   int fontNum,
+			   int *codeToGID, int codeToGIDLen,
+			   const char **enc);
+  GString *makeCacheKey(SplashFontType fontType, SplashFontFileID *idA,
+			int fontNum, int *codeToGID, int codeToGIDLen,
+			const char **enc);
+  GBool isSharedFontFile(SplashFontFile *fontFile);
+  void pruneSharedFontFiles();
+  void deleteFont(SplashFont *font);
+
   SplashFont *fontCache[splashFontCacheSize];
   GList *badFontFiles;		// [SplashFontFileID]
+  int glyphCacheSize;		// max size of each font's glyph cache
+  int nGlyphCacheHits,		// glyph cache statistics for fonts
+      nGlyphCacheMisses,	//   which have been deleted
+      nGlyphCacheEvictions,
+      nGlyphCacheResizes;
+  SplashFontFileCache *fontFileCache;	// shared font file cache
+					//   (may be NULL)
+  GList *sharedFontFiles;	// [SplashFontEngineSharedFile] - font
+				//   files from the shared cache which
+				//   are in use by this engine
 
 #if HAVE_FREETYPE_H
   SplashFTFontEngine *ftEngine;
+  GBool ftAA;			// FreeType settings (needed to get the
+  Guint ftFlags;		//   shared cache's FreeType engine)
 #endif
 };
 
@@ -51,7 +51,8 @@ public:
   virtual ~SplashFontFile();
 
   // Create a new SplashFont, i.e., a scaled instance of this font
-  // file.
+  // file.  The caller must call SplashFont::initCache() on the new
+  // font.
   virtual SplashFont *makeFont(SplashCoord *mat, SplashCoord *textMat) = 0;
 
   // Get the font file ID.
@@ -64,6 +65,13 @@ public:
   // the SplashFontFile object.
   void decRefCnt();
 
+  // Get the current reference count.
+#if MULTITHREADED
+  int getRefCnt() { return (int)gAtomicRead(&refCnt); }
+#else
+  int getRefCnt() { return refCnt; }
+#endif
+
 protected:
 
   SplashFontFile(SplashFontFileID *idA,
@@ -0,0 +1,161 @@
+//========================================================================
+//
+// SplashFontFileCache.cc
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "gmem.h"
+#include "gmempp.h"
+#include "GString.h"
+#include "GList.h"
+#include "SplashFontFile.h"
+#if HAVE_FREETYPE_H
+#include "SplashFTFontEngine.h"
+#endif
+#include "SplashFontFileCache.h"
+
+//------------------------------------------------------------------------
+// SplashFontFileCacheEntry
+//------------------------------------------------------------------------
+
+class SplashFontFileCacheEntry {
+public:
+
+  SplashFontFileCacheEntry(GString *keyA, SplashFontFile *fontFileA,
+			   size_t sizeA);
+  ~SplashFontFileCacheEntry();
+
+  GString *key;
+  SplashFontFile *fontFile;
+  size_t size;
+};
+
+SplashFontFileCacheEntry::SplashFontFileCacheEntry(GString *keyA,
+						   SplashFontFile *fontFileA,
+						   size_t sizeA) {
+  key = keyA->copy();
+  fontFile = fontFileA;
+  fontFile->incRefCnt();
+  size = sizeA;
+}
+
+SplashFontFileCacheEntry::~SplashFontFileCacheEntry() {
+  delete key;
+  fontFile->decRefCnt();
+}
+
+//------------------------------------------------------------------------
+// SplashFontFileCache
+//------------------------------------------------------------------------
+
+SplashFontFileCache::SplashFontFileCache(size_t maxSizeA) {
+  entries = new GList();
+  size = 0;
+  maxSize = maxSizeA;
+  nHits = nMisses = nEvictions = 0;
+#if HAVE_FREETYPE_H
+  ftEngines = new GList();
+#endif
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+SplashFontFileCache::~SplashFontFileCache() {
+  // the font files must be freed before the FreeType engines
+  deleteGList(entries, SplashFontFileCacheEntry);
+#if HAVE_FREETYPE_H
+  deleteGList(ftEngines, SplashFTFontEngine);
+#endif
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+void SplashFontFileCache::lock() {
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+}
+
+void SplashFontFileCache::unlock() {
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+SplashFontFile *SplashFontFileCache::lookup(GString *key) {
+  SplashFontFileCacheEntry *entry;
+  int i;
+
+  for (i = 0; i < entries->getLength(); ++i) {
+    entry = (SplashFontFileCacheEntry *)entries->get(i);
+    if (!entry->key->cmp(key)) {
+      if (i > 0) {
+	entries->del(i);
+	entries->insert(0, entry);
+      }
+      entry->fontFile->incRefCnt();
+      ++nHits;
+      return entry->fontFile;
+    }
+  }
+  ++nMisses;
+  return NULL;
+}
+
+void SplashFontFileCache::add(GString *key, SplashFontFile *fontFile,
+			      size_t fileSize) {
+  entries->insert(0, new SplashFontFileCacheEntry(key, fontFile, fileSize));
+  size += fileSize;
+  shrink();
+}
+
+#if HAVE_FREETYPE_H
+SplashFTFontEngine *SplashFontFileCache::getFTEngine(GBool aa, Guint flags) {
+  SplashFTFontEngine *ftEngine;
+  int i;
+
+  for (i = 0; i < ftEngines->getLength(); ++i) {
+    ftEngine = (SplashFTFontEngine *)ftEngines->get(i);
+    if (ftEngine->aa == aa && ftEngine->flags == flags) {
+      return ftEngine;
+    }
+  }
+  if (!(ftEngine = SplashFTFontEngine::init(aa, flags))) {
+    return NULL;
+  }
+  ftEngines->append(ftEngine);
+  return ftEngine;
+}
+#endif
+
+// Remove least recently used font files until the cache is under the
+// size limit.  Only font files which aren't referenced anywhere else
+// (i.e., whose only reference is the cache's) are removed -- this
+// guarantees that FreeType faces are only freed while the cache is
+// locked, which is required because the FreeType library is shared.
+// The caller must have locked the mutex.
+void SplashFontFileCache::shrink() {
+  SplashFontFileCacheEntry *entry;
+  int i;
+
+  for (i = entries->getLength() - 1; i >= 0 && size > maxSize; --i) {
+    entry = (SplashFontFileCacheEntry *)entries->get(i);
+    if (entry->fontFile->getRefCnt() == 1) {
+      entries->del(i);
+      size -= entry->size;
+      delete entry;
+      ++nEvictions;
+    }
+  }
+}
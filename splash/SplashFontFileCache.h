@@ -0,0 +1,100 @@
+//========================================================================
+//
+// SplashFontFileCache.h
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#ifndef SPLASHFONTFILECACHE_H
+#define SPLASHFONTFILECACHE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <stddef.h>
+#include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+
+class GString;
+class GList;
+class SplashFontFile;
+class SplashFTFontEngine;
+
+//------------------------------------------------------------------------
+// SplashFontFileCache
+//------------------------------------------------------------------------
+
+// This holds loaded font files, keyed by a string which identifies
+// the font file contents and everything else that affects the loaded
+// font (font type, encoding, code-to-GID mapping, rasterizer flags).
+// A SplashFontFileCache can be shared by any number of
+// SplashFontEngine objects, including ones in different threads and
+// ones rendering different documents, so a font which is embedded in
+// many documents is only parsed once.
+//
+// Font files are loaded with FreeType engines owned by the cache
+// (FreeType faces can't outlive their library).  The cache holds a
+// reference to each font file; the least recently used files which
+// are not in use elsewhere are discarded when the total size exceeds
+// the limit.
+class SplashFontFileCache {
+public:
+
+  SplashFontFileCache(size_t maxSizeA);
+  ~SplashFontFileCache();
+
+  // The cache must be locked around calls to lookup(), add(), and
+  // getFTEngine(), and around loading a font file with the FreeType
+  // engine returned by getFTEngine().
+  void lock();
+  void unlock();
+
+  // Find the font file for [key].  If found, the font file's
+  // reference count is incremented, and the file is returned;
+  // otherwise returns NULL.
+  SplashFontFile *lookup(GString *key);
+
+  // Add a newly loaded font file, with an approximate size (in
+  // bytes).  The cache takes its own reference to the font file, and
+  // makes a copy of [key].
+  void add(GString *key, SplashFontFile *fontFile, size_t fileSize);
+
+#if HAVE_FREETYPE_H
+  // Get the shared FreeType engine for the specified anti-aliasing
+  // and flags settings.  Returns NULL if FreeType can't be
+  // initialized.
+  SplashFTFontEngine *getFTEngine(GBool aa, Guint flags);
+#endif
+
+  // Statistics.
+  int getNumHits() { return nHits; }
+  int getNumMisses() { return nMisses; }
+  int getNumEvictions() { return nEvictions; }
+  size_t getSize() { return size; }
+  size_t getMaxSize() { return maxSize; }
+
+private:
+
+  void shrink();
+
+  GList *entries;		// [SplashFontFileCacheEntry], most
+				//   recently used first
+  size_t size;			// total size of cached font files
+  size_t maxSize;
+  int nHits, nMisses, nEvictions;
+#if HAVE_FREETYPE_H
+  GList *ftEngines;		// [SplashFTFontEngine]
+#endif
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+#endif
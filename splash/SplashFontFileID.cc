@@ -12,7 +12,9 @@
 #pragma implementation
 #endif
 
+#include <stddef.h>
 #include "gmempp.h"
+#include "GString.h"
 #include "SplashFontFileID.h"
 
 //------------------------------------------------------------------------
@@ -20,7 +22,20 @@
 //------------------------------------------------------------------------
 
 SplashFontFileID::SplashFontFileID() {
+  cacheKey = NULL;
+  cacheSize = 0;
 }
 
 SplashFontFileID::~SplashFontFileID() {
+  if (cacheKey) {
+    delete cacheKey;
+  }
+}
+
+void SplashFontFileID::setCacheKey(GString *keyA, int sizeA) {
+  if (cacheKey) {
+    delete cacheKey;
+  }
+  cacheKey = keyA;
+  cacheSize = sizeA;
 }
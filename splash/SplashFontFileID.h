@@ -17,6 +17,8 @@
 
 #include "gtypes.h"
 
+class GString;
+
 //------------------------------------------------------------------------
 // SplashFontFileID
 //------------------------------------------------------------------------
@@ -27,6 +29,21 @@ public:
   SplashFontFileID();
   virtual ~SplashFontFileID();
   virtual GBool matches(SplashFontFileID *id) = 0;
+
+  // Set the key which identifies the contents of the font file
+  // (e.g., a digest of the embedded font data, or the path of an
+  // external font file), and the approximate size of the font file.
+  // Font files with a key can be shared through a
+  // SplashFontFileCache.  This takes ownership of [keyA].
+  void setCacheKey(GString *keyA, int sizeA);
+
+  GString *getCacheKey() { return cacheKey; }
+  int getCacheSize() { return cacheSize; }
+
+private:
+
+  GString *cacheKey;
+  int cacheSize;
 };
 
 #endif
@@ -384,7 +384,7 @@ AcroForm *AcroForm::load(PDFDoc *docA, Catalog *catalog, Object *acroFormObjA) {
     // scan the annotations, looking for Widget-type annots that are
     // not attached to the AcroForm object
     for (pageNum = 1; pageNum <= catalog->getNumPages(); ++pageNum) {
-      if (catalog->getPage(pageNum)->getAnnots(&annotsObj)->isArray()) {
+      if (catalog->getPageAnnots(pageNum, &annotsObj)->isArray()) {
 	for (i = 0; i < annotsObj.arrayGetLength(); ++i) {
 	  if (annotsObj.arrayGetNF(i, &annotRef)->isRef()) {
 	    for (j = 0; j < acroForm->fields->getLength(); ++j) {
@@ -425,7 +425,7 @@ AcroForm *AcroForm::load(PDFDoc *docA, Catalog *catalog, Object *acroFormObjA) {
 
     // scan the annotations, looking for any Widget-type annots
     for (pageNum = 1; pageNum <= catalog->getNumPages(); ++pageNum) {
-      if (catalog->getPage(pageNum)->getAnnots(&annotsObj)->isArray()) {
+      if (catalog->getPageAnnots(pageNum, &annotsObj)->isArray()) {
 	for (i = 0; i < annotsObj.arrayGetLength(); ++i) {
 	  if (annotsObj.arrayGetNF(i, &annotRef)->isRef()) {
 	    annotRef.fetch(acroForm->doc->getXRef(), &annotObj);
@@ -478,7 +478,7 @@ void AcroForm::buildAnnotPageList(Catalog *catalog) {
   int pageNum, i;
 
   for (pageNum = 1; pageNum <= catalog->getNumPages(); ++pageNum) {
-    if (catalog->getPage(pageNum)->getAnnots(&annotsObj)->isArray()) {
+    if (catalog->getPageAnnots(pageNum, &annotsObj)->isArray()) {
       for (i = 0; i < annotsObj.arrayGetLength(); ++i) {
 	if (annotsObj.arrayGetNF(i, &annotObj)->isRef()) {
 	  annotPages->append(new AcroFormAnnotPage(annotObj.getRefNum(),
@@ -39,19 +39,23 @@
 class PageTreeNode {
 public:
 
-  PageTreeNode(Ref refA, int countA, PageTreeNode *parentA);
+  PageTreeNode(Ref refA, int countA, GBool leafA, PageTreeNode *parentA);
   ~PageTreeNode();
 
   Ref ref;
   int count;
+  GBool leaf;			// true for a Page (as opposed to Pages) node
   PageTreeNode *parent;
-  GList *kids;			// [PageTreeNode]
+  GList *kids;			// [PageTreeNode] (NULL for a leaf node or
+				//   an unread internal node)
   PageAttrs *attrs;
 };
 
-PageTreeNode::PageTreeNode(Ref refA, int countA, PageTreeNode *parentA) {
+PageTreeNode::PageTreeNode(Ref refA, int countA, GBool leafA,
+			   PageTreeNode *parentA) {
   ref = refA;
   count = countA;
+  leaf = leafA;
   parent = parentA;
   kids = NULL;
   attrs = NULL;
@@ -155,6 +159,14 @@ Catalog::Catalog(PDFDoc *docA) {
   pageTree = NULL;
   pages = NULL;
   pageRefs = NULL;
+  pageNodes = NULL;
+  pageIndexed = NULL;
+  pageRefHash = NULL;
+  pageRefHashSize = 0;
+  pageIndexDone = 0;
+  pageLRU = NULL;
+  pageLRULen = 0;
+  pageCacheSize = 0;
   numPages = 0;
   baseURI = NULL;
   form = NULL;
@@ -271,7 +283,11 @@ Catalog::~Catalog() {
     }
     gfree(pages);
     gfree(pageRefs);
+    gfree(pageNodes);
+    gfree(pageIndexed);
   }
+  gfree(pageRefHash);
+  gfree(pageLRU);
 #if MULTITHREADED
   gDestroyMutex(&pageMutex);
 #endif
@@ -298,15 +314,43 @@ Catalog::~Catalog() {
 }
 
 Page *Catalog::getPage(int i) {
-  Page *page;
+  PageTreeNode *node;
+  Page *page, *page2;
 
 #if MULTITHREADED
   gLockMutex(&pageMutex);
 #endif
-  if (!pages[i-1]) {
-    loadPage(i);
+  if ((page = pages[i-1])) {
+    touchPage(i);
+#if MULTITHREADED
+    gUnlockMutex(&pageMutex);
+#endif
+    return page;
   }
-  page = pages[i-1];
+  if (!pageIndexed[i-1]) {
+    indexPage(i);
+  }
+  node = pageNodes[i-1];
+#if MULTITHREADED
+  gUnlockMutex(&pageMutex);
+#endif
+
+  // create the Page object without holding the mutex, so other
+  // threads can get pages which have already been loaded -- if
+  // another thread creates the same page in the meantime, use that
+  // one instead
+  page = makePage(i, node);
+
+#if MULTITHREADED
+  gLockMutex(&pageMutex);
+#endif
+  if ((page2 = pages[i-1])) {
+    delete page;
+    page = page2;
+  } else {
+    pages[i-1] = page;
+  }
+  touchPage(i);
 #if MULTITHREADED
   gUnlockMutex(&pageMutex);
 #endif
@@ -314,19 +358,62 @@ Page *Catalog::getPage(int i) {
 }
 
 Ref *Catalog::getPageRef(int i) {
+  // once the page index is complete, pageRefs is never modified
+#if MULTITHREADED
+  if (gAtomicRead(&pageIndexDone)) {
+#else
+  if (pageIndexDone) {
+#endif
+    return &pageRefs[i-1];
+  }
+#if MULTITHREADED
+  gLockMutex(&pageMutex);
+#endif
+  if (!pageIndexed[i-1]) {
+    indexPage(i);
+  }
+#if MULTITHREADED
+  gUnlockMutex(&pageMutex);
+#endif
+  return &pageRefs[i-1];
+}
+
+Object *Catalog::getPageAnnots(int i, Object *obj) {
+  Object pageRefObj, pageObj, contentsObj;
   Ref *pageRef;
+  Page *page;
 
 #if MULTITHREADED
   gLockMutex(&pageMutex);
 #endif
-  if (!pages[i-1]) {
-    loadPage(i);
+  if ((page = pages[i-1])) {
+    page->getAnnots(obj);
   }
-  pageRef = &pageRefs[i-1];
 #if MULTITHREADED
   gUnlockMutex(&pageMutex);
 #endif
-  return pageRef;
+  if (page) {
+    return obj;
+  }
+
+  obj->initNull();
+  pageRef = getPageRef(i);
+  if (pageRef->num < 0) {
+    return obj;
+  }
+  pageRefObj.initRef(pageRef->num, pageRef->gen);
+  if (pageRefObj.fetch(xref, &pageObj)->isDict()) {
+    // the Page constructor rejects pages with invalid Annots or
+    // Contents entries, so those pages don't have any annotations
+    pageObj.dictLookupNF("Contents", &contentsObj);
+    if (contentsObj.isRef() || contentsObj.isArray() || contentsObj.isNull()) {
+      pageObj.dictLookup("Annots", obj);
+    }
+    contentsObj.free();
+  }
+  pageObj.free();
+  pageRefObj.free();
+  return obj;
 }
 
 void Catalog::doneWithPage(int i) {
@@ -336,12 +423,75 @@ void Catalog::doneWithPage(int i) {
   if (pages[i-1]) {
     delete pages[i-1];
     pages[i-1] = NULL;
+    removePageFromLRU(i);
   }
 #if MULTITHREADED
   gUnlockMutex(&pageMutex);
 #endif
 }
 
+void Catalog::setPageCacheSize(int n) {
+  int i;
+
+#if MULTITHREADED
+  gLockMutex(&pageMutex);
+#endif
+  pageCacheSize = n > 0 ? n : 0;
+  gfree(pageLRU);
+  pageLRU = NULL;
+  pageLRULen = 0;
+  if (pageCacheSize > 0) {
+    // the already-loaded pages are added to the LRU list in page
+    // number order
+    pageLRU = (int *)gmallocn(pageCacheSize + 1, sizeof(int));
+    for (i = 1; i <= numPages; ++i) {
+      if (pages[i-1]) {
+	touchPage(i);
+      }
+    }
+  }
+#if MULTITHREADED
+  gUnlockMutex(&pageMutex);
+#endif
+}
+
+// Move page <pg> to the head of the LRU list (adding it if needed),
+// and delete the least recently used page if the list is full.  The
+// mutex must be locked.
+void Catalog::touchPage(int pg) {
+  int i, oldPg;
+
+  if (pageCacheSize <= 0) {
+    return;
+  }
+  for (i = 0; i < pageLRULen && pageLRU[i] != pg; ++i) ;
+  if (i == pageLRULen) {
+    ++pageLRULen;
+  }
+  for (; i > 0; --i) {
+    pageLRU[i] = pageLRU[i-1];
+  }
+  pageLRU[0] = pg;
+  while (pageLRULen > pageCacheSize) {
+    oldPg = pageLRU[--pageLRULen];
+    delete pages[oldPg-1];
+    pages[oldPg-1] = NULL;
+  }
+}
+
+// The mutex must be locked.
+void Catalog::removePageFromLRU(int pg) {
+  int i;
+
+  for (i = 0; i < pageLRULen && pageLRU[i] != pg; ++i) ;
+  if (i < pageLRULen) {
+    --pageLRULen;
+    for (; i < pageLRULen; ++i) {
+      pageLRU[i] = pageLRU[i+1];
+    }
+  }
+}
+
 GString *Catalog::readMetadata() {
   GString *s;
   Dict *dict;
@@ -367,26 +517,40 @@ GString *Catalog::readMetadata() {
   return s;
 }
 
+#define pageRefHashFunc(num) ((Guint)(num) * 2654435761u)
+
 int Catalog::findPage(int num, int gen) {
-  int i;
+  Guint h;
+  int pg;
 
 #if MULTITHREADED
-  gLockMutex(&pageMutex);
-#endif
-  for (i = 0; i < numPages; ++i) {
-    if (!pages[i]) {
-      loadPage(i+1);
+  if (!gAtomicRead(&pageIndexDone)) {
+    gLockMutex(&pageMutex);
+    if (!pageIndexDone) {
+      buildPageIndex();
+      gAtomicIncrement(&pageIndexDone);
     }
-    if (pageRefs[i].num == num && pageRefs[i].gen == gen) {
-#if MULTITHREADED
-      gUnlockMutex(&pageMutex);
+    gUnlockMutex(&pageMutex);
+  }
+#else
+  if (!pageIndexDone) {
+    buildPageIndex();
+    pageIndexDone = 1;
+  }
 #endif
-      return i + 1;
+
+  // the index is never modified after it's built, so this doesn't
+  // need the mutex
+  if (!pageRefHash) {
+    return 0;
+  }
+  h = pageRefHashFunc(num) & (pageRefHashSize - 1);
+  while ((pg = pageRefHash[h])) {
+    if (pageRefs[pg-1].num == num && pageRefs[pg-1].gen == gen) {
+      return pg;
     }
+    h = (h + 1) & (pageRefHashSize - 1);
   }
-#if MULTITHREADED
-  gUnlockMutex(&pageMutex);
-#endif
   return 0;
 }
 
@@ -501,7 +665,8 @@ Object *Catalog::findDestInTree(Object *tree, GString *name, Object *obj) {
 }
 
 GBool Catalog::readPageTree(Object *catDict) {
-  Object topPagesRef, topPagesObj, countObj;
+  Object topPagesRef, topPagesObj, countObj, kidsObj;
+  GBool leaf;
   int i;
 
   if (!catDict->dictLookupNF("Pages", &topPagesRef)->isRef()) {
@@ -540,15 +705,22 @@ GBool Catalog::readPageTree(Object *catDict) {
     numPages = 0;
     return gFalse;
   }
-  pageTree = new PageTreeNode(topPagesRef.getRef(), numPages, NULL);
+  leaf = !topPagesObj.dictLookup("Kids", &kidsObj)->isArray();
+  kidsObj.free();
+  pageTree = new PageTreeNode(topPagesRef.getRef(), numPages, leaf, NULL);
   topPagesObj.free();
   topPagesRef.free();
   pages = (Page **)greallocn(pages, numPages, sizeof(Page *));
   pageRefs = (Ref *)greallocn(pageRefs, numPages, sizeof(Ref));
+  pageNodes = (PageTreeNode **)greallocn(pageNodes, numPages,
+					 sizeof(PageTreeNode *));
+  pageIndexed = (char *)grealloc(pageIndexed, numPages);
   for (i = 0; i < numPages; ++i) {
     pages[i] = NULL;
     pageRefs[i].num = -1;
     pageRefs[i].gen = -1;
+    pageNodes[i] = NULL;
+    pageIndexed[i] = 0;
   }
   return gTrue;
 }
@@ -580,118 +752,195 @@ int Catalog::countPageTree(Object *pagesObj) {
   return n;
 }
 
-void Catalog::loadPage(int pg) {
-  loadPage2(pg, pg - 1, pageTree);
-}
-
-void Catalog::loadPage2(int pg, int relPg, PageTreeNode *node) {
-  Object pageRefObj, pageObj, kidsObj, kidRefObj, kidObj, countObj;
-  PageTreeNode *kidNode, *p;
+// Read an internal node of the page tree: merge its PageAttrs, and
+// create the kid nodes.  Returns false on error.  The mutex must be
+// locked.
+GBool Catalog::readPageTreeNode(PageTreeNode *node) {
+  Object pageRefObj, pageObj, kidsObj, kidRefObj, kidObj, countObj, obj;
+  PageTreeNode *p;
   PageAttrs *attrs;
+  GBool leaf;
   int count, i;
 
-  if (relPg >= node->count) {
-    error(errSyntaxError, -1, "Internal error in page tree");
-    pages[pg-1] = new Page(doc, pg);
-    return;
+  // check for a loop in the page tree
+  for (p = node->parent; p; p = p->parent) {
+    if (node->ref.num == p->ref.num && node->ref.gen == p->ref.gen) {
+      error(errSyntaxError, -1, "Loop in Pages tree");
+      return gFalse;
+    }
   }
 
-  // if this node has not been filled in yet, it's either a leaf node
-  // or an unread internal node
-  if (!node->kids) {
+  // fetch the Pages object
+  pageRefObj.initRef(node->ref.num, node->ref.gen);
+  if (!pageRefObj.fetch(xref, &pageObj)->isDict()) {
+    error(errSyntaxError, -1, "Page tree object is wrong type ({0:s})",
+	  pageObj.getTypeName());
+    pageObj.free();
+    pageRefObj.free();
+    return gFalse;
+  }
 
-    // check for a loop in the page tree
-    for (p = node->parent; p; p = p->parent) {
-      if (node->ref.num == p->ref.num && node->ref.gen == p->ref.gen) {
-	error(errSyntaxError, -1, "Loop in Pages tree");
-	pages[pg-1] = new Page(doc, pg);
-	return;
-      }
-    }
+  // if "Kids" is missing, this is actually a leaf node
+  if (!pageObj.dictLookup("Kids", &kidsObj)->isArray()) {
+    node->leaf = gTrue;
+    kidsObj.free();
+    pageObj.free();
+    pageRefObj.free();
+    return gTrue;
+  }
 
-    // fetch the Page/Pages object
-    pageRefObj.initRef(node->ref.num, node->ref.gen);
-    if (!pageRefObj.fetch(xref, &pageObj)->isDict()) {
-      error(errSyntaxError, -1, "Page tree object is wrong type ({0:s})",
-	    pageObj.getTypeName());
-      pageObj.free();
-      pageRefObj.free();
-      pages[pg-1] = new Page(doc, pg);
-      return;
-    }
+  // merge the PageAttrs
+  attrs = new PageAttrs(node->parent ? node->parent->attrs
+			             : (PageAttrs *)NULL,
+			pageObj.getDict(), xref);
+  node->attrs = attrs;
 
-    // merge the PageAttrs
-    attrs = new PageAttrs(node->parent ? node->parent->attrs
-			               : (PageAttrs *)NULL,
-			  pageObj.getDict(), xref);
-
-    // if "Kids" exists, it's an internal node
-    if (pageObj.dictLookup("Kids", &kidsObj)->isArray()) {
-
-      // save the PageAttrs
-      node->attrs = attrs;
-
-      // read the kids
-      node->kids = new GList();
-      for (i = 0; i < kidsObj.arrayGetLength(); ++i) {
-	if (kidsObj.arrayGetNF(i, &kidRefObj)->isRef()) {
-	  if (kidRefObj.fetch(xref, &kidObj)->isDict()) {
-	    if (kidObj.dictLookup("Count", &countObj)->isInt()) {
-	      count = countObj.getInt();
-	    } else {
-	      count = 1;
-	    }
-	    countObj.free();
-	    node->kids->append(new PageTreeNode(kidRefObj.getRef(), count,
-						node));
-	  } else {
-	    error(errSyntaxError, -1, "Page tree object is wrong type ({0:s})",
-		  kidObj.getTypeName());
-	  }
-	  kidObj.free();
+  // read the kids
+  node->kids = new GList();
+  for (i = 0; i < kidsObj.arrayGetLength(); ++i) {
+    if (kidsObj.arrayGetNF(i, &kidRefObj)->isRef()) {
+      if (kidRefObj.fetch(xref, &kidObj)->isDict()) {
+	if (kidObj.dictLookup("Count", &countObj)->isInt()) {
+	  count = countObj.getInt();
 	} else {
-	  error(errSyntaxError, -1,
-		"Page tree reference is wrong type ({0:s})",
-		kidRefObj.getTypeName());
+	  count = 1;
 	}
-	kidRefObj.free();
+	countObj.free();
+	leaf = !kidObj.dictLookup("Kids", &obj)->isArray();
+	obj.free();
+	node->kids->append(new PageTreeNode(kidRefObj.getRef(), count, leaf,
+					    node));
+      } else {
+	error(errSyntaxError, -1, "Page tree object is wrong type ({0:s})",
+	      kidObj.getTypeName());
       }
-
+      kidObj.free();
     } else {
-      
-      // create the Page object
-      pageRefs[pg-1] = node->ref;
-      pages[pg-1] = new Page(doc, pg, pageObj.getDict(), attrs);
-      if (!pages[pg-1]->isOk()) {
-	delete pages[pg-1];
-	pages[pg-1] = new Page(doc, pg);
-      }
-
+      error(errSyntaxError, -1,
+	    "Page tree reference is wrong type ({0:s})",
+	    kidRefObj.getTypeName());
     }
-
-    kidsObj.free();
-    pageObj.free();
-    pageRefObj.free();
+    kidRefObj.free();
   }
 
-  // recursively descend the tree
-  if (node->kids) {
+  kidsObj.free();
+  pageObj.free();
+  pageRefObj.free();
+  return gTrue;
+}
+
+// Find the page tree leaf node for page <pg>, reading internal nodes
+// as needed, and fill in pageRefs[pg-1] and pageNodes[pg-1].  This
+// doesn't fetch the Page object itself.  The mutex must be locked.
+void Catalog::indexPage(int pg) {
+  PageTreeNode *node, *kidNode;
+  int relPg, i;
+
+  pageIndexed[pg-1] = 1;
+  node = pageTree;
+  relPg = pg - 1;
+  while (1) {
+    if (relPg >= node->count) {
+      error(errSyntaxError, -1, "Internal error in page tree");
+      return;
+    }
+    if (!node->leaf && !node->kids) {
+      if (!readPageTreeNode(node)) {
+	return;
+      }
+    }
+    if (node->leaf) {
+      pageRefs[pg-1] = node->ref;
+      pageNodes[pg-1] = node;
+      return;
+    }
+    kidNode = NULL;
     for (i = 0; i < node->kids->getLength(); ++i) {
       kidNode = (PageTreeNode *)node->kids->get(i);
       if (relPg < kidNode->count) {
-	loadPage2(pg, relPg, kidNode);
 	break;
       }
       relPg -= kidNode->count;
     }
-
     // this will only happen if the page tree is invalid
     // (i.e., parent count > sum of children counts)
-    if (i == node->kids->getLength()) {
+    if (!kidNode || i == node->kids->getLength()) {
       error(errSyntaxError, -1, "Invalid page count in page tree");
-      pages[pg-1] = new Page(doc, pg);
+      return;
+    }
+    node = kidNode;
+  }
+}
+
+// Index all of the pages, and build the object ID -> page number hash
+// table.  The mutex must be locked.
+void Catalog::buildPageIndex() {
+  Guint h;
+  int pg;
+
+  for (pg = 1; pg <= numPages; ++pg) {
+    if (!pageIndexed[pg-1]) {
+      indexPage(pg);
     }
   }
+  if (numPages == 0) {
+    return;
+  }
+  for (pageRefHashSize = 16;
+       pageRefHashSize < 2 * numPages && pageRefHashSize < (1 << 30);
+       pageRefHashSize <<= 1) ;
+  pageRefHash = (int *)gmallocn(pageRefHashSize, sizeof(int));
+  memset(pageRefHash, 0, pageRefHashSize * sizeof(int));
+  for (pg = 1; pg <= numPages; ++pg) {
+    if (pageRefs[pg-1].num < 0) {
+      continue;
+    }
+    // if a page object appears more than once, findPage returns the
+    // first page number
+    h = pageRefHashFunc(pageRefs[pg-1].num) & (pageRefHashSize - 1);
+    while (pageRefHash[h]) {
+      if (pageRefs[pageRefHash[h]-1].num == pageRefs[pg-1].num &&
+	  pageRefs[pageRefHash[h]-1].gen == pageRefs[pg-1].gen) {
+	break;
+      }
+      h = (h + 1) & (pageRefHashSize - 1);
+    }
+    if (!pageRefHash[h]) {
+      pageRefHash[h] = pg;
+    }
+  }
+}
+
+// Create the Page object for page <pg>, given its page tree leaf node
+// (or NULL, if the page tree is broken).  This doesn't need the mutex
+// -- leaf nodes and their parents' PageAttrs are never modified.
+Page *Catalog::makePage(int pg, PageTreeNode *node) {
+  Object pageRefObj, pageObj;
+  PageAttrs *attrs;
+  Page *page;
+
+  if (!node) {
+    return new Page(doc, pg);
+  }
+  pageRefObj.initRef(node->ref.num, node->ref.gen);
+  if (!pageRefObj.fetch(xref, &pageObj)->isDict()) {
+    error(errSyntaxError, -1, "Page tree object is wrong type ({0:s})",
+	  pageObj.getTypeName());
+    pageObj.free();
+    pageRefObj.free();
+    return new Page(doc, pg);
+  }
+  attrs = new PageAttrs(node->parent ? node->parent->attrs
+			             : (PageAttrs *)NULL,
+			pageObj.getDict(), xref);
+  page = new Page(doc, pg, pageObj.getDict(), attrs);
+  if (!page->isOk()) {
+    delete page;
+    page = new Page(doc, pg);
+  }
+  pageObj.free();
+  pageRefObj.free();
+  return page;
 }
 
 Object *Catalog::getDestOutputProfile(Object *destOutProf) {
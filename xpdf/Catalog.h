@@ -55,13 +55,27 @@ public:
   // Get a page.
   Page *getPage(int i);
 
-  // Get the reference for a page object.
+  // Get the reference for a page object.  This only reads the page
+  // tree -- it doesn't create the Page object.
   Ref *getPageRef(int i);
 
+  // Get a page's annotations array.  If the page hasn't been loaded,
+  // this reads the page dictionary directly, without creating (and
+  // keeping) the Page object.
+  Object *getPageAnnots(int i, Object *obj);
+
   // Remove a page from the catalog.  (It can be reloaded later by
   // calling getPage).
   void doneWithPage(int i);
 
+  // Limit the number of Page objects kept in memory to <n> (0 = no
+  // limit, which is the default).  With a limit, getPage() deletes
+  // the least recently used page when it creates a new one, so a
+  // Page pointer is only valid until the next getPage() call (from
+  // any thread) -- this is only useful for applications which don't
+  // hold on to Page objects.
+  void setPageCacheSize(int n);
+
   // Return base URI, or NULL if none.
   GString *getBaseURI() { return baseURI; }
 
@@ -73,7 +87,8 @@ public:
   Object *getStructTreeRoot() { return &structTreeRoot; }
 
   // Find a page, given its object ID.  Returns page number, or 0 if
-  // not found.
+  // not found.  The first call indexes the whole page tree (without
+  // creating any Page objects); after that, this is a hash lookup.
   int findPage(int num, int gen);
 
   // Find a named destination.  Returns the link destination, or
@@ -125,6 +140,23 @@ private:
   PageTreeNode *pageTree;	// the page tree
   Page **pages;			// array of pages
   Ref *pageRefs;		// object ID for each page
+  PageTreeNode **pageNodes;	// page tree leaf node for each page (its
+				//   parent holds the inherited attrs)
+  char *pageIndexed;		// true if pageRefs[i] and pageNodes[i]
+				//   have been filled in
+  int *pageRefHash;		// hash table mapping object ID to page
+				//   number (0 = empty slot)
+  int pageRefHashSize;		// size of pageRefHash (a power of 2)
+#if MULTITHREADED
+  GAtomicCounter pageIndexDone;	// set once all pages are indexed and
+				//   pageRefHash is built
+#else
+  int pageIndexDone;
+#endif
+  int *pageLRU;			// loaded page numbers, most recently
+				//   used first (only if pageCacheSize > 0)
+  int pageLRULen;		// number of entries in pageLRU
+  int pageCacheSize;		// max number of loaded pages (0 = no limit)
 #if MULTITHREADED
   GMutex pageMutex;
 #endif
@@ -147,8 +179,12 @@ private:
   Object *findDestInTree(Object *tree, GString *name, Object *obj);
   GBool readPageTree(Object *catDict);
   int countPageTree(Object *pagesObj);
-  void loadPage(int pg);
-  void loadPage2(int pg, int relPg, PageTreeNode *node);
+  GBool readPageTreeNode(PageTreeNode *node);
+  void indexPage(int pg);
+  void buildPageIndex();
+  Page *makePage(int pg, PageTreeNode *node);
+  void touchPage(int pg);
+  void removePageFromLRU(int pg);
   void readEmbeddedFileList(Dict *catDict);
   void readEmbeddedFileTree(Object *node);
   void readFileAttachmentAnnots(Object *pageNodeRef,
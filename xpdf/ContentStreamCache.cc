@@ -0,0 +1,239 @@
+//========================================================================
+//
+// ContentStreamCache.cc
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "gmem.h"
+#include "gmempp.h"
+#include "GString.h"
+#include "GHash.h"
+#include "Object.h"
+#include "Array.h"
+#include "ContentStreamCache.h"
+
+//------------------------------------------------------------------------
+// CompiledContentStream
+//------------------------------------------------------------------------
+
+CompiledContentStream::CompiledContentStream() {
+  ops = NULL;
+  nOps = opsSize = 0;
+  args = NULL;
+  nArgs = argsSize = 0;
+  size = sizeof(CompiledContentStream);
+  refCnt = 1;
+}
+
+CompiledContentStream::~CompiledContentStream() {
+  int i;
+
+  for (i = 0; i < nOps; ++i) {
+    if (ops[i].name) {
+      gfree(ops[i].name);
+    }
+  }
+  gfree(ops);
+  for (i = 0; i < nArgs; ++i) {
+    args[i].free();
+  }
+  gfree(args);
+}
+
+void CompiledContentStream::incRefCnt() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+}
+
+void CompiledContentStream::decRefCnt() {
+  GBool done;
+
+#if MULTITHREADED
+  done = gAtomicDecrement(&refCnt) == 0;
+#else
+  done = --refCnt == 0;
+#endif
+  if (done) {
+    delete this;
+  }
+}
+
+void CompiledContentStream::addOp(Operator *op, const char *name,
+				  Object *argsA, int numArgsA) {
+  CompiledOp *cop;
+  int i;
+
+  if (nOps == opsSize) {
+    opsSize = opsSize ? 2 * opsSize : 256;
+    ops = (CompiledOp *)greallocn(ops, opsSize, sizeof(CompiledOp));
+  }
+  if (nArgs + numArgsA > argsSize) {
+    argsSize = argsSize ? 2 * argsSize : 1024;
+    if (argsSize < nArgs + numArgsA) {
+      argsSize = nArgs + numArgsA;
+    }
+    args = (Object *)greallocn(args, argsSize, sizeof(Object));
+  }
+  cop = &ops[nOps++];
+  cop->op = op;
+  cop->name = op ? (char *)NULL : copyString(name);
+  cop->firstArg = nArgs;
+  cop->numArgs = numArgsA;
+  size += sizeof(CompiledOp) + numArgsA * sizeof(Object);
+  for (i = 0; i < numArgsA; ++i) {
+    args[nArgs++] = argsA[i];
+    if (argsA[i].isString()) {
+      size += argsA[i].getString()->getLength();
+    } else if (argsA[i].isArray()) {
+      size += argsA[i].arrayGetLength() * sizeof(Object);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+// ContentStreamCacheEntry
+//------------------------------------------------------------------------
+
+class ContentStreamCacheEntry {
+public:
+
+  ContentStreamCacheEntry(GString *keyA, CompiledContentStream *contentA);
+  ~ContentStreamCacheEntry();
+
+  GString *key;
+  CompiledContentStream *content;
+  ContentStreamCacheEntry *prev, *next;	// LRU list
+};
+
+ContentStreamCacheEntry::ContentStreamCacheEntry(
+			     GString *keyA, CompiledContentStream *contentA) {
+  key = keyA->copy();
+  content = contentA;
+  content->incRefCnt();
+  prev = next = NULL;
+}
+
+ContentStreamCacheEntry::~ContentStreamCacheEntry() {
+  delete key;
+  content->decRefCnt();
+}
+
+//------------------------------------------------------------------------
+// ContentStreamCache
+//------------------------------------------------------------------------
+
+ContentStreamCache::ContentStreamCache(size_t maxSizeA) {
+  entries = new GHash();
+  mru = lru = NULL;
+  size = 0;
+  maxSize = maxSizeA;
+  nHits = nMisses = nEvictions = 0;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+ContentStreamCache::~ContentStreamCache() {
+  ContentStreamCacheEntry *entry;
+
+  while ((entry = mru)) {
+    mru = entry->next;
+    delete entry;
+  }
+  delete entries;
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+CompiledContentStream *ContentStreamCache::lookup(GString *key) {
+  ContentStreamCacheEntry *entry;
+  CompiledContentStream *content;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  if ((entry = (ContentStreamCacheEntry *)entries->lookup(key))) {
+    unlink(entry);
+    linkMRU(entry);
+    content = entry->content;
+    content->incRefCnt();
+    ++nHits;
+  } else {
+    content = NULL;
+    ++nMisses;
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return content;
+}
+
+void ContentStreamCache::add(GString *key, CompiledContentStream *content) {
+  ContentStreamCacheEntry *entry;
+
+  if (content->getSize() > maxSize) {
+    return;
+  }
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  // another thread may have added the same content stream
+  if (!entries->lookup(key)) {
+    entry = new ContentStreamCacheEntry(key, content);
+    entries->add(entry->key, entry);
+    linkMRU(entry);
+    size += content->getSize();
+    // remove least recently used entries until the cache is under
+    // the size limit -- entries which are in use are freed when their
+    // last reference is dropped
+    while (size > maxSize && lru != mru) {
+      entry = lru;
+      unlink(entry);
+      entries->remove(entry->key);
+      size -= entry->content->getSize();
+      delete entry;
+      ++nEvictions;
+    }
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+void ContentStreamCache::unlink(ContentStreamCacheEntry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    mru = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    lru = entry->prev;
+  }
+  entry->prev = entry->next = NULL;
+}
+
+void ContentStreamCache::linkMRU(ContentStreamCacheEntry *entry) {
+  entry->prev = NULL;
+  entry->next = mru;
+  if (mru) {
+    mru->prev = entry;
+  } else {
+    lru = entry;
+  }
+  mru = entry;
+}
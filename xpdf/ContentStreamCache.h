@@ -0,0 +1,134 @@
+//========================================================================
+//
+// ContentStreamCache.h
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#ifndef CONTENTSTREAMCACHE_H
+#define CONTENTSTREAMCACHE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <stddef.h>
+#include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+
+class GString;
+class GHash;
+class Object;
+struct Operator;
+class ContentStreamCacheEntry;
+
+//------------------------------------------------------------------------
+// CompiledContentStream
+//------------------------------------------------------------------------
+
+struct CompiledOp {
+  Operator *op;			// the operator, or NULL if unknown
+  char *name;			// name of an unknown operator
+  int firstArg;			// index of the first arg in the args array
+  int numArgs;			// number of args
+};
+
+// A content stream (or a sequence of content streams) in parsed form:
+// a list of operators, each already looked up in the operator table,
+// with their args.  Executing a compiled content stream skips the
+// lexer, the parser, and the operator lookup.
+class CompiledContentStream {
+public:
+
+  CompiledContentStream();
+  ~CompiledContentStream();
+
+  // Reference counting.  The object is deleted when the count goes
+  // to zero.
+  void incRefCnt();
+  void decRefCnt();
+
+  // Append an operator.  This takes ownership of the args, i.e., the
+  // caller must not free them.
+  void addOp(Operator *op, const char *name, Object *argsA, int numArgsA);
+
+  int getNumOps() { return nOps; }
+  CompiledOp *getOp(int i) { return &ops[i]; }
+  Object *getArgs(CompiledOp *op) { return &args[op->firstArg]; }
+
+  // Approximate memory usage, in bytes.
+  size_t getSize() { return size; }
+
+private:
+
+  CompiledOp *ops;
+  int nOps;
+  int opsSize;			// allocated size of ops
+  Object *args;
+  int nArgs;
+  int argsSize;			// allocated size of args
+  size_t size;
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
+};
+
+//------------------------------------------------------------------------
+// ContentStreamCache
+//------------------------------------------------------------------------
+
+// Per-document cache of compiled content streams (page contents, form
+// XObjects, Type 3 CharProcs, annotation appearances), keyed by the
+// object reference(s) of the content stream(s).  The least recently
+// used entries are discarded when the total size exceeds the limit.
+class ContentStreamCache {
+public:
+
+  ContentStreamCache(size_t maxSizeA);
+  ~ContentStreamCache();
+
+  // Find the compiled content stream for [key].  If found, its
+  // reference count is incremented, and it is returned; otherwise
+  // returns NULL.
+  CompiledContentStream *lookup(GString *key);
+
+  // Add a compiled content stream.  The cache takes its own reference
+  // to [content], and makes a copy of [key].  Content streams larger
+  // than the size limit are not added.
+  void add(GString *key, CompiledContentStream *content);
+
+  // Statistics.
+  int getNumHits() { return nHits; }
+  int getNumMisses() { return nMisses; }
+  int getNumEvictions() { return nEvictions; }
+  size_t getSize() { return size; }
+
+  // Content streams larger than this aren't cached.
+  size_t getMaxSize() { return maxSize; }
+
+private:
+
+  void unlink(ContentStreamCacheEntry *entry);
+  void linkMRU(ContentStreamCacheEntry *entry);
+
+  GHash *entries;		// [ContentStreamCacheEntry], indexed by
+				//   key
+  ContentStreamCacheEntry *mru;	// most recently used entry
+  ContentStreamCacheEntry *lru;	// least recently used entry
+  size_t size;			// total size of cached content streams
+  size_t maxSize;
+  int nHits, nMisses, nEvictions;
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+#endif
@@ -22,8 +22,12 @@
 
 //------------------------------------------------------------------------
 
+// Keys are name strings (see NameTable.h), and each entry holds the
+// key's hash value, so lookups only compare strings on a hash match
+// (or not at all, if the key is the same interned name).
 struct DictEntry {
   char *key;
+  Guint hash;
   Object val;
   DictEntry *next;
 };
@@ -46,7 +50,7 @@ Dict::~Dict() {
   int i;
 
   for (i = 0; i < length; ++i) {
-    gfree(entries[i].key);
+    freeName(entries[i].key);
     entries[i].val.free();
   }
   gfree(entries);
@@ -54,28 +58,36 @@ Dict::~Dict() {
 }
 
 void Dict::add(char *key, Object *val) {
+  addName(makeName(key), val);
+  gfree(key);
+}
+
+void Dict::addName(char *key, Object *val) {
   DictEntry *e;
-  int h;
+  Guint h;
+  int b;
 
-  if ((e = find(key))) {
+  h = getNameHash(key);
+  if ((e = find(key, h))) {
     e->val.free();
     e->val = *val;
-    gfree(key);
+    freeName(key);
   } else {
     if (length == size) {
       expand();
     }
-    h = hash(key);
+    b = (int)(h % (Guint)(2 * size - 1));
     entries[length].key = key;
+    entries[length].hash = h;
     entries[length].val = *val;
-    entries[length].next = hashTab[h];
-    hashTab[h] = &entries[length];
+    entries[length].next = hashTab[b];
+    hashTab[b] = &entries[length];
     ++length;
   }
 }
 
 void Dict::expand() {
-  int h, i;
+  int b, i;
 
   size *= 2;
   entries = (DictEntry *)greallocn(entries, size, sizeof(DictEntry));
@@ -83,36 +95,27 @@ void Dict::expand() {
 				    sizeof(DictEntry *));
   memset(hashTab, 0, (2 * size - 1) * sizeof(DictEntry *));
   for (i = 0; i < length; ++i) {
-    h = hash(entries[i].key);
-    entries[i].next = hashTab[h];
-    hashTab[h] = &entries[i];
+    b = (int)(entries[i].hash % (Guint)(2 * size - 1));
+    entries[i].next = hashTab[b];
+    hashTab[b] = &entries[i];
   }
 }
 
 inline DictEntry *Dict::find(const char *key) {
+  return find(key, hashName(key));
+}
+
+inline DictEntry *Dict::find(const char *key, Guint h) {
   DictEntry *e;
-  int h;
 
-  h = hash(key);
-  for (e = hashTab[h]; e; e = e->next) {
-    if (!strcmp(key, e->key)) {
+  for (e = hashTab[h % (Guint)(2 * size - 1)]; e; e = e->next) {
+    if (e->hash == h && (e->key == key || !strcmp(key, e->key))) {
       return e;
     }
   }
   return NULL;
 }
 
-int Dict::hash(const char *key) {
-  const char *p;
-  unsigned int h;
-
-  h = 0;
-  for (p = key; *p; ++p) {
-    h = 17 * h + (int)(*p & 0xff);
-  }
-  return (int)(h % (2 * size - 1));
-}
-
 GBool Dict::is(const char *type) {
   DictEntry *e;
 
@@ -47,9 +47,14 @@ public:
   // Get number of entries.
   int getLength() { return length; }
 
-  // Add an entry.  NB: does not copy key.
+  // Add an entry.  NB: does not copy key -- <key> is an ordinary
+  // (gmalloc'ed) C string, which is freed by add().
   void add(char *key, Object *val);
 
+  // Add an entry whose key is a name string (see NameTable.h).  NB:
+  // does not copy key.
+  void addName(char *key, Object *val);
+
   // Check if dictionary is of specified type.
   GBool is(const char *type);
 
@@ -82,8 +87,8 @@ private:
 #endif
 
   DictEntry *find(const char *key);
+  DictEntry *find(const char *key, Guint h);
   void expand();
-  int hash(const char *key);
 };
 
 #endif
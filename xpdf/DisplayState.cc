@@ -27,13 +27,19 @@
 //------------------------------------------------------------------------
 
 DisplayState::DisplayState(int maxTileWidthA, int maxTileHeightA,
-			   int tileCacheSizeA, int nWorkerThreadsA,
+			   int tileCacheSizeA, int tileCacheMemoryA,
+			   GBool tileCacheCompressionA,
+			   int tilePyramidCacheSizeA,
+			   int nWorkerThreadsA,
 			   SplashColorMode colorModeA, int bitmapRowPadA) {
   int i;
 
   maxTileWidth = maxTileWidthA;
   maxTileHeight = maxTileHeightA;
   tileCacheSize = tileCacheSizeA;
+  tileCacheMemory = tileCacheMemoryA;
+  tileCacheCompression = tileCacheCompressionA;
+  tilePyramidCacheSize = tilePyramidCacheSizeA;
   nWorkerThreads = nWorkerThreadsA;
   colorMode = colorModeA;
   bitmapRowPad = bitmapRowPadA;
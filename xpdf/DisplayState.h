@@ -77,7 +77,9 @@ class DisplayState {
 public:
 
   DisplayState(int maxTileWidthA, int maxTileHeightA,
-	       int tileCacheSizeA, int nWorkerThreadsA,
+	       int tileCacheSizeA, int tileCacheMemoryA,
+	       GBool tileCacheCompressionA, int tilePyramidCacheSizeA,
+	       int nWorkerThreadsA,
 	       SplashColorMode colorModeA, int bitmapRowPadA);
   ~DisplayState();
 
@@ -107,6 +109,9 @@ public:
   int getMaxTileWidth() { return maxTileWidth; }
   int getMaxTileHeight() { return maxTileHeight; }
   int getTileCacheSize() { return tileCacheSize; }
+  int getTileCacheMemory() { return tileCacheMemory; }
+  GBool getTileCacheCompression() { return tileCacheCompression; }
+  int getTilePyramidCacheSize() { return tilePyramidCacheSize; }
   int getNWorkerThreads() { return nWorkerThreads; }
   SplashColorMode getColorMode() { return colorMode; }
   int getBitmapRowPad() { return bitmapRowPad; }
@@ -139,7 +144,10 @@ public:
 private:
 
   int maxTileWidth, maxTileHeight;
-  int tileCacheSize;
+  int tileCacheSize;		// 0 = no limit
+  int tileCacheMemory;		// in MB
+  GBool tileCacheCompression;
+  int tilePyramidCacheSize;	// in MB
   int nWorkerThreads;
 
   SplashColorMode colorMode;
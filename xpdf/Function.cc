@@ -31,6 +31,9 @@
 // loops in the function object structure.
 #define recursionLimit 8
 
+// Initial number of samples in a FunctionLUT.
+#define functionLUTInitialSize 17
+
 //------------------------------------------------------------------------
 // Function
 //------------------------------------------------------------------------
@@ -41,6 +44,14 @@ Function::Function() {
 Function::~Function() {
 }
 
+void Function::transformN(double *in, double *out, int count) {
+  int i;
+
+  for (i = 0; i < count; ++i) {
+    transform(in + i * m, out + i * n);
+  }
+}
+
 Function *Function::parse(Object *funcObj, int expectedInputs,
 			  int expectedOutputs, int recursion) {
   Function *func;
@@ -510,6 +521,47 @@ void SampledFunction::transform(double *in, double *out) {
   }
 }
 
+void SampledFunction::transformN(double *in, double *out, int count) {
+  double x, efrac0, efrac1, y;
+  double *s0, *s1;
+  int e, c, i;
+
+  // the 1-input case (the common case in shadings) is done directly,
+  // without the general m-linear interpolation code
+  if (m != 1) {
+    Function::transformN(in, out, count);
+    return;
+  }
+
+  for (c = 0; c < count; ++c) {
+    x = (in[c] - domain[0][0]) * inputMul[0] + encode[0][0];
+    if (x < 0 || x != x) {  // x!=x is a more portable version of isnan(x)
+      x = 0;
+    } else if (x > sampleSize[0] - 1) {
+      x = sampleSize[0] - 1;
+    }
+    e = (int)x;
+    if (e == sampleSize[0] - 1 && sampleSize[0] > 1) {
+      // this happens if in[c] = domain[0][1]
+      e = sampleSize[0] - 2;
+    }
+    efrac1 = x - e;
+    efrac0 = 1 - efrac1;
+    s0 = samples + e * n + idxOffset[0];
+    s1 = samples + e * n + idxOffset[1];
+    for (i = 0; i < n; ++i) {
+      y = efrac0 * s0[i] + efrac1 * s1[i];
+      y = y * (decode[i][1] - decode[i][0]) + decode[i][0];
+      if (y < range[i][0]) {
+	y = range[i][0];
+      } else if (y > range[i][1]) {
+	y = range[i][1];
+      }
+      out[c * n + i] = y;
+    }
+  }
+}
+
 //------------------------------------------------------------------------
 // ExponentialFunction
 //------------------------------------------------------------------------
@@ -635,6 +687,33 @@ void ExponentialFunction::transform(double *in, double *out) {
   return;
 }
 
+void ExponentialFunction::transformN(double *in, double *out, int count) {
+  double x, p;
+  int c, i;
+
+  for (c = 0; c < count; ++c) {
+    if (in[c] < domain[0][0]) {
+      x = domain[0][0];
+    } else if (in[c] > domain[0][1]) {
+      x = domain[0][1];
+    } else {
+      x = in[c];
+    }
+    p = pow(x, e);
+    for (i = 0; i < n; ++i) {
+      out[i] = c0[i] + p * (c1[i] - c0[i]);
+      if (hasRange) {
+	if (out[i] < range[i][0]) {
+	  out[i] = range[i][0];
+	} else if (out[i] > range[i][1]) {
+	  out[i] = range[i][1];
+	}
+      }
+    }
+    out += n;
+  }
+}
+
 //------------------------------------------------------------------------
 // StitchingFunction
 //------------------------------------------------------------------------
@@ -804,6 +883,42 @@ void StitchingFunction::transform(double *in, double *out) {
   funcs[i]->transform(&x, out);
 }
 
+void StitchingFunction::transformN(double *in, double *out, int count) {
+  double *xs;
+  int *idx;
+  double x;
+  int c, c0, i;
+
+  // map the inputs to subfunctions, and then hand each run of inputs
+  // which uses the same subfunction to that subfunction's
+  // transformN() (the inputs in a shading are usually sorted, so
+  // these runs tend to be long)
+  xs = (double *)gmallocn(count, sizeof(double));
+  idx = (int *)gmallocn(count, sizeof(int));
+  for (c = 0; c < count; ++c) {
+    if (in[c] < domain[0][0]) {
+      x = domain[0][0];
+    } else if (in[c] > domain[0][1]) {
+      x = domain[0][1];
+    } else {
+      x = in[c];
+    }
+    for (i = 0; i < k - 1; ++i) {
+      if (x < bounds[i+1]) {
+	break;
+      }
+    }
+    xs[c] = encode[2*i] + (x - bounds[i]) * scale[i];
+    idx[c] = i;
+  }
+  for (c0 = 0; c0 < count; c0 = c) {
+    for (c = c0 + 1; c < count && idx[c] == idx[c0]; ++c) ;
+    funcs[idx[c0]]->transformN(xs + c0, out + c0 * n, c - c0);
+  }
+  gfree(xs);
+  gfree(idx);
+}
+
 //------------------------------------------------------------------------
 // PostScriptFunction
 //------------------------------------------------------------------------
@@ -1600,3 +1715,149 @@ int PostScriptFunction::exec(double *stack, int sp0) {
   error(errSyntaxError, -1, "Invalid arg in PostScript function");
   return sp;
 }
+
+//------------------------------------------------------------------------
+// FunctionLUT
+//------------------------------------------------------------------------
+
+FunctionLUT::FunctionLUT(Function **funcs, int nFuncs,
+			 double tMinA, double tMaxA,
+			 double tolerance, int maxSize) {
+  double *ts, *mids, *newSamples;
+  double err, d;
+  int newSize, i, j;
+
+  tMin = tMinA;
+  tMax = tMaxA;
+  size = 0;
+  samples = NULL;
+  ok = gFalse;
+
+  nOut = 0;
+  for (i = 0; i < nFuncs; ++i) {
+    if (funcs[i]->getInputSize() != 1) {
+      return;
+    }
+    nOut += funcs[i]->getOutputSize();
+  }
+  if (nOut < 1 || nOut > funcMaxOutputs ||
+      maxSize < functionLUTInitialSize || !(tMax >= tMin)) {
+    return;
+  }
+
+  // sample the functions at evenly spaced points
+  size = functionLUTInitialSize;
+  ts = (double *)gmallocn(size, sizeof(double));
+  for (i = 0; i < size; ++i) {
+    ts[i] = tMin + (tMax - tMin) * i / (size - 1);
+  }
+  samples = (double *)gmallocn(size, nOut * (int)sizeof(double));
+  transformFuncs(funcs, nFuncs, ts, samples, size);
+
+  // repeatedly evaluate the functions at the midpoints, and compare
+  // them to the interpolated values -- the midpoints are then merged
+  // into the table, so each round doubles the table size
+  while ((newSize = 2 * size - 1) <= maxSize) {
+    ts = (double *)greallocn(ts, size - 1, sizeof(double));
+    for (i = 0; i < size - 1; ++i) {
+      ts[i] = tMin + (tMax - tMin) * (2 * i + 1) / (newSize - 1);
+    }
+    mids = (double *)gmallocn(size - 1, nOut * (int)sizeof(double));
+    transformFuncs(funcs, nFuncs, ts, mids, size - 1);
+    err = 0;
+    newSamples = (double *)gmallocn(newSize, nOut * (int)sizeof(double));
+    for (i = 0; i < size - 1; ++i) {
+      for (j = 0; j < nOut; ++j) {
+	d = fabs(0.5 * (samples[i * nOut + j] + samples[(i + 1) * nOut + j])
+		 - mids[i * nOut + j]);
+	if (!(d <= err)) {
+	  err = d;
+	}
+	newSamples[2 * i * nOut + j] = samples[i * nOut + j];
+	newSamples[(2 * i + 1) * nOut + j] = mids[i * nOut + j];
+      }
+    }
+    for (j = 0; j < nOut; ++j) {
+      newSamples[(newSize - 1) * nOut + j] = samples[(size - 1) * nOut + j];
+    }
+    gfree(mids);
+    gfree(samples);
+    samples = newSamples;
+    size = newSize;
+    if (err <= tolerance) {
+      ok = gTrue;
+      break;
+    }
+  }
+  gfree(ts);
+
+  if (tMax > tMin) {
+    scale = (size - 1) / (tMax - tMin);
+  } else {
+    scale = 0;
+  }
+}
+
+FunctionLUT::~FunctionLUT() {
+  gfree(samples);
+}
+
+void FunctionLUT::lookup(double t, double *out) {
+  double x, f;
+  double *s;
+  int i, j;
+
+  x = (t - tMin) * scale;
+  if (!(x > 0)) {
+    s = samples;
+    for (j = 0; j < nOut; ++j) {
+      out[j] = s[j];
+    }
+  } else if (x >= size - 1) {
+    s = samples + (size - 1) * nOut;
+    for (j = 0; j < nOut; ++j) {
+      out[j] = s[j];
+    }
+  } else {
+    i = (int)x;
+    f = x - i;
+    s = samples + i * nOut;
+    for (j = 0; j < nOut; ++j) {
+      out[j] = s[j] + f * (s[nOut + j] - s[j]);
+    }
+  }
+}
+
+void FunctionLUT::lookupN(double *in, double *out, int count) {
+  int c;
+
+  for (c = 0; c < count; ++c) {
+    lookup(in[c], out + c * nOut);
+  }
+}
+
+void FunctionLUT::transformFuncs(Function **funcs, int nFuncs,
+				 double *in, double *out, int count) {
+  double *buf;
+  int nOut, offset, fn, c, i;
+
+  if (nFuncs == 1) {
+    funcs[0]->transformN(in, out, count);
+    return;
+  }
+  nOut = 0;
+  for (i = 0; i < nFuncs; ++i) {
+    nOut += funcs[i]->getOutputSize();
+  }
+  buf = (double *)gmallocn(count, funcMaxOutputs * (int)sizeof(double));
+  offset = 0;
+  for (i = 0; i < nFuncs; ++i) {
+    fn = funcs[i]->getOutputSize();
+    funcs[i]->transformN(in, buf, count);
+    for (c = 0; c < count; ++c) {
+      memcpy(out + c * nOut + offset, buf + c * fn, fn * sizeof(double));
+    }
+    offset += fn;
+  }
+  gfree(buf);
+}
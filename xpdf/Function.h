@@ -70,6 +70,12 @@ public:
   // Transform an input tuple into an output tuple.
   virtual void transform(double *in, double *out) = 0;
 
+  // Transform [count] input tuples (packed into [in]) into [count]
+  // output tuples (packed into [out]).  This gives the same results
+  // as calling transform() on each tuple, but is faster for some
+  // function types.
+  virtual void transformN(double *in, double *out, int count);
+
   virtual GBool isOk() = 0;
 
 protected:
@@ -111,6 +117,7 @@ public:
   virtual Function *copy() { return new SampledFunction(this); }
   virtual int getType() { return 0; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int count);
   virtual GBool isOk() { return ok; }
 
   int getSampleSize(int i) { return sampleSize[i]; }
@@ -153,6 +160,7 @@ public:
   virtual Function *copy() { return new ExponentialFunction(this); }
   virtual int getType() { return 2; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int count);
   virtual GBool isOk() { return ok; }
 
   double *getC0() { return c0; }
@@ -182,6 +190,7 @@ public:
   virtual Function *copy() { return new StitchingFunction(this); }
   virtual int getType() { return 3; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int count);
   virtual GBool isOk() { return ok; }
 
   int getNumFuncs() { return k; }
@@ -237,4 +246,49 @@ private:
   GBool ok;
 };
 
+//------------------------------------------------------------------------
+// FunctionLUT
+//------------------------------------------------------------------------
+
+// Lookup table which approximates a set of 1-input functions (with
+// their outputs concatenated, as with the color functions in axial
+// and radial shadings) over [tMin, tMax], by linear interpolation
+// between evenly spaced samples.  The table is refined until the
+// interpolated values are within [tolerance] of the actual function
+// values (checked at the midpoints between samples), or until it
+// would have more than [maxSize] entries.
+class FunctionLUT {
+public:
+
+  FunctionLUT(Function **funcs, int nFuncs, double tMinA, double tMaxA,
+	      double tolerance, int maxSize);
+  ~FunctionLUT();
+
+  // Returns true if the table is within the error tolerance.
+  GBool isOk() { return ok; }
+
+  int getSize() { return size; }
+  int getOutputSize() { return nOut; }
+
+  // Compute the (approximate) outputs for input [t].
+  void lookup(double t, double *out);
+
+  // Compute the outputs for each of [count] inputs.
+  void lookupN(double *in, double *out, int count);
+
+  // Evaluate [nFuncs] 1-input functions (exactly) at [count] inputs,
+  // concatenating the outputs of the functions for each input.
+  static void transformFuncs(Function **funcs, int nFuncs,
+			     double *in, double *out, int count);
+
+private:
+
+  double tMin, tMax;
+  double scale;			// (size - 1) / (tMax - tMin)
+  int size;			// number of samples
+  int nOut;			// number of outputs per sample
+  double *samples;		// [size * nOut] samples
+  GBool ok;
+};
+
 #endif
@@ -37,6 +37,7 @@
 #include "Page.h"
 #include "Annot.h"
 #include "OptionalContent.h"
+#include "ContentStreamCache.h"
 #include "Error.h"
 #include "TextString.h"
 #include "Gfx.h"
@@ -438,6 +439,26 @@ void GfxResources::lookupColorSpace(const char *name, Object *obj,
   obj->initNull();
 }
 
+void GfxResources::lookupColorSpaceNF(const char *name, Object *obj) {
+  GfxResources *resPtr;
+
+  if (!strcmp(name, "DeviceGray") ||
+      !strcmp(name, "DeviceRGB") ||
+      !strcmp(name, "DeviceCMYK")) {
+    obj->initNull();
+    return;
+  }
+  for (resPtr = this; resPtr; resPtr = resPtr->next) {
+    if (resPtr->colorSpaceDict.isDict()) {
+      if (!resPtr->colorSpaceDict.dictLookupNF(name, obj)->isNull()) {
+	return;
+      }
+      obj->free();
+    }
+  }
+  obj->initNull();
+}
+
 GfxPattern *GfxResources::lookupPattern(const char *name
 					) {
   GfxResources *resPtr;
@@ -546,9 +567,11 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, int pageNum, Dict *resDict,
   }
   formDepth = 0;
   markedContentStack = new GList();
+  glyphRun = NULL;
   ocState = gTrue;
   parser = NULL;
   contentStreamStack = new GList();
+  lutCacheLen = 0;
   abortCheckCbk = abortCheckCbkA;
   abortCheckCbkData = abortCheckCbkDataA;
 
@@ -591,9 +614,11 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
   }
   formDepth = 0;
   markedContentStack = new GList();
+  glyphRun = NULL;
   ocState = gTrue;
   parser = NULL;
   contentStreamStack = new GList();
+  lutCacheLen = 0;
   abortCheckCbk = abortCheckCbkA;
   abortCheckCbkData = abortCheckCbkDataA;
 
@@ -611,6 +636,8 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
 }
 
 Gfx::~Gfx() {
+  int i;
+
   if (defaultFont) {
     delete defaultFont;
   }
@@ -625,10 +652,20 @@ Gfx::~Gfx() {
     popResources();
   }
   deleteGList(markedContentStack, GfxMarkedContent);
+  if (glyphRun) {
+    delete glyphRun;
+  }
   delete contentStreamStack;
+  for (i = 0; i < lutCacheLen; ++i) {
+    lutCache[i]->decRefCnt();
+  }
 }
 
 void Gfx::display(Object *objRef, GBool topLevel) {
+  ContentStreamCache *cache;
+  CompiledContentStream *compiled;
+  GString *key;
+  Parser *oldParser;
   Object obj1, obj2;
   int i;
 
@@ -665,10 +702,39 @@ void Gfx::display(Object *objRef, GBool topLevel) {
     obj1.free();
     return;
   }
-  parser = new Parser(xref, new Lexer(xref, &obj1), gFalse);
-  go(topLevel);
-  delete parser;
-  parser = NULL;
+
+  // if the content stream has already been compiled, run the
+  // compiled form; otherwise parse it, compiling it along the way
+  key = NULL;
+  compiled = NULL;
+  if ((cache = doc->getContentStreamCache()) &&
+      (key = getContentStreamKey(objRef, &obj1))) {
+    compiled = cache->lookup(key);
+  }
+  if (compiled) {
+    // there's no parser position to report errors at
+    oldParser = parser;
+    parser = NULL;
+    run(compiled);
+    parser = oldParser;
+  } else {
+    if (key) {
+      compiled = new CompiledContentStream();
+    }
+    parser = new Parser(xref, new Lexer(xref, &obj1), gFalse);
+    if ((compiled = go(topLevel, compiled,
+		       compiled ? cache->getMaxSize() : 0))) {
+      cache->add(key, compiled);
+    }
+    delete parser;
+    parser = NULL;
+  }
+  if (compiled) {
+    compiled->decRefCnt();
+  }
+  if (key) {
+    delete key;
+  }
   contentStreamStack->del(contentStreamStack->getLength() - 1);
   obj1.free();
 }
@@ -708,9 +774,50 @@ GBool Gfx::checkForContentStreamLoop(Object *ref) {
   return gFalse;
 }
 
-void Gfx::go(GBool topLevel) {
+// Returns the content stream cache key for <objRef>, which is either a
+// single content stream or an array of content streams (<obj> is the
+// fetched object).  Returns NULL if any of the streams is a direct
+// object, i.e., if the content stream can't be cached.
+GString *Gfx::getContentStreamKey(Object *objRef, Object *obj) {
+  GString *key;
+  Object obj2;
+  int i;
+
+  if (objRef->isRef()) {
+    return GString::format("{0:d}.{1:d}",
+			   objRef->getRefNum(), objRef->getRefGen());
+  }
+  if (!obj->isArray() || obj->arrayGetLength() == 0) {
+    return NULL;
+  }
+  key = new GString();
+  for (i = 0; i < obj->arrayGetLength(); ++i) {
+    if (!obj->arrayGetNF(i, &obj2)->isRef()) {
+      obj2.free();
+      delete key;
+      return NULL;
+    }
+    key->appendf("{0:s}{1:d}.{2:d}",
+		 i > 0 ? "," : "", obj2.getRefNum(), obj2.getRefGen());
+    obj2.free();
+  }
+  return key;
+}
+
+// Parse and execute the content stream.  If <compiled> is non-NULL,
+// the operators (and their args) are also appended to it, as long as
+// it stays under <maxCompiledSize> bytes.  This takes ownership of
+// <compiled>: if the whole content stream was compiled, i.e., if
+// <compiled> can be used in place of the content stream, it is
+// returned; otherwise it is freed (as soon as compiling stops), and
+// this returns NULL.
+CompiledContentStream *Gfx::go(GBool topLevel,
+			       CompiledContentStream *compiled,
+			       size_t maxCompiledSize) {
   Object obj;
   Object args[maxArgs];
+  Operator *op;
+  char *name;
   GBool aborted;
   int numArgs, i;
   int errCount;
@@ -735,27 +842,40 @@ void Gfx::go(GBool topLevel) {
 
     // got a command - execute it
     if (obj.isCmd()) {
+      name = obj.getCmd();
       if (printCommands) {
-	obj.print(stdout);
-	for (i = 0; i < numArgs; ++i) {
-	  printf(" ");
-	  args[i].print(stdout);
-	}
-	printf("\n");
-	fflush(stdout);
+	printOp(name, args, numArgs);
       }
-      if (!execOp(&obj, args, numArgs)) {
+      op = findOp(name);
+      if (!execOp(op, name, args, numArgs)) {
 	++errCount;
       }
+      // inline images read their data directly from the content
+      // stream, so they can't be compiled
+      if (compiled && op && op->func == &Gfx::opBeginImage) {
+	compiled->decRefCnt();
+	compiled = NULL;
+      }
+      if (compiled) {
+	compiled->addOp(op, name, args, numArgs);
+	// too big to be cached -- stop compiling, but keep executing
+	if (compiled->getSize() > maxCompiledSize) {
+	  compiled->decRefCnt();
+	  compiled = NULL;
+	}
+      } else {
+	for (i = 0; i < numArgs; ++i) {
+	  args[i].free();
+	}
+      }
       obj.free();
-      for (i = 0; i < numArgs; ++i)
-	args[i].free();
       numArgs = 0;
 
       // check for too many errors
       if (errCount > contentStreamErrorLimit) {
 	error(errSyntaxError, -1,
 	      "Too many errors - giving up on this content stream");
+	aborted = gTrue;
 	break;
       }
 
@@ -798,6 +918,52 @@ void Gfx::go(GBool topLevel) {
       args[i].free();
     }
   }
+
+  if (compiled && aborted) {
+    compiled->decRefCnt();
+    compiled = NULL;
+  }
+  return compiled;
+}
+
+// Execute a compiled content stream.
+void Gfx::run(CompiledContentStream *compiled) {
+  CompiledOp *cop;
+  Object *args;
+  const char *name;
+  int errCount, i;
+
+  opCounter = 0;
+  errCount = 0;
+  for (i = 0; i < compiled->getNumOps(); ++i) {
+
+    // check for an abort
+    ++opCounter;
+    if (abortCheckCbk && opCounter > 100) {
+      if ((*abortCheckCbk)(abortCheckCbkData)) {
+	break;
+      }
+      opCounter = 0;
+    }
+
+    // execute the command
+    cop = compiled->getOp(i);
+    args = compiled->getArgs(cop);
+    name = cop->op ? cop->op->name : cop->name;
+    if (printCommands) {
+      printOp(name, args, cop->numArgs);
+    }
+    if (!execOp(cop->op, name, args, cop->numArgs)) {
+      ++errCount;
+    }
+
+    // check for too many errors
+    if (errCount > contentStreamErrorLimit) {
+      error(errSyntaxError, -1,
+	    "Too many errors - giving up on this content stream");
+      break;
+    }
+  }
 }
 
 void Gfx::getContentObj(Object *obj) {
@@ -809,16 +975,26 @@ void Gfx::getContentObj(Object *obj) {
   }
 }
 
-// Returns true if successful, false on error.
-GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
-  Operator *op;
-  char *name;
+void Gfx::printOp(const char *name, Object args[], int numArgs) {
+  int i;
+
+  printf("%s", name);
+  for (i = 0; i < numArgs; ++i) {
+    printf(" ");
+    args[i].print(stdout);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+// Execute operator <op> (which is NULL if <name> is not a known
+// operator).  Returns true if successful, false on error.
+GBool Gfx::execOp(Operator *op, const char *name,
+		  Object args[], int numArgs) {
   Object *argPtr;
   int i;
 
-  // find operator
-  name = cmd->getCmd();
-  if (!(op = findOp(name))) {
+  if (!op) {
     if (ignoreUndef > 0) {
       return gTrue;
     }
@@ -850,7 +1026,9 @@ GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
     }
   }
   for (i = 0; i < numArgs; ++i) {
-    if (!checkArg(&argPtr[i], op->tchk[i])) {
+    // most args are numbers, so check those without the function call
+    if (op->tchk[i] == tchkNum ? !argPtr[i].isNum()
+			       : !checkArg(&argPtr[i], op->tchk[i])) {
       error(errSyntaxError, getPos(),
 	    "Arg #{0:d} to '{1:s}' operator is wrong type ({2:s})",
 	    i, name, argPtr[i].getTypeName());
@@ -864,26 +1042,46 @@ GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
   return gTrue;
 }
 
+// Operator names are at most three chars long, so they can be packed
+// into an int.  The first char goes in the high byte, so the packed
+// ints sort in the same order as the names (i.e., the opTab order).
+#define packOpName(n)						\
+  (((Guint)(Guchar)(n)[0] << 24) | ((Guint)(Guchar)(n)[1] << 16) |	\
+   ((Guint)(Guchar)(n)[2] << 8) | (Guint)(Guchar)(n)[3])
+
 Operator *Gfx::findOp(char *name) {
-  int a, b, m, cmp;
+  Guint key, key2;
+  int a, b, m;
+
+  if (!name[0]) {
+    return NULL;
+  }
+  key = (Guint)(Guchar)name[0] << 24;
+  if (name[1]) {
+    key |= (Guint)(Guchar)name[1] << 16;
+    if (name[2]) {
+      key |= (Guint)(Guchar)name[2] << 8;
+      if (name[3]) {
+	return NULL;
+      }
+    }
+  }
 
   a = -1;
   b = numOps;
-  cmp = 0; // make gcc happy
   // invariant: opTab[a] < name < opTab[b]
   while (b - a > 1) {
     m = (a + b) / 2;
-    cmp = strcmp(opTab[m].name, name);
-    if (cmp < 0)
+    key2 = packOpName(opTab[m].name);
+    if (key2 < key) {
       a = m;
-    else if (cmp > 0)
+    } else if (key2 > key) {
       b = m;
-    else
-      a = b = m;
+    } else {
+      return &opTab[m];
+    }
   }
-  if (cmp != 0)
-    return NULL;
-  return &opTab[a];
+  return NULL;
 }
 
 GBool Gfx::checkArg(Object *arg, TchkType type) {
@@ -3802,7 +4000,7 @@ void Gfx::doShowText(GString *s) {
   GfxState *savedState;
   char *p;
   int render;
-  GBool patternFill;
+  GBool patternFill, useGlyphRun;
   int len, n, uLen, nChars, nSpaces, i;
 
   font = state->getFont();
@@ -3927,6 +4125,13 @@ void Gfx::doShowText(GString *s) {
     parser = oldParser;
 
   } else if (out->useDrawChar()) {
+    useGlyphRun = out->useDrawGlyphRun();
+    if (useGlyphRun) {
+      if (!glyphRun) {
+	glyphRun = new GlyphRun();
+      }
+      glyphRun->clear();
+    }
     p = s->getCString();
     len = s->getLength();
     while (len > 0) {
@@ -3951,12 +4156,21 @@ void Gfx::doShowText(GString *s) {
       originX *= state->getFontSize();
       originY *= state->getFontSize();
       state->textTransformDelta(originX, originY, &tOriginX, &tOriginY);
-      out->drawChar(state, state->getCurX() + riseX, state->getCurY() + riseY,
-		    tdx, tdy, tOriginX, tOriginY, code, n, u, uLen);
+      if (useGlyphRun) {
+	glyphRun->append(state->getCurX() + riseX, state->getCurY() + riseY,
+			 tdx, tdy, tOriginX, tOriginY, code, n);
+      } else {
+	out->drawChar(state, state->getCurX() + riseX,
+		      state->getCurY() + riseY,
+		      tdx, tdy, tOriginX, tOriginY, code, n, u, uLen);
+      }
       state->shift(tdx, tdy);
       p += n;
       len -= n;
     }
+    if (useGlyphRun && glyphRun->getLength() > 0) {
+      out->drawGlyphRun(state, glyphRun);
+    }
 
   } else {
     dx = dy = 0;
@@ -4153,6 +4367,8 @@ GBool Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
   GBool mask, invert;
   GfxColorSpace *colorSpace, *maskColorSpace;
   GfxImageColorMap *colorMap, *maskColorMap;
+  GfxColorSpaceLUT *lut;
+  Ref csRef;
   Object maskObj, smaskObj, maskRef;
   GBool haveColorKeyMask, haveExplicitMask, haveSoftMask, haveMatte;
   int maskColors[2*gfxColorMaxComps];
@@ -4305,17 +4521,32 @@ GBool Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
     }
     obj1.free();
 
-    // get color space and color map
-    dict->lookup("ColorSpace", &obj1);
+    // get color space and color map -- keep track of the color
+    // space's object number, which is used to share color lookup
+    // tables between images
+    csRef.num = csRef.gen = -1;
+    dict->lookupNF("ColorSpace", &obj1);
     if (obj1.isNull()) {
       obj1.free();
-      dict->lookup("CS", &obj1);
+      dict->lookupNF("CS", &obj1);
+    }
+    if (obj1.isRef()) {
+      csRef = obj1.getRef();
+      obj1.fetch(xref, &obj2);
+      obj1.free();
+      obj1 = obj2;
     }
     if (obj1.isName()) {
-      res->lookupColorSpace(obj1.getName(), &obj2);
+      res->lookupColorSpaceNF(obj1.getName(), &obj2);
       if (!obj2.isNull()) {
 	obj1.free();
-	obj1 = obj2;
+	if (obj2.isRef()) {
+	  csRef = obj2.getRef();
+	  obj2.fetch(xref, &obj1);
+	  obj2.free();
+	} else {
+	  obj1 = obj2;
+	}
       } else {
 	obj2.free();
       }
@@ -4352,6 +4583,10 @@ GBool Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
       delete colorMap;
       goto err1;
     }
+    if (csRef.num >= 0 &&
+	(lut = lookupColorSpaceLUT(csRef, state->getRenderingIntent()))) {
+      colorMap->setRGBLUT(lut);
+    }
 
     // get the mask
     haveColorKeyMask = haveExplicitMask = haveSoftMask = haveMatte = gFalse;
@@ -4624,6 +4859,9 @@ GBool Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
       }
     }
 
+    if (csRef.num >= 0 && colorMap->getRGBLUT()) {
+      addColorSpaceLUT(csRef, colorMap->getRGBLUT());
+    }
     delete colorMap;
     maskObj.free();
     smaskObj.free();
@@ -4656,6 +4894,62 @@ GBool Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
   return gFalse;
 }
 
+// Look up the RGB lookup table for the color space [csRef], as
+// built by a previous image.  Returns NULL if there is no such table.
+GfxColorSpaceLUT *Gfx::lookupColorSpaceLUT(Ref csRef, GfxRenderingIntent ri) {
+  GfxColorSpaceLUT *lut;
+  Ref r;
+  int i, j;
+
+  for (i = 0; i < lutCacheLen; ++i) {
+    if (lutCacheRefs[i].num == csRef.num &&
+	lutCacheRefs[i].gen == csRef.gen &&
+	lutCache[i]->getRenderingIntent() == ri) {
+      lut = lutCache[i];
+      r = lutCacheRefs[i];
+      for (j = i; j > 0; --j) {
+	lutCacheRefs[j] = lutCacheRefs[j-1];
+	lutCache[j] = lutCache[j-1];
+      }
+      lutCacheRefs[0] = r;
+      lutCache[0] = lut;
+      return lut;
+    }
+  }
+  return NULL;
+}
+
+// Add an RGB lookup table for the color space [csRef] to the cache,
+// replacing any existing table for [csRef].
+void Gfx::addColorSpaceLUT(Ref csRef, GfxColorSpaceLUT *lut) {
+  int i, j;
+
+  for (i = 0; i < lutCacheLen; ++i) {
+    if (lutCacheRefs[i].num == csRef.num &&
+	lutCacheRefs[i].gen == csRef.gen) {
+      break;
+    }
+  }
+  if (i < lutCacheLen) {
+    if (lutCache[i] == lut) {
+      return;
+    }
+    lutCache[i]->decRefCnt();
+  } else if (lutCacheLen == gfxColorSpaceLUTCacheSize) {
+    i = lutCacheLen - 1;
+    lutCache[i]->decRefCnt();
+  } else {
+    i = lutCacheLen++;
+  }
+  for (j = i; j > 0; --j) {
+    lutCacheRefs[j] = lutCacheRefs[j-1];
+    lutCache[j] = lutCache[j-1];
+  }
+  lut->incRefCnt();
+  lutCacheRefs[0] = csRef;
+  lutCache[0] = lut;
+}
+
 void Gfx::doForm(Object *strRef, Object *str) {
   Dict *dict;
   GBool transpGroup, isolated, knockout;
@@ -4746,9 +5040,11 @@ void Gfx::doForm(Object *strRef, Object *str) {
   }
   obj1.free();
 
-  // draw it
+  // draw it -- forms which aren't transparency groups can be drawn
+  // from the output device's form cache
   ++formDepth;
-  drawForm(strRef, resDict, m, bbox, transpGroup, gFalse, isolated, knockout);
+  drawForm(strRef, resDict, m, bbox, transpGroup, gFalse, isolated, knockout,
+	   gFalse, NULL, NULL, !transpGroup);
   --formDepth;
 
   resObj.free();
@@ -4759,9 +5055,11 @@ void Gfx::drawForm(Object *strRef, Dict *resDict,
 		   GBool transpGroup, GBool softMask,
 		   GBool isolated, GBool knockout,
 		   GBool alpha, Function *transferFunc,
-		   Object *backdropColorObj) {
+		   Object *backdropColorObj, GBool cacheable) {
   Parser *oldParser;
   GfxState *savedState;
+  FormCacheStatus cacheStatus;
+  GBool aborted;
   GfxColorSpace *blendingColorSpace;
   GfxColor backdropColor;
   Object strObj, groupAttrsObj, csObj, obj1;
@@ -4841,14 +5139,36 @@ void Gfx::drawForm(Object *strRef, Dict *resDict,
     baseMatrix[i] = state->getCTM()[i];
   }
 
-  // save the state stack -- this handles the case where the form
-  // contents have unbalanced q/Q operators
-  savedState = saveStateStack();
+  // check the output device's form cache -- if the form isn't there,
+  // the output device may start rasterizing it into the cache
+  cacheStatus = formCacheNone;
+  if (cacheable && !softMask && !transpGroup && strRef->isRef()) {
+    cacheStatus = out->beginFormCache(state, this, strRef->getRef(), bbox);
+  }
 
-  // draw the form
-  display(strRef, gFalse);
+  if (cacheStatus != formCacheHit) {
 
-  restoreStateStack(savedState);
+    // save the state stack -- this handles the case where the form
+    // contents have unbalanced q/Q operators
+    savedState = saveStateStack();
+
+    // draw the form
+    display(strRef, gFalse);
+
+    restoreStateStack(savedState);
+
+    // if the form used something that can't be cached (e.g., a
+    // non-Normal blend mode), the output device discards the cached
+    // raster, and the form needs to be drawn again
+    if (cacheStatus == formCacheFill) {
+      aborted = checkForAbort();
+      if (!out->endFormCache(state, aborted) && !aborted) {
+	savedState = saveStateStack();
+	display(strRef, gFalse);
+	restoreStateStack(savedState);
+      }
+    }
+  }
 
   if (softMask || transpGroup) {
     out->endTransparencyGroup(state);
@@ -29,11 +29,13 @@ class Parser;
 class Dict;
 class Function;
 class OutputDev;
+class GlyphRun;
 class GfxFontDict;
 class GfxFont;
 class Gfx;
 class PDFRectangle;
 class AnnotBorderStyle;
+class CompiledContentStream;
 
 //------------------------------------------------------------------------
 
@@ -57,6 +59,9 @@ enum TchkType {
 
 #define maxArgs 33
 
+// Number of color space lookup tables cached by Gfx.
+#define gfxColorSpaceLUTCacheSize 8
+
 struct Operator {
   char name[4];
   int numArgs;
@@ -77,6 +82,7 @@ public:
   GBool lookupXObject(const char *name, Object *obj);
   GBool lookupXObjectNF(const char *name, Object *obj);
   void lookupColorSpace(const char *name, Object *obj, GBool inherit = gTrue);
+  void lookupColorSpaceNF(const char *name, Object *obj);
   GfxPattern *lookupPattern(const char *name
 			    );
   GfxShading *lookupShading(const char *name
@@ -163,11 +169,19 @@ public:
   // Get the current graphics state object.
   GfxState *getState() { return state; }
 
+  PDFDoc *getDoc() { return doc; }
+
   void drawForm(Object *strRef, Dict *resDict, double *matrix, double *bbox,
 		GBool transpGroup = gFalse, GBool softMask = gFalse,
 		GBool isolated = gFalse, GBool knockout = gFalse,
 		GBool alpha = gFalse, Function *transferFunc = NULL,
-		Object *backdropColorObj = NULL);
+		Object *backdropColorObj = NULL, GBool cacheable = gFalse);
+
+  // Call the abort check callback, if any.  Returns true if
+  // rendering has been aborted, i.e., anything drawn since the last
+  // check may be incomplete.
+  GBool checkForAbort()
+    { return abortCheckCbk && (*abortCheckCbk)(abortCheckCbkData); }
 
   // Take all of the content stream stack entries from <oldGfx>.  This
   // is useful when creating a new Gfx object to handle a pattern,
@@ -202,11 +216,19 @@ private:
   GBool ocState;		// true if drawing is enabled, false if
 				//   disabled
   GList *markedContentStack;	// BMC/BDC/EMC stack [GfxMarkedContent]
+  GlyphRun *glyphRun;		// buffer for drawGlyphRun (allocated
+				//   on first use)
 
   Parser *parser;		// parser for page content stream(s)
   GList *contentStreamStack;	// stack of open content streams, used
 				//   for loop-checking
 
+  // RGB lookup tables built for images, keyed by color space
+  // object, most recently used first
+  Ref lutCacheRefs[gfxColorSpaceLUTCacheSize];
+  GfxColorSpaceLUT *lutCache[gfxColorSpaceLUTCacheSize];
+  int lutCacheLen;
+
   GBool				// callback to check for an abort
     (*abortCheckCbk)(void *data);
   void *abortCheckCbkData;
@@ -214,9 +236,15 @@ private:
   static Operator opTab[];	// table of operators
 
   GBool checkForContentStreamLoop(Object *ref);
-  void go(GBool topLevel);
+  GfxColorSpaceLUT *lookupColorSpaceLUT(Ref csRef, GfxRenderingIntent ri);
+  void addColorSpaceLUT(Ref csRef, GfxColorSpaceLUT *lut);
+  GString *getContentStreamKey(Object *objRef, Object *obj);
+  CompiledContentStream *go(GBool topLevel, CompiledContentStream *compiled,
+			    size_t maxCompiledSize);
+  void run(CompiledContentStream *compiled);
   void getContentObj(Object *obj);
-  GBool execOp(Object *cmd, Object args[], int numArgs);
+  void printOp(const char *name, Object args[], int numArgs);
+  GBool execOp(Operator *op, const char *name, Object args[], int numArgs);
   Operator *findOp(char *name);
   GBool checkArg(Object *arg, TchkType type);
   GFileOffset getPos();
@@ -21,7 +21,7 @@
 #include "gmem.h"
 #include "gmempp.h"
 #include "GList.h"
-#include "GHash.h"
+#include "GStrHash.h"
 #include "Error.h"
 #include "Object.h"
 #include "Dict.h"
@@ -1542,7 +1542,7 @@ int *Gfx8BitFont::getCodeToGIDMap(FoFiTrueType *ff) {
 
 int *Gfx8BitFont::getCodeToGIDMap(FoFiType1C *ff) {
   int *map;
-  GHash *nameToGID;
+  GStrHash *nameToGID;
   int i, gid;
 
   map = (int *)gmallocn(256, sizeof(int));
@@ -2236,7 +2236,7 @@ GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
   Ref r;
   int i;
 
-  fonts = new GHash(gTrue);
+  fonts = new GStrHash(fontDict->getLength());
   uniqueFonts = new GList();
   for (i = 0; i < fontDict->getLength(); ++i) {
     tag = fontDict->getKey(i);
@@ -2245,7 +2245,7 @@ GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
     if (!obj2.isDict()) {
       error(errSyntaxError, -1, "font resource is not a dictionary");
     } else if (obj1.isRef() && (font = lookupByRef(obj1.getRef()))) {
-      fonts->add(new GString(tag), font);
+      fonts->add(tag, font);
     } else {
       if (obj1.isRef()) {
 	r = obj1.getRef();
@@ -2265,7 +2265,7 @@ GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
 	  delete font;
 	} else {
 	  uniqueFonts->append(font);
-	  fonts->add(new GString(tag), font);
+	  fonts->add(tag, font);
 	}
       }
     }
@@ -21,7 +21,7 @@
 #include "CharTypes.h"
 
 class GList;
-class GHash;
+class GStrHash;
 class Dict;
 class CMap;
 class CharCodeToUnicode;
@@ -408,7 +408,7 @@ private:
   static int hashFontObject(Object *obj);
   static void hashFontObject1(Object *obj, FNVHash *h);
 
-  GHash *fonts;			// hash table of fonts -- this may
+  GStrHash *fonts;		// hash table of fonts -- this may
 				//   include duplicates, i.e., when
 				//   two tags map to the same font
   GList *uniqueFonts;		// list of all unique font objects (no dups)
@@ -3671,6 +3671,238 @@ void GfxPatchMeshShading::getColor(double *in, GfxColor *out) {
   }
 }
 
+//------------------------------------------------------------------------
+// GfxColorSpaceLUT
+//------------------------------------------------------------------------
+
+// Max number of grid points in a GfxColorSpaceLUT.
+#define gfxColorSpaceLUTMaxPoints 100000
+
+// Max error (in 8-bit RGB units) allowed for an image color map to
+// use a GfxColorSpaceLUT.
+#define gfxColorSpaceLUTMaxError 2
+
+// Number of test colors used to measure the error of a
+// GfxColorSpaceLUT.
+#define gfxColorSpaceLUTNTests 256
+
+// Returns the grid size to use for an [nComps]-component color
+// space, or 0 if no table should be built.
+static int getGfxColorSpaceLUTGridSize(int nComps) {
+  static int gridSizes[4] = { 17, 9, 5, 3 };
+  int nPoints, i, k;
+
+  if (nComps < 2 || nComps > gfxColorMaxComps) {
+    return 0;
+  }
+  for (k = 0; k < 4; ++k) {
+    nPoints = 1;
+    for (i = 0; i < nComps && nPoints <= gfxColorSpaceLUTMaxPoints; ++i) {
+      nPoints *= gridSizes[k];
+    }
+    if (nPoints <= gfxColorSpaceLUTMaxPoints) {
+      return gridSizes[k];
+    }
+  }
+  return 0;
+}
+
+int GfxColorSpaceLUT::getNGridPoints(int nCompsA) {
+  int gridSizeA, nPoints, i;
+
+  if (!(gridSizeA = getGfxColorSpaceLUTGridSize(nCompsA))) {
+    return 0;
+  }
+  nPoints = 1;
+  for (i = 0; i < nCompsA; ++i) {
+    nPoints *= gridSizeA;
+  }
+  return nPoints;
+}
+
+GfxColorSpaceLUT *GfxColorSpaceLUT::build(GfxColorSpace *colorSpace,
+					  GfxRenderingIntent riA) {
+  GfxColorSpaceLUT *lut;
+  GfxColor color;
+  GfxRGB rgb;
+  GfxColorComp *p;
+  int idx[gfxColorMaxComps];
+  int nCompsA, gridSizeA, nPoints, i, j;
+
+  nCompsA = colorSpace->getNComps();
+  if (!(gridSizeA = getGfxColorSpaceLUTGridSize(nCompsA))) {
+    return NULL;
+  }
+  lut = new GfxColorSpaceLUT(nCompsA, gridSizeA, riA);
+  colorSpace->getDefaultRanges(lut->low, lut->range, 255);
+  nPoints = 1;
+  for (i = nCompsA - 1; i >= 0; --i) {
+    lut->stride[i] = 3 * nPoints;
+    nPoints *= gridSizeA;
+  }
+
+  // compute the RGB values at the grid points -- the last component
+  // varies fastest
+  lut->table = (GfxColorComp *)gmallocn(nPoints, 3 * sizeof(GfxColorComp));
+  for (i = 0; i < nCompsA; ++i) {
+    idx[i] = 0;
+  }
+  p = lut->table;
+  for (j = 0; j < nPoints; ++j) {
+    for (i = 0; i < nCompsA; ++i) {
+      color.c[i] = dblToCol(lut->low[i] +
+			    (idx[i] * lut->range[i]) / (gridSizeA - 1));
+    }
+    colorSpace->getRGB(&color, &rgb, riA);
+    *p++ = clip01(rgb.r);
+    *p++ = clip01(rgb.g);
+    *p++ = clip01(rgb.b);
+    for (i = nCompsA - 1; i >= 0 && ++idx[i] == gridSizeA; --i) {
+      idx[i] = 0;
+    }
+  }
+
+  // check the accuracy of the table
+  lut->maxError = lut->measureError(colorSpace);
+
+  return lut;
+}
+
+GfxColorSpaceLUT::GfxColorSpaceLUT(int nCompsA, int gridSizeA,
+				   GfxRenderingIntent riA) {
+  nComps = nCompsA;
+  gridSize = gridSizeA;
+  ri = riA;
+  table = NULL;
+  maxError = 0;
+  refCnt = 1;
+}
+
+GfxColorSpaceLUT::~GfxColorSpaceLUT() {
+  gfree(table);
+}
+
+// Returns the max error (in 8-bit RGB units) at a set of
+// pseudo-random test colors.
+int GfxColorSpaceLUT::measureError(GfxColorSpace *colorSpace) {
+  GfxColor color;
+  GfxRGB rgb;
+  int offset[gfxColorMaxComps], frac[gfxColorMaxComps];
+  Guchar rgb8[3];
+  Guint seed;
+  int err, e, i, j;
+
+  err = 0;
+  seed = 1;
+  for (j = 0; j < gfxColorSpaceLUTNTests; ++j) {
+    for (i = 0; i < nComps; ++i) {
+      seed = seed * 1103515245 + 12345;
+      color.c[i] = dblToCol(low[i] + (((seed >> 16) & 0x7fff) * range[i])
+			             / 32767);
+      mapComp(i, color.c[i], &offset[i], &frac[i]);
+    }
+    colorSpace->getRGB(&color, &rgb, ri);
+    getRGB(offset, frac, rgb8);
+    if ((e = abs((int)colToByte(clip01(rgb.r)) - (int)rgb8[0])) > err) {
+      err = e;
+    }
+    if ((e = abs((int)colToByte(clip01(rgb.g)) - (int)rgb8[1])) > err) {
+      err = e;
+    }
+    if ((e = abs((int)colToByte(clip01(rgb.b)) - (int)rgb8[2])) > err) {
+      err = e;
+    }
+  }
+  return err;
+}
+
+void GfxColorSpaceLUT::incRefCnt() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+}
+
+void GfxColorSpaceLUT::decRefCnt() {
+  GBool done;
+
+#if MULTITHREADED
+  done = gAtomicDecrement(&refCnt) == 0;
+#else
+  done = --refCnt == 0;
+#endif
+  if (done) {
+    delete this;
+  }
+}
+
+void GfxColorSpaceLUT::mapComp(int i, GfxColorComp x,
+			       int *offset, int *frac) {
+  double t;
+  int j;
+
+  if (range[i] > 0) {
+    t = ((colToDbl(x) - low[i]) / range[i]) * (gridSize - 1);
+  } else {
+    t = 0;
+  }
+  if (t <= 0) {
+    *offset = 0;
+    *frac = 0;
+  } else if (t >= gridSize - 1) {
+    *offset = (gridSize - 2) * stride[i];
+    *frac = 256;
+  } else {
+    j = (int)t;
+    *offset = j * stride[i];
+    *frac = (int)((t - j) * 256 + 0.5);
+  }
+}
+
+void GfxColorSpaceLUT::getRGB(int *offset, int *frac, Guchar *rgb) {
+  int order[gfxColorMaxComps];
+  GfxColorComp *p;
+  int base, r, g, b, w, f, i, j;
+
+  // sort the components by decreasing fraction -- this selects the
+  // simplex (within the grid cell) that contains the color
+  base = 0;
+  order[0] = 0;
+  for (i = 0; i < nComps; ++i) {
+    base += offset[i];
+    f = frac[i];
+    for (j = i; j > 0 && frac[order[j-1]] < f; --j) {
+      order[j] = order[j-1];
+    }
+    order[j] = i;
+  }
+
+  // interpolate between the simplex vertices
+  p = table + base;
+  w = 256 - frac[order[0]];
+  r = w * p[0];
+  g = w * p[1];
+  b = w * p[2];
+  for (i = 0; i < nComps; ++i) {
+    base += stride[order[i]];
+    if (i + 1 < nComps) {
+      w = frac[order[i]] - frac[order[i+1]];
+    } else {
+      w = frac[order[i]];
+    }
+    if (w) {
+      p = table + base;
+      r += w * p[0];
+      g += w * p[1];
+      b += w * p[2];
+    }
+  }
+  rgb[0] = colToByte((r + 128) >> 8);
+  rgb[1] = colToByte((g + 128) >> 8);
+  rgb[2] = colToByte((b + 128) >> 8);
+}
+
 //------------------------------------------------------------------------
 // GfxImageColorMap
 //------------------------------------------------------------------------
@@ -3703,7 +3935,14 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
   for (k = 0; k < gfxColorMaxComps; ++k) {
     lookup[k] = NULL;
     lookup2[k] = NULL;
+    lutOffset[k] = NULL;
+    lutFrac[k] = NULL;
   }
+  rgbByteLookup = NULL;
+  rgbByteLookupRI = gfxRenderingIntentRelativeColorimetric;
+  rgbLUT = NULL;
+  lutState = 2;
+  nExactPixels = 0;
 
   // get decode map
   colorSpace->getDefaultRanges(defaultLow, defaultRange, maxPixel);
@@ -3812,6 +4051,13 @@ GfxImageColorMap::GfxImageColorMap(int bitsA, Object *decode,
     }
   }
 
+  // the RGB lookup tables are built in getRGBByteLine, once enough
+  // pixels have been converted to make that worthwhile
+  if (globalParams->getEnableColorLUTs() &&
+      (nComps == 1 || useRGBLUT(colorSpace))) {
+    lutState = 0;
+  }
+
   return;
 
  err2:
@@ -3831,6 +4077,8 @@ GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
   for (k = 0; k < gfxColorMaxComps; ++k) {
     lookup[k] = NULL;
     lookup2[k] = NULL;
+    lutOffset[k] = NULL;
+    lutFrac[k] = NULL;
   }
   if (bits <= 8) {
     n = 1 << bits;
@@ -3858,6 +4106,19 @@ GfxImageColorMap::GfxImageColorMap(GfxImageColorMap *colorMap) {
     decodeLow[i] = colorMap->decodeLow[i];
     decodeRange[i] = colorMap->decodeRange[i];
   }
+  rgbByteLookup = NULL;
+  rgbByteLookupRI = colorMap->rgbByteLookupRI;
+  if (colorMap->rgbByteLookup) {
+    rgbByteLookup = (Guchar *)gmallocn(n, 3);
+    memcpy(rgbByteLookup, colorMap->rgbByteLookup, n * 3);
+  }
+  rgbLUT = NULL;
+  lutState = colorMap->lutState;
+  nExactPixels = colorMap->nExactPixels;
+  if (colorMap->rgbLUT) {
+    colorMap->rgbLUT->incRefCnt();
+    initRGBLUT(colorMap->rgbLUT);
+  }
   ok = gTrue;
 }
 
@@ -3868,9 +4129,82 @@ GfxImageColorMap::~GfxImageColorMap() {
   for (i = 0; i < gfxColorMaxComps; ++i) {
     gfree(lookup[i]);
     gfree(lookup2[i]);
+    gfree(lutOffset[i]);
+    gfree(lutFrac[i]);
+  }
+  gfree(rgbByteLookup);
+  if (rgbLUT) {
+    rgbLUT->decRefCnt();
   }
 }
 
+// Returns true if it's worth using a GfxColorSpaceLUT for images in
+// [cs], i.e., if converting colors in [cs] to RGB is expensive.
+GBool GfxImageColorMap::useRGBLUT(GfxColorSpace *cs) {
+  switch (cs->getMode()) {
+  case csLab:
+  case csDeviceN:
+    return gTrue;
+  case csICCBased:
+    return useRGBLUT(((GfxICCBasedColorSpace *)cs)->getAlt());
+  default:
+    return gFalse;
+  }
+}
+
+void GfxImageColorMap::setRGBLUT(GfxColorSpaceLUT *lut) {
+  if (lutState != 0 || nComps == 1 || lut->getNComps() != nComps) {
+    return;
+  }
+  lut->incRefCnt();
+  initRGBLUT(lut);
+}
+
+void GfxImageColorMap::buildRGBLookup(GfxRenderingIntent ri) {
+  GfxColorSpaceLUT *lut;
+  GfxRGB rgb;
+  Guchar x;
+  int n, i;
+
+  if (nComps == 1) {
+    n = bits <= 8 ? (1 << bits) : 256;
+    rgbByteLookup = (Guchar *)gmallocn(n, 3);
+    for (i = 0; i < n; ++i) {
+      x = (Guchar)i;
+      getRGB(&x, &rgb, ri);
+      rgbByteLookup[i*3] = colToByte(rgb.r);
+      rgbByteLookup[i*3 + 1] = colToByte(rgb.g);
+      rgbByteLookup[i*3 + 2] = colToByte(rgb.b);
+    }
+    rgbByteLookupRI = ri;
+    lutState = 1;
+  } else if ((lut = GfxColorSpaceLUT::build(colorSpace, ri))) {
+    initRGBLUT(lut);
+  } else {
+    lutState = 2;
+  }
+}
+
+// Takes ownership of one reference to [lut].
+void GfxImageColorMap::initRGBLUT(GfxColorSpaceLUT *lut) {
+  int n, i, k;
+
+  rgbLUT = lut;
+  if (rgbLUT->getMaxError() > gfxColorSpaceLUTMaxError) {
+    lutState = 2;
+    return;
+  }
+  n = bits <= 8 ? (1 << bits) : 256;
+  for (k = 0; k < nComps; ++k) {
+    lutOffset[k] = (int *)gmallocn(n, sizeof(int));
+    lutFrac[k] = (int *)gmallocn(n, sizeof(int));
+    for (i = 0; i < n; ++i) {
+      rgbLUT->mapComp(k, lookup[k][i], &lutOffset[k][i], &lutFrac[k][i]);
+    }
+  }
+  lutState = 1;
+}
+
 void GfxImageColorMap::getGray(Guchar *x, GfxGray *gray,
 			       GfxRenderingIntent ri) {
   GfxColor color;
@@ -3962,7 +4296,45 @@ void GfxImageColorMap::getRGBByteLine(Guchar *in, Guchar *out, int n,
 				      GfxRenderingIntent ri) {
   GfxColor color;
   GfxRGB rgb;
-  int i, j;
+  int offset[gfxColorMaxComps], frac[gfxColorMaxComps];
+  Guchar *p;
+  int buildCost, i, j;
+
+  // build a lookup table once the number of pixels converted
+  // individually exceeds the cost of building the table
+  if (lutState == 0) {
+    nExactPixels += n;
+    if (nComps == 1) {
+      buildCost = bits <= 8 ? (1 << bits) : 256;
+    } else {
+      buildCost = GfxColorSpaceLUT::getNGridPoints(nComps);
+    }
+    if (nExactPixels > buildCost) {
+      buildRGBLookup(ri);
+    }
+  }
+
+  if (lutState == 1) {
+    if (rgbByteLookup && rgbByteLookupRI == ri) {
+      for (j = 0; j < n; ++j) {
+	p = &rgbByteLookup[in[j] * 3];
+	out[j*3] = p[0];
+	out[j*3 + 1] = p[1];
+	out[j*3 + 2] = p[2];
+      }
+      return;
+    }
+    if (rgbLUT && rgbLUT->getRenderingIntent() == ri) {
+      for (j = 0; j < n; ++j) {
+	for (i = 0; i < nComps; ++i) {
+	  offset[i] = lutOffset[i][in[j * nComps + i]];
+	  frac[i] = lutFrac[i][in[j * nComps + i]];
+	}
+	rgbLUT->getRGB(offset, frac, &out[j*3]);
+      }
+      return;
+    }
+  }
 
   if (colorSpace2) {
     for (j = 0; j < n; ++j) {
@@ -19,6 +19,10 @@
 #include "Object.h"
 #include "Function.h"
 
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+
 class Array;
 class GfxFont;
 class PDFRectangle;
@@ -885,6 +889,8 @@ public:
 		   double *x2, double *y2, double *color2);
   void getBBox(double *xMin, double *yMin, double *xMax, double *yMax);
   void getColor(double *in, GfxColor *out);
+  int getNFuncs() { return nFuncs; }
+  Function *getFunc(int i) { return funcs[i]; }
 
 private:
 
@@ -925,6 +931,8 @@ public:
   GfxPatch *getPatch(int i) { return &patches[i]; }
   void getBBox(double *xMin, double *yMin, double *xMax, double *yMax);
   void getColor(double *in, GfxColor *out);
+  int getNFuncs() { return nFuncs; }
+  Function *getFunc(int i) { return funcs[i]; }
 
 private:
 
@@ -935,6 +943,71 @@ private:
   int nFuncs;
 };
 
+//------------------------------------------------------------------------
+// GfxColorSpaceLUT
+//------------------------------------------------------------------------
+
+// Interpolated lookup table for converting colors in an n-component
+// color space to 8-bit RGB.  The table holds the RGB values at the
+// points of a regular grid spanning the color space's default
+// ranges; other colors are computed by simplex interpolation (which
+// is tetrahedral interpolation in the 3-component case).  This is
+// used for images in color spaces which are expensive to convert
+// (DeviceN with a tint transform function, Lab).
+class GfxColorSpaceLUT {
+public:
+
+  // Build a table for [colorSpace].  Returns NULL if the color space
+  // has too few or too many components.
+  static GfxColorSpaceLUT *build(GfxColorSpace *colorSpace,
+				 GfxRenderingIntent riA);
+
+  // Returns the number of grid points in a table for an
+  // [nCompsA]-component color space, or 0 if no table can be built.
+  static int getNGridPoints(int nCompsA);
+
+  void incRefCnt();
+  void decRefCnt();
+
+  GfxRenderingIntent getRenderingIntent() { return ri; }
+  int getNComps() { return nComps; }
+  int getGridSize() { return gridSize; }
+
+  // Returns the max error (in 8-bit RGB units) measured at a set of
+  // test colors when the table was built.
+  int getMaxError() { return maxError; }
+
+  // Map component [i] of a color, [x], to the offset of its grid
+  // cell in the table, and its fractional position (0..256) within
+  // that cell.
+  void mapComp(int i, GfxColorComp x, int *offset, int *frac);
+
+  // Convert a color, specified as a grid offset and fraction (see
+  // mapComp) for each component, to 8-bit RGB.
+  void getRGB(int *offset, int *frac, Guchar *rgb);
+
+private:
+
+  GfxColorSpaceLUT(int nCompsA, int gridSizeA, GfxRenderingIntent riA);
+  ~GfxColorSpaceLUT();
+  int measureError(GfxColorSpace *colorSpace);
+
+  int nComps;
+  int gridSize;			// number of grid points per component
+  GfxRenderingIntent ri;
+  double low[gfxColorMaxComps];	// component ranges
+  double range[gfxColorMaxComps];
+  int stride[gfxColorMaxComps];	// table offset between adjacent grid
+				//   points, for each component
+  GfxColorComp *table;		// RGB values at the grid points
+  int maxError;
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
+};
+
 //------------------------------------------------------------------------
 // GfxImageColorMap
 //------------------------------------------------------------------------
@@ -977,9 +1050,22 @@ public:
   void getRGBByteLine(Guchar *in, Guchar *out, int n, GfxRenderingIntent ri);
   void getCMYKByteLine(Guchar *in, Guchar *out, int n, GfxRenderingIntent ri);
 
+  // Get/set the lookup table used to convert multi-component pixels
+  // to RGB.  This allows images which use the same color space to
+  // share the table.  getRGBLUT() returns NULL if no table has been
+  // built (yet) -- but a non-NULL table isn't necessarily used: a
+  // table which exceeds gfxColorSpaceLUTMaxError is kept (and shared)
+  // as a cached "don't use a LUT" result, and lutState decides
+  // whether the table is used.
+  GfxColorSpaceLUT *getRGBLUT() { return rgbLUT; }
+  void setRGBLUT(GfxColorSpaceLUT *lut);
+
 private:
 
   GfxImageColorMap(GfxImageColorMap *colorMap);
+  void buildRGBLookup(GfxRenderingIntent ri);
+  void initRGBLUT(GfxColorSpaceLUT *lut);
+  static GBool useRGBLUT(GfxColorSpace *cs);
 
   GfxColorSpace *colorSpace;	// the image color space
   int bits;			// bits per component
@@ -994,6 +1080,17 @@ private:
     decodeLow[gfxColorMaxComps];
   double			// max - min value for each component
     decodeRange[gfxColorMaxComps];
+  Guchar *rgbByteLookup;	// RGB lookup table for single-component
+				//   images
+  GfxRenderingIntent rgbByteLookupRI; // rendering intent for rgbByteLookup
+  GfxColorSpaceLUT *rgbLUT;	// RGB lookup table for multi-component
+				//   images
+  int *lutOffset[gfxColorMaxComps]; // LUT grid offset and fraction for
+  int *lutFrac[gfxColorMaxComps];   //   each pixel component value
+  int lutState;			// 0 = not built yet, 1 = in use,
+				//   2 = not used
+  int nExactPixels;		// number of pixels converted without
+				//   the LUT (lutState = 0)
   GBool ok;
 };
 
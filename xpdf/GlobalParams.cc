@@ -25,21 +25,27 @@
 #endif
 #if HAVE_FONTCONFIG
 #  include <fontconfig/fontconfig.h>
+#  ifdef _WIN32
+#    include <process.h>
+#  else
+#    include <unistd.h>
+#  endif
 #endif
 #include "gmem.h"
 #include "gmempp.h"
 #include "GString.h"
 #include "GList.h"
 #include "GHash.h"
+#include "GStrHash.h"
 #include "gfile.h"
 #include "FoFiIdentifier.h"
 #include "Error.h"
-#include "NameToCharCode.h"
 #include "CharCodeToUnicode.h"
 #include "UnicodeRemapping.h"
 #include "UnicodeMap.h"
 #include "CMap.h"
 #include "BuiltinFontTables.h"
+#include "NameTable.h"
 #include "FontEncodingTables.h"
 #include "GlobalParams.h"
 
@@ -344,6 +350,28 @@ int SysFontInfo::match(GString *nameA) {
   return 0;
 }
 
+//------------------------------------------------------------------------
+// SysFontIndexDep
+//------------------------------------------------------------------------
+
+#if HAVE_FONTCONFIG
+
+// Version number for the system font index file format.
+#define sysFontIndexVersion 1
+
+class SysFontIndexDep {
+public:
+
+  SysFontIndexDep(GString *pathA, long mtimeA)
+    { path = pathA; mtime = mtimeA; }
+  ~SysFontIndexDep() { delete path; }
+
+  GString *path;
+  long mtime;
+};
+
+#endif
+
 //------------------------------------------------------------------------
 // SysFontList
 //------------------------------------------------------------------------
@@ -361,24 +389,47 @@ public:
 
 #if HAVE_FONTCONFIG
   void scanFontconfigFonts();
+
+  // Read the font list from an index file written by writeIndex().
+  // Returns false if the file is missing or invalid, or if any of the
+  // font directories or fontconfig config files has changed since the
+  // index was written.
+  GBool readIndex(GString *fileName);
+
+  // Write the font list (from scanFontconfigFonts) to an index file.
+  void writeIndex(GString *fileName);
 #endif
 
 private:
 
+#if HAVE_FONTCONFIG
+  void addIndexDep(const char *path);
+#endif
+
 #ifdef _WIN32
   SysFontInfo *makeWindowsFont(char *name, int fontNum,
 			       char *path);
 #endif
 
   GList *fonts;			// [SysFontInfo]
+#if HAVE_FONTCONFIG
+  GList *indexDeps;		// files and dirs that the font list
+				//   depends on [SysFontIndexDep]
+#endif
 };
 
 SysFontList::SysFontList() {
   fonts = new GList();
+#if HAVE_FONTCONFIG
+  indexDeps = new GList();
+#endif
 }
 
 SysFontList::~SysFontList() {
   deleteGList(fonts, SysFontInfo);
+#if HAVE_FONTCONFIG
+  deleteGList(indexDeps, SysFontIndexDep);
+#endif
 }
 
 SysFontInfo *SysFontList::find(GString *name) {
@@ -492,6 +543,8 @@ void SysFontList::scanFontconfigFonts() {
   FcPattern *pattern;
   FcObjectSet *objSet;
   FcFontSet *fontSet;
+  FcStrList *strList;
+  FcChar8 *s;
   char *name, *file;
   SysFontType type;
   int fontNum, i, n;
@@ -509,6 +562,21 @@ void SysFontList::scanFontconfigFonts() {
   FcPatternDestroy(pattern);
   FcObjectSetDestroy(objSet);
 
+  // the font directories (including subdirectories) and config files
+  // determine the font list, so they're used to validate the index
+  if ((strList = FcConfigGetFontDirs(cfg))) {
+    while ((s = FcStrListNext(strList))) {
+      addIndexDep((char *)s);
+    }
+    FcStrListDone(strList);
+  }
+  if ((strList = FcConfigGetConfigFiles(cfg))) {
+    while ((s = FcStrListNext(strList))) {
+      addIndexDep((char *)s);
+    }
+    FcStrListDone(strList);
+  }
+
   if (fontSet) {
     for (i = 0; i < fontSet->nfont; ++i) {
 
@@ -553,6 +621,161 @@ void SysFontList::scanFontconfigFonts() {
 
   FcConfigDestroy(cfg);
 }
+
+void SysFontList::addIndexDep(const char *path) {
+  int i;
+
+  if (!*path) {
+    return;
+  }
+  for (i = 0; i < indexDeps->getLength(); ++i) {
+    if (!((SysFontIndexDep *)indexDeps->get(i))->path->cmp(path)) {
+      return;
+    }
+  }
+  indexDeps->append(new SysFontIndexDep(new GString(path),
+					(long)getModTime((char *)path)));
+}
+
+// The index is a text file: a version line, followed by one line per
+// dependency ("d", mtime, path) and one line per font ("f", type,
+// font number, path, name), with tab-separated fields.  The whole
+// file is read into memory and split in place.
+GBool SysFontList::readIndex(GString *fileName) {
+  FILE *f;
+  char *buf, *line, *next, *fields[5];
+  long size;
+  int nFields, type, fontNum, i;
+  GBool ok;
+
+  if (!(f = openFile(fileName->getCString(), "rb"))) {
+    return gFalse;
+  }
+  if (gfseek(f, 0, SEEK_END) ||
+      (size = (long)gftell(f)) <= 0 ||
+      gfseek(f, 0, SEEK_SET)) {
+    fclose(f);
+    return gFalse;
+  }
+  buf = (char *)gmalloc((int)size + 1);
+  if ((long)fread(buf, 1, size, f) != size) {
+    gfree(buf);
+    fclose(f);
+    return gFalse;
+  }
+  buf[size] = '\0';
+  fclose(f);
+
+  ok = gTrue;
+  for (line = buf; ok && line && *line; line = next) {
+    if ((next = strchr(line, '\n'))) {
+      *next++ = '\0';
+    }
+    if (line == buf) {
+      ok = atoi(line) == sysFontIndexVersion &&
+	   !strncmp(line + strspn(line, "0123456789"),
+		    " xpdf-sysfont-index", 19);
+      continue;
+    }
+    nFields = 0;
+    fields[nFields++] = line;
+    for (i = 0; line[i] && nFields < 5; ++i) {
+      if (line[i] == '\t') {
+	line[i] = '\0';
+	fields[nFields++] = line + i + 1;
+      }
+    }
+    if (!strcmp(fields[0], "d") && nFields == 3) {
+      ok = atol(fields[1]) == (long)getModTime(fields[2]);
+      if (ok) {
+	indexDeps->append(new SysFontIndexDep(new GString(fields[2]),
+					      atol(fields[1])));
+      }
+    } else if (!strcmp(fields[0], "f") && nFields == 5) {
+      type = atoi(fields[1]);
+      fontNum = atoi(fields[2]);
+      ok = type >= sysFontPFA && type <= sysFontOTF && fontNum >= 0;
+      if (ok) {
+	fonts->append(new SysFontInfo(new GString(fields[4]),
+				      new GString(fields[3]),
+				      (SysFontType)type, fontNum));
+      }
+    } else {
+      ok = gFalse;
+    }
+  }
+  gfree(buf);
+
+  if (!ok || indexDeps->getLength() == 0) {
+    deleteGList(fonts, SysFontInfo);
+    fonts = new GList();
+    deleteGList(indexDeps, SysFontIndexDep);
+    indexDeps = new GList();
+    return gFalse;
+  }
+  return gTrue;
+}
+
+// The index is written to a temporary file, which is then renamed, so
+// that other processes never see a partially written index.
+void SysFontList::writeIndex(GString *fileName) {
+  SysFontInfo *fi;
+  SysFontIndexDep *dep;
+  GString *tmpFileName;
+  FILE *f;
+  GBool ok;
+  int i;
+
+  // names and paths containing tabs or newlines can't be stored
+  for (i = 0; i < fonts->getLength(); ++i) {
+    fi = (SysFontInfo *)fonts->get(i);
+    if (strpbrk(fi->name->getCString(), "\t\n") ||
+	strpbrk(fi->path->getCString(), "\t\n")) {
+      return;
+    }
+  }
+  for (i = 0; i < indexDeps->getLength(); ++i) {
+    dep = (SysFontIndexDep *)indexDeps->get(i);
+    if (strpbrk(dep->path->getCString(), "\t\n")) {
+      return;
+    }
+  }
+
+#ifdef _WIN32
+  tmpFileName = GString::format("{0:t}.{1:d}", fileName, (int)_getpid());
+#else
+  tmpFileName = GString::format("{0:t}.{1:d}", fileName, (int)getpid());
+#endif
+  if (!(f = openFile(tmpFileName->getCString(), "wb"))) {
+    error(errIO, -1, "Couldn't write system font index file '{0:t}'",
+	  fileName);
+    delete tmpFileName;
+    return;
+  }
+  fprintf(f, "%d xpdf-sysfont-index\n", sysFontIndexVersion);
+  for (i = 0; i < indexDeps->getLength(); ++i) {
+    dep = (SysFontIndexDep *)indexDeps->get(i);
+    fprintf(f, "d\t%ld\t%s\n", dep->mtime, dep->path->getCString());
+  }
+  for (i = 0; i < fonts->getLength(); ++i) {
+    fi = (SysFontInfo *)fonts->get(i);
+    fprintf(f, "f\t%d\t%d\t%s\t%s\n", (int)fi->type, fi->fontNum,
+	    fi->path->getCString(), fi->name->getCString());
+  }
+  ok = !ferror(f);
+  ok = !fclose(f) && ok;
+#ifdef _WIN32
+  if (ok) {
+    remove(fileName->getCString());
+  }
+#endif
+  if (!ok || rename(tmpFileName->getCString(), fileName->getCString())) {
+    error(errIO, -1, "Couldn't write system font index file '{0:t}'",
+	  fileName);
+    remove(tmpFileName->getCString());
+  }
+  delete tmpFileName;
+}
 #endif // HAVE_FONTCONFIG
 
 //------------------------------------------------------------------------
@@ -623,13 +846,14 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
 #endif
 
   initBuiltinFontTables();
+  initNameTable();
 
   // scan the encoding in reverse because we want the lowest-numbered
   // index for each char name ('space' is encoded twice)
-  macRomanReverseMap = new NameToCharCode();
+  macRomanReverseMap = new GStrHash(256);
   for (i = 255; i >= 0; --i) {
     if (macRomanEncoding[i]) {
-      macRomanReverseMap->add(macRomanEncoding[i], (CharCode)i);
+      macRomanReverseMap->add(macRomanEncoding[i], i);
     }
   }
 
@@ -641,7 +865,7 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
 #endif
   configFileVars = new GHash(gTrue);
   setDataDirVar();
-  nameToUnicode = new NameToCharCode();
+  nameToUnicode = new GStrHash();
   cidToUnicodes = new GHash(gTrue);
   unicodeToUnicodes = new GHash(gTrue);
   residentUnicodeMaps = new GHash();
@@ -654,6 +878,7 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   ccFontFiles = new GHash(gTrue);
   base14SysFonts = new GHash(gTrue);
   sysFonts = new SysFontList();
+  sysFontIndexFile = NULL;
 #if HAVE_PAPER_H
   char *paperName;
   const struct paper *paperType;
@@ -718,8 +943,20 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   initialSelectMode = new GString("linear");
   maxTileWidth = 1500;
   maxTileHeight = 1500;
-  tileCacheSize = 10;
+  tileCacheSize = 0;
+  tileCacheMemory = 64;
+  tileCacheCompression = gFalse;
+  tilePyramidCacheSize = 32;
   workerThreads = 1;
+  imageCacheSize = 32;
+  imageScalingThreads = 1;
+  enableColorLUTs = gTrue;
+  shadingThreads = 1;
+  fontFileCacheSize = 0;
+  glyphCacheSize = 1024;
+  type3CacheSize = 16;
+  formCacheSize = 0;
+  patternCacheSize = 8;
   enableFreeType = gTrue;
   disableFreeTypeHinting = gFalse;
   antialias = gTrue;
@@ -738,6 +975,10 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   drawAnnotations = gTrue;
   drawFormFields = gTrue;
   enableXFA = gTrue;
+  contentStreamCacheSize = 16;
+  prefetchPages = gFalse;
+  rangeStreamBlockSize = 65536;
+  rangeStreamCacheSize = 16;
   overprintPreview = gFalse;
   paperColor = new GString("#ffffff");
   matteColor = new GString("#808080");
@@ -752,7 +993,7 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   mapExtTrueTypeFontsViaUnicode = gTrue;
   useTrueTypeUnicodeMapping = gFalse;
   droppedFonts = new GHash(gTrue);
-  createDefaultKeyBindings();
+  keyBindings = NULL;
   popupMenuCmds = new GList();
   tabStateFile = appendToPath(getHomeDir(), ".xpdf.tab-state");
   savePageNumbers = gTrue;
@@ -767,11 +1008,6 @@ GlobalParams::GlobalParams(const char *cfgFileName) {
   unicodeMapCache = new UnicodeMapCache();
   cMapCache = new CMapCache();
 
-  // set up the initial nameToUnicode table
-  for (i = 0; nameToUnicodeTab[i].name; ++i) {
-    nameToUnicode->add(nameToUnicodeTab[i].name, nameToUnicodeTab[i].u);
-  }
-
   // set up the residentUnicodeMaps table
   map = new UnicodeMap("Latin1", gFalse,
 		       latin1UnicodeMapRanges, latin1UnicodeMapLen);
@@ -1172,6 +1408,15 @@ void GlobalParams::parseLine(char *buf, GString *fileName, int line) {
       parseInteger("maxTileHeight", &maxTileHeight, tokens, fileName, line);
     } else if (!cmd->cmp("tileCacheSize")) {
       parseInteger("tileCacheSize", &tileCacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("tileCacheMemory")) {
+      parseInteger("tileCacheMemory", &tileCacheMemory,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("tileCacheCompression")) {
+      parseYesNo("tileCacheCompression", &tileCacheCompression,
+		 tokens, fileName, line);
+    } else if (!cmd->cmp("tilePyramidCacheSize")) {
+      parseInteger("tilePyramidCacheSize", &tilePyramidCacheSize,
+		   tokens, fileName, line);
     } else if (!cmd->cmp("workerThreads")) {
       parseInteger("workerThreads", &workerThreads, tokens, fileName, line);
     } else if (!cmd->cmp("enableFreeType")) {
@@ -1223,9 +1468,44 @@ void GlobalParams::parseLine(char *buf, GString *fileName, int line) {
     } else if (!cmd->cmp("enableXFA")) {
       parseYesNo("enableXFA", &enableXFA,
 		 tokens, fileName, line);
+    } else if (!cmd->cmp("contentStreamCacheSize")) {
+      parseInteger("contentStreamCacheSize", &contentStreamCacheSize,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("prefetchPages")) {
+      parseYesNo("prefetchPages", &prefetchPages, tokens, fileName, line);
+    } else if (!cmd->cmp("rangeStreamBlockSize")) {
+      parseInteger("rangeStreamBlockSize", &rangeStreamBlockSize,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("rangeStreamCacheSize")) {
+      parseInteger("rangeStreamCacheSize", &rangeStreamCacheSize,
+		   tokens, fileName, line);
     } else if (!cmd->cmp("overprintPreview")) {
       parseYesNo("overprintPreview", &overprintPreview,
 		 tokens, fileName, line);
+    } else if (!cmd->cmp("imageCacheSize")) {
+      parseInteger("imageCacheSize", &imageCacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("imageScalingThreads")) {
+      parseInteger("imageScalingThreads", &imageScalingThreads,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("enableColorLUTs")) {
+      parseYesNo("enableColorLUTs", &enableColorLUTs, tokens, fileName, line);
+    } else if (!cmd->cmp("shadingThreads")) {
+      parseInteger("shadingThreads", &shadingThreads, tokens, fileName, line);
+    } else if (!cmd->cmp("fontFileCacheSize")) {
+      parseInteger("fontFileCacheSize", &fontFileCacheSize,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("sysFontIndexFile")) {
+      parseString("sysFontIndexFile", &sysFontIndexFile,
+		  tokens, fileName, line);
+    } else if (!cmd->cmp("glyphCacheSize")) {
+      parseInteger("glyphCacheSize", &glyphCacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("type3CacheSize")) {
+      parseInteger("type3CacheSize", &type3CacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("formCacheSize")) {
+      parseInteger("formCacheSize", &formCacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("patternCacheSize")) {
+      parseInteger("patternCacheSize", &patternCacheSize,
+		   tokens, fileName, line);
     } else if (!cmd->cmp("paperColor")) {
       parseString("paperColor", &paperColor, tokens, fileName, line);
     } else if (!cmd->cmp("matteColor")) {
@@ -1391,7 +1671,7 @@ void GlobalParams::parseNameToUnicode(GList *tokens, GString *fileName,
     tok2 = strtok(NULL, " \t\r\n");
     if (tok1 && tok2) {
       sscanf(tok1, "%x", &u);
-      nameToUnicode->add(tok2, u);
+      nameToUnicode->add(tok2, (int)u);
     } else {
       error(errConfig, -1, "Bad line in 'nameToUnicode' file ({0:t}:{1:d})",
 	    name, line2);
@@ -1752,6 +2032,9 @@ void GlobalParams::parseBind(GList *tokens, GString *fileName, int line) {
 		"bind", tokens, fileName, line)) {
     return;
   }
+  if (!keyBindings) {
+    createDefaultKeyBindings();
+  }
   for (i = 0; i < keyBindings->getLength(); ++i) {
     binding = (KeyBinding *)keyBindings->get(i);
     if (binding->code == code &&
@@ -1782,6 +2065,9 @@ void GlobalParams::parseUnbind(GList *tokens, GString *fileName, int line) {
 		"unbind", tokens, fileName, line)) {
     return;
   }
+  if (!keyBindings) {
+    createDefaultKeyBindings();
+  }
   for (i = 0; i < keyBindings->getLength(); ++i) {
     binding = (KeyBinding *)keyBindings->get(i);
     if (binding->code == code &&
@@ -2076,6 +2362,7 @@ GlobalParams::~GlobalParams() {
   GList *list;
 
   freeBuiltinFontTables();
+  freeNameTable();
 
   delete macRomanReverseMap;
 
@@ -2093,6 +2380,9 @@ GlobalParams::~GlobalParams() {
   deleteGHash(ccFontFiles, GString);
   deleteGHash(base14SysFonts, Base14FontInfo);
   delete sysFonts;
+  if (sysFontIndexFile) {
+    delete sysFontIndexFile;
+  }
   deleteGHash(psResidentFonts, GString);
   deleteGList(psResidentFonts16, PSFontParam16);
   deleteGList(psResidentFontsCC, PSFontParam16);
@@ -2122,7 +2412,9 @@ GlobalParams::~GlobalParams() {
     delete defaultPrinter;
   }
   delete droppedFonts;
-  deleteGList(keyBindings, KeyBinding);
+  if (keyBindings) {
+    deleteGList(keyBindings, KeyBinding);
+  }
   deleteGList(popupMenuCmds, PopupMenuCmd);
   delete tabStateFile;
   delete debugLogFile;
@@ -2389,7 +2681,12 @@ void GlobalParams::setupBaseFonts(const char *dir) {
   }
 #endif
 #if HAVE_FONTCONFIG
-  sysFonts->scanFontconfigFonts();
+  if (!sysFontIndexFile || !sysFonts->readIndex(sysFontIndexFile)) {
+    sysFonts->scanFontconfigFonts();
+    if (sysFontIndexFile) {
+      sysFonts->writeIndex(sysFontIndexFile);
+    }
+  }
 #endif
 }
 
@@ -2399,7 +2696,7 @@ void GlobalParams::setupBaseFonts(const char *dir) {
 
 CharCode GlobalParams::getMacRomanCharCode(char *charName) {
   // no need to lock - macRomanReverseMap is constant
-  return macRomanReverseMap->lookup(charName);
+  return (CharCode)macRomanReverseMap->lookupInt(charName);
 }
 
 GString *GlobalParams::getBaseDir() {
@@ -2412,8 +2709,30 @@ GString *GlobalParams::getBaseDir() {
 }
 
 Unicode GlobalParams::mapNameToUnicode(const char *charName) {
+  Unicode u;
+  int a, b, m, cmp;
+
   // no need to lock - nameToUnicode is constant
-  return nameToUnicode->lookup(charName);
+  if ((u = (Unicode)nameToUnicode->lookupInt(charName))) {
+    return u;
+  }
+
+  // binary search the built-in table -- this is sorted, so it doesn't
+  // need to be copied into a hash table at startup
+  a = -1;
+  b = (int)(sizeof(nameToUnicodeTab) / sizeof(nameToUnicodeTab[0])) - 1;
+  while (b - a > 1) {
+    m = (a + b) / 2;
+    cmp = strcmp(nameToUnicodeTab[m].name, charName);
+    if (cmp < 0) {
+      a = m;
+    } else if (cmp > 0) {
+      b = m;
+    } else {
+      return nameToUnicodeTab[m].u;
+    }
+  }
+  return 0;
 }
 
 UnicodeMap *GlobalParams::getResidentUnicodeMap(GString *encodingName) {
@@ -3022,6 +3341,33 @@ int GlobalParams::getTileCacheSize() {
   return n;
 }
 
+int GlobalParams::getTileCacheMemory() {
+  int n;
+
+  lockGlobalParams;
+  n = tileCacheMemory;
+  unlockGlobalParams;
+  return n;
+}
+
+GBool GlobalParams::getTileCacheCompression() {
+  GBool f;
+
+  lockGlobalParams;
+  f = tileCacheCompression;
+  unlockGlobalParams;
+  return f;
+}
+
+int GlobalParams::getTilePyramidCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = tilePyramidCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
 int GlobalParams::getWorkerThreads() {
   int n;
 
@@ -3031,6 +3377,87 @@ int GlobalParams::getWorkerThreads() {
   return n;
 }
 
+int GlobalParams::getImageCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = imageCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getImageScalingThreads() {
+  int n;
+
+  lockGlobalParams;
+  n = imageScalingThreads;
+  unlockGlobalParams;
+  return n;
+}
+
+GBool GlobalParams::getEnableColorLUTs() {
+  GBool en;
+
+  lockGlobalParams;
+  en = enableColorLUTs;
+  unlockGlobalParams;
+  return en;
+}
+
+int GlobalParams::getShadingThreads() {
+  int n;
+
+  lockGlobalParams;
+  n = shadingThreads;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getFontFileCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = fontFileCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getGlyphCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = glyphCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getType3CacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = type3CacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getFormCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = formCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getPatternCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = patternCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
 GBool GlobalParams::getEnableFreeType() {
   GBool f;
 
@@ -3194,6 +3621,42 @@ GBool GlobalParams::getEnableXFA() {
   return xfa;
 }
 
+int GlobalParams::getContentStreamCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = contentStreamCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+GBool GlobalParams::getPrefetchPages() {
+  GBool prefetch;
+
+  lockGlobalParams;
+  prefetch = prefetchPages;
+  unlockGlobalParams;
+  return prefetch;
+}
+
+int GlobalParams::getRangeStreamBlockSize() {
+  int n;
+
+  lockGlobalParams;
+  n = rangeStreamBlockSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getRangeStreamCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = rangeStreamCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
 
 
 GString *GlobalParams::getPaperColor() {
@@ -3305,6 +3768,9 @@ GList *GlobalParams::getKeyBinding(int code, int mods, int context) {
   cmds = NULL;
   // for ASCII chars, ignore the shift modifier
   modMask = (code >= 0x21 && code <= 0xff) ? ~xpdfKeyModShift : ~0;
+  if (!keyBindings) {
+    createDefaultKeyBindings();
+  }
   for (i = 0; i < keyBindings->getLength(); ++i) {
     binding = (KeyBinding *)keyBindings->get(i);
     if (binding->code == code &&
@@ -3322,6 +3788,11 @@ GList *GlobalParams::getKeyBinding(int code, int mods, int context) {
 }
 
 GList *GlobalParams::getAllKeyBindings() {
+  lockGlobalParams;
+  if (!keyBindings) {
+    createDefaultKeyBindings();
+  }
+  unlockGlobalParams;
   return keyBindings;
 }
 
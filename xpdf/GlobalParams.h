@@ -29,7 +29,7 @@
 class GString;
 class GList;
 class GHash;
-class NameToCharCode;
+class GStrHash;
 class CharCodeToUnicode;
 class CharCodeToUnicodeCache;
 class UnicodeMap;
@@ -308,7 +308,19 @@ public:
   int getMaxTileWidth();
   int getMaxTileHeight();
   int getTileCacheSize();
+  int getTileCacheMemory();
+  GBool getTileCacheCompression();
+  int getTilePyramidCacheSize();
   int getWorkerThreads();
+  int getImageCacheSize();
+  int getImageScalingThreads();
+  GBool getEnableColorLUTs();
+  int getShadingThreads();
+  int getFontFileCacheSize();
+  int getGlyphCacheSize();
+  int getType3CacheSize();
+  int getFormCacheSize();
+  int getPatternCacheSize();
   GBool getEnableFreeType();
   GBool getDisableFreeTypeHinting();
   GBool getAntialias();
@@ -327,6 +339,10 @@ public:
   GBool getDrawAnnotations();
   GBool getDrawFormFields();
   GBool getEnableXFA();
+  int getContentStreamCacheSize();
+  GBool getPrefetchPages();
+  int getRangeStreamBlockSize();
+  int getRangeStreamCacheSize();
   GBool getOverprintPreview() { return overprintPreview; }
   GString *getPaperColor();
   GString *getMatteColor();
@@ -460,7 +476,7 @@ private:
 
   //----- static tables
 
-  NameToCharCode *		// mapping from char name to
+  GStrHash *			// mapping from char name to
     macRomanReverseMap;		//   MacRomanEncoding index
 
   //----- meta settings
@@ -471,8 +487,9 @@ private:
 
   //----- user-modifiable settings
 
-  NameToCharCode *		// mapping from char name to Unicode
-    nameToUnicode;
+  GStrHash *			// mapping from char name to Unicode, from
+    nameToUnicode;		//   nameToUnicode files (overrides the
+				//   built-in table)
   GHash *cidToUnicodes;		// files for mappings from char collections
 				//   to Unicode, indexed by collection name
 				//   [GString]
@@ -495,6 +512,8 @@ private:
   GHash *base14SysFonts;	// Base-14 system font files: font name
 				//   mapped to path [Base14FontInfo]
   SysFontList *sysFonts;	// system fonts
+  GString *sysFontIndexFile;	// on-disk index of system fonts (or
+				//   NULL)
   int psPaperWidth;		// paper size, in PostScript points, for
   int psPaperHeight;		//   PostScript output
   int psImageableLLX,		// imageable area, in PostScript points,
@@ -556,8 +575,30 @@ private:
   GString *initialSelectMode;	// initial selection mode (block or linear)
   int maxTileWidth;		// maximum rasterization tile width
   int maxTileHeight;		// maximum rasterization tile height
-  int tileCacheSize;		// number of rasterization tiles in cache
+  int tileCacheSize;		// max number of rasterization tiles in
+				//   cache (0 = no limit)
+  int tileCacheMemory;		// memory (in MB) for rasterization tiles
+  GBool tileCacheCompression;	// compress inactive tiles
+  int tilePyramidCacheSize;	// memory (in MB) for tiles kept at other
+				//   zoom levels
   int workerThreads;		// number of rasterization worker threads
+  int imageCacheSize;		// memory (in MB) for scaled images
+  int imageScalingThreads;	// max number of threads used to scale
+				//   a large image
+  GBool enableColorLUTs;	// use lookup tables for image color
+				//   conversion
+  int shadingThreads;		// max number of threads used to
+				//   rasterize a shading
+  int fontFileCacheSize;	// memory (in MB) for the process-wide
+				//   font file cache
+  int glyphCacheSize;		// max memory (in KB) for each font's
+				//   glyph bitmap cache
+  int type3CacheSize;		// memory (in MB) for cached Type 3
+				//   glyphs
+  int formCacheSize;		// memory (in MB) for cached form XObject
+				//   rasters (0 = disabled)
+  int patternCacheSize;		// memory (in MB) for cached tiling
+				//   pattern cells (0 = disabled)
   GBool enableFreeType;		// FreeType enable flag
   GBool disableFreeTypeHinting;	// FreeType hinting disable flag
   GBool antialias;		// font anti-aliasing enable flag
@@ -577,6 +618,12 @@ private:
   GBool drawAnnotations;	// draw annotations or not
   GBool drawFormFields;		// draw form fields or not
   GBool enableXFA;		// enable XFA form parsing
+  int contentStreamCacheSize;	// memory (in MB) for compiled content
+				//   streams
+  GBool prefetchPages;		// prefetch each page's objects before
+				//   displaying it
+  int rangeStreamBlockSize;	// block size (in bytes) for RangeStream
+  int rangeStreamCacheSize;	// memory (in MB) for RangeStream blocks
   GBool overprintPreview;	// enable overprint preview
   GString *paperColor;		// paper (page background) color
   GString *matteColor;		// matte (background outside of page) color
@@ -596,6 +643,7 @@ private:
 					//   ToUnicode mapping
   GHash *droppedFonts;		// dropped fonts [int]
   GList *keyBindings;		// key & mouse button bindings [KeyBinding]
+				//   (created on first use)
   GList *popupMenuCmds;		// popup menu commands [PopupMenuCmd]
   GString *tabStateFile;	// path for the tab state save file
   GBool savePageNumbers;	// save page number when file is closed
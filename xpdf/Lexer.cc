@@ -47,7 +47,7 @@ static char specialChars[256] = {
 // Lexer
 //------------------------------------------------------------------------
 
-Lexer::Lexer(XRef *xref, Stream *str) {
+Lexer::Lexer(XRef *xref, Stream *str): lexStr(this) {
   Object obj;
 
   curStr.initStream(str);
@@ -56,9 +56,10 @@ Lexer::Lexer(XRef *xref, Stream *str) {
   strPtr = 0;
   freeArray = gTrue;
   curStr.streamReset();
+  startStream();
 }
 
-Lexer::Lexer(XRef *xref, Object *obj) {
+Lexer::Lexer(XRef *xref, Object *obj): lexStr(this) {
   Object obj2;
 
   if (obj->isStream()) {
@@ -74,6 +75,7 @@ Lexer::Lexer(XRef *xref, Object *obj) {
     streams->get(strPtr, &curStr);
     curStr.streamReset();
   }
+  startStream();
 }
 
 Lexer::~Lexer() {
@@ -86,27 +88,93 @@ Lexer::~Lexer() {
   }
 }
 
-int Lexer::getChar() {
-  int c;
+// Set up the buffer for a new current stream.
+void Lexer::startStream() {
+  curStrIsBase = !curStr.isNone() &&
+		 curStr.getStream()->getBaseStream() == curStr.getStream();
+  blockSize = lexerMinBufSize;
+  clearBuf();
+}
 
-  c = EOF;
-  while (!curStr.isNone() && (c = curStr.streamGetChar()) == EOF) {
-    curStr.streamClose();
-    curStr.free();
-    ++strPtr;
-    if (strPtr < streams->getLength()) {
-      streams->get(strPtr, &curStr);
-      curStr.streamReset();
+// Empty the buffer, i.e., sync the buffer position with the current
+// stream position.
+void Lexer::clearBuf() {
+  bufPtr = bufEnd = buf;
+  bufPos = curStrIsBase ? curStr.streamGetPos() : 0;
+}
+
+// Read the next block from the current stream.  Returns false at the
+// end of the current stream.  The block size starts small (so that
+// parsing a single object from a file doesn't read much more than
+// needed) and grows up to the buffer size.
+GBool Lexer::fillBuf() {
+  int n;
+
+  if (curStr.isNone()) {
+    return gFalse;
+  }
+  if (curStrIsBase) {
+    bufPos = curStr.streamGetPos();
+  }
+  n = curStr.getStream()->getBlock(buf, blockSize);
+  if (blockSize < lexerMaxBufSize) {
+    blockSize *= 2;
+  }
+  bufPtr = buf;
+  bufEnd = buf + n;
+  return n > 0;
+}
+
+// Close the current stream, and move on to the next one (if any).
+void Lexer::nextStream() {
+  curStr.streamClose();
+  curStr.free();
+  ++strPtr;
+  if (strPtr < streams->getLength()) {
+    streams->get(strPtr, &curStr);
+    curStr.streamReset();
+  }
+  startStream();
+}
+
+// Called by getChar() when the buffer is empty.
+int Lexer::getCharSlow() {
+  while (!fillBuf()) {
+    if (curStr.isNone()) {
+      return EOF;
     }
+    nextStream();
   }
-  return c;
+  return *bufPtr++ & 0xff;
 }
 
-int Lexer::lookChar() {
-  if (curStr.isNone()) {
+// Called by lookChar() when the buffer is empty.  Like getChar(),
+// this doesn't move on to the next stream.
+int Lexer::lookCharSlow() {
+  if (!fillBuf()) {
     return EOF;
   }
-  return curStr.streamLookChar();
+  return *bufPtr & 0xff;
+}
+
+GFileOffset Lexer::getPos() {
+  if (curStr.isNone()) {
+    return -1;
+  }
+  // for decoded streams, this is the position in the underlying
+  // (encoded) stream, which is only approximate anyway
+  if (!curStrIsBase) {
+    return curStr.streamGetPos();
+  }
+  return bufPos + (int)(bufPtr - buf);
+}
+
+void Lexer::setPos(GFileOffset pos, int dir) {
+  if (!curStr.isNone()) {
+    curStr.streamSetPos(pos, dir);
+    blockSize = lexerMinBufSize;
+    clearBuf();
+  }
 }
 
 Object *Lexer::getObj(Object *obj) {
@@ -547,9 +615,79 @@ void Lexer::skipToNextLine() {
 }
 
 void Lexer::skipToEOF() {
-  while (getChar() != EOF) ;
+  // discard a block at a time
+  do {
+    bufPtr = bufEnd;
+  } while (getCharSlow() != EOF);
 }
 
 GBool Lexer::isSpace(int c) {
   return c >= 0 && c <= 0xff && specialChars[c] == 1;
 }
+
+//------------------------------------------------------------------------
+// LexerStream
+//------------------------------------------------------------------------
+
+Stream *LexerStream::copy() {
+  return lexer->curStr.getStream()->copy();
+}
+
+StreamKind LexerStream::getKind() {
+  return lexer->curStr.getStream()->getKind();
+}
+
+int LexerStream::getChar() {
+  int c;
+
+  if ((c = lexer->lookChar()) != EOF) {
+    ++lexer->bufPtr;
+  }
+  return c;
+}
+
+int LexerStream::lookChar() {
+  return lexer->lookChar();
+}
+
+int LexerStream::getBlock(char *blk, int size) {
+  int n;
+
+  // use up the buffered data, then read the rest directly from the
+  // current stream
+  n = (int)(lexer->bufEnd - lexer->bufPtr);
+  if (n > size) {
+    n = size;
+  }
+  memcpy(blk, lexer->bufPtr, n);
+  lexer->bufPtr += n;
+  if (n < size && !lexer->curStr.isNone()) {
+    n += lexer->curStr.getStream()->getBlock(blk + n, size - n);
+    lexer->clearBuf();
+  }
+  return n;
+}
+
+GFileOffset LexerStream::getPos() {
+  return lexer->getPos();
+}
+
+void LexerStream::setPos(GFileOffset pos, int dir) {
+  lexer->setPos(pos, dir);
+}
+
+GBool LexerStream::isBinary(GBool last) {
+  return lexer->curStr.getStream()->isBinary(last);
+}
+
+BaseStream *LexerStream::getBaseStream() {
+  return lexer->curStr.getStream()->getBaseStream();
+}
+
+Stream *LexerStream::getUndecodedStream() {
+  return lexer->curStr.getStream()->getUndecodedStream();
+}
+
+Dict *LexerStream::getDict() {
+  return lexer->curStr.getStream()->getDict();
+}
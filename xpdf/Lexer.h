@@ -19,8 +19,42 @@
 #include "Stream.h"
 
 class XRef;
+class Lexer;
 
 #define tokBufSize 128		// size of token buffer
+#define lexerMinBufSize 256	// initial size of input block
+#define lexerMaxBufSize 4096	// size of input buffer
+
+//------------------------------------------------------------------------
+// LexerStream
+//------------------------------------------------------------------------
+
+// The Lexer reads its input in blocks, so the underlying stream is
+// generally positioned ahead of the Lexer.  Lexer::getStream()
+// returns this wrapper, which reads from the Lexer's buffer first,
+// and then from the current underlying stream -- this is used to read
+// inline image data and to scan for 'endstream'.
+class LexerStream: public Stream {
+public:
+
+  LexerStream(Lexer *lexerA) { lexer = lexerA; }
+  virtual Stream *copy();
+  virtual StreamKind getKind();
+  virtual void reset() {}
+  virtual int getChar();
+  virtual int lookChar();
+  virtual int getBlock(char *blk, int size);
+  virtual GFileOffset getPos();
+  virtual void setPos(GFileOffset pos, int dir = 0);
+  virtual GBool isBinary(GBool last = gTrue);
+  virtual BaseStream *getBaseStream();
+  virtual Stream *getUndecodedStream();
+  virtual Dict *getDict();
+
+private:
+
+  Lexer *lexer;
+};
 
 //------------------------------------------------------------------------
 // Lexer
@@ -55,31 +89,47 @@ public:
   // Get stream index (for arrays of streams).
   int getStreamIndex() { return strPtr; }
 
-  // Get stream.
+  // Get stream.  This returns a wrapper around the current stream
+  // (see LexerStream), or NULL if there are no more streams.
   Stream *getStream()
-    { return curStr.isNone() ? (Stream *)NULL : curStr.getStream(); }
+    { return curStr.isNone() ? (Stream *)NULL : &lexStr; }
 
   // Get current position in file.
-  GFileOffset getPos()
-    { return curStr.isNone() ? -1 : curStr.streamGetPos(); }
+  GFileOffset getPos();
 
   // Set position in file.
-  void setPos(GFileOffset pos, int dir = 0)
-    { if (!curStr.isNone()) curStr.streamSetPos(pos, dir); }
+  void setPos(GFileOffset pos, int dir = 0);
 
   // Returns true if <c> is a whitespace character.
   static GBool isSpace(int c);
 
 private:
 
-  int getChar();
-  int lookChar();
+  int getChar()
+    { return bufPtr < bufEnd ? (*bufPtr++ & 0xff) : getCharSlow(); }
+  int lookChar()
+    { return bufPtr < bufEnd ? (*bufPtr & 0xff) : lookCharSlow(); }
+  int getCharSlow();
+  int lookCharSlow();
+  void startStream();
+  void clearBuf();
+  GBool fillBuf();
+  void nextStream();
 
   Array *streams;		// array of input streams
   int strPtr;			// index of current stream
   Object curStr;		// current stream
+  GBool curStrIsBase;		// is the current stream a BaseStream?
   GBool freeArray;		// should lexer free the streams array?
+  char buf[lexerMaxBufSize];	// input buffer
+  char *bufPtr;			// next char in buffer
+  char *bufEnd;			// end of valid data in buffer
+  int blockSize;		// size of the next input block
+  GFileOffset bufPos;		// position of buf[0] in the current stream
   char tokBuf[tokBufSize];	// temporary token buffer
+  LexerStream lexStr;		// wrapper returned by getStream()
+
+  friend class LexerStream;
 };
 
 #endif
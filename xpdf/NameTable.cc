@@ -0,0 +1,236 @@
+//========================================================================
+//
+// NameTable.cc
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#include <aconf.h>
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "NameTable.h"
+
+//------------------------------------------------------------------------
+
+// The table is split into shards, each with its own lock, to reduce
+// contention between threads which are parsing at the same time.
+#define nameTableNShards 16
+
+// Maximum number of interned names in each shard.
+#define nameTableMaxShardNames 4096
+
+// Initial number of buckets in each shard.
+#define nameTableInitShardSize 256
+
+struct NameHeader {
+  NameHeader *next;		// next name in the bucket (interned names
+				//   only)
+  Guint hash;
+  GBool interned;
+  // name chars follow
+};
+
+struct NameTableShard {
+  NameHeader **buckets;
+  int size;			// number of buckets (a power of 2)
+  int n;			// number of names
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+static NameTableShard *nameTable = NULL;
+
+#define nameHeader(name) ((NameHeader *)(name) - 1)
+#define nameChars(hdr) ((char *)((hdr) + 1))
+
+//------------------------------------------------------------------------
+
+static NameHeader *allocName(const char *s, int len, Guint hash,
+			     GBool interned) {
+  NameHeader *hdr;
+
+  hdr = (NameHeader *)gmalloc((int)sizeof(NameHeader) + len + 1);
+  hdr->next = NULL;
+  hdr->hash = hash;
+  hdr->interned = interned;
+  memcpy(nameChars(hdr), s, len + 1);
+  return hdr;
+}
+
+static void expandShard(NameTableShard *shard) {
+  NameHeader **oldBuckets;
+  NameHeader *hdr;
+  int oldSize, i, b;
+
+  oldSize = shard->size;
+  oldBuckets = shard->buckets;
+  shard->size *= 2;
+  shard->buckets = (NameHeader **)gmallocn(shard->size, sizeof(NameHeader *));
+  memset(shard->buckets, 0, shard->size * sizeof(NameHeader *));
+  for (i = 0; i < oldSize; ++i) {
+    while ((hdr = oldBuckets[i])) {
+      oldBuckets[i] = hdr->next;
+      b = (int)((hdr->hash / nameTableNShards) & (shard->size - 1));
+      hdr->next = shard->buckets[b];
+      shard->buckets[b] = hdr;
+    }
+  }
+  gfree(oldBuckets);
+}
+
+void initNameTable() {
+  NameTableShard *shard;
+  int i;
+
+  if (nameTable) {
+    return;
+  }
+  nameTable = (NameTableShard *)gmallocn(nameTableNShards,
+					 sizeof(NameTableShard));
+  for (i = 0; i < nameTableNShards; ++i) {
+    shard = &nameTable[i];
+    shard->size = nameTableInitShardSize;
+    shard->buckets = (NameHeader **)gmallocn(shard->size,
+					     sizeof(NameHeader *));
+    memset(shard->buckets, 0, shard->size * sizeof(NameHeader *));
+    shard->n = 0;
+#if MULTITHREADED
+    gInitMutex(&shard->mutex);
+#endif
+  }
+}
+
+void freeNameTable() {
+  NameTableShard *shard;
+  NameHeader *hdr;
+  int i, j;
+
+  if (!nameTable) {
+    return;
+  }
+  for (i = 0; i < nameTableNShards; ++i) {
+    shard = &nameTable[i];
+    for (j = 0; j < shard->size; ++j) {
+      while ((hdr = shard->buckets[j])) {
+	shard->buckets[j] = hdr->next;
+	gfree(hdr);
+      }
+    }
+    gfree(shard->buckets);
+#if MULTITHREADED
+    gDestroyMutex(&shard->mutex);
+#endif
+  }
+  gfree(nameTable);
+  nameTable = NULL;
+}
+
+char *makeName(const char *s) {
+  NameTableShard *shard;
+  NameHeader *hdr;
+  const char *p;
+  Guint h;
+  int len, b;
+
+  // compute the hash and length in one pass
+  h = 2166136261U;
+  for (p = s; *p; ++p) {
+    h ^= (Guint)(*p & 0xff);
+    h *= 16777619U;
+  }
+  len = (int)(p - s);
+
+  if (nameTable && len <= nameTableMaxLength) {
+    // the low bits of the hash select the shard, and the remaining
+    // bits select the bucket
+    shard = &nameTable[h & (nameTableNShards - 1)];
+#if MULTITHREADED
+    gLockMutex(&shard->mutex);
+#endif
+    b = (int)((h / nameTableNShards) & (shard->size - 1));
+    for (hdr = shard->buckets[b]; hdr; hdr = hdr->next) {
+      if (hdr->hash == h && !strcmp(nameChars(hdr), s)) {
+	break;
+      }
+    }
+    if (!hdr && shard->n < nameTableMaxShardNames) {
+      hdr = allocName(s, len, h, gTrue);
+      hdr->next = shard->buckets[b];
+      shard->buckets[b] = hdr;
+      if (++shard->n > shard->size) {
+	expandShard(shard);
+      }
+    }
+#if MULTITHREADED
+    gUnlockMutex(&shard->mutex);
+#endif
+    if (hdr) {
+      return nameChars(hdr);
+    }
+  }
+
+  return nameChars(allocName(s, len, h, gFalse));
+}
+
+char *copyName(char *name) {
+  NameHeader *hdr;
+
+  hdr = nameHeader(name);
+  if (hdr->interned) {
+    return name;
+  }
+  return nameChars(allocName(name, (int)strlen(name), hdr->hash, gFalse));
+}
+
+void freeName(char *name) {
+  NameHeader *hdr;
+
+  hdr = nameHeader(name);
+  if (!hdr->interned) {
+    gfree(hdr);
+  }
+}
+
+Guint getNameHash(char *name) {
+  return nameHeader(name)->hash;
+}
+
+// FNV-1a hash.
+Guint hashName(const char *s) {
+  const char *p;
+  Guint h;
+
+  h = 2166136261U;
+  for (p = s; *p; ++p) {
+    h ^= (Guint)(*p & 0xff);
+    h *= 16777619U;
+  }
+  return h;
+}
+
+int getNumInternedNames() {
+  int n, i;
+
+  if (!nameTable) {
+    return 0;
+  }
+  n = 0;
+  for (i = 0; i < nameTableNShards; ++i) {
+#if MULTITHREADED
+    gLockMutex(&nameTable[i].mutex);
+#endif
+    n += nameTable[i].n;
+#if MULTITHREADED
+    gUnlockMutex(&nameTable[i].mutex);
+#endif
+  }
+  return n;
+}
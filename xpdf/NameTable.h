@@ -0,0 +1,62 @@
+//========================================================================
+//
+// NameTable.h
+//
+// This file is part of xpdf, and is licensed under the GPL v2 or v3
+// (see README, COPYING, and COPYING3).
+//
+//========================================================================
+
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <aconf.h>
+
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+// name strings
+//------------------------------------------------------------------------
+
+// The strings in name objects and dictionary keys are "name strings":
+// null-terminated C strings preceded by a hidden header which holds
+// the string's hash value.  Names up to nameTableMaxLength bytes are
+// interned in a process-wide table (up to a limit on the total number
+// of interned names), so each distinct name is stored once, and
+// copying or freeing it doesn't allocate or free anything.  Other
+// names are allocated individually.  Name strings must be created
+// with makeName() or copyName() and freed with freeName(); they must
+// not be modified.
+//
+// The table is set up by the GlobalParams constructor and freed by
+// the GlobalParams destructor -- names created when there is no table
+// are simply not interned.  Name objects must not outlive
+// GlobalParams.
+
+// Names longer than this aren't interned.
+#define nameTableMaxLength 127
+
+// Set up and free the name table.
+extern void initNameTable();
+extern void freeNameTable();
+
+// Create a name string from a C string.
+extern char *makeName(const char *s);
+
+// Copy a name string.  Interned names are returned as is.
+extern char *copyName(char *name);
+
+// Free a name string.
+extern void freeName(char *name);
+
+// Return the hash value of a name string.  This is the same value
+// returned by hashName() for the string.
+extern Guint getNameHash(char *name);
+
+// Compute the hash value of a C string.
+extern Guint hashName(const char *s);
+
+// Return the number of interned names.
+extern int getNumInternedNames();
+
+#endif
@@ -6,11 +6,14 @@
 //
 //========================================================================
 
+// This table is sorted by name (in strcmp order), so it can be
+// searched directly, without building a hash table at startup.
 static struct {
   Unicode u;
   const char *name;
 } nameToUnicodeTab[] = {
   {0x0021, "!"},
+  {0x0022, "\""},
   {0x0023, "#"},
   {0x0024, "$"},
   {0x0025, "%"},
@@ -775,7 +778,6 @@ static struct {
   {0xff3a, "Zmonospace"},
   {0xf77a, "Zsmall"},
   {0x01b5, "Zstroke"},
-  {0x0022, "\""},
   {0x005c, "\\"},
   {0x005d, "]"},
   {0x005e, "^"},
@@ -2781,11 +2783,11 @@ static struct {
   {0x0aa3, "nnagujarati"},
   {0x0a23, "nnagurmukhi"},
   {0x0929, "nnnadeva"},
+  {0x00a0, "nobreakspace"},
   {0x306e, "nohiragana"},
   {0x30ce, "nokatakana"},
   {0xff89, "nokatakanahalfwidth"},
   {0x00a0, "nonbreakingspace"},
-  {0x00a0, "nobreakspace"},
   {0x0e13, "nonenthai"},
   {0x0e19, "nonuthai"},
   {0x0646, "noonarabic"},
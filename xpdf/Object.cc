@@ -84,7 +84,7 @@ Object *Object::copy(Object *obj) {
     obj->string = string->copy();
     break;
   case objName:
-    obj->name = copyString(name);
+    obj->name = copyName(name);
     break;
   case objArray:
     array->incRef();
@@ -122,7 +122,7 @@ void Object::free() {
     delete string;
     break;
   case objName:
-    gfree(name);
+    freeName(name);
     break;
   case objArray:
     if (!array->decRef()) {
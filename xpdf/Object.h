@@ -24,6 +24,7 @@
 #if MULTITHREADED
 #include "GMutex.h"
 #endif
+#include "NameTable.h"
 
 class XRef;
 class Array;
@@ -98,7 +99,7 @@ public:
   Object *initString(GString *stringA)
     { initObj(objString); string = stringA; return this; }
   Object *initName(const char *nameA)
-    { initObj(objName); name = copyString(nameA); return this; }
+    { initObj(objName); name = makeName(nameA); return this; }
   Object *initNull()
     { initObj(objNull); return this; }
   Object *initArray(XRef *xref);
@@ -208,7 +209,7 @@ private:
     int intg;			//   integer
     double real;		//   real
     GString *string;		//   string
-    char *name;			//   name
+    char *name;			//   name (see NameTable.h)
     Array *array;		//   array
     Dict *dict;			//   dictionary
     Stream *stream;		//   stream
@@ -13,12 +13,47 @@
 #endif
 
 #include <stddef.h>
+#include "gmem.h"
 #include "gmempp.h"
 #include "Object.h"
 #include "Stream.h"
 #include "GfxState.h"
 #include "OutputDev.h"
 
+//------------------------------------------------------------------------
+// GlyphRun
+//------------------------------------------------------------------------
+
+GlyphRun::GlyphRun() {
+  size = 16;
+  chars = (GlyphRunChar *)gmallocn(size, sizeof(GlyphRunChar));
+  len = 0;
+}
+
+GlyphRun::~GlyphRun() {
+  gfree(chars);
+}
+
+void GlyphRun::append(double x, double y, double dx, double dy,
+		      double originX, double originY,
+		      CharCode code, int nBytes) {
+  GlyphRunChar *ch;
+
+  if (len == size) {
+    size *= 2;
+    chars = (GlyphRunChar *)greallocn(chars, size, sizeof(GlyphRunChar));
+  }
+  ch = &chars[len++];
+  ch->x = x;
+  ch->y = y;
+  ch->dx = dx;
+  ch->dy = dy;
+  ch->originX = originX;
+  ch->originY = originY;
+  ch->code = code;
+  ch->nBytes = nBytes;
+}
+
 //------------------------------------------------------------------------
 // OutputDev
 //------------------------------------------------------------------------
@@ -76,6 +111,17 @@ void OutputDev::updateAll(GfxState *state) {
   updateFont(state);
 }
 
+void OutputDev::drawGlyphRun(GfxState *state, GlyphRun *run) {
+  GlyphRunChar *ch;
+  int i;
+
+  for (i = 0; i < run->getLength(); ++i) {
+    ch = run->getChar(i);
+    drawChar(state, ch->x, ch->y, ch->dx, ch->dy, ch->originX, ch->originY,
+	     ch->code, ch->nBytes, NULL, 0);
+  }
+}
+
 GBool OutputDev::beginType3Char(GfxState *state, double x, double y,
 				double dx, double dy,
 				CharCode code, Unicode *u, int uLen) {
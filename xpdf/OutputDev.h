@@ -32,6 +32,52 @@ class Catalog;
 class Page;
 class Function;
 
+//------------------------------------------------------------------------
+
+// Return values for OutputDev::beginFormCache().
+enum FormCacheStatus {
+  formCacheNone,		// not cached: draw the form normally
+  formCacheHit,			// the form was drawn from the cache
+  formCacheFill			// the form is being rasterized into the cache
+};
+
+//------------------------------------------------------------------------
+// GlyphRun
+//------------------------------------------------------------------------
+
+// One char in a GlyphRun.  The fields have the same meanings as the
+// corresponding drawChar() args.
+struct GlyphRunChar {
+  double x, y;
+  double dx, dy;
+  double originX, originY;
+  CharCode code;
+  int nBytes;
+};
+
+// A run of chars drawn by one string -- the string in a Tj, ', or "
+// op, or one string in a TJ array.  All of the chars share the same
+// GfxState.
+class GlyphRun {
+public:
+
+  GlyphRun();
+  ~GlyphRun();
+
+  void clear() { len = 0; }
+  void append(double x, double y, double dx, double dy,
+	      double originX, double originY, CharCode code, int nBytes);
+
+  int getLength() { return len; }
+  GlyphRunChar *getChar(int i) { return &chars[i]; }
+
+private:
+
+  GlyphRunChar *chars;
+  int len;
+  int size;
+};
+
 //------------------------------------------------------------------------
 // OutputDev
 //------------------------------------------------------------------------
@@ -54,6 +100,15 @@ public:
   // Does this device use drawChar() or drawString()?
   virtual GBool useDrawChar() = 0;
 
+  // Does this device use drawGlyphRun()?  If this returns true (and
+  // useDrawChar() returns true), Gfx calls drawGlyphRun() once per
+  // string, instead of calling drawChar() for each char (after the
+  // text position has been advanced past the string).  Glyph runs
+  // don't include Unicode mappings, so devices which need them
+  // (e.g., for text extraction) should use drawChar().  This is never
+  // used for Type 3 chars that are handled by beginType3Char.
+  virtual GBool useDrawGlyphRun() { return gFalse; }
+
   // Does this device use tilingPatternFill()?  If this returns false,
   // tiling pattern fills will be reduced to a series of other drawing
   // operations.
@@ -177,6 +232,7 @@ public:
 			double originX, double originY,
 			CharCode code, int nBytes, Unicode *u, int uLen) {}
   virtual void drawString(GfxState *state, GString *s) {}
+  virtual void drawGlyphRun(GfxState *state, GlyphRun *run);
   virtual GBool beginType3Char(GfxState *state, double x, double y,
 			       double dx, double dy,
 			       CharCode code, Unicode *u, int uLen);
@@ -225,6 +281,22 @@ public:
   //----- form XObjects
   virtual void drawForm(Ref id) {}
 
+  // Form raster cache.  Gfx calls beginFormCache() before drawing the
+  // contents of a form XObject (which isn't a transparency group),
+  // with the form's CTM and bbox clip already set up.  If this
+  // returns formCacheHit, the output device has drawn the form from
+  // its cache, and Gfx skips the content stream.  If it returns
+  // formCacheFill, the output device is rasterizing the form into its
+  // cache: Gfx draws the content stream, and then calls
+  // endFormCache().  If <abort> is true, the form was not drawn
+  // completely, and must not be cached.  endFormCache() returns false
+  // if the form couldn't be cached, in which case nothing has been
+  // drawn, and Gfx needs to draw the content stream again.
+  virtual FormCacheStatus beginFormCache(GfxState *state, Gfx *gfx, Ref id,
+					 double *bbox)
+    { return formCacheNone; }
+  virtual GBool endFormCache(GfxState *state, GBool abort) { return gTrue; }
+
   //----- PostScript XObjects
   virtual void psXObject(Stream *psStream, Stream *level1Stream) {}
 
@@ -59,6 +59,9 @@ PDFCore::PDFCore(SplashColorMode colorMode, int bitmapRowPad,
   state = new DisplayState(globalParams->getMaxTileWidth(),
 			   globalParams->getMaxTileHeight(),
 			   globalParams->getTileCacheSize(),
+			   globalParams->getTileCacheMemory(),
+			   globalParams->getTileCacheCompression(),
+			   globalParams->getTilePyramidCacheSize(),
 			   globalParams->getWorkerThreads(),
 			   colorMode, bitmapRowPad);
   tileMap = new TileMap(state);
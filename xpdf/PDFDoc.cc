@@ -40,6 +40,7 @@
 #include "Outline.h"
 #endif
 #include "OptionalContent.h"
+#include "ContentStreamCache.h"
 #include "PDFDoc.h"
 
 //------------------------------------------------------------------------
@@ -47,6 +48,11 @@
 #define headerSearchSize 1024	// read this many bytes at beginning of
 				//   file to look for '%PDF'
 
+// In streaming mode, keep this many Page objects, and this many
+// decoded object streams.
+#define pdfDocStreamingPageCacheSize    4
+#define pdfDocStreamingObjStrCacheSize 16
+
 // Avoid sharing files with child processes on Windows, where sharing
 // can cause problems.
 #ifdef _WIN32
@@ -246,8 +252,30 @@ PDFDoc::PDFDoc(BaseStream *strA, GString *ownerPassword,
   ok = setup(ownerPassword, userPassword);
 }
 
+PDFDoc::PDFDoc(ByteRangeProvider *providerA, GString *ownerPassword,
+	       GString *userPassword, PDFCore *coreA) {
+  Object obj;
+  int cacheSize;
+
+  init(coreA);
+
+  fileName = NULL;
+#ifdef _WIN32
+  fileNameU = NULL;
+#endif
+
+  // create stream
+  obj.initNull();
+  cacheSize = globalParams->getRangeStreamCacheSize();
+  str = new RangeStream(providerA, globalParams->getRangeStreamBlockSize(),
+			cacheSize > 0 ? (size_t)cacheSize << 20 : 0, &obj);
+
+  ok = setup(ownerPassword, userPassword);
+}
+
 void PDFDoc::init(PDFCore *coreA) {
   ok = gFalse;
+  streaming = gFalse;
   errCode = errNone;
   core = coreA;
   file = NULL;
@@ -258,6 +286,12 @@ void PDFDoc::init(PDFCore *coreA) {
   outline = NULL;
 #endif
   optContent = NULL;
+  if (globalParams->getContentStreamCacheSize() > 0) {
+    contentStreamCache = new ContentStreamCache(
+		 (size_t)globalParams->getContentStreamCacheSize() << 20);
+  } else {
+    contentStreamCache = NULL;
+  }
 }
 
 GBool PDFDoc::setup(GString *ownerPassword, GString *userPassword) {
@@ -330,6 +364,9 @@ GBool PDFDoc::setup2(GString *ownerPassword, GString *userPassword,
 }
 
 PDFDoc::~PDFDoc() {
+  if (contentStreamCache) {
+    delete contentStreamCache;
+  }
   if (optContent) {
     delete optContent;
   }
@@ -442,6 +479,20 @@ void PDFDoc::displayPage(OutputDev *out, int page,
   catalog->getPage(page)->display(out, hDPI, vDPI,
 				  rotate, useMediaBox, crop, printing,
 				  abortCheckCbk, abortCheckCbkData);
+  if (streaming) {
+    catalog->doneWithPage(page);
+  }
+}
+
+void PDFDoc::setStreamingMode(GBool streamingA) {
+  streaming = streamingA;
+  if (xref) {
+    xref->setObjStrCacheSize(streaming ? pdfDocStreamingObjStrCacheSize
+			               : objStrCacheSize);
+  }
+  if (catalog) {
+    catalog->setPageCacheSize(streaming ? pdfDocStreamingPageCacheSize : 0);
+  }
 }
 
 void PDFDoc::displayPages(OutputDev *out, int firstPage, int lastPage,
@@ -22,6 +22,7 @@
 
 class GString;
 class BaseStream;
+class ByteRangeProvider;
 class OutputDev;
 class Links;
 class LinkAction;
@@ -30,6 +31,7 @@ class Outline;
 class OutlineItem;
 class OptionalContent;
 class PDFCore;
+class ContentStreamCache;
 
 //------------------------------------------------------------------------
 // PDFDoc
@@ -54,6 +56,12 @@ public:
   PDFDoc(BaseStream *strA, GString *ownerPassword = NULL,
 	 GString *userPassword = NULL, PDFCore *coreA = NULL);
 
+  // Read the PDF file from <providerA>, via a RangeStream (using the
+  // rangeStreamBlockSize and rangeStreamCacheSize settings).  Takes
+  // ownership of <providerA>.
+  PDFDoc(ByteRangeProvider *providerA, GString *ownerPassword = NULL,
+	 GString *userPassword = NULL, PDFCore *coreA = NULL);
+
   ~PDFDoc();
 
   // Was PDF document successfully opened?
@@ -99,6 +107,16 @@ public:
   // Return the structure tree root object.
   Object *getStructTreeRoot() { return catalog->getStructTreeRoot(); }
 
+  // Streaming mode is for applications (like the command line tools)
+  // which process the pages in order, once each.  It keeps memory
+  // use bounded on very large documents: displayPage() deletes each
+  // Page object after drawing it, at most a few Page objects are kept
+  // in memory (so a Page pointer is only valid until the next
+  // getPage() call -- see Catalog::setPageCacheSize), and the object
+  // stream cache is smaller.
+  void setStreamingMode(GBool streamingA);
+  GBool getStreamingMode() { return streaming; }
+
   // Display a page.
   void displayPage(OutputDev *out, int page,
 		   double hDPI, double vDPI, int rotate,
@@ -149,6 +167,10 @@ public:
   // Return the OptionalContent object.
   OptionalContent *getOptionalContent() { return optContent; }
 
+  // Return the compiled content stream cache, or NULL if it's
+  // disabled.
+  ContentStreamCache *getContentStreamCache() { return contentStreamCache; }
+
   // Is the file encrypted?
   GBool isEncrypted() { return xref->isEncrypted(); }
 
@@ -220,6 +242,8 @@ private:
   Outline *outline;
 #endif
   OptionalContent *optContent;
+  ContentStreamCache *contentStreamCache;
+  GBool streaming;		// true in streaming mode
 
   GBool ok;
   int errCode;
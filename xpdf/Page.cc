@@ -13,6 +13,8 @@
 #endif
 
 #include <stddef.h>
+#include <string.h>
+#include "gmem.h"
 #include "gmempp.h"
 #include "Trace.h"
 #include "GlobalParams.h"
@@ -323,6 +325,7 @@ Page::Page(PDFDoc *docA, int numA, Dict *pageDict, PageAttrs *attrsA) {
     }
   }
 
+  prefetchCount = 0;
   return;
 
  err2:
@@ -330,6 +333,7 @@ Page::Page(PDFDoc *docA, int numA, Dict *pageDict, PageAttrs *attrsA) {
  err1:
   contents.initNull();
   thumbnail.initNull();
+  prefetchCount = 0;
   ok = gFalse;
 }
 
@@ -341,6 +345,7 @@ Page::Page(PDFDoc *docA, int numA) {
   annots.initNull();
   contents.initNull();
   thumbnail.initNull();
+  prefetchCount = 0;
   ok = gTrue;
 }
 
@@ -391,6 +396,18 @@ void Page::displaySlice(OutputDev *out, double hDPI, double vDPI,
     return;
   }
 
+  // prefetch the page's objects (only on the first call, since a
+  // page may be displayed in many slices)
+  if (globalParams->getPrefetchPages()) {
+#if MULTITHREADED
+    if (gAtomicIncrement(&prefetchCount) == 1) {
+#else
+    if (++prefetchCount == 1) {
+#endif
+      prefetch();
+    }
+  }
+
   traceBegin(this, "begin page");
 
   rotate += getRotate();
@@ -458,6 +475,112 @@ void Page::displaySlice(OutputDev *out, double hDPI, double vDPI,
   traceEnd(this, "end page");
 }
 
+//------------------------------------------------------------------------
+// page prefetch
+//------------------------------------------------------------------------
+
+// Limits on the number of objects prefetched for one page, and on the
+// nesting of direct arrays/dictionaries.
+#define pagePrefetchMaxObjects 4096
+#define pagePrefetchMaxDepth   32
+
+struct PagePrefetchState {
+  char *visited;		// flag for each object number
+  int nObjects;			// size of visited
+  Ref *refs;			// refs to prefetch
+  int nRefs;
+  int refsSize;
+};
+
+static void prefetchScanDict(PagePrefetchState *st, Dict *dict, int depth);
+
+// Queue any refs in <obj> which haven't been seen yet.
+static void prefetchScan(PagePrefetchState *st, Object *obj, int depth) {
+  Object obj2;
+  int num, i;
+
+  if (depth > pagePrefetchMaxDepth) {
+    return;
+  }
+  if (obj->isRef()) {
+    num = obj->getRefNum();
+    if (num < 0 || num >= st->nObjects || st->visited[num] ||
+	st->nRefs >= pagePrefetchMaxObjects) {
+      return;
+    }
+    st->visited[num] = 1;
+    if (st->nRefs == st->refsSize) {
+      st->refsSize = st->refsSize ? 2 * st->refsSize : 64;
+      st->refs = (Ref *)greallocn(st->refs, st->refsSize, sizeof(Ref));
+    }
+    st->refs[st->nRefs++] = obj->getRef();
+  } else if (obj->isArray()) {
+    for (i = 0; i < obj->arrayGetLength(); ++i) {
+      prefetchScan(st, obj->arrayGetNF(i, &obj2), depth + 1);
+      obj2.free();
+    }
+  } else if (obj->isDict()) {
+    prefetchScanDict(st, obj->getDict(), depth + 1);
+  } else if (obj->isStream()) {
+    prefetchScanDict(st, obj->streamGetDict(), depth + 1);
+  }
+}
+
+static void prefetchScanDict(PagePrefetchState *st, Dict *dict, int depth) {
+  Object obj;
+  char *key;
+  int i;
+
+  // don't wander off into the rest of the page tree
+  if (dict->is("Page") || dict->is("Pages")) {
+    return;
+  }
+  for (i = 0; i < dict->getLength(); ++i) {
+    // skip back-pointers, link/action targets, and other things which
+    // aren't needed to display the page
+    key = dict->getKey(i);
+    if (!strcmp(key, "Parent") || !strcmp(key, "P") ||
+	!strcmp(key, "Dest") || !strcmp(key, "A") || !strcmp(key, "AA") ||
+	!strcmp(key, "Metadata") || !strcmp(key, "PieceInfo") ||
+	!strcmp(key, "Thumb")) {
+      continue;
+    }
+    prefetchScan(st, dict->getValNF(i, &obj), depth);
+    obj.free();
+  }
+}
+
+void Page::prefetch() {
+  PagePrefetchState st;
+  Dict *resDict;
+
+  st.nObjects = xref->getNumObjects();
+  if (st.nObjects <= 0) {
+    return;
+  }
+  st.visited = (char *)gmalloc(st.nObjects);
+  memset(st.visited, 0, st.nObjects);
+  st.refs = NULL;
+  st.nRefs = st.refsSize = 0;
+
+  prefetchScan(&st, &contents, 0);
+  if ((resDict = getResourceDict())) {
+    prefetchScanDict(&st, resDict, 0);
+  }
+  if (globalParams->getDrawAnnotations()) {
+    prefetchScan(&st, &annots, 0);
+  }
+
+  // nothing is fetched here -- the objects are read (and parsed)
+  // only once, by Gfx, while the readahead for the rest proceeds
+  if (st.nRefs > 0) {
+    xref->prefetch(st.refs, st.nRefs);
+  }
+
+  gfree(st.refs);
+  gfree(st.visited);
+}
+
 void Page::makeBox(double hDPI, double vDPI, int rotate,
 		   GBool useMediaBox, GBool upsideDown,
 		   double sliceX, double sliceY, double sliceW, double sliceH,
@@ -16,6 +16,9 @@
 #endif
 
 #include "Object.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
 
 class Dict;
 class PDFDoc;
@@ -188,6 +191,14 @@ public:
 
   void processLinks(OutputDev *out);
 
+  // Prefetch the objects referenced by the page's contents,
+  // resources, and annotations (including refs inside their direct
+  // arrays and dictionaries), by passing them to XRef::prefetch().
+  // This doesn't fetch any objects, so objects which are only
+  // referenced from other indirect objects (e.g., a font's embedded
+  // font file) aren't prefetched.
+  void prefetch();
+
   // Get the page's default CTM.
   void getDefaultCTM(double *ctm, double hDPI, double vDPI,
 		     int rotate, GBool useMediaBox, GBool upsideDown);
@@ -202,6 +213,11 @@ private:
   Object contents;		// page contents
   Object thumbnail;		// reference to thumbnail image
   GBool ok;			// true if page is valid
+#if MULTITHREADED
+  GAtomicCounter prefetchCount;	// used to prefetch only once
+#else
+  int prefetchCount;		// used to prefetch only once
+#endif
 };
 
 #endif
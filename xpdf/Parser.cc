@@ -84,15 +84,15 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
 	      "Dictionary key must be a name object");
 	shift();
       } else {
-	key = copyString(buf1.getName());
+	key = copyName(buf1.getName());
 	shift();
 	if (buf1.isEOF() || buf1.isError()) {
-	  gfree(key);
+	  freeName(key);
 	  break;
 	}
-	obj->dictAdd(key, getObj(&obj2, gFalse,
-				 fileKey, encAlgorithm, keyLength,
-				 objNum, objGen, recursion + 1));
+	obj->getDict()->addName(key, getObj(&obj2, gFalse,
+					    fileKey, encAlgorithm, keyLength,
+					    objNum, objGen, recursion + 1));
       }
     }
     if (buf1.isEOF())
@@ -140,9 +140,11 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
     obj->initString(s2);
     shift();
 
-  // simple object
+  // simple object -- move it out of the buffer (rather than copying
+  // it), so that names, strings, and commands aren't copied again
   } else {
-    buf1.copy(obj);
+    *obj = buf1;
+    buf1.initNull();
     shift();
   }
 
@@ -12,8 +12,12 @@
 #pragma implementation
 #endif
 
+#include <stdlib.h>
 #include <math.h>
+#include "gmem.h"
+#include "GThread.h"
 #include "Trace.h"
+#include "GlobalParams.h"
 #include "GfxState.h"
 #include "SplashBitmap.h"
 #include "SplashPattern.h"
@@ -28,6 +32,629 @@
 // fill.
 #define patchColorDelta (dblToCol(1 / 256.0))
 
+// Max error allowed (in color space units) when the color functions
+// of an axial or radial shading are approximated with a lookup
+// table.
+#define shadingLUTTolerance (0.5 / 255)
+
+// Min size of the lookup table used to approximate the color
+// functions of an axial or radial shading (smaller color ramps are
+// computed exactly).
+#define shadingLUTMinSize 33
+
+// Min number of pixels in a function, axial, or radial shading
+// bitmap for multithreaded rendering.
+#define shadingMinThreadedPixels (256 * 256)
+
+// Min number of patches in a patch mesh shading for multithreaded
+// patch subdivision.
+#define shadingMinThreadedPatches 16
+
+// Number of patches subdivided by each thread in one pass of a
+// multithreaded patch mesh fill.
+#define shadingPatchesPerJob 16
+
+// Number of entries in the color ramp used for parameterized
+// Gouraud triangle shadings.
+#define gouraudRampSize 1024
+
+// Maximum error allowed in the Gouraud color ramp (in 0..255 units).
+#define gouraudRampMaxError 1
+
+//------------------------------------------------------------------------
+
+// State shared by the threads rendering a function, axial, or radial
+// shading -- each thread fills a band of rows.
+struct ShadingRowJob {
+  void (*fillRows)(ShadingRowJob *job, int jobIdx, int yA, int yB);
+  int yStart, yEnd;		// rows to fill
+  int xStart, xEnd;		// columns to fill
+  int nJobs;
+  SplashBitmap *bitmap;
+  SplashColorMode mode;
+  GBool reverseVideo;
+  int xMin, yMin;		// bitmap origin, in device space
+  double mat[6];		// device space -> shading space transform
+
+  // function shadings
+  GfxFunctionShading **shadings; // per-thread copies of the shading
+  GfxColorSpace **colorSpaces;	// per-thread copies of the color space
+  GfxRenderingIntent ri;
+
+  // function, axial, and radial shadings
+  double x0, y0, x1, y1;
+
+  // axial and radial shadings
+  SplashColorPtr sColors;	// color ramp
+  int nColors;
+  GBool ext0, ext1;
+  double dx, dy;
+
+  // axial shadings
+  double d;
+
+  // radial shadings
+  double r0, r1, r0dr, r02, a, a2;
+  GBool aIsZero;
+};
+
+static void initShadingRowJob(ShadingRowJob *job,
+			      void (*fillRows)(ShadingRowJob *job, int jobIdx,
+					       int yA, int yB),
+			      SplashBitmap *bitmap, SplashColorMode mode,
+			      GBool reverseVideo, int xMin, int yMin,
+			      double *mat) {
+  job->fillRows = fillRows;
+  job->yStart = 0;
+  job->yEnd = bitmap->getHeight();
+  job->xStart = 0;
+  job->xEnd = bitmap->getWidth();
+  job->nJobs = 1;
+  job->bitmap = bitmap;
+  job->mode = mode;
+  job->reverseVideo = reverseVideo;
+  job->xMin = xMin;
+  job->yMin = yMin;
+  for (int i = 0; i < 6; ++i) {
+    job->mat[i] = mat[i];
+  }
+}
+
+static void shadingRowJobFunc(void *data, int jobIdx) {
+  ShadingRowJob *job = (ShadingRowJob *)data;
+  int n = job->yEnd - job->yStart;
+  (*job->fillRows)(job, jobIdx,
+		   job->yStart + (n * jobIdx) / job->nJobs,
+		   job->yStart + (n * (jobIdx + 1)) / job->nJobs);
+}
+
+// Returns the number of threads to use for a [width] x [height]
+// shading bitmap.
+static int getShadingThreads(int width, int height) {
+  if ((double)width * height < shadingMinThreadedPixels) {
+    return 1;
+  }
+  int nThreads = globalParams->getShadingThreads();
+  if (nThreads > height) {
+    nThreads = height;
+  }
+  if (nThreads < 1) {
+    nThreads = 1;
+  }
+  return nThreads;
+}
+
+// Fill the rows of a shading bitmap, using [nThreads] threads.
+static void runShadingRowJob(ShadingRowJob *job, int nThreads) {
+  job->nJobs = nThreads;
+  if (nThreads > 1) {
+    gRunParallel(&shadingRowJobFunc, job, nThreads);
+  } else {
+    (*job->fillRows)(job, 0, job->yStart, job->yEnd);
+  }
+}
+
+// Convert a color in [colorSpace] to a Splash color.
+static void convertShadingColor(GfxColorSpace *colorSpace,
+				GfxRenderingIntent ri,
+				SplashColorMode mode, GBool reverseVideo,
+				GfxColor *color, SplashColorPtr sColor) {
+  GfxGray gray;
+  GfxRGB rgb;
+#if SPLASH_CMYK
+  GfxCMYK cmyk;
+#endif
+
+  switch (mode) {
+  case splashModeMono8:
+    colorSpace->getGray(color, &gray, ri);
+    if (reverseVideo) {
+      gray = gfxColorComp1 - gray;
+    }
+    sColor[0] = colToByte(gray);
+    break;
+  case splashModeRGB8:
+    colorSpace->getRGB(color, &rgb, ri);
+    if (reverseVideo) {
+      rgb.r = gfxColorComp1 - rgb.r;
+      rgb.g = gfxColorComp1 - rgb.g;
+      rgb.b = gfxColorComp1 - rgb.b;
+    }
+    sColor[0] = colToByte(rgb.r);
+    sColor[1] = colToByte(rgb.g);
+    sColor[2] = colToByte(rgb.b);
+    break;
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    colorSpace->getCMYK(color, &cmyk, ri);
+    sColor[0] = colToByte(cmyk.c);
+    sColor[1] = colToByte(cmyk.m);
+    sColor[2] = colToByte(cmyk.y);
+    sColor[3] = colToByte(cmyk.k);
+    break;
+#endif
+  case splashModeMono1:
+  case splashModeBGR8:
+    // mode cannot be Mono1 or BGR8
+    break;
+  }
+}
+
+static void fillFunctionShadingRows(ShadingRowJob *job, int jobIdx,
+				    int yA, int yB) {
+  GfxFunctionShading *shading = job->shadings[jobIdx];
+  GfxColorSpace *colorSpace = job->colorSpaces[jobIdx];
+  SplashBitmap *bitmap = job->bitmap;
+  int nComps = splashColorModeNComps[job->mode];
+  double *iMat = job->mat;
+
+  for (int y = yA; y < yB; ++y) {
+    SplashColorPtr dataPtr = bitmap->getDataPtr() + y * bitmap->getRowSize();
+    Guchar *alphaPtr = bitmap->getAlphaPtr() + y * bitmap->getAlphaRowSize();
+    for (int x = 0; x < bitmap->getWidth(); ++x) {
+
+      // convert coords to the pattern domain
+      double tx = job->xMin + x + 0.5;
+      double ty = job->yMin + y + 0.5;
+      double xx = tx * iMat[0] + ty * iMat[2] + iMat[4];
+      double yy = tx * iMat[1] + ty * iMat[3] + iMat[5];
+
+      // get the color
+      if (xx >= job->x0 && xx <= job->x1 && yy >= job->y0 && yy <= job->y1) {
+	GfxColor color;
+	shading->getColor(xx, yy, &color);
+	SplashColor sColor;
+	convertShadingColor(colorSpace, job->ri, job->mode, job->reverseVideo,
+			    &color, sColor);
+	for (int i = 0; i < nComps; ++i) {
+	  *dataPtr++ = sColor[i];
+	}
+	*alphaPtr++ = 0xff;
+      } else {
+	dataPtr += nComps;
+	*alphaPtr++ = 0;
+      }
+    }
+  }
+}
+
+static void fillAxialShadingRows(ShadingRowJob *job, int jobIdx,
+				 int yA, int yB) {
+  SplashBitmap *bitmap = job->bitmap;
+  int nComps = splashColorModeNComps[job->mode];
+  double *ictm = job->mat;
+  SplashColorPtr sColors = job->sColors;
+  int nColors = job->nColors;
+  SplashColorPtr sColor;
+
+  for (int y = yA; y < yB; ++y) {
+    SplashColorPtr dataPtr = bitmap->getDataPtr() + y * bitmap->getRowSize();
+    Guchar *alphaPtr = bitmap->getAlphaPtr() + y * bitmap->getAlphaRowSize();
+    for (int x = 0; x < bitmap->getWidth(); ++x) {
+
+      // convert coords to user space
+      double tx = job->xMin + x + 0.5;
+      double ty = job->yMin + y + 0.5;
+      double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
+      double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
+
+      // compute the position along the axis
+      double s = ((xx - job->x0) * job->dx + (yy - job->y0) * job->dy)
+	         * job->d;
+      GBool go = gFalse;
+      if (s < 0) {
+	go = job->ext0;
+      } else if (s > 1) {
+	go = job->ext1;
+      } else {
+	go = gTrue;
+      }
+      if (go) {
+	if (s <= 0) {
+	  sColor = sColors;
+	} else if (s >= 1) {
+	  sColor = sColors + (nColors - 1) * nComps;
+	} else {
+	  int i = (int)((nColors - 1) * s + 0.5);
+	  sColor = sColors + i * nComps;
+	}
+	for (int i = 0; i < nComps; ++i) {
+	  *dataPtr++ = sColor[i];
+	}
+	*alphaPtr++ = 0xff;
+      } else {
+	dataPtr += nComps;
+	*alphaPtr++ = 0;
+      }
+    }
+  }
+}
+
+static void fillRadialShadingRows(ShadingRowJob *job, int jobIdx,
+				  int yA, int yB) {
+  SplashBitmap *bitmap = job->bitmap;
+  int nComps = splashColorModeNComps[job->mode];
+  double *ictm = job->mat;
+  SplashColorPtr sColors = job->sColors;
+  int nColors = job->nColors;
+  double x0 = job->x0;
+  double y0 = job->y0;
+  double r0 = job->r0;
+  double r1 = job->r1;
+  double dx = job->dx;
+  double dy = job->dy;
+  double a = job->a;
+  double a2 = job->a2;
+  GBool ext0 = job->ext0;
+  GBool ext1 = job->ext1;
+  SplashColorPtr sColor;
+
+  for (int y = yA; y < yB; ++y) {
+    SplashColorPtr dataPtr = bitmap->getDataPtr()
+                             + y * bitmap->getRowSize() + job->xStart * nComps;
+    Guchar *alphaPtr = bitmap->getAlphaPtr()
+                       + y * bitmap->getAlphaRowSize() + job->xStart;
+    for (int x = job->xStart; x < job->xEnd; ++x) {
+
+      // convert coords to user space
+      double tx = job->xMin + x + 0.5;
+      double ty = job->yMin + y + 0.5;
+      double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
+      double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
+
+      // compute the radius of the circle at x,y
+      double b = 2 * ((xx - x0) * dx + (yy - y0) * dy + job->r0dr);
+      double c = (xx - x0) * (xx - x0) + (yy - y0) * (yy - y0) - job->r02;
+      double s = 0;
+      GBool go = gFalse;
+      if (job->aIsZero) {
+	if (fabs(b) < 0.000001) {
+	  if (c <= 0) {
+	    if (ext0) {
+	      s = 0;
+	      go = gTrue;
+	    }
+	  } else {
+	    if (ext1) {
+	      s = 1;
+	      go = gTrue;
+	    }
+	  }
+	} else {
+	  double s0 = c / b;
+	  double rs0 = r0 + s0 * (r1 - r0);
+	  if ((s0 >= 0 || ext0) && (s0 <= 1 || ext1) && rs0 >= 0) { 
+	    s = s0;
+	    go = gTrue;
+	  }
+	}
+      } else {
+	double e = b*b - 4*a*c;
+	if (e >= 0) {
+	  double es = sqrt(e);
+	  double s0 = (b + es) * a2;
+	  double s1 = (b - es) * a2;
+	  double rs0 = r0 + s0 * (r1 - r0);
+	  double rs1 = r0 + s1 * (r1 - r0);
+	  if (s0 > s1) {
+	    if ((s0 >= 0 || ext0) && (s0 <= 1 || ext1) && rs0 >= 0) {
+	      s = s0;
+	      go = gTrue;
+	    } else if ((s1 >= 0 || ext0) && (s1 <= 1 || ext1) && rs1 >= 0) {
+	      s = s1;
+	      go = gTrue;
+	    }
+	  } else {
+	    if ((s1 >= 0 || ext0) && (s1 <= 1 || ext1) && rs1 >= 0) {
+	      s = s1;
+	      go = gTrue;
+	    } else if ((s0 >= 0 || ext0) && (s0 <= 1 || ext1) && rs0 >= 0) {
+	      s = s0;
+	      go = gTrue;
+	    }
+	  }
+	}
+      }
+      if (!go) {
+	dataPtr += nComps;
+	*alphaPtr++ = 0x00;
+	continue;
+      }
+      if (s <= 0) {
+	sColor = sColors;
+      } else if (s >= 1) {
+	sColor = sColors + (nColors - 1) * nComps;
+      } else {
+	int i = (int)((nColors - 1) * s + 0.5);
+	sColor = sColors + i * nComps;
+      }
+      for (int i = 0; i < nComps; ++i) {
+	*dataPtr++ = sColor[i];
+      }
+      *alphaPtr++ = 0xff;
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+// A patch mesh subdivision leaf: a patch which is small enough (or
+// has little enough color variation) to be filled with a single
+// color.
+struct ShadingPatchLeaf {
+  double x[12], y[12];		// outline, in bitmap coords
+  GfxColor color;
+};
+
+// State shared by the threads subdividing the patches of a patch mesh
+// shading -- each thread subdivides a range of patches, and the
+// resulting leaves are filled (in order) by the calling thread.
+struct ShadingPatchJob {
+  GfxState *state;
+  GfxPatchMeshShading *shading;
+  int xMin, yMin;		// bitmap origin, in device space
+  int depth;			// initial subdivision depth
+  int firstPatch, nPatches;	// patches in the current pass
+  int nJobs;
+  Function ***funcs;		// per-thread copies of the functions
+  ShadingPatchLeaf **leaves;	// per-thread subdivision leaves
+  int *nLeaves;
+  int *leavesSize;
+};
+
+// Same as GfxPatchMeshShading::getColor, but uses the functions in
+// [funcs], which may be a per-thread copy of the shading's functions.
+static void getPatchColor(GfxPatchMeshShading *shading, Function **funcs,
+			  double *in, GfxColor *out) {
+  if (shading->getNFuncs() > 0) {
+    double c[gfxColorMaxComps];
+    for (int i = 0; i < shading->getNFuncs(); ++i) {
+      funcs[i]->transform(in, &c[i]);
+    }
+    for (int i = 0; i < shading->getColorSpace()->getNComps(); ++i) {
+      out->c[i] = dblToCol(c[i]);
+    }
+  } else {
+    for (int i = 0; i < shading->getNComps(); ++i) {
+      out->c[i] = dblToCol(in[i]);
+    }
+  }
+}
+
+// Get the color at the first corner of a patch, and check whether
+// the patch should be filled (true) or subdivided further (false).
+static GBool isPatchLeaf(GfxState *state, GfxPatchMeshShading *shading,
+			 Function **funcs, GfxPatch *patch, int depth,
+			 GfxColor *c00) {
+  getPatchColor(shading, funcs, patch->color[0][0], c00);
+
+  // stop subdivision at max depth
+  if (depth == patchMaxDepth) {
+    return gTrue;
+  }
+
+  // stop subdivision if colors are close enough
+  int nComps = shading->getColorSpace()->getNComps();
+  GfxColor c01, c10, c11;
+  getPatchColor(shading, funcs, patch->color[0][1], &c01);
+  getPatchColor(shading, funcs, patch->color[1][0], &c10);
+  getPatchColor(shading, funcs, patch->color[1][1], &c11);
+  int k;
+  for (k = 0; k < nComps; ++k) {
+    if (abs(c00->c[k] - c01.c[k]) > patchColorDelta ||
+	abs(c01.c[k] - c11.c[k]) > patchColorDelta ||
+	abs(c11.c[k] - c10.c[k]) > patchColorDelta ||
+	abs(c10.c[k] - c00->c[k]) > patchColorDelta) {
+      break;
+    }
+  }
+  if (k == nComps) {
+    return gTrue;
+  }
+
+  // stop subdivision if patch is small enough
+  double xxMin = 0;
+  double yyMin = 0;
+  double xxMax = 0;
+  double yyMax = 0;
+  for (int j = 0; j < 4; ++j) {
+    for (int i = 0; i < 4; ++i) {
+      double xx, yy;
+      state->transformDelta(patch->x[i][j], patch->y[i][j], &xx, &yy);
+      if (i == 0 && j == 0) {
+	xxMin = xxMax = xx;
+	yyMin = yyMax = yy;
+      } else {
+	if (xx < xxMin) {
+	  xxMin = xx;
+	} else if (xx > xxMax) {
+	  xxMax = xx;
+	}
+	if (yy < yyMin) {
+	  yyMin = yy;
+	} else if (yy > yyMax) {
+	  yyMax = yy;
+	}
+      }
+    }
+  }
+  return xxMax - xxMin < 1 && yyMax - yyMin < 1;
+}
+
+// Compute the outline of a patch, in bitmap coords.
+static void getPatchOutline(GfxState *state, GfxPatch *patch,
+			    int xMin, int yMin, double *xs, double *ys) {
+  static int idx[12][2] = {
+    {0, 0}, {0, 1}, {0, 2}, {0, 3}, {1, 3}, {2, 3},
+    {3, 3}, {3, 2}, {3, 1}, {3, 0}, {2, 0}, {1, 0}
+  };
+  for (int k = 0; k < 12; ++k) {
+    double xx, yy;
+    state->transform(patch->x[idx[k][0]][idx[k][1]],
+		     patch->y[idx[k][0]][idx[k][1]], &xx, &yy);
+    xs[k] = xx - xMin;
+    ys[k] = yy - yMin;
+  }
+}
+
+static SplashPath *makePatchPath(double *xs, double *ys) {
+  SplashPath *path = new SplashPath();
+  path->moveTo(xs[0], ys[0]);
+  path->curveTo(xs[1], ys[1], xs[2], ys[2], xs[3], ys[3]);
+  path->curveTo(xs[4], ys[4], xs[5], ys[5], xs[6], ys[6]);
+  path->curveTo(xs[7], ys[7], xs[8], ys[8], xs[9], ys[9]);
+  path->curveTo(xs[10], ys[10], xs[11], ys[11], xs[0], ys[0]);
+  path->close();
+  return path;
+}
+
+// Split a patch into four sub-patches.
+static void splitPatch(GfxPatch *patch, int nComps,
+		       GfxPatch *patch00, GfxPatch *patch01,
+		       GfxPatch *patch10, GfxPatch *patch11) {
+  double xx[4][8], yy[4][8];
+  for (int i = 0; i < 4; ++i) {
+    xx[i][0] = patch->x[i][0];
+    yy[i][0] = patch->y[i][0];
+    xx[i][1] = 0.5 * (patch->x[i][0] + patch->x[i][1]);
+    yy[i][1] = 0.5 * (patch->y[i][0] + patch->y[i][1]);
+    double xxm = 0.5 * (patch->x[i][1] + patch->x[i][2]);
+    double yym = 0.5 * (patch->y[i][1] + patch->y[i][2]);
+    xx[i][6] = 0.5 * (patch->x[i][2] + patch->x[i][3]);
+    yy[i][6] = 0.5 * (patch->y[i][2] + patch->y[i][3]);
+    xx[i][2] = 0.5 * (xx[i][1] + xxm);
+    yy[i][2] = 0.5 * (yy[i][1] + yym);
+    xx[i][5] = 0.5 * (xxm + xx[i][6]);
+    yy[i][5] = 0.5 * (yym + yy[i][6]);
+    xx[i][3] = xx[i][4] = 0.5 * (xx[i][2] + xx[i][5]);
+    yy[i][3] = yy[i][4] = 0.5 * (yy[i][2] + yy[i][5]);
+    xx[i][7] = patch->x[i][3];
+    yy[i][7] = patch->y[i][3];
+  }
+  for (int i = 0; i < 4; ++i) {
+    patch00->x[0][i] = xx[0][i];
+    patch00->y[0][i] = yy[0][i];
+    patch00->x[1][i] = 0.5 * (xx[0][i] + xx[1][i]);
+    patch00->y[1][i] = 0.5 * (yy[0][i] + yy[1][i]);
+    double xxm = 0.5 * (xx[1][i] + xx[2][i]);
+    double yym = 0.5 * (yy[1][i] + yy[2][i]);
+    patch10->x[2][i] = 0.5 * (xx[2][i] + xx[3][i]);
+    patch10->y[2][i] = 0.5 * (yy[2][i] + yy[3][i]);
+    patch00->x[2][i] = 0.5 * (patch00->x[1][i] + xxm);
+    patch00->y[2][i] = 0.5 * (patch00->y[1][i] + yym);
+    patch10->x[1][i] = 0.5 * (xxm + patch10->x[2][i]);
+    patch10->y[1][i] = 0.5 * (yym + patch10->y[2][i]);
+    patch00->x[3][i] = 0.5 * (patch00->x[2][i] + patch10->x[1][i]);
+    patch00->y[3][i] = 0.5 * (patch00->y[2][i] + patch10->y[1][i]);
+    patch10->x[0][i] = patch00->x[3][i];
+    patch10->y[0][i] = patch00->y[3][i];
+    patch10->x[3][i] = xx[3][i];
+    patch10->y[3][i] = yy[3][i];
+  }
+  for (int i = 4; i < 8; ++i) {
+    patch01->x[0][i-4] = xx[0][i];
+    patch01->y[0][i-4] = yy[0][i];
+    patch01->x[1][i-4] = 0.5 * (xx[0][i] + xx[1][i]);
+    patch01->y[1][i-4] = 0.5 * (yy[0][i] + yy[1][i]);
+    double xxm = 0.5 * (xx[1][i] + xx[2][i]);
+    double yym = 0.5 * (yy[1][i] + yy[2][i]);
+    patch11->x[2][i-4] = 0.5 * (xx[2][i] + xx[3][i]);
+    patch11->y[2][i-4] = 0.5 * (yy[2][i] + yy[3][i]);
+    patch01->x[2][i-4] = 0.5 * (patch01->x[1][i-4] + xxm);
+    patch01->y[2][i-4] = 0.5 * (patch01->y[1][i-4] + yym);
+    patch11->x[1][i-4] = 0.5 * (xxm + patch11->x[2][i-4]);
+    patch11->y[1][i-4] = 0.5 * (yym + patch11->y[2][i-4]);
+    patch01->x[3][i-4] = 0.5 * (patch01->x[2][i-4] + patch11->x[1][i-4]);
+    patch01->y[3][i-4] = 0.5 * (patch01->y[2][i-4] + patch11->y[1][i-4]);
+    patch11->x[0][i-4] = patch01->x[3][i-4];
+    patch11->y[0][i-4] = patch01->y[3][i-4];
+    patch11->x[3][i-4] = xx[3][i];
+    patch11->y[3][i-4] = yy[3][i];
+  }
+  for (int i = 0; i < nComps; ++i) {
+    patch00->color[0][0][i] = patch->color[0][0][i];
+    patch00->color[0][1][i] = 0.5 * (patch->color[0][0][i] +
+				      patch->color[0][1][i]);
+    patch01->color[0][0][i] = patch00->color[0][1][i];
+    patch01->color[0][1][i] = patch->color[0][1][i];
+    patch01->color[1][1][i] = 0.5 * (patch->color[0][1][i] +
+				      patch->color[1][1][i]);
+    patch11->color[0][1][i] = patch01->color[1][1][i];
+    patch11->color[1][1][i] = patch->color[1][1][i];
+    patch11->color[1][0][i] = 0.5 * (patch->color[1][1][i] +
+				      patch->color[1][0][i]);
+    patch10->color[1][1][i] = patch11->color[1][0][i];
+    patch10->color[1][0][i] = patch->color[1][0][i];
+    patch10->color[0][0][i] = 0.5 * (patch->color[1][0][i] +
+				      patch->color[0][0][i]);
+    patch00->color[1][0][i] = patch10->color[0][0][i];
+    patch00->color[1][1][i] = 0.5 * (patch00->color[1][0][i] +
+				      patch01->color[1][1][i]);
+    patch01->color[1][0][i] = patch00->color[1][1][i];
+    patch11->color[0][0][i] = patch00->color[1][1][i];
+    patch10->color[0][1][i] = patch00->color[1][1][i];
+  }
+}
+
+static void subdividePatch(ShadingPatchJob *job, int jobIdx,
+			   GfxPatch *patch, int depth) {
+  GfxColor c00;
+  if (isPatchLeaf(job->state, job->shading, job->funcs[jobIdx], patch,
+		  depth, &c00)) {
+    if (job->nLeaves[jobIdx] == job->leavesSize[jobIdx]) {
+      job->leavesSize[jobIdx] *= 2;
+      job->leaves[jobIdx] =
+	  (ShadingPatchLeaf *)greallocn(job->leaves[jobIdx],
+					job->leavesSize[jobIdx],
+					sizeof(ShadingPatchLeaf));
+    }
+    ShadingPatchLeaf *leaf = &job->leaves[jobIdx][job->nLeaves[jobIdx]++];
+    getPatchOutline(job->state, patch, job->xMin, job->yMin,
+		    leaf->x, leaf->y);
+    leaf->color = c00;
+  } else {
+    GfxPatch patch00, patch01, patch10, patch11;
+    splitPatch(patch, job->shading->getNComps(),
+	       &patch00, &patch01, &patch10, &patch11);
+    subdividePatch(job, jobIdx, &patch00, depth + 1);
+    subdividePatch(job, jobIdx, &patch10, depth + 1);
+    subdividePatch(job, jobIdx, &patch01, depth + 1);
+    subdividePatch(job, jobIdx, &patch11, depth + 1);
+  }
+}
+
+static void shadingPatchJobFunc(void *data, int jobIdx) {
+  ShadingPatchJob *job = (ShadingPatchJob *)data;
+  int i0 = job->firstPatch + (job->nPatches * jobIdx) / job->nJobs;
+  int i1 = job->firstPatch + (job->nPatches * (jobIdx + 1)) / job->nJobs;
+  job->nLeaves[jobIdx] = 0;
+  for (int i = i0; i < i1; ++i) {
+    subdividePatch(job, jobIdx, job->shading->getPatch(i), job->depth);
+  }
+}
+
+//------------------------------------------------------------------------
+
 SplashBitmap *ShadingImage::generateBitmap(GfxState *state,
 					   GfxShading *shading,
 					   SplashColorMode mode,
@@ -101,7 +728,6 @@ SplashBitmap *ShadingImage::generateFunctionBitmap(GfxState *state,
   traceMessage("function shading fill bitmap");
   SplashBitmap *bitmap = new SplashBitmap(bitmapWidth, bitmapHeight, 1, mode,
 					  gTrue, gTrue, parentBitmap);
-  int nComps = splashColorModeNComps[mode];
 
   // compute the domain -> device space transform = mat * CTM
   double *ctm = state->getCTM();
@@ -127,34 +753,34 @@ SplashBitmap *ShadingImage::generateFunctionBitmap(GfxState *state,
   iMat[4] = (mat[2] * mat[5] - mat[3] * mat[4]) * det;
   iMat[5] = (mat[1] * mat[4] - mat[0] * mat[5]) * det;
 
-  // fill the bitmap
-  SplashColorPtr dataPtr = bitmap->getDataPtr();
-  Guchar *alphaPtr = bitmap->getAlphaPtr();
-  for (int y = 0; y < bitmapHeight; ++y) {
-    for (int x = 0; x < bitmapWidth; ++x) {
-
-      // convert coords to the pattern domain
-      double tx = xMin + x + 0.5;
-      double ty = yMin + y + 0.5;
-      double xx = tx * iMat[0] + ty * iMat[2] + iMat[4];
-      double yy = tx * iMat[1] + ty * iMat[3] + iMat[5];
-
-      // get the color
-      if (xx >= x0 && xx <= x1 && yy >= y0 && yy <= y1) {
-	GfxColor color;
-	shading->getColor(xx, yy, &color);
-	SplashColor sColor;
-	computeShadingColor(state, mode, reverseVideo, &color, sColor);
-	for (int i = 0; i < nComps; ++i) {
-	  *dataPtr++ = sColor[i];
-	}
-	*alphaPtr++ = 0xff;
-      } else {
-	dataPtr += nComps;
-	*alphaPtr++ = 0;
-      }
-    }
+  // fill the bitmap -- each thread gets its own copies of the
+  // shading and color space, because functions aren't thread-safe
+  ShadingRowJob job;
+  initShadingRowJob(&job, &fillFunctionShadingRows, bitmap, mode,
+		    reverseVideo, xMin, yMin, iMat);
+  job.x0 = x0;
+  job.y0 = y0;
+  job.x1 = x1;
+  job.y1 = y1;
+  job.ri = state->getRenderingIntent();
+  int nThreads = getShadingThreads(bitmapWidth, bitmapHeight);
+  job.shadings = (GfxFunctionShading **)
+                     gmallocn(nThreads, sizeof(GfxFunctionShading *));
+  job.colorSpaces = (GfxColorSpace **)
+                        gmallocn(nThreads, sizeof(GfxColorSpace *));
+  job.shadings[0] = shading;
+  job.colorSpaces[0] = state->getFillColorSpace();
+  for (int i = 1; i < nThreads; ++i) {
+    job.shadings[i] = (GfxFunctionShading *)shading->copy();
+    job.colorSpaces[i] = state->getFillColorSpace()->copy();
   }
+  runShadingRowJob(&job, nThreads);
+  for (int i = 1; i < nThreads; ++i) {
+    delete job.shadings[i];
+    delete job.colorSpaces[i];
+  }
+  gfree(job.shadings);
+  gfree(job.colorSpaces);
 
   *xOut = xMin;
   *yOut = yMin;
@@ -171,6 +797,11 @@ SplashBitmap *ShadingImage::generateAxialBitmap(GfxState *state,
   // get the shading parameters
   double x0, y0, x1, y1;
   shading->getCoords(&x0, &y0, &x1, &y1);
+  Function *funcs[gfxColorMaxComps];
+  int nFuncs = shading->getNFuncs();
+  for (int i = 0; i < nFuncs; ++i) {
+    funcs[i] = shading->getFunc(i);
+  }
   double t0 = shading->getDomain0();
   double t1 = shading->getDomain1();
   GBool ext0 = shading->getExtend0();
@@ -249,34 +880,25 @@ SplashBitmap *ShadingImage::generateAxialBitmap(GfxState *state,
 
   // special case: horizontal axis (in device space)
   } else if (fabs(yy0 - yy1) < 0.01) {
+    // compute the colors for all columns in one batch
+    double *ts = (double *)gmallocn(bitmapWidth, sizeof(double));
+    GBool *gos = (GBool *)gmallocn(bitmapWidth, sizeof(GBool));
     for (int x = 0; x < bitmapWidth; ++x) {
-      SplashColorPtr dataPtr = bitmap->getDataPtr() + x * nComps;
-      Guchar *alphaPtr = bitmap->getAlphaPtr() + x;
       double tx = xMin + x + 0.5;
       double ty = yMin + 0.5;
       double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
       double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
       double s = ((xx - x0) * dx + (yy - y0) * dy) * d;
-      GBool go = gFalse;
-      if (s < 0) {
-	go = ext0;
-      } else if (s > 1) {
-	go = ext1;
-      } else {
-	go = gTrue;
-      }
-      if (go) {
-	GfxColor color;
-	if (s <= 0) {
-	  shading->getColor(t0, &color);
-	} else if (s >= 1) {
-	  shading->getColor(t1, &color);
-	} else {
-	  double t = t0 + s * (t1 - t0);
-	  shading->getColor(t, &color);
-	}
-	SplashColor sColor;
-	computeShadingColor(state, mode, reverseVideo, &color, sColor);
+      computeAxialT(s, t0, t1, ext0, ext1, &ts[x], &gos[x]);
+    }
+    SplashColorPtr sColors = (SplashColorPtr)gmallocn(bitmapWidth, nComps);
+    computeShadingColors(state, mode, reverseVideo, funcs, nFuncs,
+			 ts, bitmapWidth, gFalse, sColors);
+    for (int x = 0; x < bitmapWidth; ++x) {
+      SplashColorPtr dataPtr = bitmap->getDataPtr() + x * nComps;
+      Guchar *alphaPtr = bitmap->getAlphaPtr() + x;
+      if (gos[x]) {
+	SplashColorPtr sColor = sColors + x * nComps;
 	for (int y = 0; y < bitmapHeight; ++y) {
 	  for (int i = 0; i < nComps; ++i) {
 	    dataPtr[i] = sColor[i];
@@ -290,39 +912,33 @@ SplashBitmap *ShadingImage::generateAxialBitmap(GfxState *state,
 	  *alphaPtr = 0;
 	  alphaPtr += bitmapWidth;
 	}
-      }
-    }
-
-  // special case: vertical axis (in device space)
-  } else if (fabs(xx0 - xx1) < 0.01) {
-    for (int y = 0; y < bitmapHeight; ++y) {
-      SplashColorPtr dataPtr = bitmap->getDataPtr() + y * bitmap->getRowSize();
-      Guchar *alphaPtr = bitmap->getAlphaPtr() + y * bitmapWidth;
-      double tx = xMin + 0.5;
-      double ty = yMin + y + 0.5;
-      double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
-      double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
-      double s = ((xx - x0) * dx + (yy - y0) * dy) * d;
-      GBool go = gFalse;
-      if (s < 0) {
-	go = ext0;
-      } else if (s > 1) {
-	go = ext1;
-      } else {
-	go = gTrue;
-      }
-      if (go) {
-	GfxColor color;
-	if (s <= 0) {
-	  shading->getColor(t0, &color);
-	} else if (s >= 1) {
-	  shading->getColor(t1, &color);
-	} else {
-	  double t = t0 + s * (t1 - t0);
-	  shading->getColor(t, &color);
-	}
-	SplashColor sColor;
-	computeShadingColor(state, mode, reverseVideo, &color, sColor);
+      }
+    }
+    gfree(sColors);
+    gfree(gos);
+    gfree(ts);
+
+  // special case: vertical axis (in device space)
+  } else if (fabs(xx0 - xx1) < 0.01) {
+    // compute the colors for all rows in one batch
+    double *ts = (double *)gmallocn(bitmapHeight, sizeof(double));
+    GBool *gos = (GBool *)gmallocn(bitmapHeight, sizeof(GBool));
+    for (int y = 0; y < bitmapHeight; ++y) {
+      double tx = xMin + 0.5;
+      double ty = yMin + y + 0.5;
+      double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
+      double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
+      double s = ((xx - x0) * dx + (yy - y0) * dy) * d;
+      computeAxialT(s, t0, t1, ext0, ext1, &ts[y], &gos[y]);
+    }
+    SplashColorPtr sColors = (SplashColorPtr)gmallocn(bitmapHeight, nComps);
+    computeShadingColors(state, mode, reverseVideo, funcs, nFuncs,
+			 ts, bitmapHeight, gFalse, sColors);
+    for (int y = 0; y < bitmapHeight; ++y) {
+      SplashColorPtr dataPtr = bitmap->getDataPtr() + y * bitmap->getRowSize();
+      Guchar *alphaPtr = bitmap->getAlphaPtr() + y * bitmapWidth;
+      if (gos[y]) {
+	SplashColorPtr sColor = sColors + y * nComps;
 	for (int x = 0; x < bitmapWidth; ++x) {
 	  for (int i = 0; i < nComps; ++i) {
 	    dataPtr[i] = sColor[i];
@@ -334,6 +950,9 @@ SplashBitmap *ShadingImage::generateAxialBitmap(GfxState *state,
 	memset(alphaPtr, 0, bitmapWidth);
       }
     }
+    gfree(sColors);
+    gfree(gos);
+    gfree(ts);
 
   // general case
   } else {
@@ -346,56 +965,22 @@ SplashBitmap *ShadingImage::generateAxialBitmap(GfxState *state,
       nColors = 1024;
     }
     SplashColorPtr sColors = (SplashColorPtr)gmallocn(nColors, nComps);
-    SplashColorPtr sColor = sColors;
-    for (int i = 0; i < nColors; ++i) {
-      double s = (double)i / (double)(nColors - 1);
-      double t = t0 + s * (t1 - t0);
-      GfxColor color;
-      shading->getColor(t, &color);
-      computeShadingColor(state, mode, reverseVideo, &color, sColor);
-      sColor += nComps;
-    }
-
-    SplashColorPtr dataPtr = bitmap->getDataPtr();
-    Guchar *alphaPtr = bitmap->getAlphaPtr();
-    for (int y = 0; y < bitmapHeight; ++y) {
-      for (int x = 0; x < bitmapWidth; ++x) {
-
-	// convert coords to user space
-	double tx = xMin + x + 0.5;
-	double ty = yMin + y + 0.5;
-	double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
-	double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
-
-	// compute the position along the axis
-	double s = ((xx - x0) * dx + (yy - y0) * dy) * d;
-	GBool go = gFalse;
-	if (s < 0) {
-	  go = ext0;
-	} else if (s > 1) {
-	  go = ext1;
-	} else {
-	  go = gTrue;
-	}
-	if (go) {
-	  if (s <= 0) {
-	    sColor = sColors;
-	  } else if (s >= 1) {
-	    sColor = sColors + (nColors - 1) * nComps;
-	  } else {
-	    int i = (int)((nColors - 1) * s + 0.5);
-	    sColor = sColors + i * nComps;
-	  }
-	  for (int i = 0; i < nComps; ++i) {
-	    *dataPtr++ = sColor[i];
-	  }
-	  *alphaPtr++ = 0xff;
-	} else {
-	  dataPtr += nComps;
-	  *alphaPtr++ = 0;
-	}
-      }
-    }
+    computeShadingRamp(state, mode, reverseVideo, funcs, nFuncs,
+		       t0, t1, nColors, sColors);
+
+    ShadingRowJob job;
+    initShadingRowJob(&job, &fillAxialShadingRows, bitmap, mode,
+		      reverseVideo, xMin, yMin, ictm);
+    job.sColors = sColors;
+    job.nColors = nColors;
+    job.x0 = x0;
+    job.y0 = y0;
+    job.dx = dx;
+    job.dy = dy;
+    job.d = d;
+    job.ext0 = ext0;
+    job.ext1 = ext1;
+    runShadingRowJob(&job, getShadingThreads(bitmapWidth, bitmapHeight));
     gfree(sColors);
   }
 
@@ -414,6 +999,11 @@ SplashBitmap *ShadingImage::generateRadialBitmap(GfxState *state,
   // get the shading parameters
   double x0, y0, r0, x1, y1, r1;
   shading->getCoords(&x0, &y0, &r0, &x1, &y1, &r1);
+  Function *funcs[gfxColorMaxComps];
+  int nFuncs = shading->getNFuncs();
+  for (int i = 0; i < nFuncs; ++i) {
+    funcs[i] = shading->getFunc(i);
+  }
   double t0 = shading->getDomain0();
   double t1 = shading->getDomain1();
   GBool ext0 = shading->getExtend0();
@@ -495,15 +1085,9 @@ SplashBitmap *ShadingImage::generateRadialBitmap(GfxState *state,
     nColors = 1024;
   }
   SplashColorPtr sColors = (SplashColorPtr)gmallocn(nColors, nComps);
-  SplashColorPtr sColor = sColors;
-  for (int i = 0; i < nColors; ++i) {
-    double s = (double)i / (double)(nColors - 1);
-    double t = t0 + s * (t1 - t0);
-    GfxColor color;
-    shading->getColor(t, &color);
-    computeShadingColor(state, mode, reverseVideo, &color, sColor);
-    sColor += nComps;
-  }
+  computeShadingRamp(state, mode, reverseVideo, funcs, nFuncs,
+		     t0, t1, nColors, sColors);
+  SplashColorPtr sColor;
 
   // special case: in the "enclosed" + extended case, we can fill the
   // bitmap with the outer color and just render inside the larger
@@ -572,105 +1156,36 @@ SplashBitmap *ShadingImage::generateRadialBitmap(GfxState *state,
   }
 
   // render the shading into the bitmap
-  double dx = x1 - x0;
-  double dy = y1 - y0;
   double dr = r1 - r0;
-  double r0dr = r0 * dr;
-  double r02 = r0 * r0;
-  double a = dx * dx + dy * dy - dr * dr;
-  GBool aIsZero;
-  double a2;
-  if (fabs(a) < 0.00001) {
-    aIsZero = gTrue;
-    a2 = 0;
+  ShadingRowJob job;
+  initShadingRowJob(&job, &fillRadialShadingRows, bitmap, mode,
+		    reverseVideo, xMin, yMin, ictm);
+  job.yStart = byMin;
+  job.yEnd = byMax;
+  job.xStart = bxMin;
+  job.xEnd = bxMax;
+  job.sColors = sColors;
+  job.nColors = nColors;
+  job.ext0 = ext0;
+  job.ext1 = ext1;
+  job.x0 = x0;
+  job.y0 = y0;
+  job.r0 = r0;
+  job.r1 = r1;
+  job.dx = x1 - x0;
+  job.dy = y1 - y0;
+  job.r0dr = r0 * dr;
+  job.r02 = r0 * r0;
+  job.a = job.dx * job.dx + job.dy * job.dy - dr * dr;
+  if (fabs(job.a) < 0.00001) {
+    job.aIsZero = gTrue;
+    job.a2 = 0;
   } else {
-    aIsZero = gFalse;
-    a2 = 1 / (2 * a);
+    job.aIsZero = gFalse;
+    job.a2 = 1 / (2 * job.a);
   }
-  for (int y = byMin; y < byMax; ++y) {
-    SplashColorPtr dataPtr = bitmap->getDataPtr()
-                             + y * bitmap->getRowSize() + bxMin * nComps;
-    Guchar *alphaPtr = bitmap->getAlphaPtr()
-                       + y * bitmap->getAlphaRowSize() + bxMin;
-    for (int x = bxMin; x < bxMax; ++x) {
-
-      // convert coords to user space
-      double tx = xMin + x + 0.5;
-      double ty = yMin + y + 0.5;
-      double xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
-      double yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
-
-      // compute the radius of the circle at x,y
-      double b = 2 * ((xx - x0) * dx + (yy - y0) * dy + r0dr);
-      double c = (xx - x0) * (xx - x0) + (yy - y0) * (yy - y0) - r02;
-      double s = 0;
-      GBool go = gFalse;
-      if (aIsZero) {
-	if (fabs(b) < 0.000001) {
-	  if (c <= 0) {
-	    if (ext0) {
-	      s = 0;
-	      go = gTrue;
-	    }
-	  } else {
-	    if (ext1) {
-	      s = 1;
-	      go = gTrue;
-	    }
-	  }
-	} else {
-	  double s0 = c / b;
-	  double rs0 = r0 + s0 * (r1 - r0);
-	  if ((s0 >= 0 || ext0) && (s0 <= 1 || ext1) && rs0 >= 0) { 
-	    s = s0;
-	    go = gTrue;
-	  }
-	}
-      } else {
-	double e = b*b - 4*a*c;
-	if (e >= 0) {
-	  double es = sqrt(e);
-	  double s0 = (b + es) * a2;
-	  double s1 = (b - es) * a2;
-	  double rs0 = r0 + s0 * (r1 - r0);
-	  double rs1 = r0 + s1 * (r1 - r0);
-	  if (s0 > s1) {
-	    if ((s0 >= 0 || ext0) && (s0 <= 1 || ext1) && rs0 >= 0) {
-	      s = s0;
-	      go = gTrue;
-	    } else if ((s1 >= 0 || ext0) && (s1 <= 1 || ext1) && rs1 >= 0) {
-	      s = s1;
-	      go = gTrue;
-	    }
-	  } else {
-	    if ((s1 >= 0 || ext0) && (s1 <= 1 || ext1) && rs1 >= 0) {
-	      s = s1;
-	      go = gTrue;
-	    } else if ((s0 >= 0 || ext0) && (s0 <= 1 || ext1) && rs0 >= 0) {
-	      s = s0;
-	      go = gTrue;
-	    }
-	  }
-	}
-      }
-      if (!go) {
-	dataPtr += nComps;
-	*alphaPtr++ = 0x00;
-	continue;
-      }
-      if (s <= 0) {
-	sColor = sColors;
-      } else if (s >= 1) {
-	sColor = sColors + (nColors - 1) * nComps;
-      } else {
-	int i = (int)((nColors - 1) * s + 0.5);
-	sColor = sColors + i * nComps;
-      }
-      for (int i = 0; i < nComps; ++i) {
-	*dataPtr++ = sColor[i];
-      }
-      *alphaPtr++ = 0xff;
-    }
+  if (byMin < byMax) {
+    runShadingRowJob(&job, getShadingThreads(bxMax - bxMin, byMax - byMin));
   }
 
   gfree(sColors);
@@ -767,6 +1282,41 @@ SplashBitmap *ShadingImage::generateGouraudTriangleBitmap(
   memset(bitmap->getDataPtr(), 0, bitmap->getHeight() * bitmap->getRowSize());
   memset(bitmap->getAlphaPtr(), 0, bitmap->getHeight() * bitmap->getWidth());
 
+  // for a parameterized shading, pre-compute a color ramp covering
+  // the range of parameter values
+  SplashColorPtr ramp = NULL;
+  double tMin = 0, tMax = 0;
+  if (shading->getNFuncs() > 0) {
+    for (int i = 0; i < shading->getNTriangles(); ++i) {
+      double x0, y0, x1, y1, x2, y2;
+      double color0[gfxColorMaxComps];
+      double color1[gfxColorMaxComps];
+      double color2[gfxColorMaxComps];
+      shading->getTriangle(i, &x0, &y0, color0,
+			   &x1, &y1, color1,
+			   &x2, &y2, color2);
+      if (i == 0) {
+	tMin = tMax = color0[0];
+      }
+      double ts[3] = { color0[0], color1[0], color2[0] };
+      for (int j = 0; j < 3; ++j) {
+	if (ts[j] < tMin) {
+	  tMin = ts[j];
+	} else if (ts[j] > tMax) {
+	  tMax = ts[j];
+	}
+      }
+    }
+    if (tMax > tMin) {
+      Function *funcs[gfxColorMaxComps];
+      for (int i = 0; i < shading->getNFuncs(); ++i) {
+	funcs[i] = shading->getFunc(i);
+      }
+      ramp = computeGouraudRamp(state, mode, reverseVideo,
+				funcs, shading->getNFuncs(), tMin, tMax);
+    }
+  }
+
   // draw the triangles
   for (int i = 0; i < shading->getNTriangles(); ++i) {
     double x0, y0, x1, y1, x2, y2;
@@ -779,8 +1329,9 @@ SplashBitmap *ShadingImage::generateGouraudTriangleBitmap(
     gouraudFillTriangle(state, bitmap, mode, reverseVideo,
 			xMin, yMin, xMax, yMax,
 			x0, y0, color0, x1, y1, color1, x2, y2, color2,
-			shading);
+			shading, ramp, tMin, tMax);
   }
+  gfree(ramp);
 
   *xOut = xMin;
   *yOut = yMin;
@@ -794,9 +1345,15 @@ void ShadingImage::gouraudFillTriangle(GfxState *state, SplashBitmap *bitmap,
 				       double x0, double y0, double *color0,
 				       double x1, double y1, double *color1,
 				       double x2, double y2, double *color2,
-				       GfxGouraudTriangleShading *shading) {
+				       GfxGouraudTriangleShading *shading,
+				       SplashColorPtr ramp,
+				       double rampTMin, double rampTMax) {
   int nShadingComps = shading->getNComps();
   int nBitmapComps = splashColorModeNComps[mode];
+  double rampScale = 0;
+  if (ramp) {
+    rampScale = (gouraudRampSize - 1) / (rampTMax - rampTMin);
+  }
 
   //--- transform the vertices to device space, sort by y
   double dx0, dy0, dx1, dy1, dx2, dy2;
@@ -908,10 +1465,22 @@ void ShadingImage::gouraudFillTriangle(GfxState *state, SplashBitmap *bitmap,
       }
 
       //--- compute color and set pixel
-      GfxColor gColor;
-      shading->getColor(cc, &gColor);
-      SplashColor sColor;
-      computeShadingColor(state, mode, reverseVideo, &gColor, sColor);
+      SplashColor sColorBuf;
+      SplashColorPtr sColor;
+      if (ramp) {
+	int k = (int)((cc[0] - rampTMin) * rampScale + 0.5);
+	if (k < 0) {
+	  k = 0;
+	} else if (k > gouraudRampSize - 1) {
+	  k = gouraudRampSize - 1;
+	}
+	sColor = ramp + k * nBitmapComps;
+      } else {
+	GfxColor gColor;
+	shading->getColor(cc, &gColor);
+	sColor = sColorBuf;
+	computeShadingColor(state, mode, reverseVideo, &gColor, sColor);
+      }
       for (int i = 0; i < nBitmapComps; ++i) {
 	dataPtr[i] = sColor[i];
       }
@@ -1025,9 +1594,22 @@ SplashBitmap *ShadingImage::generatePatchMeshBitmap(
   } else {
     start = 0;
   }
-  for (int i = 0; i < shading->getNPatches(); ++i) {
-    fillPatch(state, splash, mode, reverseVideo,
-	      xMin, yMin, shading->getPatch(i), shading, start);
+  int nThreads = 1;
+  if (shading->getNPatches() >= shadingMinThreadedPatches) {
+    nThreads = globalParams->getShadingThreads();
+  }
+  if (nThreads > 1) {
+    fillPatchesThreaded(state, splash, mode, reverseVideo, xMin, yMin,
+			shading, start, nThreads);
+  } else {
+    Function *funcs[gfxColorMaxComps];
+    for (int i = 0; i < shading->getNFuncs(); ++i) {
+      funcs[i] = shading->getFunc(i);
+    }
+    for (int i = 0; i < shading->getNPatches(); ++i) {
+      fillPatch(state, splash, mode, reverseVideo,
+		xMin, yMin, shading->getPatch(i), shading, funcs, start);
+    }
   }
 
   delete splash;
@@ -1042,195 +1624,242 @@ void ShadingImage::fillPatch(GfxState *state, Splash *splash,
 			     int xMin, int yMin,
 			     GfxPatch *patch,
 			     GfxPatchMeshShading *shading,
+			     Function **funcs,
 			     int depth) {
+  // draw the patch
   GfxColor c00;
-  shading->getColor(patch->color[0][0], &c00);
-  GBool stop = gFalse;
+  if (isPatchLeaf(state, shading, funcs, patch, depth, &c00)) {
+    SplashColor sColor;
+    computeShadingColor(state, mode, reverseVideo, &c00, sColor);
+    splash->setFillPattern(new SplashSolidColor(sColor));
+    double xs[12], ys[12];
+    getPatchOutline(state, patch, xMin, yMin, xs, ys);
+    SplashPath *path = makePatchPath(xs, ys);
+    splash->fill(path, gFalse);
+    delete path;
 
-  // stop subdivision at max depth
-  if (depth == patchMaxDepth) {
-    stop = gTrue;
+  // subdivide the patch
+  } else {
+    GfxPatch patch00, patch01, patch10, patch11;
+    splitPatch(patch, shading->getNComps(),
+	       &patch00, &patch01, &patch10, &patch11);
+    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch00,
+	      shading, funcs, depth + 1);
+    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch10,
+	      shading, funcs, depth + 1);
+    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch01,
+	      shading, funcs, depth + 1);
+    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch11,
+	      shading, funcs, depth + 1);
   }
+}
 
-  // stop subdivision if colors are close enough
-  if (!stop) {
-    int nComps = shading->getColorSpace()->getNComps();
-    GfxColor c01, c10, c11;
-    shading->getColor(patch->color[0][1], &c01);
-    shading->getColor(patch->color[1][0], &c10);
-    shading->getColor(patch->color[1][1], &c11);
-    int i;
-    for (i = 0; i < nComps; ++i) {
-      if (abs(c00.c[i] - c01.c[i]) > patchColorDelta ||
-	  abs(c01.c[i] - c11.c[i]) > patchColorDelta ||
-	  abs(c11.c[i] - c10.c[i]) > patchColorDelta ||
-	  abs(c10.c[i] - c00.c[i]) > patchColorDelta) {
-	break;
+// Fill the patches of a patch mesh shading, subdividing them with
+// [nThreads] threads.  The leaves are filled in the same order as by
+// fillPatch(), so the result is identical.
+void ShadingImage::fillPatchesThreaded(GfxState *state, Splash *splash,
+				       SplashColorMode mode,
+				       GBool reverseVideo,
+				       int xMin, int yMin,
+				       GfxPatchMeshShading *shading,
+				       int depth, int nThreads) {
+  ShadingPatchJob job;
+  job.state = state;
+  job.shading = shading;
+  job.xMin = xMin;
+  job.yMin = yMin;
+  job.depth = depth;
+  job.nJobs = nThreads;
+  job.funcs = (Function ***)gmallocn(nThreads, sizeof(Function **));
+  job.leaves = (ShadingPatchLeaf **)gmallocn(nThreads,
+					     sizeof(ShadingPatchLeaf *));
+  job.nLeaves = (int *)gmallocn(nThreads, sizeof(int));
+  job.leavesSize = (int *)gmallocn(nThreads, sizeof(int));
+  for (int j = 0; j < nThreads; ++j) {
+    job.funcs[j] = (Function **)gmallocn(gfxColorMaxComps,
+					 sizeof(Function *));
+    for (int i = 0; i < shading->getNFuncs(); ++i) {
+      if (j == 0) {
+	job.funcs[j][i] = shading->getFunc(i);
+      } else {
+	job.funcs[j][i] = shading->getFunc(i)->copy();
       }
     }
-    if (i == nComps) {
-      stop = gTrue;
-    }
+    job.leavesSize[j] = 64;
+    job.leaves[j] = (ShadingPatchLeaf *)gmallocn(job.leavesSize[j],
+						 sizeof(ShadingPatchLeaf));
+    job.nLeaves[j] = 0;
   }
 
-  // stop subdivision if patch is small enough
-  if (!stop) {
-    double xxMin = 0;
-    double yyMin = 0;
-    double xxMax = 0;
-    double yyMax = 0;
-    for (int j = 0; j < 4; ++j) {
-      for (int i = 0; i < 4; ++i) {
-	double xx, yy;
-	state->transformDelta(patch->x[i][j], patch->y[i][j], &xx, &yy);
-	if (i == 0 && j == 0) {
-	  xxMin = xxMax = xx;
-	  yyMin = yyMax = yy;
-	} else {
-	  if (xx < xxMin) {
-	    xxMin = xx;
-	  } else if (xx > xxMax) {
-	    xxMax = xx;
-	  }
-	  if (yy < yyMin) {
-	    yyMin = yy;
-	  } else if (yy > yyMax) {
-	    yyMax = yy;
-	  }
-	}
-      }
+  int passSize = nThreads * shadingPatchesPerJob;
+  for (job.firstPatch = 0;
+       job.firstPatch < shading->getNPatches();
+       job.firstPatch += passSize) {
+    job.nPatches = shading->getNPatches() - job.firstPatch;
+    if (job.nPatches > passSize) {
+      job.nPatches = passSize;
     }
-    if (xxMax - xxMin < 1 && yyMax - yyMin < 1) {
-      stop = gTrue;
+    gRunParallel(&shadingPatchJobFunc, &job, nThreads);
+    for (int j = 0; j < nThreads; ++j) {
+      for (int k = 0; k < job.nLeaves[j]; ++k) {
+	ShadingPatchLeaf *leaf = &job.leaves[j][k];
+	SplashColor sColor;
+	computeShadingColor(state, mode, reverseVideo, &leaf->color, sColor);
+	splash->setFillPattern(new SplashSolidColor(sColor));
+	SplashPath *path = makePatchPath(leaf->x, leaf->y);
+	splash->fill(path, gFalse);
+	delete path;
+      }
     }
   }
 
-  // draw the patch
-  if (stop) {
-    SplashColor sColor;
-    computeShadingColor(state, mode, reverseVideo, &c00, sColor);
-    splash->setFillPattern(new SplashSolidColor(sColor));
-    SplashPath *path = new SplashPath();
-    double xx0, yy0, xx1, yy1, xx2, yy2, xx3, yy3;
-    state->transform(patch->x[0][0], patch->y[0][0], &xx0, &yy0);
-    path->moveTo(xx0 - xMin, yy0 - yMin);
-    state->transform(patch->x[0][1], patch->y[0][1], &xx1, &yy1);
-    state->transform(patch->x[0][2], patch->y[0][2], &xx2, &yy2);
-    state->transform(patch->x[0][3], patch->y[0][3], &xx3, &yy3);
-    path->curveTo(xx1 - xMin, yy1 - yMin, xx2 - xMin, yy2 - yMin,
-		  xx3 - xMin, yy3 - yMin);
-    state->transform(patch->x[1][3], patch->y[1][3], &xx1, &yy1);
-    state->transform(patch->x[2][3], patch->y[2][3], &xx2, &yy2);
-    state->transform(patch->x[3][3], patch->y[3][3], &xx3, &yy3);
-    path->curveTo(xx1 - xMin, yy1 - yMin, xx2 - xMin, yy2 - yMin,
-		  xx3 - xMin, yy3 - yMin);
-    state->transform(patch->x[3][2], patch->y[3][2], &xx1, &yy1);
-    state->transform(patch->x[3][1], patch->y[3][1], &xx2, &yy2);
-    state->transform(patch->x[3][0], patch->y[3][0], &xx3, &yy3);
-    path->curveTo(xx1 - xMin, yy1 - yMin, xx2 - xMin, yy2 - yMin,
-		  xx3 - xMin, yy3 - yMin);
-    state->transform(patch->x[2][0], patch->y[2][0], &xx1, &yy1);
-    state->transform(patch->x[1][0], patch->y[1][0], &xx2, &yy2);
-    path->curveTo(xx1 - xMin, yy1 - yMin, xx2 - xMin, yy2 - yMin,
-		  xx0 - xMin, yy0 - yMin);
-    path->close();
-    splash->fill(path, gFalse);
-    delete path;
+  for (int j = 0; j < nThreads; ++j) {
+    if (j > 0) {
+      for (int i = 0; i < shading->getNFuncs(); ++i) {
+	delete job.funcs[j][i];
+      }
+    }
+    gfree(job.funcs[j]);
+    gfree(job.leaves[j]);
+  }
+  gfree(job.funcs);
+  gfree(job.leaves);
+  gfree(job.nLeaves);
+  gfree(job.leavesSize);
+}
 
-  // subdivide the patch
+// Map position [s] along the axis of an axial shading to the
+// function input *[t], and set *[go] if the point is inside the
+// (possibly extended) shading.
+void ShadingImage::computeAxialT(double s, double t0, double t1,
+				 GBool ext0, GBool ext1,
+				 double *t, GBool *go) {
+  if (s < 0) {
+    *go = ext0;
+  } else if (s > 1) {
+    *go = ext1;
   } else {
-    double xx[4][8], yy[4][8];
-    for (int i = 0; i < 4; ++i) {
-      xx[i][0] = patch->x[i][0];
-      yy[i][0] = patch->y[i][0];
-      xx[i][1] = 0.5 * (patch->x[i][0] + patch->x[i][1]);
-      yy[i][1] = 0.5 * (patch->y[i][0] + patch->y[i][1]);
-      double xxm = 0.5 * (patch->x[i][1] + patch->x[i][2]);
-      double yym = 0.5 * (patch->y[i][1] + patch->y[i][2]);
-      xx[i][6] = 0.5 * (patch->x[i][2] + patch->x[i][3]);
-      yy[i][6] = 0.5 * (patch->y[i][2] + patch->y[i][3]);
-      xx[i][2] = 0.5 * (xx[i][1] + xxm);
-      yy[i][2] = 0.5 * (yy[i][1] + yym);
-      xx[i][5] = 0.5 * (xxm + xx[i][6]);
-      yy[i][5] = 0.5 * (yym + yy[i][6]);
-      xx[i][3] = xx[i][4] = 0.5 * (xx[i][2] + xx[i][5]);
-      yy[i][3] = yy[i][4] = 0.5 * (yy[i][2] + yy[i][5]);
-      xx[i][7] = patch->x[i][3];
-      yy[i][7] = patch->y[i][3];
+    *go = gTrue;
+  }
+  if (s <= 0) {
+    *t = t0;
+  } else if (s >= 1) {
+    *t = t1;
+  } else {
+    *t = t0 + s * (t1 - t0);
+  }
+}
+
+// Compute a [gouraudRampSize]-entry color ramp for t values in
+// [tMin, tMax], for a parameterized Gouraud-shaded triangle shading.
+// Pixels are mapped to the nearest ramp entry, so the ramp is checked
+// against the exact colors at the midpoints between entries -- if
+// the color functions change too quickly for that to be accurate,
+// this returns NULL, and the caller evaluates the functions per
+// pixel.
+SplashColorPtr ShadingImage::computeGouraudRamp(GfxState *state,
+						SplashColorMode mode,
+						GBool reverseVideo,
+						Function **funcs, int nFuncs,
+						double tMin, double tMax) {
+  int nComps = splashColorModeNComps[mode];
+  SplashColorPtr ramp = (SplashColorPtr)gmallocn(gouraudRampSize, nComps);
+  computeShadingRamp(state, mode, reverseVideo, funcs, nFuncs,
+		     tMin, tMax, gouraudRampSize, ramp);
+  int nMid = gouraudRampSize - 1;
+  double *ts = (double *)gmallocn(nMid, sizeof(double));
+  for (int i = 0; i < nMid; ++i) {
+    double s = ((double)i + 0.5) / (double)nMid;
+    ts[i] = tMin + s * (tMax - tMin);
+  }
+  SplashColorPtr mid = (SplashColorPtr)gmallocn(nMid, nComps);
+  computeShadingColors(state, mode, reverseVideo, funcs, nFuncs,
+		       ts, nMid, gFalse, mid);
+  GBool ok = gTrue;
+  for (int i = 0; ok && i < nMid * nComps; ++i) {
+    if (abs((int)mid[i] - (int)ramp[i]) > gouraudRampMaxError ||
+	abs((int)mid[i] - (int)ramp[i + nComps]) > gouraudRampMaxError) {
+      ok = gFalse;
     }
-    GfxPatch patch00, patch01, patch10, patch11;
-    for (int i = 0; i < 4; ++i) {
-      patch00.x[0][i] = xx[0][i];
-      patch00.y[0][i] = yy[0][i];
-      patch00.x[1][i] = 0.5 * (xx[0][i] + xx[1][i]);
-      patch00.y[1][i] = 0.5 * (yy[0][i] + yy[1][i]);
-      double xxm = 0.5 * (xx[1][i] + xx[2][i]);
-      double yym = 0.5 * (yy[1][i] + yy[2][i]);
-      patch10.x[2][i] = 0.5 * (xx[2][i] + xx[3][i]);
-      patch10.y[2][i] = 0.5 * (yy[2][i] + yy[3][i]);
-      patch00.x[2][i] = 0.5 * (patch00.x[1][i] + xxm);
-      patch00.y[2][i] = 0.5 * (patch00.y[1][i] + yym);
-      patch10.x[1][i] = 0.5 * (xxm + patch10.x[2][i]);
-      patch10.y[1][i] = 0.5 * (yym + patch10.y[2][i]);
-      patch00.x[3][i] = 0.5 * (patch00.x[2][i] + patch10.x[1][i]);
-      patch00.y[3][i] = 0.5 * (patch00.y[2][i] + patch10.y[1][i]);
-      patch10.x[0][i] = patch00.x[3][i];
-      patch10.y[0][i] = patch00.y[3][i];
-      patch10.x[3][i] = xx[3][i];
-      patch10.y[3][i] = yy[3][i];
+  }
+  gfree(mid);
+  gfree(ts);
+  if (!ok) {
+    gfree(ramp);
+    ramp = NULL;
+  }
+  return ramp;
+}
+
+// Compute a color ramp with [nColors] evenly spaced entries from
+// [t0] to [t1], for an axial or radial shading.
+void ShadingImage::computeShadingRamp(GfxState *state,
+				      SplashColorMode mode,
+				      GBool reverseVideo,
+				      Function **funcs, int nFuncs,
+				      double t0, double t1, int nColors,
+				      SplashColorPtr sColors) {
+  double *ts = (double *)gmallocn(nColors, sizeof(double));
+  for (int i = 0; i < nColors; ++i) {
+    double s = (double)i / (double)(nColors - 1);
+    ts[i] = t0 + s * (t1 - t0);
+  }
+  computeShadingColors(state, mode, reverseVideo, funcs, nFuncs,
+		       ts, nColors, gTrue, sColors);
+  gfree(ts);
+}
+
+// Compute the colors for the [nColors] function inputs in [ts], for
+// an axial or radial shading.  If [approx] is set, and the color
+// functions are smooth enough, they are approximated with a lookup
+// table, which needs far fewer function evaluations.
+void ShadingImage::computeShadingColors(GfxState *state,
+					SplashColorMode mode,
+					GBool reverseVideo,
+					Function **funcs, int nFuncs,
+					double *ts, int nColors,
+					GBool approx,
+					SplashColorPtr sColors) {
+  int nOut = 0;
+  for (int i = 0; i < nFuncs; ++i) {
+    nOut += funcs[i]->getOutputSize();
+  }
+  double *out = (double *)gmallocn(nColors, nOut * (int)sizeof(double));
+  FunctionLUT *lut = NULL;
+  if (approx && nColors / 2 >= shadingLUTMinSize) {
+    double tMin = ts[0];
+    double tMax = ts[0];
+    for (int i = 1; i < nColors; ++i) {
+      if (ts[i] < tMin) {
+	tMin = ts[i];
+      } else if (ts[i] > tMax) {
+	tMax = ts[i];
+      }
     }
-    for (int i = 4; i < 8; ++i) {
-      patch01.x[0][i-4] = xx[0][i];
-      patch01.y[0][i-4] = yy[0][i];
-      patch01.x[1][i-4] = 0.5 * (xx[0][i] + xx[1][i]);
-      patch01.y[1][i-4] = 0.5 * (yy[0][i] + yy[1][i]);
-      double xxm = 0.5 * (xx[1][i] + xx[2][i]);
-      double yym = 0.5 * (yy[1][i] + yy[2][i]);
-      patch11.x[2][i-4] = 0.5 * (xx[2][i] + xx[3][i]);
-      patch11.y[2][i-4] = 0.5 * (yy[2][i] + yy[3][i]);
-      patch01.x[2][i-4] = 0.5 * (patch01.x[1][i-4] + xxm);
-      patch01.y[2][i-4] = 0.5 * (patch01.y[1][i-4] + yym);
-      patch11.x[1][i-4] = 0.5 * (xxm + patch11.x[2][i-4]);
-      patch11.y[1][i-4] = 0.5 * (yym + patch11.y[2][i-4]);
-      patch01.x[3][i-4] = 0.5 * (patch01.x[2][i-4] + patch11.x[1][i-4]);
-      patch01.y[3][i-4] = 0.5 * (patch01.y[2][i-4] + patch11.y[1][i-4]);
-      patch11.x[0][i-4] = patch01.x[3][i-4];
-      patch11.y[0][i-4] = patch01.y[3][i-4];
-      patch11.x[3][i-4] = xx[3][i];
-      patch11.y[3][i-4] = yy[3][i];
+    lut = new FunctionLUT(funcs, nFuncs, tMin, tMax,
+			  shadingLUTTolerance, nColors / 2);
+    if (!lut->isOk()) {
+      delete lut;
+      lut = NULL;
     }
-    for (int i = 0; i < shading->getNComps(); ++i) {
-      patch00.color[0][0][i] = patch->color[0][0][i];
-      patch00.color[0][1][i] = 0.5 * (patch->color[0][0][i] +
-				      patch->color[0][1][i]);
-      patch01.color[0][0][i] = patch00.color[0][1][i];
-      patch01.color[0][1][i] = patch->color[0][1][i];
-      patch01.color[1][1][i] = 0.5 * (patch->color[0][1][i] +
-				      patch->color[1][1][i]);
-      patch11.color[0][1][i] = patch01.color[1][1][i];
-      patch11.color[1][1][i] = patch->color[1][1][i];
-      patch11.color[1][0][i] = 0.5 * (patch->color[1][1][i] +
-				      patch->color[1][0][i]);
-      patch10.color[1][1][i] = patch11.color[1][0][i];
-      patch10.color[1][0][i] = patch->color[1][0][i];
-      patch10.color[0][0][i] = 0.5 * (patch->color[1][0][i] +
-				      patch->color[0][0][i]);
-      patch00.color[1][0][i] = patch10.color[0][0][i];
-      patch00.color[1][1][i] = 0.5 * (patch00.color[1][0][i] +
-				      patch01.color[1][1][i]);
-      patch01.color[1][0][i] = patch00.color[1][1][i];
-      patch11.color[0][0][i] = patch00.color[1][1][i];
-      patch10.color[0][1][i] = patch00.color[1][1][i];
+  }
+  if (lut) {
+    lut->lookupN(ts, out, nColors);
+    delete lut;
+  } else {
+    FunctionLUT::transformFuncs(funcs, nFuncs, ts, out, nColors);
+  }
+
+  int nComps = splashColorModeNComps[mode];
+  for (int i = 0; i < nColors; ++i) {
+    GfxColor color;
+    for (int j = 0; j < gfxColorMaxComps; ++j) {
+      color.c[j] = j < nOut ? dblToCol(out[i * nOut + j]) : 0;
     }
-    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch00,
-	      shading, depth + 1);
-    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch10,
-	      shading, depth + 1);
-    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch01,
-	      shading, depth + 1);
-    fillPatch(state, splash, mode, reverseVideo, xMin, yMin, &patch11,
-	      shading, depth + 1);
+    computeShadingColor(state, mode, reverseVideo, &color,
+			sColors + i * nComps);
   }
+  gfree(out);
 }
 
 void ShadingImage::computeShadingColor(GfxState *state,
@@ -1238,46 +1867,8 @@ void ShadingImage::computeShadingColor(GfxState *state,
 				       GBool reverseVideo,
 				       GfxColor *color,
 				       SplashColorPtr sColor) {
-  GfxGray gray;
-  GfxRGB rgb;
-#if SPLASH_CMYK
-  GfxCMYK cmyk;
-#endif
-
-  state->setFillColor(color);
-  switch (mode) {
-  case splashModeMono8:
-    state->getFillGray(&gray);
-    if (reverseVideo) {
-      gray = gfxColorComp1 - gray;
-    }
-    sColor[0] = colToByte(gray);
-    break;
-  case splashModeRGB8:
-    state->getFillRGB(&rgb);
-    if (reverseVideo) {
-      rgb.r = gfxColorComp1 - rgb.r;
-      rgb.g = gfxColorComp1 - rgb.g;
-      rgb.b = gfxColorComp1 - rgb.b;
-    }
-    sColor[0] = colToByte(rgb.r);
-    sColor[1] = colToByte(rgb.g);
-    sColor[2] = colToByte(rgb.b);
-    break;
-#if SPLASH_CMYK
-  case splashModeCMYK8:
-    state->getFillCMYK(&cmyk);
-    sColor[0] = colToByte(cmyk.c);
-    sColor[1] = colToByte(cmyk.m);
-    sColor[2] = colToByte(cmyk.y);
-    sColor[3] = colToByte(cmyk.k);
-    break;
-#endif
-  case splashModeMono1:
-  case splashModeBGR8:
-    // mode cannot be Mono1 or BGR8
-    break;
-  }
+  convertShadingColor(state->getFillColorSpace(), state->getRenderingIntent(),
+		      mode, reverseVideo, color, sColor);
 }
 
 // Transform a user space bbox to a device space bbox.
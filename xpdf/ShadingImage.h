@@ -21,6 +21,7 @@
 
 class GfxState;
 class GfxShading;
+class Function;
 class SplashBitmap;
 class Splash;
 
@@ -77,7 +78,9 @@ private:
 				  double x0, double y0, double *color0,
 				  double x1, double y1, double *color1,
 				  double x2, double y2, double *color2,
-				  GfxGouraudTriangleShading *shading);
+				  GfxGouraudTriangleShading *shading,
+				  SplashColorPtr ramp,
+				  double rampTMin, double rampTMax);
   static SplashBitmap *generatePatchMeshBitmap(GfxState *state,
 					       GfxPatchMeshShading *shading,
 					       SplashColorMode mode,
@@ -90,7 +93,34 @@ private:
 			int xMin, int yMin,
 			GfxPatch *patch,
 			GfxPatchMeshShading *shading,
+			Function **funcs,
 			int depth);
+  static void fillPatchesThreaded(GfxState *state, Splash *splash,
+				  SplashColorMode mode, GBool reverseVideo,
+				  int xMin, int yMin,
+				  GfxPatchMeshShading *shading,
+				  int depth, int nThreads);
+  static void computeAxialT(double s, double t0, double t1,
+			    GBool ext0, GBool ext1,
+			    double *t, GBool *go);
+  static SplashColorPtr computeGouraudRamp(GfxState *state,
+					   SplashColorMode mode,
+					   GBool reverseVideo,
+					   Function **funcs, int nFuncs,
+					   double tMin, double tMax);
+  static void computeShadingRamp(GfxState *state,
+				 SplashColorMode mode,
+				 GBool reverseVideo,
+				 Function **funcs, int nFuncs,
+				 double t0, double t1, int nColors,
+				 SplashColorPtr sColors);
+  static void computeShadingColors(GfxState *state,
+				   SplashColorMode mode,
+				   GBool reverseVideo,
+				   Function **funcs, int nFuncs,
+				   double *ts, int nColors,
+				   GBool approx,
+				   SplashColorPtr sColors);
   static void computeShadingColor(GfxState *state,
 				  SplashColorMode mode,
 				  GBool reverseVideo,
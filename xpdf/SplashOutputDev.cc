@@ -17,10 +17,14 @@
 #include <limits.h>
 #include "gmempp.h"
 #include "gfile.h"
+#include "GList.h"
+#include "GHash.h"
 #include "Trace.h"
 #include "GlobalParams.h"
 #include "Error.h"
 #include "Object.h"
+#include "PDFDoc.h"
+#include "OptionalContent.h"
 #include "Gfx.h"
 #include "GfxFont.h"
 #include "ShadingImage.h"
@@ -32,6 +36,7 @@
 #include "FoFiTrueType.h"
 #include "FoFiType1C.h"
 #include "JPXStream.h"
+#include "Decrypt.h"
 #include "SplashBitmap.h"
 #include "SplashGlyphBitmap.h"
 #include "SplashPattern.h"
@@ -43,6 +48,7 @@
 #include "SplashFont.h"
 #include "SplashFontFile.h"
 #include "SplashFontFileID.h"
+#include "SplashFontFileCache.h"
 #include "Splash.h"
 #include "SplashOutputDev.h"
 
@@ -66,10 +72,12 @@ extern "C" int unlink(char *filename);
 
 //------------------------------------------------------------------------
 
-// Type 3 font cache size parameters
+// Type 3 font cache size parameters -- Type 3 fonts have at most 256
+// chars, so the max number of sets lets a font with small glyphs be
+// cached completely
 #define type3FontCacheAssoc   8
-#define type3FontCacheMaxSets 8
-#define type3FontCacheSize    (128*1024)
+#define type3FontCacheMaxSets 32
+#define type3FontCacheSize    (1024*1024)
 
 // Map StrokeAdjustMode (from GlobalParams) to SplashStrokeAdjustMode
 // (for Splash).
@@ -486,6 +494,54 @@ private:
   int substIdx;
 };
 
+//------------------------------------------------------------------------
+// shared font file cache
+//------------------------------------------------------------------------
+
+static SplashFontFileCache *makeSharedFontFileCache() {
+  int size;
+
+  if ((size = globalParams->getFontFileCacheSize()) <= 0) {
+    return NULL;
+  }
+  return new SplashFontFileCache((size_t)size << 20);
+}
+
+// Return the process-wide font file cache, which is shared by all
+// SplashOutputDev objects (in all threads), or NULL if it is disabled
+// (fontFileCacheSize = 0).  The cache is created on first use, and
+// is never freed.
+static SplashFontFileCache *getSharedFontFileCache() {
+  // initialization of a local static is thread-safe
+  static SplashFontFileCache *cache = makeSharedFontFileCache();
+
+  return cache;
+}
+
+// Make the font file cache key for an embedded font file, from the
+// MD5 digest of its contents.
+static GString *makeEmbFontFileCacheKey(MD5State *md5State) {
+  GString *key;
+  int i;
+
+  md5Finish(md5State);
+  key = new GString("emb:");
+  for (i = 0; i < 16; ++i) {
+    key->appendf("{0:02x}", md5State->digest[i]);
+  }
+  return key;
+}
+
+// Make the font file cache key for an external font file.  This
+// includes the substitution parameters, and the modification time (so
+// a modified font file won't be matched).
+static GString *makeExtFontFileCacheKey(GfxFontLoc *fontLoc) {
+  return GString::format("ext:{0:t}/{1:d}/{2:d}/{3:.4g}/{4:ld}",
+			 fontLoc->path, fontLoc->fontNum, fontLoc->substIdx,
+			 fontLoc->oblique,
+			 (long)getModTime(fontLoc->path->getCString()));
+}
+
 //------------------------------------------------------------------------
 // T3FontCache
 //------------------------------------------------------------------------
@@ -519,6 +575,8 @@ public:
   Guchar *cacheData;		// glyph pixmap cache
   T3FontCacheTag *cacheTags;	// cache tags, i.e., char codes
   int refCount;			// active reference count for this T3 font
+
+  size_t getSize() { return (size_t)cacheSets * cacheAssoc * glyphSize; }
 };
 
 T3FontCache::T3FontCache(Ref *fontIDA, double m11A, double m12A,
@@ -610,6 +668,220 @@ struct SplashTransparencyGroup {
   SplashTransparencyGroup *next;
 };
 
+//------------------------------------------------------------------------
+// SplashFormCache
+//------------------------------------------------------------------------
+
+// Forms are rasterized at this many sub-pixel positions (in each
+// direction).  A cached raster is reused for any translation with
+// the same (quantized) sub-pixel position.
+#define splashFormCachePhases 4
+
+// The position and transform of a rasterized form.  This is used
+// (as raw bytes, followed by a SplashCacheStateKey) for the cache key.
+struct SplashFormCacheKey {
+  int num, gen;			// form XObject ref
+  double mat[4];		// CTM, without the translation
+  int phaseX, phaseY;		// quantized sub-pixel translation
+  int x, y, w, h;		// raster rectangle, relative to the
+				//   integer part of the translation
+};
+
+// The position and transform of a rasterized tiling pattern cell
+// (followed by a SplashCacheStateKey in the cache key).  The cell
+// bitmap is independent of where the pattern is drawn, since the
+// tiles are placed at integer pixel positions.
+struct SplashPatternCacheKey {
+  int num, gen;			// pattern content stream ref
+  double mat[6];		// pattern space -> cell bitmap transform
+  int w, h;			// cell bitmap size
+};
+
+// Everything else, other than the content stream itself, which
+// affects a rasterized form or pattern cell.
+struct SplashCacheStateKey {
+  //----- graphics state inherited by the content stream
+  int fillCSMode, strokeCSMode;
+  GfxColor fillColor, strokeColor;
+  double lineWidth, miterLimit, flatness;
+  int lineCap, lineJoin, strokeAdjust;
+  int fontNum, fontGen;
+  double fontSize, charSpace, wordSpace, horizScaling, leading, rise;
+  int render, renderingIntent;
+  //----- output device state
+  int vectorAntialias, reverseVideo, skipHorizText, skipRotatedText;
+};
+
+class SplashFormCacheEntry {
+public:
+
+  SplashFormCacheEntry(GString *keyA, SplashBitmap *bitmapA);
+  ~SplashFormCacheEntry();
+
+  GString *key;
+  SplashBitmap *bitmap;		// rasterized form, or NULL if the form
+				//   can't be cached
+  int modXMin, modYMin,		// modified region in bitmap
+      modXMax, modYMax;
+  size_t size;			// memory used by this entry
+  SplashFormCacheEntry *prev, *next;	// LRU list
+};
+
+SplashFormCacheEntry::SplashFormCacheEntry(GString *keyA,
+					   SplashBitmap *bitmapA) {
+  key = keyA;
+  bitmap = bitmapA;
+  modXMin = modYMin = 0;
+  modXMax = modYMax = -1;
+  size = sizeof(SplashFormCacheEntry) + key->getLength();
+  if (bitmap) {
+    size += (size_t)bitmap->getHeight() *
+	    ((bitmap->getRowSize() < 0 ? -bitmap->getRowSize()
+	                               : bitmap->getRowSize()) +
+	     bitmap->getAlphaRowSize());
+  }
+  prev = next = NULL;
+}
+
+SplashFormCacheEntry::~SplashFormCacheEntry() {
+  delete key;
+  if (bitmap) {
+    delete bitmap;
+  }
+}
+
+// Cache of rasterized forms (or tiling pattern cells), keyed by
+// SplashFormCacheKey (or SplashPatternCacheKey).  The least recently
+// used entries are discarded when the total size exceeds the limit.
+class SplashFormCache {
+public:
+
+  SplashFormCache(size_t maxSizeA);
+  ~SplashFormCache();
+
+  // Find the entry for [key], and make it the most recently used
+  // entry.  Returns NULL if there is no such entry.
+  SplashFormCacheEntry *lookup(GString *key);
+
+  // Add an entry, discarding old entries as needed.  Returns true if
+  // the cache took ownership of [entry].  If there is already an
+  // entry with the same key, this returns false, and the caller still
+  // owns [entry].
+  GBool add(SplashFormCacheEntry *entry);
+
+  // Discard all entries.
+  void flush();
+
+  size_t getMaxSize() { return maxSize; }
+  int getNumEvictions() { return nEvictions; }
+
+private:
+
+  void unlink(SplashFormCacheEntry *entry);
+  void linkMRU(SplashFormCacheEntry *entry);
+
+  GHash *entries;		// [SplashFormCacheEntry], indexed by key
+  SplashFormCacheEntry *mru;	// most recently used entry
+  SplashFormCacheEntry *lru;	// least recently used entry
+  size_t size;			// total size of the entries
+  size_t maxSize;
+  int nEvictions;
+};
+
+SplashFormCache::SplashFormCache(size_t maxSizeA) {
+  entries = new GHash();
+  mru = lru = NULL;
+  size = 0;
+  maxSize = maxSizeA;
+  nEvictions = 0;
+}
+
+SplashFormCache::~SplashFormCache() {
+  flush();
+  delete entries;
+}
+
+void SplashFormCache::flush() {
+  SplashFormCacheEntry *entry;
+
+  while ((entry = mru)) {
+    mru = entry->next;
+    entries->remove(entry->key);
+    delete entry;
+  }
+  lru = NULL;
+  size = 0;
+}
+
+SplashFormCacheEntry *SplashFormCache::lookup(GString *key) {
+  SplashFormCacheEntry *entry;
+
+  if ((entry = (SplashFormCacheEntry *)entries->lookup(key))) {
+    unlink(entry);
+    linkMRU(entry);
+  }
+  return entry;
+}
+
+GBool SplashFormCache::add(SplashFormCacheEntry *entry) {
+  SplashFormCacheEntry *oldEntry;
+
+  if (entries->lookup(entry->key)) {
+    return gFalse;
+  }
+  entries->add(entry->key, entry);
+  linkMRU(entry);
+  size += entry->size;
+  while (size > maxSize && lru != mru) {
+    oldEntry = lru;
+    unlink(oldEntry);
+    entries->remove(oldEntry->key);
+    size -= oldEntry->size;
+    delete oldEntry;
+    ++nEvictions;
+  }
+  return gTrue;
+}
+
+void SplashFormCache::unlink(SplashFormCacheEntry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    mru = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    lru = entry->prev;
+  }
+  entry->prev = entry->next = NULL;
+}
+
+void SplashFormCache::linkMRU(SplashFormCacheEntry *entry) {
+  entry->prev = NULL;
+  entry->next = mru;
+  if (mru) {
+    mru->prev = entry;
+  } else {
+    lru = entry;
+  }
+  mru = entry;
+}
+
+// A form being rasterized into the cache.
+struct SplashFormCacheFill {
+  GString *key;
+  int tx, ty;			// position of the raster
+  GBool ok;			// cleared if the form uses something
+				//   which can't be cached
+
+  //----- saved state
+  SplashBitmap *origBitmap;
+  Splash *origSplash;
+
+  SplashFormCacheFill *next;
+};
+
 //------------------------------------------------------------------------
 // SplashOutputDev
 //------------------------------------------------------------------------
@@ -637,27 +909,54 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
 
   xref = NULL;
 
+  imageCache = new SplashImageCache(
+		     (size_t)globalParams->getImageCacheSize() << 20);
+
   bitmap = new SplashBitmap(1, 1, bitmapRowPad, colorMode,
 			    colorMode != splashModeMono1, bitmapTopDown, NULL);
-  splash = new Splash(bitmap, vectorAntialias, NULL, &screenParams);
+  splash = new Splash(bitmap, vectorAntialias, imageCache, &screenParams);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
   splash->setStrokeAdjust(
 		 mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
   splash->setEnablePathSimplification(
 		 globalParams->getEnablePathSimplification());
+  splash->setImageScalingThreads(globalParams->getImageScalingThreads());
   splash->clear(paperColor, 0);
 
   fontEngine = NULL;
 
-  nT3Fonts = 0;
+  t3FontCache = new GList();
+  t3FontCacheSize = 0;
+  t3FontCacheMaxSize = (size_t)globalParams->getType3CacheSize() << 20;
+  nT3CacheHits = nT3CacheMisses = 0;
+  nT3CacheGlyphEvictions = nT3CacheFontEvictions = 0;
   t3GlyphStack = NULL;
 
   font = NULL;
   needFontUpdate = gFalse;
   textClipPath = NULL;
+  glyphRunXY = NULL;
+  glyphRunCodes = NULL;
+  glyphRunSize = 0;
 
   transpGroupStack = NULL;
 
+  if (globalParams->getFormCacheSize() > 0) {
+    formCache = new SplashFormCache(
+		      (size_t)globalParams->getFormCacheSize() << 20);
+  } else {
+    formCache = NULL;
+  }
+  formCacheFillStack = NULL;
+  nFormCacheHits = nFormCacheMisses = 0;
+  if (globalParams->getPatternCacheSize() > 0) {
+    patternCache = new SplashFormCache(
+		      (size_t)globalParams->getPatternCacheSize() << 20);
+  } else {
+    patternCache = NULL;
+  }
+  nPatternCacheHits = nPatternCacheMisses = 0;
+
   nestCount = 0;
 
   startPageCbk = NULL;
@@ -717,10 +1016,12 @@ void SplashOutputDev::setupScreenParams(double hDPI, double vDPI) {
 }
 
 SplashOutputDev::~SplashOutputDev() {
-  int i;
-
-  for (i = 0; i < nT3Fonts; ++i) {
-    delete t3FontCache[i];
+  deleteGList(t3FontCache, T3FontCache);
+  if (formCache) {
+    delete formCache;
+  }
+  if (patternCache) {
+    delete patternCache;
   }
   if (fontEngine) {
     delete fontEngine;
@@ -731,13 +1032,16 @@ SplashOutputDev::~SplashOutputDev() {
   if (bitmap) {
     delete bitmap;
   }
+  imageCache->decRefCount();
   if (textClipPath) {
     delete textClipPath;
   }
+  gfree(glyphRunXY);
+  gfree(glyphRunCodes);
 }
 
 void SplashOutputDev::startDoc(XRef *xrefA) {
-  int i;
+  int glyphCacheSize;
 
   xref = xrefA;
   if (fontEngine) {
@@ -752,10 +1056,30 @@ void SplashOutputDev::startDoc(XRef *xrefA) {
 				    allowAntialias &&
 				      globalParams->getAntialias() &&
 				      colorMode != splashModeMono1);
-  for (i = 0; i < nT3Fonts; ++i) {
-    delete t3FontCache[i];
-  }
-  nT3Fonts = 0;
+  fontEngine->setFontFileCache(getSharedFontFileCache());
+  glyphCacheSize = globalParams->getGlyphCacheSize();
+  if (glyphCacheSize < 0) {
+    glyphCacheSize = 0;
+  } else if (glyphCacheSize > 1024 * 1024) {
+    glyphCacheSize = 1024 * 1024;
+  }
+  fontEngine->setGlyphCacheSize(glyphCacheSize << 10);
+  deleteGList(t3FontCache, T3FontCache);
+  t3FontCache = new GList();
+  t3FontCacheSize = 0;
+  if (formCache) {
+    formCache->flush();
+  }
+  if (patternCache) {
+    patternCache->flush();
+  }
+  imageCache->flush();
+}
+
+void SplashOutputDev::setImageCache(SplashImageCache *imageCacheA) {
+  imageCacheA->incRefCount();
+  imageCache->decRefCount();
+  imageCache = imageCacheA;
 }
 
 void SplashOutputDev::startPage(int pageNum, GfxState *state) {
@@ -791,10 +1115,11 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state) {
 			      colorMode != splashModeMono1, bitmapTopDown,
 			      NULL);
   }
-  splash = new Splash(bitmap, vectorAntialias, NULL, &screenParams);
+  splash = new Splash(bitmap, vectorAntialias, imageCache, &screenParams);
   splash->setMinLineWidth(globalParams->getMinLineWidth());
   splash->setEnablePathSimplification(
 		 globalParams->getEnablePathSimplification());
+  splash->setImageScalingThreads(globalParams->getImageScalingThreads());
   if (state) {
     ctm = state->getCTM();
     mat[0] = (SplashCoord)ctm[0];
@@ -1106,6 +1431,9 @@ void SplashOutputDev::setOverprintMask(GfxState *state,
 
 void SplashOutputDev::updateBlendMode(GfxState *state) {
   splash->setBlendFunc(splashOutBlendFuncs[state->getBlendMode()]);
+  if (state->getBlendMode() != gfxBlendNormal) {
+    setFormCacheUnsafe();
+  }
 }
 
 void SplashOutputDev::updateFillOpacity(GfxState *state) {
@@ -1183,12 +1511,15 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
   Object refObj, strObj;
 #if LOAD_FONTS_FROM_MEM
   GString *fontBuf;
-  FILE *extFontFile;
 #else
   GString *tmpFileName, *fileName;
   FILE *tmpFile;
 #endif
+  FILE *extFontFile;
   char blk[4096];
+  MD5State md5State;
+  GBool shareFontFile;
+  int fontFileSize;
   int *codeToGID;
   CharCodeToUnicode *ctu;
   double *textMat;
@@ -1239,6 +1570,8 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
   } else {
 
     fontNum = 0;
+    shareFontFile = getSharedFontFileCache() != NULL;
+    fontFileSize = 0;
 
     if (!(fontLoc = gfxFont->locateFont(xref, gFalse))) {
       error(errSyntaxError, -1, "Couldn't find a font for '{0:s}'",
@@ -1262,8 +1595,15 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
 	goto err2;
       }
       strObj.streamReset();
+      if (shareFontFile) {
+	md5Start(&md5State);
+      }
       while ((n = strObj.streamGetBlock(blk, sizeof(blk))) > 0) {
 	fontBuf->append(blk, n);
+	if (shareFontFile) {
+	  md5Append(&md5State, (Guchar *)blk, n);
+	}
+	fontFileSize += n;
       }
       strObj.streamClose();
       strObj.free();
@@ -1284,14 +1624,24 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
 	goto err2;
       }
       strObj.streamReset();
+      if (shareFontFile) {
+	md5Start(&md5State);
+      }
       while ((n = strObj.streamGetBlock(blk, sizeof(blk))) > 0) {
 	fwrite(blk, 1, n, tmpFile);
+	if (shareFontFile) {
+	  md5Append(&md5State, (Guchar *)blk, n);
+	}
+	fontFileSize += n;
       }
       strObj.streamClose();
       strObj.free();
       fclose(tmpFile);
       fileName = tmpFileName;
 #endif
+      if (shareFontFile) {
+	id->setCacheKey(makeEmbFontFileCacheKey(&md5State), fontFileSize);
+      }
 
     // external font
     } else { // gfxFontLocExternal
@@ -1307,9 +1657,19 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
 	fontBuf->append(blk, n);
       }
       fclose(extFontFile);
+      fontFileSize = fontBuf->getLength();
 #else
       fileName = fontLoc->path;
+      if (shareFontFile && (extFontFile = openFile(fileName->getCString(),
+						   "rb"))) {
+	gfseek(extFontFile, 0, SEEK_END);
+	fontFileSize = (int)gftell(extFontFile);
+	fclose(extFontFile);
+      }
 #endif
+      if (shareFontFile) {
+	id->setCacheKey(makeExtFontFileCacheKey(fontLoc), fontFileSize);
+      }
       fontNum = fontLoc->fontNum;
       if (fontLoc->substIdx >= 0) {
 	id->setSubstIdx(fontLoc->substIdx);
@@ -1760,8 +2120,11 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
 					double xStep, double yStep) {
   SplashBitmap *origBitmap, *tileBitmap;
   Splash *origSplash;
+  SplashFormCacheEntry *entry;
+  GString *key;
   SplashColor color;
   Guint *overprintMaskBitmap;
+  GfxColorSpaceMode fillMode, strokeMode;
   double *ctm;
   double ictm[6], tileMat[6], mat1[6], mat2[6];
   double tileXMin, tileYMin, tileXMax, tileYMax;
@@ -1772,6 +2135,7 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
   double tx, ty, idet, txMin, tyMin, txMax, tyMax;
   int tileW, tileH, tileSize;
   int ixMin, ixMax, iyMin, iyMax, ix, iy, x, y;
+  GBool reducedTile, overprintPreview, cacheable, cached, tiled;
   int i;
 
   // Notes:
@@ -1963,6 +2327,7 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
   iyMax = (int)floor(tyMax) + 1;
 
   // special case: pattern tile is larger than clipping bbox
+  reducedTile = gFalse;
   if (ixMax - ixMin == 1 && iyMax - iyMin == 1) {
     // reduce the tile size to just the clipping bbox -- this improves
     // performance in cases where just a small portion of one tile is
@@ -1983,6 +2348,7 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
     iyMax = 1;
     adjXMin = clipXMin;
     adjYMin = clipYMin;
+    reducedTile = gTrue;
   }
 
   // compute tile matrix = PTM * BTM * Mtranslate * Mscale * iCTM
@@ -2017,60 +2383,125 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
   tileMat[4] = mat2[4] * ictm[0] + mat2[5] * ictm[2] + ictm[4];
   tileMat[5] = mat2[4] * ictm[1] + mat2[5] * ictm[3] + ictm[5];
 
-  // create a temporary bitmap
-  origBitmap = bitmap;
-  origSplash = splash;
-  traceMessage("tiling pattern bitmap");
-  bitmap = tileBitmap = new SplashBitmap(tileW, tileH, bitmapRowPad,
-					 colorMode, gTrue, bitmapTopDown,
-					 origBitmap);
-  splash = new Splash(bitmap, vectorAntialias,
-		      origSplash->getImageCache(), origSplash->getScreen());
-  for (i = 0; i < splashMaxColorComps; ++i) {
-    color[i] = 0;
-  }
-  splash->clear(color);
 #if SPLASH_CMYK
-  // if we're doing overprint preview, we need to track the overprint
-  // mask at each pixel in the tile bitmap
-  if (globalParams->getOverprintPreview() &&
-      colorMode == splashModeCMYK8) {
-    overprintMaskBitmap = (Guint *)gmallocn(tileH, tileW * (int)sizeof(Guint));
-    memset(overprintMaskBitmap, 0, tileH * tileW * sizeof(Guint));
-    splash->setOverprintMaskBitmap(overprintMaskBitmap);
-  } else {
-    overprintMaskBitmap = NULL;
-  }
-#else // SPLASH_CMYK
-  overprintMaskBitmap = NULL;
-#endif // SPLASH_CMYK
-  splash->setMinLineWidth(globalParams->getMinLineWidth());
-  splash->setStrokeAdjust(
-		 mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
-  splash->setEnablePathSimplification(
-		 globalParams->getEnablePathSimplification());
-  ++nestCount;
-
-  // copy the fill color (for uncolored tiling patterns)
-  // (and stroke color, to handle buggy PDF files)
-  // -- Acrobat apparently doesn't copy the full state here
-  splash->setFillPattern(origSplash->getFillPattern()->copy());
-  splash->setStrokePattern(origSplash->getStrokePattern()->copy());
+  overprintPreview = globalParams->getOverprintPreview() &&
+                     colorMode == splashModeCMYK8;
+#else
+  overprintPreview = gFalse;
+#endif
 
-  // reset the clip rectangle
-  state->resetDevClipRect(0, 0, tileW, tileH);
+  // check the pattern cell cache -- the cell bitmap depends only on
+  // the key, except for a tile which has been reduced to the clipping
+  // bbox, and with overprint preview (which needs the overprint mask
+  // for each pixel); the fill/stroke colors are only meaningful as
+  // part of the key with device color spaces
+  fillMode = state->getFillColorSpace()->getMode();
+  strokeMode = state->getStrokeColorSpace()->getMode();
+  cacheable = patternCache &&
+              strRef->isRef() &&
+              !reducedTile &&
+              !overprintPreview &&
+              !t3GlyphStack &&
+              (fillMode == csDeviceGray ||
+	       fillMode == csDeviceRGB ||
+	       fillMode == csDeviceCMYK) &&
+              (strokeMode == csDeviceGray ||
+	       strokeMode == csDeviceRGB ||
+	       strokeMode == csDeviceCMYK) &&
+              (double)tileW * (double)tileH *
+	        (splashColorModeNComps[colorMode] + 1)
+	        <= (double)(patternCache->getMaxSize() / 4);
+  key = NULL;
+  tileBitmap = NULL;
+  cached = gFalse;
+  overprintMaskBitmap = NULL;
+  if (cacheable) {
+    key = makePatternCacheKey(state, gfx, strRef->getRef(), mat2,
+			      tileW, tileH);
+    if ((entry = patternCache->lookup(key))) {
+      tileBitmap = entry->bitmap;
+      cached = gTrue;
+      delete key;
+      key = NULL;
+      ++nPatternCacheHits;
+    } else {
+      ++nPatternCacheMisses;
+    }
+  }
 
-  // render the tile
-  gfx->drawForm(strRef, resDict, tileMat, bbox);
+  if (!tileBitmap) {
 
-  // restore the original bitmap
-  --nestCount;
-  delete splash;
-  bitmap = origBitmap;
-  splash = origSplash;
+    // create a temporary bitmap -- if it's going into the cache, it
+    // doesn't use origBitmap as the parent, because it may outlive it
+    origBitmap = bitmap;
+    origSplash = splash;
+    traceMessage("tiling pattern bitmap");
+    bitmap = tileBitmap = new SplashBitmap(tileW, tileH, bitmapRowPad,
+					   colorMode, gTrue, bitmapTopDown,
+					   key ? (SplashBitmap *)NULL
+					       : origBitmap);
+    splash = new Splash(bitmap, vectorAntialias,
+			origSplash->getImageCache(), origSplash->getScreen());
+    for (i = 0; i < splashMaxColorComps; ++i) {
+      color[i] = 0;
+    }
+    splash->clear(color);
+    // if we're doing overprint preview, we need to track the overprint
+    // mask at each pixel in the tile bitmap
+    if (overprintPreview) {
+      overprintMaskBitmap = (Guint *)gmallocn(tileH,
+					      tileW * (int)sizeof(Guint));
+      memset(overprintMaskBitmap, 0, tileH * tileW * sizeof(Guint));
+      splash->setOverprintMaskBitmap(overprintMaskBitmap);
+    }
+    splash->setMinLineWidth(globalParams->getMinLineWidth());
+    splash->setStrokeAdjust(
+		   mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
+    splash->setEnablePathSimplification(
+		   globalParams->getEnablePathSimplification());
+    splash->setImageScalingThreads(globalParams->getImageScalingThreads());
+    ++nestCount;
+
+    // copy the fill color (for uncolored tiling patterns)
+    // (and stroke color, to handle buggy PDF files)
+    // -- Acrobat apparently doesn't copy the full state here
+    splash->setFillPattern(origSplash->getFillPattern()->copy());
+    splash->setStrokePattern(origSplash->getStrokePattern()->copy());
+
+    // reset the clip rectangle
+    state->resetDevClipRect(0, 0, tileW, tileH);
+
+    // render the tile
+    gfx->drawForm(strRef, resDict, tileMat, bbox);
+
+    // restore the original bitmap
+    --nestCount;
+    delete splash;
+    bitmap = origBitmap;
+    splash = origSplash;
+
+    // add the tile to the cache (unless rendering was aborted, in
+    // which case the tile may be incomplete) -- if it was added, the
+    // cache now owns the tile bitmap
+    if (key) {
+      if (gfx->checkForAbort()) {
+	delete key;
+      } else {
+	entry = new SplashFormCacheEntry(key, tileBitmap);
+	if (patternCache->add(entry)) {
+	  cached = gTrue;
+	} else {
+	  entry->bitmap = NULL;
+	  delete entry;
+	}
+      }
+    }
+  }
   splash->setOverprintMask(0xffffffff);
 
-  // draw the tiles
+  // draw the tiles -- if the tiles are on an integer pixel grid, and
+  // don't overlap, entire scan lines are handled at once
+  tiled = colorMode != splashModeMono1 && !overprintMaskBitmap;
   if (tileW == 1 && tileH == 1 &&
       fabs(xStepX * yStepY - xStepY * yStepX) < 0.9) {
     // if the tile is 1x1 pixel, and the stepping completely fills the
@@ -2082,12 +2513,29 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
     ixMax = (int)floor(clipXMax) + 1;
     iyMin = (int)floor(clipYMin);
     iyMax = (int)floor(clipYMax) + 1;
-    for (iy = iyMin; iy < iyMax; ++iy) {
-      for (ix = ixMin; ix < ixMax; ++ix) {
-	splash->composite(tileBitmap, 0, 0, ix, iy, tileW, tileH,
-			  gFalse, gFalse);
+    if (tiled) {
+      splash->compositeTiled(tileBitmap, ixMin, iyMin, 1, 1,
+			     ixMax - ixMin, iyMax - iyMin);
+    } else {
+      for (iy = iyMin; iy < iyMax; ++iy) {
+	for (ix = ixMin; ix < ixMax; ++ix) {
+	  splash->composite(tileBitmap, 0, 0, ix, iy, tileW, tileH,
+			    gFalse, gFalse);
+	}
       }
     }
+  } else if (tiled &&
+	     xStepY == 0 && yStepX == 0 &&
+	     adjXMin == floor(adjXMin) && adjYMin == floor(adjYMin) &&
+	     xStepX == floor(xStepX) && yStepY == floor(yStepY) &&
+	     fabs(xStepX) >= tileW && fabs(yStepY) >= tileH) {
+    // the tiles don't overlap, so the order doesn't matter -- go
+    // left-to-right and top-to-bottom
+    x = (int)adjXMin + (int)xStepX * (xStepX > 0 ? ixMin : ixMax - 1);
+    y = (int)adjYMin + (int)yStepY * (yStepY > 0 ? iyMin : iyMax - 1);
+    splash->compositeTiled(tileBitmap, x, y,
+			   (int)fabs(xStepX), (int)fabs(yStepY),
+			   ixMax - ixMin, iyMax - iyMin);
   } else {
     for (iy = iyMin; iy < iyMax; ++iy) {
       for (ix = ixMin; ix < ixMax; ++ix) {
@@ -2106,7 +2554,9 @@ void SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx,
   }
 
   gfree(overprintMaskBitmap);
-  delete tileBitmap;
+  if (!cached) {
+    delete tileBitmap;
+  }
 }
 
 GBool SplashOutputDev::shadedFill(GfxState *state, GfxShading *shading) {
@@ -2324,6 +2774,64 @@ void SplashOutputDev::drawChar(GfxState *state, double x, double y,
   }
 }
 
+// Filled text (the common case) is drawn with a single call to
+// Splash::fillChars, which sets up the compositing pipeline once for
+// the whole run.  Anything else (stroked text, clipping text) is
+// handled one char at a time by drawChar.
+void SplashOutputDev::drawGlyphRun(GfxState *state, GlyphRun *run) {
+  GlyphRunChar *ch;
+  double m[4];
+  GBool horiz;
+  int render, n, i;
+
+  render = state->getRender();
+  if (render != 0) {
+    if (render != 3) {
+      OutputDev::drawGlyphRun(state, run);
+    }
+    return;
+  }
+
+  if (skipHorizText || skipRotatedText) {
+    state->getFontTransMat(&m[0], &m[1], &m[2], &m[3]);
+    // this matches the 'diagonal' test in TextPage::updateFont()
+    horiz = m[0] > 0 && fabs(m[1]) < 0.001 &&
+            fabs(m[2]) < 0.001 && m[3] < 0;
+    if ((skipHorizText && horiz) || (skipRotatedText && !horiz)) {
+      return;
+    }
+  }
+
+  if (needFontUpdate) {
+    doUpdateFont(state);
+  }
+  if (!font) {
+    return;
+  }
+  if (state->getFillColorSpace()->isNonMarking()) {
+    return;
+  }
+
+  n = run->getLength();
+  if (n > glyphRunSize) {
+    glyphRunSize = n;
+    glyphRunXY = (SplashCoord *)greallocn(glyphRunXY, 2 * glyphRunSize,
+					  sizeof(SplashCoord));
+    glyphRunCodes = (int *)greallocn(glyphRunCodes, glyphRunSize,
+				     sizeof(int));
+  }
+  for (i = 0; i < n; ++i) {
+    ch = run->getChar(i);
+    glyphRunXY[2*i] = (SplashCoord)(ch->x - ch->originX);
+    glyphRunXY[2*i+1] = (SplashCoord)(ch->y - ch->originY);
+    glyphRunCodes[i] = (int)ch->code;
+  }
+  setOverprintMask(state, state->getFillColorSpace(),
+		   state->getFillOverprint(), state->getOverprintMode(),
+		   state->getFillColor());
+  splash->fillChars(glyphRunXY, glyphRunCodes, n, font);
+}
+
 GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
 				      double dx, double dy,
 				      CharCode code, Unicode *u, int uLen) {
@@ -2361,44 +2869,22 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
   state->transform(0, 0, &xt, &yt);
 
   // is it the first (MRU) font in the cache?
-  if (!(nT3Fonts > 0 &&
-	t3FontCache[0]->matches(fontID, ctm[0], ctm[1], ctm[2], ctm[3]))) {
+  if (!(t3FontCache->getLength() > 0 &&
+	((T3FontCache *)t3FontCache->get(0))->matches(fontID, ctm[0], ctm[1],
+						       ctm[2], ctm[3]))) {
 
     // is the font elsewhere in the cache?
-    for (i = 1; i < nT3Fonts; ++i) {
-      if (t3FontCache[i]->matches(fontID, ctm[0], ctm[1], ctm[2], ctm[3])) {
-	t3Font = t3FontCache[i];
-	for (j = i; j > 0; --j) {
-	  t3FontCache[j] = t3FontCache[j - 1];
-	}
-	t3FontCache[0] = t3Font;
+    for (i = 1; i < t3FontCache->getLength(); ++i) {
+      t3Font = (T3FontCache *)t3FontCache->get(i);
+      if (t3Font->matches(fontID, ctm[0], ctm[1], ctm[2], ctm[3])) {
+	t3FontCache->del(i);
+	t3FontCache->insert(0, t3Font);
 	break;
       }
     }
-    if (i >= nT3Fonts) {
+    if (i >= t3FontCache->getLength()) {
 
       // create new entry in the font cache
-      if (nT3Fonts < splashOutT3FontCacheSize) {
-	for (j = nT3Fonts; j > 0; --j) {
-	  t3FontCache[j] = t3FontCache[j - 1];
-	}
-      } else {
-	for (j = nT3Fonts - 1; j >= 0; --j) {
-	  if (t3FontCache[j]->refCount == 0) {
-	    break;
-	  }
-	}
-	if (j < 0) {
-	  error(errSyntaxError, -1, "Type 3 fonts nested too deeply");
-	  return gTrue;
-	}
-	delete t3FontCache[j];
-	--nT3Fonts;
-	for (; j > 0; --j) {
-	  t3FontCache[j] = t3FontCache[j - 1];
-	}
-      }
-      ++nT3Fonts;
       bbox = gfxFont->getFontBBox();
       if (bbox[0] == 0 && bbox[1] == 0 && bbox[2] == 0 && bbox[3] == 0) {
 	// unspecified bounding box -- just take a guess
@@ -2446,16 +2932,19 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
 	}
 	validBBox = gTrue;
       }
-      t3FontCache[0] = new T3FontCache(fontID, ctm[0], ctm[1], ctm[2], ctm[3],
-	                               (int)floor(xMin - xt) - 2,
-				       (int)floor(yMin - yt) - 2,
-				       (int)ceil(xMax) - (int)floor(xMin) + 4,
-				       (int)ceil(yMax) - (int)floor(yMin) + 4,
-				       validBBox,
-				       colorMode != splashModeMono1);
+      t3Font = new T3FontCache(fontID, ctm[0], ctm[1], ctm[2], ctm[3],
+			       (int)floor(xMin - xt) - 2,
+			       (int)floor(yMin - yt) - 2,
+			       (int)ceil(xMax) - (int)floor(xMin) + 4,
+			       (int)ceil(yMax) - (int)floor(yMin) + 4,
+			       validBBox,
+			       colorMode != splashModeMono1);
+      t3FontCache->insert(0, t3Font);
+      t3FontCacheSize += t3Font->getSize();
+      shrinkType3FontCache();
     }
   }
-  t3Font = t3FontCache[0];
+  t3Font = (T3FontCache *)t3FontCache->get(0);
 
   // is the glyph in the cache?
   i = (code & (t3Font->cacheSets - 1)) * t3Font->cacheAssoc;
@@ -2464,9 +2953,11 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
 	t3Font->cacheTags[i+j].code == code) {
       drawType3Glyph(state, t3Font, &t3Font->cacheTags[i+j],
 		     t3Font->cacheData + (i+j) * t3Font->glyphSize);
+      ++nT3CacheHits;
       return gTrue;
     }
   }
+  ++nT3CacheMisses;
 
   if (t3Font->refCount > 1000) {
     error(errSyntaxError, -1, "Type 3 CharProcs nested too deeply");
@@ -2492,6 +2983,26 @@ GBool SplashOutputDev::beginType3Char(GfxState *state, double x, double y,
   return gFalse;
 }
 
+// Remove least recently used Type 3 fonts until the cache is under
+// the size limit.  The MRU font, and fonts which are in use by a
+// (possibly nested) CharProc, are never removed.
+void SplashOutputDev::shrinkType3FontCache() {
+  T3FontCache *t3Font;
+  int i;
+
+  for (i = t3FontCache->getLength() - 1;
+       i > 0 && t3FontCacheSize > t3FontCacheMaxSize;
+       --i) {
+    t3Font = (T3FontCache *)t3FontCache->get(i);
+    if (t3Font->refCount == 0) {
+      t3FontCache->del(i);
+      t3FontCacheSize -= t3Font->getSize();
+      delete t3Font;
+      ++nT3CacheFontEvictions;
+    }
+  }
+}
+
 void SplashOutputDev::endType3Char(GfxState *state) {
   T3GlyphStack *t3gs;
   double *ctm;
@@ -2608,6 +3119,9 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy,
   i = (t3GlyphStack->code & (t3Font->cacheSets - 1)) * t3Font->cacheAssoc;
   for (j = 0; j < t3Font->cacheAssoc; ++j) {
     if ((t3Font->cacheTags[i+j].mru & 0x7fff) == t3Font->cacheAssoc - 1) {
+      if (t3Font->cacheTags[i+j].mru & 0x8000) {
+	++nT3CacheGlyphEvictions;
+      }
       t3Font->cacheTags[i+j].mru = 0x8000;
       t3Font->cacheTags[i+j].code = t3GlyphStack->code;
       t3GlyphStack->cacheTag = &t3Font->cacheTags[i+j];
@@ -2774,6 +3288,9 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   SplashColor maskColor;
   GString *imgTag;
 
+  // the soft mask is in device space, so it can't be cached
+  setFormCacheUnsafe();
+
   ctm = state->getCTM();
   mat[0] = ctm[0];
   mat[1] = ctm[1];
@@ -2796,6 +3313,8 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
 		     mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
   maskSplash->setEnablePathSimplification(
 		     globalParams->getEnablePathSimplification());
+  maskSplash->setImageScalingThreads(
+		     globalParams->getImageScalingThreads());
   if (splash->getSoftMask()) {
     maskSplash->setSoftMask(splash->getSoftMask(), gFalse);
   }
@@ -3295,6 +3814,8 @@ void SplashOutputDev::drawMaskedImage(GfxState *state, Object *ref,
 		       mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
     maskSplash->setEnablePathSimplification(
 		       globalParams->getEnablePathSimplification());
+    maskSplash->setImageScalingThreads(
+		       globalParams->getImageScalingThreads());
     maskColor[0] = 0;
     maskSplash->clear(maskColor);
     maskColor[0] = 0xff;
@@ -3655,6 +4176,8 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
 		       mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
     maskSplash->setEnablePathSimplification(
 		       globalParams->getEnablePathSimplification());
+    maskSplash->setImageScalingThreads(
+		       globalParams->getImageScalingThreads());
     clearMaskRegion(state, maskSplash, 0, 0, 1, 1);
     maskSplash->drawImage(NULL,
 			  &imageSrc, &imgMaskData, splashModeMono8, gFalse,
@@ -3749,8 +4272,11 @@ GString *SplashOutputDev::makeImageTag(Object *ref, GfxRenderingIntent ri,
       (colorSpace && colorSpace->isDefaultColorSpace())) {
     return NULL;
   }
-  return GString::format("{0:d}_{1:d}_{2:d}",
-			 ref->getRefNum(), ref->getRefGen(), (int)ri);
+  // the tag also records whether images are being inverted (in
+  // reverse video mode), because cached images are kept across pages
+  return GString::format("{0:d}_{1:d}_{2:d}_{3:d}",
+			 ref->getRefNum(), ref->getRefGen(), (int)ri,
+			 (reverseVideo && reverseVideoInvertImages) ? 1 : 0);
 }
 
 void SplashOutputDev::reduceImageResolution(Stream *str, double *ctm,
@@ -3847,15 +4373,12 @@ void SplashOutputDev::clearMaskRegion(GfxState *state,
   }
 }
 
-GBool SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
-					      GfxColorSpace *blendingColorSpace,
-					      GBool isolated, GBool knockout,
-					      GBool forSoftMask) {
-  SplashTransparencyGroup *transpGroup;
-  SplashBitmap *backdropBitmap;
-  SplashColor color;
+// Compute the device space rectangle (in integer coords) covered by
+// <bbox>, intersected with the clip region and the bitmap.
+void SplashOutputDev::getGroupRect(GfxState *state, double *bbox,
+				   int *tx, int *ty, int *w, int *h) {
   double xMin, yMin, xMax, yMax, x, y;
-  int bw, bh, tx, ty, w, h, i;
+  int bw, bh;
 
   // transform the bbox
   state->transform(bbox[0], bbox[1], &x, &y);
@@ -3916,35 +4439,53 @@ GBool SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
   // convert box coords to integers
   bw = bitmap->getWidth();
   bh = bitmap->getHeight();
-  tx = (int)floor(xMin);
-  if (tx < 0) {
-    tx = 0;
-  } else if (tx >= bw) {
-    tx = bw - 1;
-  }
-  ty = (int)floor(yMin);
-  if (ty < 0) {
-    ty = 0;
-  } else if (ty >= bh) {
-    ty = bh - 1;
-  }
-  w = (int)ceil(xMax) - tx + 1;
+  *tx = (int)floor(xMin);
+  if (*tx < 0) {
+    *tx = 0;
+  } else if (*tx >= bw) {
+    *tx = bw - 1;
+  }
+  *ty = (int)floor(yMin);
+  if (*ty < 0) {
+    *ty = 0;
+  } else if (*ty >= bh) {
+    *ty = bh - 1;
+  }
+  *w = (int)ceil(xMax) - *tx + 1;
   // NB bw and tx are both non-negative, so 'bw - tx' can't overflow
-  if (bw - tx < w) {
-    w = bw - tx;
+  if (bw - *tx < *w) {
+    *w = bw - *tx;
   }
-  if (w < 1) {
-    w = 1;
+  if (*w < 1) {
+    *w = 1;
   }
-  h = (int)ceil(yMax) - ty + 1;
+  *h = (int)ceil(yMax) - *ty + 1;
   // NB bh and ty are both non-negative, so 'bh - ty' can't overflow
-  if (bh - ty < h) {
-    h = bh - ty;
+  if (bh - *ty < *h) {
+    *h = bh - *ty;
+  }
+  if (*h < 1) {
+    *h = 1;
   }
-  if (h < 1) {
-    h = 1;
+}
+
+GBool SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
+					      GfxColorSpace *blendingColorSpace,
+					      GBool isolated, GBool knockout,
+					      GBool forSoftMask) {
+  SplashTransparencyGroup *transpGroup;
+  SplashBitmap *backdropBitmap;
+  SplashColor color;
+  int tx, ty, w, h, i;
+
+  // soft masks and knockout groups depend on the backdrop, so they
+  // can't be part of a cached form raster
+  if (forSoftMask || knockout) {
+    setFormCacheUnsafe();
   }
 
+  getGroupRect(state, bbox, &tx, &ty, &w, &h);
+
   // optimization: a non-isolated group drawn with alpha=1 and
   // Blend=Normal and backdrop alpha=0 is equivalent to drawing
   // directly onto the backdrop (i.e., a regular non-t-group Form)
@@ -4017,6 +4558,7 @@ GBool SplashOutputDev::beginTransparencyGroup(GfxState *state, double *bbox,
 		 mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
   splash->setEnablePathSimplification(
 		 globalParams->getEnablePathSimplification());
+  splash->setImageScalingThreads(globalParams->getImageScalingThreads());
   copyState(transpGroup->origSplash, gTrue);
   if (!isolated || knockout) {
     // non-isolated and knockout groups nested in another group will
@@ -4322,6 +4864,329 @@ void SplashOutputDev::clearSoftMask(GfxState *state) {
   splash->setSoftMask(NULL);
 }
 
+//------------------------------------------------------------------------
+// form cache
+//------------------------------------------------------------------------
+
+FormCacheStatus SplashOutputDev::beginFormCache(GfxState *state, Gfx *gfx,
+						Ref id, double *bbox) {
+  SplashFormCacheEntry *entry;
+  SplashFormCacheFill *fill;
+  GfxColorSpaceMode fillMode, strokeMode;
+  GString *key;
+  SplashColor color;
+  double *ctm;
+  int tx, ty, w, h, i;
+
+  if (!formCache) {
+    return formCacheNone;
+  }
+
+  // the form is rasterized into a separate bitmap, which is then
+  // composited onto the page -- this is only equivalent to drawing
+  // the form directly if the result doesn't depend on the backdrop,
+  // and if the form's bitmap doesn't need to inherit any of the
+  // transparency state
+  fillMode = state->getFillColorSpace()->getMode();
+  strokeMode = state->getStrokeColorSpace()->getMode();
+  ctm = state->getCTM();
+  if (!(colorMode == splashModeMono8 ||
+	colorMode == splashModeRGB8 ||
+	colorMode == splashModeBGR8) ||
+      t3GlyphStack ||
+      textClipPath ||
+      splash->getSoftMask() ||
+      splash->getInNonIsolatedGroup() ||
+      splash->getInKnockoutGroup() ||
+      state->getFillOpacity() != 1 ||
+      state->getStrokeOpacity() != 1 ||
+      state->getBlendMode() != gfxBlendNormal ||
+      state->getFillOverprint() ||
+      state->getStrokeOverprint() ||
+      state->getTransfer()[0] ||
+      !(fillMode == csDeviceGray ||
+	fillMode == csDeviceRGB ||
+	fillMode == csDeviceCMYK) ||
+      !(strokeMode == csDeviceGray ||
+	strokeMode == csDeviceRGB ||
+	strokeMode == csDeviceCMYK) ||
+      fabs(ctm[4]) > 1e6 || fabs(ctm[5]) > 1e6) {
+    return formCacheNone;
+  }
+
+  // don't cache forms which would take up a large part of the cache
+  getGroupRect(state, bbox, &tx, &ty, &w, &h);
+  if ((double)w * (double)h * (splashColorModeNComps[colorMode] + 1)
+      > (double)(formCache->getMaxSize() / 4)) {
+    return formCacheNone;
+  }
+
+  key = makeFormCacheKey(state, gfx, id, tx, ty, w, h);
+
+  // check the cache
+  if ((entry = formCache->lookup(key))) {
+    delete key;
+    if (!entry->bitmap) {
+      return formCacheNone;
+    }
+    if (entry->modXMin <= entry->modXMax &&
+	entry->modYMin <= entry->modYMax) {
+      splash->setOverprintMask(0xffffffff);
+      splash->composite(entry->bitmap, entry->modXMin, entry->modYMin,
+			tx + entry->modXMin, ty + entry->modYMin,
+			entry->modXMax - entry->modXMin + 1,
+			entry->modYMax - entry->modYMin + 1,
+			gFalse, gFalse);
+    }
+    ++nFormCacheHits;
+    return formCacheHit;
+  }
+  ++nFormCacheMisses;
+
+  // push a new stack entry
+  fill = new SplashFormCacheFill();
+  fill->key = key;
+  fill->tx = tx;
+  fill->ty = ty;
+  fill->ok = gTrue;
+  fill->origBitmap = bitmap;
+  fill->origSplash = splash;
+  fill->next = formCacheFillStack;
+  formCacheFillStack = fill;
+
+  // create the bitmap -- this doesn't use origBitmap as the parent,
+  // because the bitmap may outlive it
+  traceMessage("form cache bitmap");
+  bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, gTrue,
+			    bitmapTopDown, NULL);
+  splash = new Splash(bitmap, vectorAntialias,
+		      fill->origSplash->getImageCache(),
+		      fill->origSplash->getScreen());
+  splash->setMinLineWidth(globalParams->getMinLineWidth());
+  splash->setStrokeAdjust(
+		 mapStrokeAdjustMode[globalParams->getStrokeAdjust()]);
+  splash->setEnablePathSimplification(
+		 globalParams->getEnablePathSimplification());
+  splash->setImageScalingThreads(globalParams->getImageScalingThreads());
+  copyState(fill->origSplash, gTrue);
+  for (i = 0; i < splashMaxColorComps; ++i) {
+    color[i] = 0;
+  }
+  splash->clear(color, 0);
+  splash->clearModRegion();
+  state->shiftCTM(-tx, -ty);
+  updateCTM(state, 0, 0, 0, 0, 0, 0);
+  ++nestCount;
+
+  return formCacheFill;
+}
+
+GBool SplashOutputDev::endFormCache(GfxState *state, GBool abort) {
+  SplashFormCacheFill *fill;
+  SplashFormCacheEntry *entry;
+  SplashBitmap *fBitmap;
+  int xMin, yMin, xMax, yMax;
+  GBool ok;
+
+  splash->getModRegion(&xMin, &yMin, &xMax, &yMax);
+
+  // restore state
+  fill = formCacheFillStack;
+  formCacheFillStack = fill->next;
+  --nestCount;
+  delete splash;
+  fBitmap = bitmap;
+  bitmap = fill->origBitmap;
+  splash = fill->origSplash;
+  state->shiftCTM(fill->tx, fill->ty);
+  updateCTM(state, 0, 0, 0, 0, 0, 0);
+  ok = fill->ok;
+
+  // paint the rasterized form onto the parent bitmap
+  if (ok && xMin <= xMax && yMin <= yMax) {
+    splash->setOverprintMask(0xffffffff);
+    splash->composite(fBitmap, xMin, yMin,
+		      fill->tx + xMin, fill->ty + yMin,
+		      xMax - xMin + 1, yMax - yMin + 1,
+		      gFalse, gFalse);
+  }
+
+  // add it to the cache -- if the form can't be cached, add an empty
+  // entry, so it isn't drawn twice next time
+  if (abort) {
+    delete fBitmap;
+    delete fill->key;
+  } else if (ok) {
+    entry = new SplashFormCacheEntry(fill->key, fBitmap);
+    entry->modXMin = xMin;
+    entry->modYMin = yMin;
+    entry->modXMax = xMax;
+    entry->modYMax = yMax;
+    if (!formCache->add(entry)) {
+      delete entry;
+    }
+  } else {
+    delete fBitmap;
+    entry = new SplashFormCacheEntry(fill->key, NULL);
+    if (!formCache->add(entry)) {
+      delete entry;
+    }
+  }
+  delete fill;
+
+  return ok;
+}
+
+// Build the form cache key for form <id>, drawn into the rectangle
+// <tx>, <ty>, <w>, <h> with the current state.
+GString *SplashOutputDev::makeFormCacheKey(GfxState *state, Gfx *gfx, Ref id,
+					   int tx, int ty, int w, int h) {
+  SplashFormCacheKey k;
+  GString *key;
+  double *ctm;
+  int qx, qy, ix, iy, i;
+
+  memset(&k, 0, sizeof(k));
+  k.num = id.num;
+  k.gen = id.gen;
+
+  // split the translation into an integer part (the raster is
+  // positioned relative to this) and a quantized sub-pixel part
+  ctm = state->getCTM();
+  for (i = 0; i < 4; ++i) {
+    k.mat[i] = ctm[i];
+  }
+  qx = (int)floor(ctm[4] * splashFormCachePhases + 0.5);
+  qy = (int)floor(ctm[5] * splashFormCachePhases + 0.5);
+  ix = (int)floor((double)qx / splashFormCachePhases);
+  iy = (int)floor((double)qy / splashFormCachePhases);
+  k.phaseX = qx - ix * splashFormCachePhases;
+  k.phaseY = qy - iy * splashFormCachePhases;
+  k.x = tx - ix;
+  k.y = ty - iy;
+  k.w = w;
+  k.h = h;
+
+  key = new GString((char *)&k, (int)sizeof(k));
+  appendCacheStateKey(state, gfx, key);
+  return key;
+}
+
+// Build the pattern cache key for the tiling pattern cell with
+// content stream <id>, rasterized into a <w> x <h> bitmap with the
+// transform <mat> (pattern space -> bitmap).
+GString *SplashOutputDev::makePatternCacheKey(GfxState *state, Gfx *gfx,
+					      Ref id, double *mat,
+					      int w, int h) {
+  SplashPatternCacheKey k;
+  GString *key;
+  int i;
+
+  memset(&k, 0, sizeof(k));
+  k.num = id.num;
+  k.gen = id.gen;
+  for (i = 0; i < 6; ++i) {
+    k.mat[i] = mat[i];
+  }
+  k.w = w;
+  k.h = h;
+
+  key = new GString((char *)&k, (int)sizeof(k));
+  appendCacheStateKey(state, gfx, key);
+  return key;
+}
+
+// Append the graphics state, output device state, and optional
+// content state which can affect a rasterized form or pattern cell
+// to <key>.
+void SplashOutputDev::appendCacheStateKey(GfxState *state, Gfx *gfx,
+					  GString *key) {
+  SplashCacheStateKey k;
+  GfxColorSpace *cs;
+  OptionalContent *optContent;
+  double *dash;
+  double dashStart;
+  int dashLength, nOCGs, c, i, j;
+
+  memset(&k, 0, sizeof(k));
+  cs = state->getFillColorSpace();
+  k.fillCSMode = cs->getMode();
+  for (i = 0; i < cs->getNComps() && i < gfxColorMaxComps; ++i) {
+    k.fillColor.c[i] = state->getFillColor()->c[i];
+  }
+  cs = state->getStrokeColorSpace();
+  k.strokeCSMode = cs->getMode();
+  for (i = 0; i < cs->getNComps() && i < gfxColorMaxComps; ++i) {
+    k.strokeColor.c[i] = state->getStrokeColor()->c[i];
+  }
+  k.lineWidth = state->getLineWidth();
+  k.miterLimit = state->getMiterLimit();
+  k.flatness = state->getFlatness();
+  k.lineCap = state->getLineCap();
+  k.lineJoin = state->getLineJoin();
+  k.strokeAdjust = state->getStrokeAdjust();
+  if (state->getFont()) {
+    k.fontNum = state->getFont()->getID()->num;
+    k.fontGen = state->getFont()->getID()->gen;
+  } else {
+    k.fontNum = k.fontGen = -1;
+  }
+  k.fontSize = state->getFontSize();
+  k.charSpace = state->getCharSpace();
+  k.wordSpace = state->getWordSpace();
+  k.horizScaling = state->getHorizScaling();
+  k.leading = state->getLeading();
+  k.rise = state->getRise();
+  k.render = state->getRender();
+  k.renderingIntent = state->getRenderingIntent();
+  k.vectorAntialias = vectorAntialias;
+  k.reverseVideo = reverseVideo;
+  k.skipHorizText = skipHorizText;
+  k.skipRotatedText = skipRotatedText;
+
+  key->append((char *)&k, (int)sizeof(k));
+  state->getLineDash(&dash, &dashLength, &dashStart);
+  if (dashLength > 0) {
+    key->append((char *)&dashStart, (int)sizeof(double));
+    key->append((char *)dash, dashLength * (int)sizeof(double));
+  }
+
+  // the contents may be marked as optional content, so the on/off
+  // state of the OCGs (which the viewer can change) is part of the
+  // key, one bit per OCG
+  if ((optContent = gfx->getDoc()->getOptionalContent()) &&
+      (nOCGs = optContent->getNumOCGs()) > 0) {
+    for (i = 0; i < nOCGs; i += 8) {
+      c = 0;
+      for (j = 0; j < 8 && i + j < nOCGs; ++j) {
+	if (optContent->getOCG(i + j)->getState()) {
+	  c |= 1 << j;
+	}
+      }
+      key->append((char)c);
+    }
+  }
+}
+
+// Called when the current form uses something which can't be
+// rasterized separately from the backdrop.  This applies to all of
+// the forms being rasterized, since each one contains the next.
+void SplashOutputDev::setFormCacheUnsafe() {
+  SplashFormCacheFill *fill;
+
+  for (fill = formCacheFillStack; fill; fill = fill->next) {
+    fill->ok = gFalse;
+  }
+}
+
+int SplashOutputDev::getNumFormCacheEvictions() {
+  return formCache ? formCache->getNumEvictions() : 0;
+}
+
+int SplashOutputDev::getNumPatternCacheEvictions() {
+  return patternCache ? patternCache->getNumEvictions() : 0;
+}
+
 void SplashOutputDev::setPaperColor(SplashColorPtr paperColorA) {
   splashColorCopy(paperColor, paperColorA);
 }
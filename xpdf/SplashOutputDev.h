@@ -24,21 +24,20 @@
 class Gfx8BitFont;
 class SplashBitmap;
 class Splash;
+class SplashImageCache;
 class SplashPath;
 class SplashPattern;
 class SplashFontEngine;
 class SplashFont;
 class T3FontCache;
+class SplashFormCache;
+struct SplashFormCacheFill;
 struct T3FontCacheTag;
 struct T3GlyphStack;
 struct SplashTransparencyGroup;
 
 //------------------------------------------------------------------------
 
-// number of Type 3 fonts to cache
-#define splashOutT3FontCacheSize 8
-
-//------------------------------------------------------------------------
 // SplashOutputDev
 //------------------------------------------------------------------------
 
@@ -64,6 +63,9 @@ public:
   // Does this device use drawChar() or drawString()?
   virtual GBool useDrawChar() { return gTrue; }
 
+  // Does this device use drawGlyphRun()?
+  virtual GBool useDrawGlyphRun() { return gTrue; }
+
   // Does this device use tilingPatternFill()?  If this returns false,
   // tiling pattern fills will be reduced to a series of other drawing
   // operations.
@@ -130,6 +132,7 @@ public:
 			double dx, double dy,
 			double originX, double originY,
 			CharCode code, int nBytes, Unicode *u, int uLen);
+  virtual void drawGlyphRun(GfxState *state, GlyphRun *run);
   virtual GBool beginType3Char(GfxState *state, double x, double y,
 			       double dx, double dy,
 			       CharCode code, Unicode *u, int uLen);
@@ -177,6 +180,11 @@ public:
 			   Function *transferFunc, GfxColor *backdropColor);
   virtual void clearSoftMask(GfxState *state);
 
+  //----- form XObjects
+  virtual FormCacheStatus beginFormCache(GfxState *state, Gfx *gfx, Ref id,
+					 double *bbox);
+  virtual GBool endFormCache(GfxState *state, GBool abort);
+
   //----- special access
 
   // Called to indicate that a new PDF document has been loaded.
@@ -190,6 +198,36 @@ public:
   GBool isReverseVideo() { return reverseVideo; }
   void setReverseVideo(GBool reverseVideoA) { reverseVideo = reverseVideoA; }
 
+  // Get the font engine.  This is replaced by startDoc().
+  SplashFontEngine *getFontEngine() { return fontEngine; }
+
+  // Get the scaled image cache.  This is kept across pages, and
+  // flushed by startDoc().
+  SplashImageCache *getImageCache() { return imageCache; }
+
+  // Use a shared scaled image cache (e.g., one shared by several
+  // SplashOutputDev objects rasterizing the same document in
+  // different threads).  This must be called after startDoc().
+  void setImageCache(SplashImageCache *imageCacheA);
+
+  // Type 3 glyph cache statistics.  A miss is a CharProc execution;
+  // the cache is kept across pages, and flushed by startDoc().
+  int getNumType3CacheHits() { return nT3CacheHits; }
+  int getNumType3CacheMisses() { return nT3CacheMisses; }
+  int getNumType3CacheGlyphEvictions() { return nT3CacheGlyphEvictions; }
+  int getNumType3CacheFontEvictions() { return nT3CacheFontEvictions; }
+
+  // Form cache statistics.  A miss is a form rasterized into the
+  // cache; the cache is kept across pages, and flushed by startDoc().
+  int getNumFormCacheHits() { return nFormCacheHits; }
+  int getNumFormCacheMisses() { return nFormCacheMisses; }
+  int getNumFormCacheEvictions();
+
+  // Tiling pattern cell cache statistics (like the form cache).
+  int getNumPatternCacheHits() { return nPatternCacheHits; }
+  int getNumPatternCacheMisses() { return nPatternCacheMisses; }
+  int getNumPatternCacheEvictions();
+
   // Get the bitmap and its size.
   SplashBitmap *getBitmap() { return bitmap; }
   int getBitmapWidth();
@@ -254,6 +292,7 @@ private:
   SplashPath *convertPath(GfxState *state, GfxPath *path,
 			  GBool dropEmptySubpaths);
   void doUpdateFont(GfxState *state);
+  void shrinkType3FontCache();
   void drawType3Glyph(GfxState *state, T3FontCache *t3Font,
 		      T3FontCacheTag *tag, Guchar *data);
   static GBool imageMaskSrc(void *data, Guchar *line);
@@ -275,6 +314,14 @@ private:
 		       double xMin, double yMin,
 		       double xMax, double yMax);
   void copyState(Splash *oldSplash, GBool copyColors);
+  void getGroupRect(GfxState *state, double *bbox,
+		    int *tx, int *ty, int *w, int *h);
+  GString *makeFormCacheKey(GfxState *state, Gfx *gfx, Ref id,
+			    int tx, int ty, int w, int h);
+  GString *makePatternCacheKey(GfxState *state, Gfx *gfx, Ref id,
+			       double *mat, int w, int h);
+  void appendCacheStateKey(GfxState *state, Gfx *gfx, GString *key);
+  void setFormCacheUnsafe();
 #if 1 //~tmp: turn off anti-aliasing temporarily
   void setInShading(GBool sh);
 #endif
@@ -297,20 +344,39 @@ private:
 
   SplashBitmap *bitmap;
   Splash *splash;
+  SplashImageCache *imageCache;	// scaled image cache
   SplashFontEngine *fontEngine;
 
-  T3FontCache *			// Type 3 font cache
-    t3FontCache[splashOutT3FontCacheSize];
-  int nT3Fonts;			// number of valid entries in t3FontCache
+  GList *t3FontCache;		// Type 3 font cache [T3FontCache], most
+				//   recently used first
+  size_t t3FontCacheSize;	// total size of t3FontCache, in bytes
+  size_t t3FontCacheMaxSize;	// max size of t3FontCache, in bytes
+  int nT3CacheHits,		// Type 3 glyph cache statistics
+      nT3CacheMisses,
+      nT3CacheGlyphEvictions,
+      nT3CacheFontEvictions;
   T3GlyphStack *t3GlyphStack;	// Type 3 glyph context stack
 
   SplashFont *font;		// current font
   GBool needFontUpdate;		// set when the font needs to be updated
   SplashPath *textClipPath;	// clipping path built with text object
+  SplashCoord *glyphRunXY;	// buffers used by drawGlyphRun
+  int *glyphRunCodes;
+  int glyphRunSize;
 
   SplashTransparencyGroup *	// transparency group stack
     transpGroupStack;
 
+  SplashFormCache *formCache;	// form raster cache (NULL if disabled)
+  SplashFormCacheFill *		// forms being rasterized into the cache
+    formCacheFillStack;
+  int nFormCacheHits,		// form cache statistics
+      nFormCacheMisses;
+  SplashFormCache *patternCache;// tiling pattern cell cache (NULL if
+				//   disabled)
+  int nPatternCacheHits,	// pattern cache statistics
+      nPatternCacheMisses;
+
   int nestCount;
 
   void (*startPageCbk)(void *data);
@@ -20,6 +20,7 @@
 #include <io.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 #include <string.h>
 #include <ctype.h>
@@ -678,6 +679,7 @@ public:
   void free();
   int readBlock(char *buf, GFileOffset pos, int size);
   GFileOffset getSize();
+  void prefetch(GFileOffset pos, GFileOffset len);
 
 private:
 
@@ -758,6 +760,24 @@ GFileOffset SharedFile::getSize() {
   return size;
 }
 
+// This only passes the hint to the OS, which reads the data into its
+// cache asynchronously -- it doesn't touch the FILE, so it doesn't
+// need the mutex.
+void SharedFile::prefetch(GFileOffset pos, GFileOffset len) {
+#if defined(POSIX_FADV_WILLNEED)
+  posix_fadvise(fileno(f), (off_t)pos, (off_t)len, POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+  struct radvisory ra;
+
+  if (len > INT_MAX) {
+    len = INT_MAX;
+  }
+  ra.ra_offset = (off_t)pos;
+  ra.ra_count = (int)len;
+  fcntl(fileno(f), F_RDADVISE, &ra);
+#endif
+}
+
 //------------------------------------------------------------------------
 // FileStream
 //------------------------------------------------------------------------
@@ -800,6 +820,10 @@ Stream *FileStream::makeSubStream(GFileOffset startA, GBool limitedA,
   return new FileStream(f, startA, limitedA, lengthA, dictA);
 }
 
+void FileStream::prefetch(GFileOffset pos, GFileOffset len) {
+  f->prefetch(pos, len);
+}
+
 void FileStream::reset() {
   bufPtr = bufEnd = buf;
   bufPos = start;
@@ -869,6 +893,595 @@ void FileStream::moveStart(int delta) {
   bufPos = start;
 }
 
+//------------------------------------------------------------------------
+// FileByteRangeProvider
+//------------------------------------------------------------------------
+
+FileByteRangeProvider::FileByteRangeProvider(FILE *fA) {
+  f = fA;
+}
+
+FileByteRangeProvider::~FileByteRangeProvider() {
+  fclose(f);
+}
+
+GFileOffset FileByteRangeProvider::getSize() {
+  if (gfseek(f, 0, SEEK_END)) {
+    return -1;
+  }
+  return gftell(f);
+}
+
+int FileByteRangeProvider::readRange(char *buf, GFileOffset pos, int size) {
+  int n;
+
+  if (gfseek(f, pos, SEEK_SET)) {
+    return -1;
+  }
+  n = (int)fread(buf, 1, size, f);
+  if (n < size && ferror(f)) {
+    return -1;
+  }
+  return n;
+}
+
+//------------------------------------------------------------------------
+// RangeStreamCache
+//------------------------------------------------------------------------
+
+#define rangeStreamMinBlockSize 1024
+#define rangeStreamMaxBlockSize (16 << 20)
+
+struct RangeStreamBlock {
+  int idx;			// block index
+  char *data;
+  int len;			// number of valid bytes (less than the block
+				//   size only for the last block)
+  RangeStreamBlock *prev,	// LRU list (prev = more recently used)
+                   *next;
+};
+
+class RangeStreamCache {
+public:
+
+  RangeStreamCache(ByteRangeProvider *providerA, int blockSizeA,
+		   size_t cacheSizeA);
+  RangeStreamCache *copy();
+  void free();
+
+  // Copy up to <size> bytes at <pos> into <buf>, stopping at the end
+  // of a block.  If the block isn't cached, this fetches it, along
+  // with any following uncached blocks before <fetchEnd>.  Returns
+  // the number of bytes copied.
+  int read(char *buf, GFileOffset pos, int size, GFileOffset fetchEnd);
+
+  void prefetch(GFileOffset pos, GFileOffset len);
+
+  GFileOffset getSize() { return fileSize; }
+  int getBlockSize() { return blockSize; }
+  GFileOffset getMaxReadahead()
+    { return (GFileOffset)maxFetchBlocks * blockSize; }
+  GFileOffset getBytesFetched();
+  int getNumFetches();
+  int getNumCacheHits();
+  int getNumCacheMisses();
+
+private:
+
+  ~RangeStreamCache();
+  RangeStreamBlock *fetchBlocks(int first, int last);
+  void insertBlock(RangeStreamBlock *blk);
+  void unlinkBlock(RangeStreamBlock *blk);
+
+  ByteRangeProvider *provider;
+  GFileOffset fileSize;
+  int blockSize;
+  int nBlocks;			// number of blocks in the file
+  RangeStreamBlock **blocks;	// cached block for each index (or NULL)
+  RangeStreamBlock *lruHead,	// most recently used block
+                   *lruTail;	// least recently used block
+  int nCached;			// number of cached blocks
+  int maxCached;		// max number of cached blocks
+  int maxFetchBlocks;		// max number of blocks in one fetch
+  GFileOffset bytesFetched;
+  int nFetches;
+  int nHits, nMisses;
+  int refCnt;
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+RangeStreamCache::RangeStreamCache(ByteRangeProvider *providerA,
+				   int blockSizeA, size_t cacheSizeA) {
+  size_t n;
+
+  provider = providerA;
+  if (blockSizeA < rangeStreamMinBlockSize) {
+    blockSize = rangeStreamMinBlockSize;
+  } else if (blockSizeA > rangeStreamMaxBlockSize) {
+    blockSize = rangeStreamMaxBlockSize;
+  } else {
+    blockSize = blockSizeA;
+  }
+  fileSize = provider->getSize();
+  if (fileSize < 0) {
+    error(errIO, -1, "Couldn't get the size of the PDF file");
+    fileSize = 0;
+  }
+  if ((fileSize - 1) / blockSize >= INT_MAX) {
+    error(errIO, -1, "PDF file is too large");
+    fileSize = 0;
+  }
+  nBlocks = (int)((fileSize + blockSize - 1) / blockSize);
+  blocks = (RangeStreamBlock **)gmallocn(nBlocks ? nBlocks : 1,
+					 sizeof(RangeStreamBlock *));
+  memset(blocks, 0, (nBlocks ? nBlocks : 1) * sizeof(RangeStreamBlock *));
+  lruHead = lruTail = NULL;
+  nCached = 0;
+  n = cacheSizeA / blockSize;
+  maxCached = n < 4 ? 4 : n > INT_MAX ? INT_MAX : (int)n;
+  // a single fetch can't use more than half of the cache, so it
+  // doesn't flush out everything else, and its buffer size has to
+  // fit in an int
+  maxFetchBlocks = maxCached / 2;
+  if (maxFetchBlocks > INT_MAX / blockSize) {
+    maxFetchBlocks = INT_MAX / blockSize;
+  }
+  bytesFetched = 0;
+  nFetches = 0;
+  nHits = nMisses = 0;
+  refCnt = 1;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+RangeStreamCache::~RangeStreamCache() {
+  RangeStreamBlock *blk, *next;
+
+  for (blk = lruHead; blk; blk = next) {
+    next = blk->next;
+    gfree(blk->data);
+    delete blk;
+  }
+  gfree(blocks);
+  delete provider;
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+RangeStreamCache *RangeStreamCache::copy() {
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  ++refCnt;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return this;
+}
+
+void RangeStreamCache::free() {
+  int newCount;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  newCount = --refCnt;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  if (newCount == 0) {
+    delete this;
+  }
+}
+
+int RangeStreamCache::read(char *buf, GFileOffset pos, int size,
+			   GFileOffset fetchEnd) {
+  RangeStreamBlock *blk;
+  GFileOffset last;
+  int idx, off, n;
+
+  if (pos < 0 || pos >= fileSize || size <= 0) {
+    return 0;
+  }
+  idx = (int)(pos / blockSize);
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  if ((blk = blocks[idx])) {
+    ++nHits;
+    unlinkBlock(blk);
+    insertBlock(blk);
+  } else {
+    ++nMisses;
+    last = idx;
+    if (fetchEnd > pos) {
+      last = (fetchEnd - 1) / blockSize;
+    }
+    if (last > (GFileOffset)idx + maxFetchBlocks - 1) {
+      last = (GFileOffset)idx + maxFetchBlocks - 1;
+    }
+    blk = fetchBlocks(idx, (int)last);
+  }
+  n = 0;
+  if (blk) {
+    off = (int)(pos - (GFileOffset)idx * blockSize);
+    n = blk->len - off;
+    if (n > size) {
+      n = size;
+    }
+    if (n < 0) {
+      n = 0;
+    }
+    memcpy(buf, blk->data + off, n);
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return n;
+}
+
+void RangeStreamCache::prefetch(GFileOffset pos, GFileOffset len) {
+  GFileOffset end;
+  int first, last, idx, runEnd, budget;
+
+  if (pos < 0 || len <= 0 || pos >= fileSize) {
+    return;
+  }
+  end = pos + len;
+  if (end > fileSize) {
+    end = fileSize;
+  }
+  first = (int)(pos / blockSize);
+  last = (int)((end - 1) / blockSize);
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  // fetch each run of uncached blocks with a single request
+  budget = maxFetchBlocks;
+  idx = first;
+  while (idx <= last && budget > 0) {
+    if (blocks[idx]) {
+      ++idx;
+      continue;
+    }
+    runEnd = idx;
+    while (runEnd < last && runEnd - idx + 1 < budget &&
+	   !blocks[runEnd + 1]) {
+      ++runEnd;
+    }
+    if (!fetchBlocks(idx, runEnd)) {
+      break;
+    }
+    budget -= runEnd - idx + 1;
+    idx = runEnd + 1;
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+// Fetch blocks <first> .. <last> (stopping early at the first block
+// which is already cached), and add them to the cache.  Returns the
+// first block, or NULL on error.  The mutex must be locked.
+RangeStreamBlock *RangeStreamCache::fetchBlocks(int first, int last) {
+  RangeStreamBlock *blk, *firstBlk;
+  GFileOffset pos, end;
+  char *buf;
+  int len, n, i, off;
+
+  if (last >= nBlocks) {
+    last = nBlocks - 1;
+  }
+  for (i = first + 1; i <= last; ++i) {
+    if (blocks[i]) {
+      last = i - 1;
+      break;
+    }
+  }
+  pos = (GFileOffset)first * blockSize;
+  end = (GFileOffset)(last + 1) * blockSize;
+  if (end > fileSize) {
+    end = fileSize;
+  }
+  len = (int)(end - pos);
+  buf = (char *)gmalloc(len);
+  n = provider->readRange(buf, pos, len);
+  ++nFetches;
+  if (n <= 0) {
+    if (n < 0) {
+      error(errIO, pos, "Couldn't read from the PDF file");
+    }
+    gfree(buf);
+    return NULL;
+  }
+  if (n > len) {
+    n = len;
+  }
+  bytesFetched += n;
+
+  // insert the blocks in reverse order, so the first one ends up at
+  // the head of the LRU list
+  firstBlk = NULL;
+  for (i = last; i >= first; --i) {
+    off = (i - first) * blockSize;
+    if (off >= n) {
+      continue;
+    }
+    blk = new RangeStreamBlock;
+    blk->idx = i;
+    blk->len = n - off < blockSize ? n - off : blockSize;
+    blk->data = (char *)gmalloc(blk->len);
+    memcpy(blk->data, buf + off, blk->len);
+    blocks[i] = blk;
+    insertBlock(blk);
+    firstBlk = blk;
+  }
+  gfree(buf);
+
+  // evict the least recently used blocks
+  while (nCached > maxCached) {
+    blk = lruTail;
+    unlinkBlock(blk);
+    blocks[blk->idx] = NULL;
+    gfree(blk->data);
+    delete blk;
+  }
+
+  return firstBlk;
+}
+
+// Insert <blk> at the head of the LRU list.
+void RangeStreamCache::insertBlock(RangeStreamBlock *blk) {
+  blk->prev = NULL;
+  blk->next = lruHead;
+  if (lruHead) {
+    lruHead->prev = blk;
+  } else {
+    lruTail = blk;
+  }
+  lruHead = blk;
+  ++nCached;
+}
+
+void RangeStreamCache::unlinkBlock(RangeStreamBlock *blk) {
+  if (blk->prev) {
+    blk->prev->next = blk->next;
+  } else {
+    lruHead = blk->next;
+  }
+  if (blk->next) {
+    blk->next->prev = blk->prev;
+  } else {
+    lruTail = blk->prev;
+  }
+  --nCached;
+}
+
+GFileOffset RangeStreamCache::getBytesFetched() {
+  GFileOffset n;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  n = bytesFetched;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return n;
+}
+
+int RangeStreamCache::getNumFetches() {
+  int n;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  n = nFetches;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return n;
+}
+
+int RangeStreamCache::getNumCacheHits() {
+  int n;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  n = nHits;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return n;
+}
+
+int RangeStreamCache::getNumCacheMisses() {
+  int n;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  n = nMisses;
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return n;
+}
+
+//------------------------------------------------------------------------
+// RangeStream
+//------------------------------------------------------------------------
+
+RangeStream::RangeStream(ByteRangeProvider *providerA, int blockSizeA,
+			 size_t cacheSizeA, Object *dictA):
+    BaseStream(dictA) {
+  cache = new RangeStreamCache(providerA, blockSizeA, cacheSizeA);
+  start = 0;
+  limited = gFalse;
+  length = 0;
+  bufPtr = bufEnd = buf;
+  bufPos = start;
+  seqPos = -1;
+  readahead = 0;
+}
+
+RangeStream::RangeStream(RangeStreamCache *cacheA, GFileOffset startA,
+			 GBool limitedA, GFileOffset lengthA, Object *dictA):
+    BaseStream(dictA) {
+  cache = cacheA->copy();
+  start = startA;
+  limited = limitedA;
+  length = lengthA;
+  bufPtr = bufEnd = buf;
+  bufPos = start;
+  seqPos = -1;
+  readahead = 0;
+}
+
+RangeStream::~RangeStream() {
+  cache->free();
+}
+
+Stream *RangeStream::copy() {
+  Object dictA;
+
+  dict.copy(&dictA);
+  return new RangeStream(cache, start, limited, length, &dictA);
+}
+
+Stream *RangeStream::makeSubStream(GFileOffset startA, GBool limitedA,
+				   GFileOffset lengthA, Object *dictA) {
+  return new RangeStream(cache, startA, limitedA, lengthA, dictA);
+}
+
+void RangeStream::prefetch(GFileOffset pos, GFileOffset len) {
+  cache->prefetch(pos, len);
+}
+
+void RangeStream::reset() {
+  bufPtr = bufEnd = buf;
+  bufPos = start;
+  seqPos = -1;
+  readahead = 0;
+}
+
+int RangeStream::getBlock(char *blk, int size) {
+  int n, m;
+
+  n = 0;
+  while (n < size) {
+    if (bufPtr >= bufEnd) {
+      if (!fillBuf()) {
+	break;
+      }
+    }
+    m = (int)(bufEnd - bufPtr);
+    if (m > size - n) {
+      m = size - n;
+    }
+    memcpy(blk + n, bufPtr, m);
+    bufPtr += m;
+    n += m;
+  }
+  return n;
+}
+
+GBool RangeStream::fillBuf() {
+  GFileOffset fetchEnd;
+  int n;
+
+  bufPos += (int)(bufEnd - buf);
+  bufPtr = bufEnd = buf;
+  if (limited && bufPos >= start + length) {
+    return gFalse;
+  }
+  if (limited && bufPos + rangeStreamBufSize > start + length) {
+    n = (int)(start + length - bufPos);
+  } else {
+    n = rangeStreamBufSize;
+  }
+
+  // a limited stream is (almost always) a stream object's data, which
+  // will be read to the end, so fetch all of it on a miss; otherwise,
+  // double the readahead each time the stream is read sequentially
+  if (limited) {
+    fetchEnd = start + length;
+  } else {
+    if (bufPos == seqPos) {
+      if (readahead == 0) {
+	readahead = cache->getBlockSize();
+      } else if (readahead < cache->getMaxReadahead()) {
+	readahead *= 2;
+	if (readahead > cache->getMaxReadahead()) {
+	  readahead = cache->getMaxReadahead();
+	}
+      }
+    } else {
+      readahead = 0;
+    }
+    fetchEnd = bufPos + n + readahead;
+  }
+  seqPos = bufPos + n;
+
+  n = cache->read(buf, bufPos, n, fetchEnd);
+  bufEnd = buf + n;
+  if (bufPtr >= bufEnd) {
+    return gFalse;
+  }
+  return gTrue;
+}
+
+void RangeStream::setPos(GFileOffset pos, int dir) {
+  GFileOffset size;
+
+  if (dir >= 0) {
+    bufPos = pos;
+  } else {
+    size = cache->getSize();
+    if (pos <= size) {
+      bufPos = size - pos;
+    } else {
+      bufPos = 0;
+    }
+  }
+  bufPtr = bufEnd = buf;
+  seqPos = -1;
+  readahead = 0;
+}
+
+void RangeStream::moveStart(int delta) {
+  start += delta;
+  bufPtr = bufEnd = buf;
+  bufPos = start;
+  seqPos = -1;
+  readahead = 0;
+}
+
+GFileOffset RangeStream::getFileSize() {
+  return cache->getSize();
+}
+
+GFileOffset RangeStream::getBytesFetched() {
+  return cache->getBytesFetched();
+}
+
+int RangeStream::getNumFetches() {
+  return cache->getNumFetches();
+}
+
+int RangeStream::getNumCacheHits() {
+  return cache->getNumCacheHits();
+}
+
+int RangeStream::getNumCacheMisses() {
+  return cache->getNumCacheMisses();
+}
+
 //------------------------------------------------------------------------
 // MemStream
 //------------------------------------------------------------------------
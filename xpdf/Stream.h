@@ -26,6 +26,7 @@
 
 class BaseStream;
 class SharedFile;
+class RangeStreamCache;
 
 //------------------------------------------------------------------------
 
@@ -183,6 +184,11 @@ public:
   virtual GFileOffset getStart() = 0;
   virtual void moveStart(int delta) = 0;
 
+  // Hint that the bytes [<pos>, <pos> + <len>) (relative to the
+  // start of the file) will be read soon.  This starts reading them
+  // in the background, if possible, and returns immediately.
+  virtual void prefetch(GFileOffset pos, GFileOffset len) {}
+
 protected:
 
   Object dict;
@@ -329,6 +335,7 @@ public:
   virtual void setPos(GFileOffset pos, int dir = 0);
   virtual GFileOffset getStart() { return start; }
   virtual void moveStart(int delta);
+  virtual void prefetch(GFileOffset pos, GFileOffset len);
 
 private:
 
@@ -346,6 +353,117 @@ private:
   GFileOffset bufPos;
 };
 
+//------------------------------------------------------------------------
+// ByteRangeProvider
+//
+// Interface for reading a PDF file from somewhere other than a local
+// file, e.g., from an HTTP server with range requests.  This is used
+// by RangeStream.
+//------------------------------------------------------------------------
+
+class ByteRangeProvider {
+public:
+
+  ByteRangeProvider() {}
+  virtual ~ByteRangeProvider() {}
+
+  // Return the size of the file, or -1 if it isn't available.
+  virtual GFileOffset getSize() = 0;
+
+  // Read <size> bytes, starting at <pos>, into <buf>.  Returns the
+  // number of bytes read, which should be less than <size> only at
+  // end of file, or -1 on error.  This is called with the
+  // RangeStream's cache locked, so it is never called from more than
+  // one thread at a time.
+  virtual int readRange(char *buf, GFileOffset pos, int size) = 0;
+};
+
+//------------------------------------------------------------------------
+// FileByteRangeProvider
+//
+// A ByteRangeProvider which reads a local file.  This is a stand-in
+// for a remote provider, which is useful for testing RangeStream
+// (e.g., with the '-rangeio' option to pdfinfo and pdftoppm).
+//------------------------------------------------------------------------
+
+class FileByteRangeProvider: public ByteRangeProvider {
+public:
+
+  // Takes ownership of <fA>, which must be opened in binary mode.
+  FileByteRangeProvider(FILE *fA);
+  virtual ~FileByteRangeProvider();
+  virtual GFileOffset getSize();
+  virtual int readRange(char *buf, GFileOffset pos, int size);
+
+private:
+
+  FILE *f;
+};
+
+//------------------------------------------------------------------------
+// RangeStream
+//
+// A BaseStream which reads from a ByteRangeProvider.  Data is
+// fetched in fixed-size blocks, which are kept in an LRU cache
+// (shared by all sub-streams).  A miss inside a stream object's data
+// fetches ahead to the end of the stream object (up to a limit), and
+// prefetch() fetches all of the missing blocks in a range with as few
+// requests as possible -- so it's worth enabling the prefetchPages
+// option with this stream.
+//------------------------------------------------------------------------
+
+#define rangeStreamBufSize 4096
+
+class RangeStream: public BaseStream {
+public:
+
+  // Takes ownership of <providerA>.  Blocks are <blockSizeA> bytes,
+  // and the cache holds up to <cacheSizeA> bytes.
+  RangeStream(ByteRangeProvider *providerA, int blockSizeA,
+	      size_t cacheSizeA, Object *dictA);
+  virtual ~RangeStream();
+  virtual Stream *copy();
+  virtual Stream *makeSubStream(GFileOffset startA, GBool limitedA,
+				GFileOffset lengthA, Object *dictA);
+  virtual StreamKind getKind() { return strFile; }
+  virtual void reset();
+  virtual int getChar()
+    { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr++ & 0xff); }
+  virtual int lookChar()
+    { return (bufPtr >= bufEnd && !fillBuf()) ? EOF : (*bufPtr & 0xff); }
+  virtual int getBlock(char *blk, int size);
+  virtual GFileOffset getPos() { return bufPos + (int)(bufPtr - buf); }
+  virtual void setPos(GFileOffset pos, int dir = 0);
+  virtual GFileOffset getStart() { return start; }
+  virtual void moveStart(int delta);
+  virtual void prefetch(GFileOffset pos, GFileOffset len);
+
+  // Statistics (for the whole file, i.e., shared by all sub-streams).
+  GFileOffset getFileSize();
+  GFileOffset getBytesFetched();
+  int getNumFetches();
+  int getNumCacheHits();
+  int getNumCacheMisses();
+
+private:
+
+  RangeStream(RangeStreamCache *cacheA, GFileOffset startA, GBool limitedA,
+	      GFileOffset lengthA, Object *dictA);
+  GBool fillBuf();
+
+  RangeStreamCache *cache;
+  GFileOffset start;
+  GBool limited;
+  GFileOffset length;
+  char buf[rangeStreamBufSize];
+  char *bufPtr;
+  char *bufEnd;
+  GFileOffset bufPos;
+  GFileOffset seqPos;		// end of the previous buffer fill, used to
+				//   detect sequential reads
+  GFileOffset readahead;	// current sequential readahead, in bytes
+};
+
 //------------------------------------------------------------------------
 // MemStream
 //------------------------------------------------------------------------
@@ -26,6 +26,7 @@
 #include "gmempp.h"
 #include "GString.h"
 #include "GList.h"
+#include "GArena.h"
 #include "gfile.h"
 #include "config.h"
 #include "Error.h"
@@ -203,14 +204,18 @@ static inline double dmax(double x, double y) {
 // TextChar
 //------------------------------------------------------------------------
 
+// TextChars are allocated in the TextPage's arena, so they are never
+// freed individually -- they all go away when the TextPage is cleared
+// or deleted.
 class TextChar {
 public:
 
-  TextChar(Unicode cA, int charPosA, int charLenA,
-	   double xMinA, double yMinA, double xMaxA, double yMaxA,
-	   int rotA, GBool rotatedA, GBool clippedA, GBool invisibleA,
-	   TextFontInfo *fontA, double fontSizeA,
-	   double colorRA, double colorGA, double colorBA);
+  static TextChar *make(GArena *arena,
+			Unicode cA, int charPosA, int charLenA,
+			double xMinA, double yMinA, double xMaxA, double yMaxA,
+			int rotA, GBool rotatedA, GBool clippedA,
+			GBool invisibleA, TextFontInfo *fontA, double fontSizeA,
+			double colorRA, double colorGA, double colorBA);
 
   static int cmpX(const void *p1, const void *p2);
   static int cmpY(const void *p1, const void *p2);
@@ -235,64 +240,70 @@ public:
   char overlap;
 };
 
-TextChar::TextChar(Unicode cA, int charPosA, int charLenA,
-		   double xMinA, double yMinA, double xMaxA, double yMaxA,
-		   int rotA, GBool rotatedA, GBool clippedA, GBool invisibleA,
-		   TextFontInfo *fontA, double fontSizeA,
-		   double colorRA, double colorGA, double colorBA) {
+TextChar *TextChar::make(GArena *arena,
+			 Unicode cA, int charPosA, int charLenA,
+			 double xMinA, double yMinA,
+			 double xMaxA, double yMaxA,
+			 int rotA, GBool rotatedA, GBool clippedA,
+			 GBool invisibleA, TextFontInfo *fontA,
+			 double fontSizeA,
+			 double colorRA, double colorGA, double colorBA) {
+  TextChar *ch;
   double t;
 
-  c = cA;
-  charPos = charPosA;
-  charLen = charLenA;
-  xMin = xMinA;
-  yMin = yMinA;
-  xMax = xMaxA;
-  yMax = yMaxA;
+  ch = (TextChar *)arena->alloc((int)sizeof(TextChar));
+  ch->c = cA;
+  ch->charPos = charPosA;
+  ch->charLen = charLenA;
+  ch->xMin = xMinA;
+  ch->yMin = yMinA;
+  ch->xMax = xMaxA;
+  ch->yMax = yMaxA;
   // this can happen with vertical writing mode, or with odd values
   // for the char/word spacing parameters
-  if (xMin > xMax) {
-    t = xMin; xMin = xMax; xMax = t;
+  if (ch->xMin > ch->xMax) {
+    t = ch->xMin; ch->xMin = ch->xMax; ch->xMax = t;
   }
-  if (yMin > yMax) {
-    t = yMin; yMin = yMax; yMax = t;
+  if (ch->yMin > ch->yMax) {
+    t = ch->yMin; ch->yMin = ch->yMax; ch->yMax = t;
   }
   // TextPage::findGaps uses integer coordinates, so clip the char
   // bbox to fit in a 32-bit int (this is generally only a problem in
   // damaged PDF files)
-  if (xMin < -1e8) {
-    xMin = -1e8;
+  if (ch->xMin < -1e8) {
+    ch->xMin = -1e8;
   }
-  if (xMax > 1e8) {
-    xMax = 1e8;
+  if (ch->xMax > 1e8) {
+    ch->xMax = 1e8;
   }
-  if (yMin < -1e8) {
-    yMin = -1e8;
+  if (ch->yMin < -1e8) {
+    ch->yMin = -1e8;
   }
-  if (yMax > 1e8) {
-    yMax = 1e8;
+  if (ch->yMax > 1e8) {
+    ch->yMax = 1e8;
   }
   // zero-width characters will cause problems in the splitting code
   if (rotA & 1) {
-    if (yMax - yMin < 1e-6) {
-      yMax = yMin + 1e-6;
+    if (ch->yMax - ch->yMin < 1e-6) {
+      ch->yMax = ch->yMin + 1e-6;
     }
   } else {
-    if (xMax - xMin < 1e-6) {
-      xMax = xMin + 1e-6;
+    if (ch->xMax - ch->xMin < 1e-6) {
+      ch->xMax = ch->xMin + 1e-6;
     }
   }
-  rot = (Guchar)rotA;
-  rotated = (char)rotatedA;
-  clipped = (char)clippedA;
-  invisible = (char)invisibleA;
-  spaceAfter = (char)gFalse;
-  font = fontA;
-  fontSize = fontSizeA;
-  colorR = colorRA;
-  colorG = colorGA;
-  colorB = colorBA;
-  overlap = gFalse;
+  ch->rot = (Guchar)rotA;
+  ch->rotated = (char)rotatedA;
+  ch->clipped = (char)clippedA;
+  ch->invisible = (char)invisibleA;
+  ch->spaceAfter = (char)gFalse;
+  ch->font = fontA;
+  ch->fontSize = fontSizeA;
+  ch->colorR = colorRA;
+  ch->colorG = colorGA;
+  ch->colorB = colorBA;
+  ch->overlap = gFalse;
+  return ch;
 }
 
 int TextChar::cmpX(const void *p1, const void *p2) {
@@ -1210,6 +1221,7 @@ TextPage::TextPage(TextOutputControl *controlA) {
   actualTextY1 = 0;
   actualTextNBytes = 0;
 
+  arena = new GArena();
   chars = new GList();
   fonts = new GList();
 
@@ -1225,7 +1237,7 @@ TextPage::TextPage(TextOutputControl *controlA) {
 
 TextPage::~TextPage() {
   clear();
-  deleteGList(chars, TextChar);
+  delete chars;
   deleteGList(fonts, TextFontInfo);
   deleteGList(underlines, TextUnderline);
   deleteGList(links, TextLink);
@@ -1233,6 +1245,7 @@ TextPage::~TextPage() {
     deleteGList(findCols, TextColumn);
   }
   gfree(uBuf);
+  delete arena;
 }
 
 void TextPage::startPage(GfxState *state) {
@@ -1258,8 +1271,9 @@ void TextPage::clear() {
   actualText = NULL;
   actualTextLen = 0;
   actualTextNBytes = 0;
-  deleteGList(chars, TextChar);
+  delete chars;
   chars = new GList();
+  arena->reset();
   deleteGList(fonts, TextFontInfo);
   fonts = new GList();
   deleteGList(underlines, TextUnderline);
@@ -1560,13 +1574,13 @@ void TextPage::addChar(GfxState *state, double x, double y,
       } else {
 	j = i;
       }
-      chars->append(new TextChar(uBuf[j], charPos, nBytes,
-				 xMin, yMin, xMax, yMax,
-				 curRot, rotated, clipped,
-				 state->getRender() == 3 || alpha < 0.001,
-				 curFont, curFontSize,
-				 colToDbl(rgb.r), colToDbl(rgb.g),
-				 colToDbl(rgb.b)));
+      chars->append(TextChar::make(arena, uBuf[j], charPos, nBytes,
+				   xMin, yMin, xMax, yMax,
+				   curRot, rotated, clipped,
+				   state->getRender() == 3 || alpha < 0.001,
+				   curFont, curFontSize,
+				   colToDbl(rgb.r), colToDbl(rgb.g),
+				   colToDbl(rgb.b)));
     }
   }
 
@@ -1577,8 +1591,9 @@ void TextPage::addSpecialChar(double xMin, double yMin,
 			      double xMax, double yMax,
 			      int rot, TextFontInfo *font, double fontSize,
 			      Unicode u) {
-  chars->append(new TextChar(u, 0, 0, xMin, yMin, xMax, yMax, rot,
-			     gFalse, gFalse, gFalse, font, fontSize, 0, 0, 0));
+  chars->append(TextChar::make(arena, u, 0, 0, xMin, yMin, xMax, yMax, rot,
+			       gFalse, gFalse, gFalse, font, fontSize,
+			       0, 0, 0));
 }
 
 //~ this is inefficient -- consider using some sort of tree
@@ -1596,7 +1611,6 @@ void TextPage::removeChars(double xMin, double yMin,
     if (xOverlap > xOverlapThresh * (ch->xMax - ch->xMin) &&
 	yOverlap > yOverlapThresh * (ch->yMax - ch->yMin)) {
       chars->del(i);
-      delete ch;
     } else {
       ++i;
     }
@@ -1762,7 +1776,7 @@ void TextPage::writeReadingOrder(void *outputStream,
     if (overlappingChars->getLength() > 0) {
       columns->append(buildOverlappingTextColumn(overlappingChars));
     }
-    deleteGList(overlappingChars, TextChar);
+    delete overlappingChars;
   }
 #if 0 //~debug
   dumpColumns(columns);
@@ -1831,7 +1845,7 @@ GList *TextPage::makeColumns() {
       if (overlappingChars->getLength() > 0) {
 	columns->append(buildOverlappingTextColumn(overlappingChars));
       }
-      deleteGList(overlappingChars, TextChar);
+      delete overlappingChars;
     }
   }
   return columns;
@@ -1958,7 +1972,7 @@ void TextPage::writePhysLayout(void *outputStream,
       }
       delete col;
     }
-    deleteGList(overlappingChars, TextChar);
+    delete overlappingChars;
   }
 }
 
@@ -3398,8 +3412,6 @@ GList *TextPage::separateOverlappingText(GList *charsA) {
 	for (int j = j0; j <= j1; ++j) {
 	  if (overlapChars) {
 	    overlapChars->append(charsA->get(j0));
-	  } else {
-	    delete (TextChar *)charsA->get(j0);
 	  }
 	  charsA->del(j0);
 	}
@@ -6361,7 +6373,7 @@ TextWordList *TextPage::makeWordListForChars(GList *charList) {
       if (overlappingChars->getLength() > 0) {
 	columns->append(buildOverlappingTextColumn(overlappingChars));
       }
-      deleteGList(overlappingChars, TextChar);
+      delete overlappingChars;
     }
   }
 
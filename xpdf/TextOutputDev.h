@@ -21,6 +21,7 @@
 #include "OutputDev.h"
 
 class GList;
+class GArena;
 class UnicodeMap;
 class UnicodeRemapping;
 
@@ -637,6 +638,7 @@ private:
          actualTextY1;
   int actualTextNBytes;
 
+  GArena *arena;		// page-lifetime allocations (TextChars)
   GList *chars;			// [TextChar]
   GList *fonts;			// all font info objects used on this
 				//   page [TextFontInfo]
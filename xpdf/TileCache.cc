@@ -12,6 +12,8 @@
 #pragma implementation
 #endif
 
+#include <string.h>
+#include <math.h>
 #include "gmem.h"
 #include "gmempp.h"
 #include "GList.h"
@@ -25,12 +27,168 @@
 #include "Object.h"
 #include "PDFDoc.h"
 #include "SplashBitmap.h"
+#include "Splash.h"
 #include "SplashOutputDev.h"
+#include "GlobalParams.h"
 #include "DisplayState.h"
 #include "GfxState.h"
 #include "TileMap.h"
 #include "TileCache.h"
 
+//------------------------------------------------------------------------
+
+// Tiles rasterized at resolutions within this factor of an active
+// tile's resolution (on the same page) are kept, subject to the
+// tilePyramidCacheSize memory limit, and used as placeholders.
+#define tilePyramidMaxScale 4.0
+
+//------------------------------------------------------------------------
+// CompressedTile
+//
+// Inactive tiles can be stored in a run-length encoded form.  Each
+// row of pixels is coded as a sequence of packets, where a pixel is
+// <pixSize> bytes:
+//   n = 0 .. 127   -- (n + 1) literal pixels follow
+//   n = 128 .. 255 -- the next pixel is repeated (n - 126) times
+// Rasterized pages usually have large areas of paper color, which
+// compress very well.  The alpha channel is dropped -- it's only used
+// to display tiles which are still being rasterized.
+//------------------------------------------------------------------------
+
+class CompressedTile {
+public:
+
+  // Compress <bitmap>.  Returns NULL if the compressed form isn't
+  // significantly smaller than the original.
+  static CompressedTile *compress(SplashBitmap *bitmap);
+
+  ~CompressedTile() { gfree(data); }
+
+  // Decompress into a new bitmap.
+  SplashBitmap *decompress();
+
+  size_t getSize() { return size; }
+
+private:
+
+  CompressedTile() {}
+  static int getPixelSize(SplashColorMode mode, int width,
+			  int *pixelsPerRow);
+
+  int width, height;
+  SplashColorMode mode;
+  GBool topDown;
+  Guchar *data;
+  size_t size;
+};
+
+int CompressedTile::getPixelSize(SplashColorMode mode, int width,
+				 int *pixelsPerRow) {
+  if (mode == splashModeMono1) {
+    *pixelsPerRow = (width + 7) >> 3;
+    return 1;
+  }
+  *pixelsPerRow = width;
+  return splashColorModeNComps[mode];
+}
+
+CompressedTile *CompressedTile::compress(SplashBitmap *bitmap) {
+  CompressedTile *ct;
+  SplashBitmapRowSize rowSize;
+  Guchar *buf, *row, *p, *q;
+  size_t rawSize, maxSize, n;
+  int pixSize, pixPerRow, x, y, run, lit;
+
+  pixSize = getPixelSize(bitmap->getMode(), bitmap->getWidth(), &pixPerRow);
+  rowSize = bitmap->getRowSize();
+  if (rowSize < 0) {
+    rowSize = -rowSize;
+  }
+  rawSize = (size_t)rowSize * bitmap->getHeight();
+
+  // stop as soon as the output would exceed 3/4 of the raw size
+  maxSize = rawSize - rawSize / 4;
+  // (each packet codes at least one pixel, so a row can't expand by
+  // more than one byte per pixel)
+  buf = (Guchar *)gmalloc(maxSize + (size_t)pixPerRow * (pixSize + 1));
+  n = 0;
+  for (y = 0; y < bitmap->getHeight(); ++y) {
+    row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+    x = 0;
+    while (x < pixPerRow) {
+      p = row + x * pixSize;
+      for (run = 1;
+	   run < 129 && x + run < pixPerRow &&
+	     !memcmp(p, p + run * pixSize, pixSize);
+	   ++run) ;
+      if (run > 1) {
+	buf[n++] = (Guchar)(run + 126);
+	memcpy(buf + n, p, pixSize);
+	n += pixSize;
+	x += run;
+      } else {
+	// collect literal pixels up to the start of the next run
+	for (lit = 1; lit < 128 && x + lit < pixPerRow; ++lit) {
+	  q = p + lit * pixSize;
+	  if (x + lit + 1 < pixPerRow && !memcmp(q, q + pixSize, pixSize)) {
+	    break;
+	  }
+	}
+	buf[n++] = (Guchar)(lit - 1);
+	memcpy(buf + n, p, lit * pixSize);
+	n += lit * pixSize;
+	x += lit;
+      }
+    }
+    if (n > maxSize) {
+      gfree(buf);
+      return NULL;
+    }
+  }
+
+  ct = new CompressedTile();
+  ct->width = bitmap->getWidth();
+  ct->height = bitmap->getHeight();
+  ct->mode = bitmap->getMode();
+  ct->topDown = bitmap->getRowSize() >= 0;
+  ct->data = (Guchar *)grealloc(buf, n ? n : 1);
+  ct->size = n;
+  return ct;
+}
+
+SplashBitmap *CompressedTile::decompress() {
+  SplashBitmap *bitmap;
+  Guchar *p, *row, *q;
+  int pixSize, pixPerRow, x, y, n, i;
+
+  bitmap = new SplashBitmap(width, height, 1, mode, gFalse, topDown, NULL);
+  pixSize = getPixelSize(mode, width, &pixPerRow);
+  p = data;
+  for (y = 0; y < height; ++y) {
+    row = bitmap->getDataPtr() + y * bitmap->getRowSize();
+    q = row;
+    x = 0;
+    while (x < pixPerRow) {
+      n = *p++;
+      if (n < 128) {
+	n += 1;
+	memcpy(q, p, n * pixSize);
+	p += n * pixSize;
+	q += n * pixSize;
+      } else {
+	n -= 126;
+	for (i = 0; i < n; ++i) {
+	  memcpy(q, p, pixSize);
+	  q += pixSize;
+	}
+	p += pixSize;
+      }
+      x += n;
+    }
+  }
+  return bitmap;
+}
+
 //------------------------------------------------------------------------
 // CachedTileDesc
 //------------------------------------------------------------------------
@@ -51,19 +209,80 @@ public:
     TileDesc(tile->page, tile->rotate, tile->dpi,
 	     tile->tx, tile->ty, tile->tw, tile->th),
     state(cachedTileUnstarted), active(gTrue),
-    bitmap(NULL), freeBitmap(gFalse) {}
+    bitmap(NULL), freeBitmap(gFalse),
+    compressed(NULL), incompressible(gFalse) {}
   ~CachedTileDesc();
 
+  // Switch a finished tile to compressed form.  Returns false if the
+  // tile doesn't compress well.
+  GBool compress();
+
+  // Switch a compressed tile back to a bitmap.
+  void decompress();
+
+  // Return the amount of memory used by the tile's bitmap (or
+  // compressed data).
+  size_t getMemSize();
+
   CachedTileState state;
   GBool active;
-  SplashBitmap *bitmap;
+  SplashBitmap *bitmap;		// NULL if the tile is compressed
   GBool freeBitmap;
+  CompressedTile *compressed;	// non-NULL if the tile is compressed
+  GBool incompressible;		// set if compression was tried and
+				//   failed
 };
 
 CachedTileDesc::~CachedTileDesc() {
   if (freeBitmap) {
     delete bitmap;
   }
+  delete compressed;
+}
+
+GBool CachedTileDesc::compress() {
+  if (!(compressed = CompressedTile::compress(bitmap))) {
+    incompressible = gTrue;
+    return gFalse;
+  }
+  delete bitmap;
+  bitmap = NULL;
+  freeBitmap = gFalse;
+  return gTrue;
+}
+
+void CachedTileDesc::decompress() {
+  bitmap = compressed->decompress();
+  freeBitmap = gTrue;
+  delete compressed;
+  compressed = NULL;
+}
+
+size_t CachedTileDesc::getMemSize() {
+  SplashBitmapRowSize rowSize;
+  size_t size;
+
+  if (compressed) {
+    return compressed->getSize();
+  }
+  if (!bitmap) {
+    return 0;
+  }
+  rowSize = bitmap->getRowSize();
+  if (rowSize < 0) {
+    rowSize = -rowSize;
+  }
+  size = (size_t)rowSize * bitmap->getHeight();
+  if (bitmap->getAlphaPtr()) {
+    size += bitmap->getAlphaRowSize() * bitmap->getHeight();
+  }
+  return size;
+}
+
+static GBool isNearbyDPI(double dpi1, double dpi2) {
+  return dpi1 != dpi2 &&
+         dpi1 * tilePyramidMaxScale >= dpi2 &&
+         dpi2 * tilePyramidMaxScale >= dpi1;
 }
 
 //------------------------------------------------------------------------
@@ -270,6 +489,8 @@ TileCache::TileCache(DisplayState *stateA) {
   state->setTileCache(this);
   cache = new GList();
   threadPool = new TileCacheThreadPool(this, state->getNWorkerThreads());
+  imageCache = new SplashImageCache(
+		     (size_t)globalParams->getImageCacheSize() << 20);
   tileDoneCbk = NULL;
   tileDoneCbkData = NULL;
 }
@@ -277,6 +498,7 @@ TileCache::TileCache(DisplayState *stateA) {
 TileCache::~TileCache() {
   flushCache(gFalse);
   delete threadPool;
+  imageCache->decRefCount();
   delete cache;
 }
 
@@ -341,6 +563,9 @@ SplashBitmap *TileCache::getTileBitmap(TileDesc *tile, GBool *finished) {
     return NULL;
   }
   ct = (CachedTileDesc *)cache->get(cacheIdx);
+  if (ct->compressed) {
+    ct->decompress();
+  }
   if (ct->state != cachedTileCanceled) {
     bitmap = ct->bitmap;
   } else {
@@ -353,6 +578,51 @@ SplashBitmap *TileCache::getTileBitmap(TileDesc *tile, GBool *finished) {
   return bitmap;
 }
 
+GList *TileCache::getPlaceholderTiles(TileDesc *tile) {
+  GList *tiles;
+  CachedTileDesc *ct;
+  PlaceholderTileDesc *pt;
+  double scale, dist;
+  int i, j;
+
+  tiles = new GList();
+  if (state->getTilePyramidCacheSize() <= 0) {
+    return tiles;
+  }
+  threadPool->lockMutex();
+  for (i = 0; i < cache->getLength(); ++i) {
+    ct = (CachedTileDesc *)cache->get(i);
+    if (ct->state != cachedTileFinished ||
+	ct->page != tile->page ||
+	ct->rotate != tile->rotate ||
+	!isNearbyDPI(ct->dpi, tile->dpi)) {
+      continue;
+    }
+    // check for overlap in <tile>'s device space
+    scale = tile->dpi / ct->dpi;
+    if (ct->tx * scale >= tile->tx + tile->tw ||
+	(ct->tx + ct->tw) * scale <= tile->tx ||
+	ct->ty * scale >= tile->ty + tile->th ||
+	(ct->ty + ct->th) * scale <= tile->ty) {
+      continue;
+    }
+    if (ct->compressed) {
+      ct->decompress();
+    }
+    // keep the list sorted by decreasing distance from tile->dpi
+    dist = fabs(log(scale));
+    for (j = 0; j < tiles->getLength(); ++j) {
+      pt = (PlaceholderTileDesc *)tiles->get(j);
+      if (fabs(log(tile->dpi / pt->dpi)) < dist) {
+	break;
+      }
+    }
+    tiles->insert(j, new PlaceholderTileDesc(ct, ct->bitmap));
+  }
+  threadPool->unlockMutex();
+  return tiles;
+}
+
 void TileCache::paperColorChanged() {
   flushCache(gFalse);
 }
@@ -367,6 +637,7 @@ void TileCache::optionalContentChanged() {
 
 void TileCache::docChanged() {
   flushCache(gTrue);
+  imageCache->flush();
 }
 
 
@@ -390,25 +661,49 @@ int TileCache::findTile(TileDesc *tile, GList *tileList) {
   return -1;
 }
 
-// If there are too many tiles in the cache, remove the least recently
-// used tiles.  Never removes active tiles.  The caller must have
-// locked the ThreadPool mutex.
+// If the cache uses too much memory (or, if tileCacheSize is set,
+// has too many tiles), remove the least recently used tiles.  If
+// tile compression is enabled, inactive tiles are compressed first.
+// Pyramid tiles (see isPyramidTile) are not counted against these
+// limits -- they are limited separately, by the tilePyramidCacheSize
+// memory budget, and they are never compressed.  Never removes active
+// tiles.  The caller must have locked the ThreadPool mutex.
 void TileCache::cleanCache() {
   CachedTileDesc *ct;
-  int n, i;
+  size_t size, maxSize, pyramidSize, maxPyramidSize, tileSize;
+  int n, maxN, i;
 
-  // count the number of non-canceled tiles
+  // compress inactive tiles; count the number of non-canceled tiles,
+  // and the memory used by regular and pyramid tiles
   n = 0;
+  size = pyramidSize = 0;
   for (i = 0; i < cache->getLength(); ++i) {
     ct = (CachedTileDesc *)cache->get(i);
     if (ct->state != cachedTileCanceled) {
-      ++n;
+      if (isPyramidTile(ct)) {
+	pyramidSize += ct->getMemSize();
+      } else {
+	if (!ct->active && ct->state == cachedTileFinished &&
+	    ct->bitmap && !ct->incompressible &&
+	    state->getTileCacheCompression()) {
+	  ct->compress();
+	}
+	size += ct->getMemSize();
+	++n;
+      }
     }
   }
+  maxSize = (size_t)state->getTileCacheMemory() << 20;
+  maxN = state->getTileCacheSize();
+  if (maxN <= 0) {
+    maxN = cache->getLength();
+  }
+  maxPyramidSize = (size_t)state->getTilePyramidCacheSize() << 20;
 
-  // if there are too many non-canceled tiles, remove tiles
+  // if the cache is too big, remove tiles
   i = cache->getLength() - 1;
-  while (n > state->getTileCacheSize() && i >= 0) {
+  while ((n > maxN || size > maxSize || pyramidSize > maxPyramidSize) &&
+	 i >= 0) {
     ct = (CachedTileDesc *)cache->get(i);
     if (ct->active) {
       break;
@@ -416,15 +711,49 @@ void TileCache::cleanCache() {
     // any non-active tiles with state == cachedTileUnstarted should
     // already have been removed by setActiveTileList()
     if (ct->state == cachedTileFinished) {
-      delete (CachedTileDesc *)cache->del(i);
-      --n;
-      --i;
-    } else {
-      --i;
+      tileSize = ct->getMemSize();
+      if (isPyramidTile(ct)) {
+	if (pyramidSize > maxPyramidSize) {
+	  pyramidSize -= tileSize;
+	  delete (CachedTileDesc *)cache->del(i);
+	}
+      } else if (n > maxN || size > maxSize) {
+	size -= tileSize;
+	--n;
+	delete (CachedTileDesc *)cache->del(i);
+      }
     }
+    --i;
   }
 }
 
+// Returns true if <ct> is a finished, inactive tile which can be used
+// as a placeholder for an active tile, i.e., an active tile on the
+// same page and rotation, at a nearby (but different) resolution.
+// The caller must have locked the ThreadPool mutex.
+GBool TileCache::isPyramidTile(CachedTileDesc *ct) {
+  CachedTileDesc *t;
+  int i;
+
+  if (ct->active || ct->state != cachedTileFinished ||
+      state->getTilePyramidCacheSize() <= 0) {
+    return gFalse;
+  }
+  // active tiles are always at the front of the cache list
+  for (i = 0; i < cache->getLength(); ++i) {
+    t = (CachedTileDesc *)cache->get(i);
+    if (!t->active) {
+      break;
+    }
+    if (t->state != cachedTileCanceled &&
+	t->page == ct->page && t->rotate == ct->rotate &&
+	isNearbyDPI(t->dpi, ct->dpi)) {
+      return gTrue;
+    }
+  }
+  return gFalse;
+}
+
 // Remove all cached tiles.  For tiles that are being rasterized, sets
 // state to canceled.  If <wait> is true, this function won't return
 // until the cache is empty, i.e., until all possible users of the
@@ -534,6 +863,7 @@ void TileCache::rasterizeTile(CachedTileDesc *ct) {
   info.out = out;
   out->setStartPageCallback(&TileCache::startPageCbk, &info);
   out->startDoc(state->getDoc()->getXRef());
+  out->setImageCache(imageCache);
   state->getDoc()->displayPageSlice(out, ct->page, ct->dpi, ct->dpi, ct->rotate,
 				    gFalse, gTrue, gFalse,
 				    ct->tx, ct->ty, ct->tw, ct->th,
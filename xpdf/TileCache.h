@@ -17,13 +17,30 @@
 
 #include "gtypes.h"
 #include "SplashTypes.h"
+#include "TileMap.h"
 
 class SplashBitmap;
+class SplashImageCache;
 class SplashOutputDev;
 class DisplayState;
 class CachedTileDesc;
 class TileCacheThreadPool;
-class TileDesc;
+
+//------------------------------------------------------------------------
+
+// A finished tile, rasterized at a different resolution, which can be
+// scaled and displayed in place of a tile that hasn't been rasterized
+// yet.
+class PlaceholderTileDesc: public TileDesc {
+public:
+
+  PlaceholderTileDesc(TileDesc *tile, SplashBitmap *bitmapA):
+    TileDesc(tile->page, tile->rotate, tile->dpi,
+	     tile->tx, tile->ty, tile->tw, tile->th),
+    bitmap(bitmapA) {}
+
+  SplashBitmap *bitmap;		// owned by the TileCache
+};
 
 //------------------------------------------------------------------------
 
@@ -43,6 +60,15 @@ public:
   // otherwise.
   SplashBitmap *getTileBitmap(TileDesc *tile, GBool *finished);
 
+  // Return a list of PlaceholderTileDesc objects for finished tiles,
+  // rasterized at nearby zoom levels, which overlap <tile>.  The list
+  // is sorted so that the closest resolution comes last, i.e., the
+  // tiles should be drawn in list order.  The caller is responsible
+  // for deleting the list (and its PlaceholderTileDesc objects).  The
+  // bitmaps remain valid until the next call to setActiveTileList()
+  // or to one of the xxxChanged() functions.
+  GList *getPlaceholderTiles(TileDesc *tile);
+
   // Set a callback to be called whenever a tile rasterization is
   // finished.  NB: this callback will be called from a worker thread.
   void setTileDoneCbk(void (*cbk)(void *data), void *data)
@@ -58,6 +84,7 @@ private:
 
   int findTile(TileDesc *tile, GList *tileList);
   void cleanCache();
+  GBool isPyramidTile(CachedTileDesc *ct);
   void flushCache(GBool wait);
   void removeTile(CachedTileDesc *ct);
   GBool hasUnstartedTiles();
@@ -69,6 +96,8 @@ private:
   DisplayState *state;
   GList *cache;			// [CachedTileDesc]
   TileCacheThreadPool *threadPool;
+  SplashImageCache *imageCache;	// scaled images, shared by all of the
+				//   worker threads
   void (*tileDoneCbk)(void *data);
   void *tileDoneCbkData;
 
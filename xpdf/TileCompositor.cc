@@ -14,6 +14,7 @@
 
 #include <string.h>
 #include <math.h>
+#include "gmem.h"
 #include "gmempp.h"
 #include "GString.h"
 #include "GList.h"
@@ -52,8 +53,9 @@ SplashBitmap *TileCompositor::getBitmap(GBool *finished) {
   GList *tiles;
   PlacedTileDesc *tile;
   SplashBitmap *tileBitmap;
+  GList *placeholders;
   GBool allTilesFinished, tileFinished;
-  int xSrc, ySrc, xDest, yDest, w, h, i;
+  int xSrc, ySrc, xDest, yDest, w, h, i, j;
 
   if (bitmapValid) {
     *finished = gTrue;
@@ -102,11 +104,29 @@ SplashBitmap *TileCompositor::getBitmap(GBool *finished) {
       h = state->getWinH() - yDest;
     }
     if (w > 0 && h > 0) {
-      if ((tileBitmap = tileCache->getTileBitmap(tile, &tileFinished))) {
+      tileFinished = gFalse;
+      tileBitmap = tileCache->getTileBitmap(tile, &tileFinished);
+      if (tileBitmap && tileFinished) {
 	blit(tileBitmap, xSrc, ySrc,
-	     bitmap, xDest, yDest, w, h, !tileFinished);
+	     bitmap, xDest, yDest, w, h, gFalse);
       } else {
-	fill(xDest, yDest, w, h, state->getPaperColor());
+	// if the tile isn't finished, use scaled tiles from nearby
+	// zoom levels (if any) in place of a partially rasterized
+	// tile
+	placeholders = tileCache->getPlaceholderTiles(tile);
+	if (placeholders->getLength() > 0) {
+	  fill(xDest, yDest, w, h, state->getPaperColor());
+	  for (j = 0; j < placeholders->getLength(); ++j) {
+	    blitPlaceholder((PlaceholderTileDesc *)placeholders->get(j), tile,
+			    xSrc, ySrc, xDest, yDest, w, h);
+	  }
+	} else if (tileBitmap) {
+	  blit(tileBitmap, xSrc, ySrc,
+	       bitmap, xDest, yDest, w, h, gTrue);
+	} else {
+	  fill(xDest, yDest, w, h, state->getPaperColor());
+	}
+	deleteGList(placeholders, PlaceholderTileDesc);
       }
       allTilesFinished &= tileFinished;
     }
@@ -346,6 +366,65 @@ void TileCompositor::blit(SplashBitmap *srcBitmap, int xSrc, int ySrc,
   }
 }
 
+// Scale the part of <placeholder> which overlaps [xSrc, ySrc, w, h]
+// in <tile> and copy it to [xDest, yDest] in the window bitmap.  This
+// uses nearest-neighbor sampling -- the result is only displayed
+// until <tile> is finished.  Pixels not covered by <placeholder> are
+// left unchanged.  This only supports the RGB8 and BGR8 color modes.
+void TileCompositor::blitPlaceholder(PlaceholderTileDesc *placeholder,
+				     TileDesc *tile,
+				     int xSrc, int ySrc, int xDest, int yDest,
+				     int w, int h) {
+  SplashBitmap *srcBitmap;
+  SplashColorPtr srcData, destData, srcRow, srcP, destP;
+  SplashBitmapRowSize srcRowSize, destRowSize;
+  double scale;
+  int *xMap;
+  int srcW, srcH, sx, sy, x, y;
+
+  srcBitmap = placeholder->bitmap;
+  srcW = srcBitmap->getWidth();
+  if (placeholder->tw < srcW) {
+    srcW = placeholder->tw;
+  }
+  srcH = srcBitmap->getHeight();
+  if (placeholder->th < srcH) {
+    srcH = placeholder->th;
+  }
+  scale = placeholder->dpi / tile->dpi;
+
+  // map each dest column to a source column (or -1)
+  xMap = (int *)gmallocn(w, sizeof(int));
+  for (x = 0; x < w; ++x) {
+    sx = (int)floor((tile->tx + xSrc + x + 0.5) * scale) - placeholder->tx;
+    xMap[x] = (sx >= 0 && sx < srcW) ? sx : -1;
+  }
+
+  srcData = srcBitmap->getDataPtr();
+  srcRowSize = srcBitmap->getRowSize();
+  destData = bitmap->getDataPtr();
+  destRowSize = bitmap->getRowSize();
+  for (y = 0; y < h; ++y) {
+    sy = (int)floor((tile->ty + ySrc + y + 0.5) * scale) - placeholder->ty;
+    if (sy < 0 || sy >= srcH) {
+      continue;
+    }
+    srcRow = &srcData[sy * srcRowSize];
+    destP = &destData[(yDest + y) * destRowSize + 3 * xDest];
+    for (x = 0; x < w; ++x) {
+      if (xMap[x] >= 0) {
+	srcP = &srcRow[3 * xMap[x]];
+	destP[0] = srcP[0];
+	destP[1] = srcP[1];
+	destP[2] = srcP[2];
+      }
+      destP += 3;
+    }
+  }
+
+  gfree(xMap);
+}
+
 // Fill [xDest, yDest, w, h] with color.  This only supports the RGB8
 // and BGR8 color modes.
 void TileCompositor::fill(int xDest, int yDest, int w, int h,
@@ -21,6 +21,8 @@ class GList;
 class SplashBitmap;
 class DisplayState;
 class TileCache;
+class TileDesc;
+class PlaceholderTileDesc;
 
 //------------------------------------------------------------------------
 
@@ -59,6 +61,8 @@ private:
   void blit(SplashBitmap *srcBitmap, int xSrc, int ySrc,
 	    SplashBitmap *destBitmap, int xDest, int yDest,
 	    int w, int h, GBool compositeWithPaper);
+  void blitPlaceholder(PlaceholderTileDesc *placeholder, TileDesc *tile,
+		       int xSrc, int ySrc, int xDest, int yDest, int w, int h);
   void fill(int xDest, int yDest, int w, int h,
 	    SplashColorPtr color);
   void drawSelection();
@@ -34,6 +34,12 @@
 #define xrefSearchSize 1024	// read this many bytes at end of file
 				//   to look for 'startxref'
 
+#define xrefPrefetchGap (32 * 1024)	// prefetch ranges which are
+					//   closer than this are merged
+#define xrefPrefetchMaxObjSize (64 * 1024)	// size assumed for an
+						//   object with no known
+						//   end
+
 //------------------------------------------------------------------------
 // Permission bits
 //------------------------------------------------------------------------
@@ -308,11 +314,14 @@ XRef::XRef(BaseStream *strA, GBool repair) {
   xrefTablePosLen = 0;
   streamEnds = NULL;
   streamEndsLen = 0;
+  objEnds = NULL;
+  objEndsLen = 0;
   for (i = 0; i < objStrCacheSize; ++i) {
     objStrs[i] = NULL;
     objStrLastUse[i] = 0;
   }
   objStrCacheLength = 0;
+  objStrCacheMax = objStrCacheSize;
   objStrTime = 0;
 
   encrypted = gFalse;
@@ -401,6 +410,7 @@ XRef::~XRef() {
   if (streamEnds) {
     gfree(streamEnds);
   }
+  gfree(objEnds);
   for (i = 0; i < objStrCacheSize; ++i) {
     if (objStrs[i]) {
       delete objStrs[i];
@@ -1351,8 +1361,9 @@ ObjectStream *XRef::getObjectStream(int objStrNum) {
   }
 
   // add to the cache
-  if (objStrCacheLength == objStrCacheSize) {
-    delete objStrs[objStrCacheSize - 1];
+  if (objStrCacheLength >= objStrCacheMax) {
+    delete objStrs[objStrCacheLength - 1];
+    objStrs[objStrCacheLength - 1] = NULL;
     --objStrCacheLength;
   }
   for (j = objStrCacheLength; j > 0; --j) {
@@ -1366,6 +1377,26 @@ ObjectStream *XRef::getObjectStream(int objStrNum) {
   return objStr;
 }
 
+void XRef::setObjStrCacheSize(int n) {
+#if MULTITHREADED
+  gLockMutex(&objStrsMutex);
+#endif
+  if (n < 1) {
+    n = 1;
+  } else if (n > objStrCacheSize) {
+    n = objStrCacheSize;
+  }
+  objStrCacheMax = n;
+  while (objStrCacheLength > objStrCacheMax) {
+    delete objStrs[objStrCacheLength - 1];
+    objStrs[objStrCacheLength - 1] = NULL;
+    --objStrCacheLength;
+  }
+#if MULTITHREADED
+  gUnlockMutex(&objStrsMutex);
+#endif
+}
+
 // If the oldest (least recently used) entry in the object stream
 // cache is more than objStrCacheTimeout accesses old (hasn't been
 // used in the last objStrCacheTimeout accesses), eject it from the
@@ -1415,6 +1446,144 @@ GBool XRef::getStreamEnd(GFileOffset streamStart, GFileOffset *streamEnd) {
   return gTrue;
 }
 
+struct XRefPrefetchRange {
+  GFileOffset start, end;
+};
+
+static int cmpFileOffsets(const void *p1, const void *p2) {
+  GFileOffset x1 = *(const GFileOffset *)p1;
+  GFileOffset x2 = *(const GFileOffset *)p2;
+  return x1 < x2 ? -1 : x1 > x2 ? 1 : 0;
+}
+
+static int cmpPrefetchRanges(const void *p1, const void *p2) {
+  return cmpFileOffsets(&((const XRefPrefetchRange *)p1)->start,
+			&((const XRefPrefetchRange *)p2)->start);
+}
+
+void XRef::prefetch(Ref *refs, int nRefs) {
+  XRefPrefetchRange *ranges;
+  XRefEntry *e;
+  GFileOffset pos;
+  GBool cached;
+  int nRanges, num, i, j, k;
+
+  if (nRefs <= 0) {
+    return;
+  }
+#if MULTITHREADED
+  gLockMutex(&cacheMutex);
+#endif
+  if (!objEnds) {
+    buildObjEnds();
+  }
+#if MULTITHREADED
+  gUnlockMutex(&cacheMutex);
+#endif
+
+  // find the byte range of each object -- for an object in an object
+  // stream, this is the object stream (unless it's already been read
+  // into the object stream cache)
+  ranges = (XRefPrefetchRange *)gmallocn(nRefs, sizeof(XRefPrefetchRange));
+  nRanges = 0;
+  for (i = 0; i < nRefs; ++i) {
+    num = refs[i].num;
+    if (num < 0 || num >= size) {
+      continue;
+    }
+    e = &entries[num];
+    if (e->type == xrefEntryCompressed) {
+      if (e->offset >= (GFileOffset)size) {
+	continue;
+      }
+      cached = gFalse;
+#if MULTITHREADED
+      gLockMutex(&objStrsMutex);
+#endif
+      for (k = 0; k < objStrCacheLength; ++k) {
+	if (objStrs[k] && objStrs[k]->getObjStrNum() == (int)e->offset) {
+	  cached = gTrue;
+	  break;
+	}
+      }
+#if MULTITHREADED
+      gUnlockMutex(&objStrsMutex);
+#endif
+      if (cached) {
+	continue;
+      }
+      e = &entries[(int)e->offset];
+    }
+    if (e->type != xrefEntryUncompressed) {
+      continue;
+    }
+    pos = start + e->offset;
+    ranges[nRanges].start = pos;
+    ranges[nRanges].end = getObjectEnd(pos);
+    ++nRanges;
+  }
+
+  // merge overlapping and nearby ranges, and issue the prefetches
+  qsort(ranges, nRanges, sizeof(XRefPrefetchRange), &cmpPrefetchRanges);
+  for (i = 0; i < nRanges; i = j) {
+    for (j = i + 1;
+	 j < nRanges && ranges[j].start <= ranges[i].end + xrefPrefetchGap;
+	 ++j) {
+      if (ranges[j].end > ranges[i].end) {
+	ranges[i].end = ranges[j].end;
+      }
+    }
+    str->prefetch(ranges[i].start, ranges[i].end - ranges[i].start);
+  }
+  gfree(ranges);
+}
+
+// Build the sorted list of positions used by getObjectEnd(): the
+// start of each uncompressed object, plus the xref tables and the
+// 'startxref'.
+void XRef::buildObjEnds() {
+  int n, i;
+
+  objEnds = (GFileOffset *)gmallocn(size + xrefTablePosLen + 1,
+				    sizeof(GFileOffset));
+  n = 0;
+  for (i = 0; i < size; ++i) {
+    if (entries[i].type == xrefEntryUncompressed) {
+      objEnds[n++] = start + entries[i].offset;
+    }
+  }
+  for (i = 0; i < xrefTablePosLen; ++i) {
+    objEnds[n++] = start + xrefTablePos[i];
+  }
+  if (lastStartxrefPos > 0) {
+    objEnds[n++] = lastStartxrefPos;
+  }
+  qsort(objEnds, n, sizeof(GFileOffset), &cmpFileOffsets);
+  objEndsLen = n;
+}
+
+// Return the end of the object at <pos>, i.e., the next position in
+// objEnds.
+GFileOffset XRef::getObjectEnd(GFileOffset pos) {
+  int a, b, m;
+
+  if (objEndsLen == 0 || pos >= objEnds[objEndsLen - 1]) {
+    return pos + xrefPrefetchMaxObjSize;
+  }
+  a = -1;
+  b = objEndsLen - 1;
+  // invariant: objEnds[a] <= pos < objEnds[b]
+  while (b - a > 1) {
+    m = (a + b) / 2;
+    if (pos < objEnds[m]) {
+      b = m;
+    } else {
+      a = m;
+    }
+  }
+  return objEnds[b];
+}
+
 GFileOffset XRef::strToFileOffset(char *s) {
   GFileOffset x, d;
   char *p;
@@ -122,6 +122,16 @@ public:
   // Returns false if unknown or file is not damaged.
   GBool getStreamEnd(GFileOffset streamStart, GFileOffset *streamEnd);
 
+  // Limit the object stream cache to <n> object streams (at most
+  // objStrCacheSize, which is the default).
+  void setObjStrCacheSize(int n);
+
+  // Hint that the objects <refs>[0 .. <nRefs>-1] will be fetched
+  // soon.  This looks up the byte range of each object (or of the
+  // object stream containing it), merges nearby ranges, and passes
+  // them to the underlying BaseStream's prefetch function.
+  void prefetch(Ref *refs, int nRefs);
+
   // Direct access.
   int getSize() { return size; }
   XRefEntry *getEntry(int i) { return &entries[i]; }
@@ -148,9 +158,14 @@ private:
   GFileOffset *streamEnds;	// 'endstream' positions - only used in
 				//   damaged files
   int streamEndsLen;		// number of valid entries in streamEnds
+  GFileOffset *objEnds;		// sorted object and xref table positions,
+				//   used to find the end of each object
+				//   (only used by prefetch)
+  int objEndsLen;		// number of entries in objEnds
   ObjectStream *		// cached object streams
     objStrs[objStrCacheSize];
   int objStrCacheLength;	// number of valid entries in objStrs[]
+  int objStrCacheMax;		// max number of entries in objStrs[]
   Guint				// time of last use for each obj stream
     objStrLastUse[objStrCacheSize];
   Guint objStrTime;		// current time for the obj stream cache
@@ -187,6 +202,8 @@ private:
   ObjectStream *getObjectStream(int objStrNum);
   void cleanObjectStreamCache();
   GFileOffset strToFileOffset(char *s);
+  void buildObjEnds();
+  GFileOffset getObjectEnd(GFileOffset pos);
 };
 
 #endif
@@ -82,6 +82,7 @@ int main(int argc, char *argv[]) {
   GString *ownerPW, *userPW;
   ImageOutputDev *imgOut;
   GBool ok;
+  size_t peakMem;
   int exitCode;
 
   exitCode = 99;
@@ -136,6 +137,10 @@ int main(int argc, char *argv[]) {
     goto err1;
   }
 
+  // the pages are processed in order, once each, so there's no need
+  // to keep them around
+  doc->setStreamingMode(gTrue);
+
   // check for copy permission
   if (!doc->okToCopy()) {
     error(errNotAllowed, -1,
@@ -157,6 +162,11 @@ int main(int argc, char *argv[]) {
 		      gFalse, gTrue, gFalse);
   }
   delete imgOut;
+  if (globalParams->getPrintStatusInfo() &&
+      (peakMem = gMemPeakUsage()) > 0) {
+    printf("[peak memory usage: %.1f MB]\n",
+	   (double)peakMem / (1024 * 1024));
+  }
 
   exitCode = 0;
 
@@ -54,6 +54,7 @@ static char textEncName[128] = "";
 static char ownerPassword[33] = "\001";
 static char userPassword[33] = "\001";
 static char cfgFileName[256] = "";
+static GBool rangeIO = gFalse;
 static GBool printVersion = gFalse;
 static GBool printHelp = gFalse;
 
@@ -74,6 +75,8 @@ static ArgDesc argDesc[] = {
    "owner password (for encrypted files)"},
   {"-upw",    argString,   userPassword,   sizeof(userPassword),
    "user password (for encrypted files)"},
+  {"-rangeio", argFlag,    &rangeIO,       0,
+   "read the PDF file through a RangeStream (for testing)"},
   {"-cfg",        argString,      cfgFileName,    sizeof(cfgFileName),
    "configuration file to use in place of .xpdfrc"},
   {"-v",      argFlag,     &printVersion,  0,
@@ -100,6 +103,7 @@ int main(int argc, char *argv[]) {
   char buf[256];
   double w, h, wISO, hISO;
   FILE *f;
+  RangeStream *rangeStr;
   GString *metadata;
   ZxDoc *xmp;
   int permFlags, keyLength, encVersion;
@@ -152,7 +156,15 @@ int main(int argc, char *argv[]) {
   } else {
     userPW = NULL;
   }
-  doc = new PDFDoc(fileName, ownerPW, userPW);
+  // with -rangeio, read the file through a RangeStream (if the file
+  // can't be opened, the regular PDFDoc constructor reports the error)
+  rangeStr = NULL;
+  if (rangeIO && (f = openFile(fileName, "rb"))) {
+    doc = new PDFDoc(new FileByteRangeProvider(f), ownerPW, userPW);
+    rangeStr = (RangeStream *)doc->getBaseStream();
+  } else {
+    doc = new PDFDoc(fileName, ownerPW, userPW);
+  }
   if (userPW) {
     delete userPW;
   }
@@ -307,6 +319,14 @@ int main(int argc, char *argv[]) {
   // print PDF version
   printf("PDF version:    %.1f\n", doc->getPDFVersion());
 
+  // print RangeStream statistics
+  if (rangeStr) {
+    printf("Range fetches:  %d (%.0f bytes)\n",
+	   rangeStr->getNumFetches(), (double)rangeStr->getBytesFetched());
+    printf("Range cache:    %d hits, %d misses\n",
+	   rangeStr->getNumCacheHits(), rangeStr->getNumCacheMisses());
+  }
+
   // print the metadata
   if (printMetadata && metadata) {
     fputs("Metadata:\n", stdout);
@@ -14,6 +14,7 @@
 #include "parseargs.h"
 #include "gfile.h"
 #include "GString.h"
+#include "GArena.h"
 #include "GlobalParams.h"
 #include "PDFDoc.h"
 #include "HTMLGen.h"
@@ -268,6 +269,7 @@ int main(int argc, char *argv[]) {
 
   // check for memory leaks
   Object::memCheck(stderr);
+  gArenaReport(stderr);
   gMemReport(stderr);
 
   return exitCode;
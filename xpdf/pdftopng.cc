@@ -22,8 +22,10 @@
 #include "GlobalParams.h"
 #include "Object.h"
 #include "PDFDoc.h"
+#include "ContentStreamCache.h"
 #include "SplashBitmap.h"
 #include "Splash.h"
+#include "SplashFontEngine.h"
 #include "SplashOutputDev.h"
 #include "Error.h"
 #include "config.h"
@@ -106,7 +108,12 @@ int main(int argc, char *argv[]) {
   GString *ownerPW, *userPW;
   SplashColor paperColor;
   SplashOutputDev *splashOut;
+  SplashImageCache *imageCache;
+  ContentStreamCache *contentStreamCache;
+  int nGlyphCacheHits, nGlyphCacheMisses, nGlyphCacheEvictions;
+  int nGlyphCacheResizes;
   GBool ok, toStdout, printStatusInfo;
+  size_t peakMem;
   int exitCode;
   int pg;
   png_structp png;
@@ -189,6 +196,10 @@ int main(int argc, char *argv[]) {
     goto err1;
   }
 
+  // the pages are processed in order, once each, so there's no need
+  // to keep them around
+  doc->setStreamingMode(gTrue);
+
   // get page range
   if (firstPage < 1)
     firstPage = 1;
@@ -281,6 +292,47 @@ int main(int argc, char *argv[]) {
       fclose(f);
     }
   }
+  if (printStatusInfo) {
+    imageCache = splashOut->getImageCache();
+    printf("[image cache: %d hits, %d misses, %d evictions]\n",
+	   imageCache->getNumHits(), imageCache->getNumMisses(),
+	   imageCache->getNumEvictions());
+    splashOut->getFontEngine()->getGlyphCacheStats(&nGlyphCacheHits,
+						   &nGlyphCacheMisses,
+						   &nGlyphCacheEvictions,
+						   &nGlyphCacheResizes);
+    printf("[glyph cache: %d hits, %d misses, %d evictions, %d resizes]\n",
+	   nGlyphCacheHits, nGlyphCacheMisses, nGlyphCacheEvictions,
+	   nGlyphCacheResizes);
+    printf("[Type 3 glyph cache: %d hits, %d misses, %d glyph evictions,"
+	   " %d font evictions]\n",
+	   splashOut->getNumType3CacheHits(),
+	   splashOut->getNumType3CacheMisses(),
+	   splashOut->getNumType3CacheGlyphEvictions(),
+	   splashOut->getNumType3CacheFontEvictions());
+    if (globalParams->getFormCacheSize() > 0) {
+      printf("[form cache: %d hits, %d misses, %d evictions]\n",
+	     splashOut->getNumFormCacheHits(),
+	     splashOut->getNumFormCacheMisses(),
+	     splashOut->getNumFormCacheEvictions());
+    }
+    if (globalParams->getPatternCacheSize() > 0) {
+      printf("[pattern cache: %d hits, %d misses, %d evictions]\n",
+	     splashOut->getNumPatternCacheHits(),
+	     splashOut->getNumPatternCacheMisses(),
+	     splashOut->getNumPatternCacheEvictions());
+    }
+    if ((contentStreamCache = doc->getContentStreamCache())) {
+      printf("[content stream cache: %d hits, %d misses, %d evictions]\n",
+	     contentStreamCache->getNumHits(),
+	     contentStreamCache->getNumMisses(),
+	     contentStreamCache->getNumEvictions());
+    }
+    if ((peakMem = gMemPeakUsage()) > 0) {
+      printf("[peak memory usage: %.1f MB]\n",
+	     (double)peakMem / (1024 * 1024));
+    }
+  }
   delete splashOut;
 
   exitCode = 0;
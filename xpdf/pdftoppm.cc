@@ -22,9 +22,12 @@
 #include "GString.h"
 #include "GlobalParams.h"
 #include "Object.h"
+#include "Stream.h"
 #include "PDFDoc.h"
+#include "ContentStreamCache.h"
 #include "SplashBitmap.h"
 #include "Splash.h"
+#include "SplashFontEngine.h"
 #include "SplashOutputDev.h"
 #include "Error.h"
 #include "config.h"
@@ -44,6 +47,7 @@ static char vectorAntialiasStr[16] = "";
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static GBool verbose = gFalse;
+static GBool rangeIO = gFalse;
 static GBool quiet = gFalse;
 static char cfgFileName[256] = "";
 static GBool printVersion = gFalse;
@@ -80,6 +84,8 @@ static ArgDesc argDesc[] = {
    "user password (for encrypted files)"},
   {"-verbose", argFlag,    &verbose,       0,
    "print per-page status information"},
+  {"-rangeio", argFlag,    &rangeIO,       0,
+   "read the PDF file through a RangeStream (for testing)"},
   {"-q",      argFlag,     &quiet,         0,
    "don't print any messages or errors"},
   {"-cfg",        argString,      cfgFileName,    sizeof(cfgFileName),
@@ -105,7 +111,14 @@ int main(int argc, char *argv[]) {
   GString *ownerPW, *userPW;
   SplashColor paperColor;
   SplashOutputDev *splashOut;
+  SplashImageCache *imageCache;
+  ContentStreamCache *contentStreamCache;
+  RangeStream *rangeStr;
+  FILE *f;
+  int nGlyphCacheHits, nGlyphCacheMisses, nGlyphCacheEvictions;
+  int nGlyphCacheResizes;
   GBool ok, toStdout, printStatusInfo;
+  size_t peakMem;
   int exitCode;
   int pg, n;
   const char *ext;
@@ -190,7 +203,15 @@ int main(int argc, char *argv[]) {
   } else {
     userPW = NULL;
   }
-  doc = new PDFDoc(fileName, ownerPW, userPW);
+  // with -rangeio, read the file through a RangeStream (if the file
+  // can't be opened, the regular PDFDoc constructor reports the error)
+  rangeStr = NULL;
+  if (rangeIO && (f = openFile(fileName, "rb"))) {
+    doc = new PDFDoc(new FileByteRangeProvider(f), ownerPW, userPW);
+    rangeStr = (RangeStream *)doc->getBaseStream();
+  } else {
+    doc = new PDFDoc(fileName, ownerPW, userPW);
+  }
   if (userPW) {
     delete userPW;
   }
@@ -202,6 +223,10 @@ int main(int argc, char *argv[]) {
     goto err1;
   }
 
+  // the pages are processed in order, once each, so there's no need
+  // to keep them around
+  doc->setStreamingMode(gTrue);
+
   // get page range
   if (firstPage < 1)
     firstPage = 1;
@@ -262,6 +287,54 @@ int main(int argc, char *argv[]) {
       delete ppmFile;
     }
   }
+  if (printStatusInfo) {
+    imageCache = splashOut->getImageCache();
+    printf("[image cache: %d hits, %d misses, %d evictions]\n",
+	   imageCache->getNumHits(), imageCache->getNumMisses(),
+	   imageCache->getNumEvictions());
+    splashOut->getFontEngine()->getGlyphCacheStats(&nGlyphCacheHits,
+						   &nGlyphCacheMisses,
+						   &nGlyphCacheEvictions,
+						   &nGlyphCacheResizes);
+    printf("[glyph cache: %d hits, %d misses, %d evictions, %d resizes]\n",
+	   nGlyphCacheHits, nGlyphCacheMisses, nGlyphCacheEvictions,
+	   nGlyphCacheResizes);
+    printf("[Type 3 glyph cache: %d hits, %d misses, %d glyph evictions,"
+	   " %d font evictions]\n",
+	   splashOut->getNumType3CacheHits(),
+	   splashOut->getNumType3CacheMisses(),
+	   splashOut->getNumType3CacheGlyphEvictions(),
+	   splashOut->getNumType3CacheFontEvictions());
+    if (globalParams->getFormCacheSize() > 0) {
+      printf("[form cache: %d hits, %d misses, %d evictions]\n",
+	     splashOut->getNumFormCacheHits(),
+	     splashOut->getNumFormCacheMisses(),
+	     splashOut->getNumFormCacheEvictions());
+    }
+    if (globalParams->getPatternCacheSize() > 0) {
+      printf("[pattern cache: %d hits, %d misses, %d evictions]\n",
+	     splashOut->getNumPatternCacheHits(),
+	     splashOut->getNumPatternCacheMisses(),
+	     splashOut->getNumPatternCacheEvictions());
+    }
+    if ((contentStreamCache = doc->getContentStreamCache())) {
+      printf("[content stream cache: %d hits, %d misses, %d evictions]\n",
+	     contentStreamCache->getNumHits(),
+	     contentStreamCache->getNumMisses(),
+	     contentStreamCache->getNumEvictions());
+    }
+    if ((peakMem = gMemPeakUsage()) > 0) {
+      printf("[peak memory usage: %.1f MB]\n",
+	     (double)peakMem / (1024 * 1024));
+    }
+    if (rangeStr) {
+      printf("[range stream: %d fetches, %.0f of %.0f bytes,"
+	     " %d hits, %d misses]\n",
+	     rangeStr->getNumFetches(), (double)rangeStr->getBytesFetched(),
+	     (double)rangeStr->getFileSize(), rangeStr->getNumCacheHits(),
+	     rangeStr->getNumCacheMisses());
+    }
+  }
   delete splashOut;
 
   exitCode = 0;
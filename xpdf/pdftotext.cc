@@ -20,6 +20,7 @@
 #include "parseargs.h"
 #include "GString.h"
 #include "GList.h"
+#include "GArena.h"
 #include "GlobalParams.h"
 #include "Object.h"
 #include "Stream.h"
@@ -141,6 +142,7 @@ int main(int argc, char *argv[]) {
   UnicodeMap *uMap;
   GBool ok;
   char *p;
+  size_t peakMem;
   int exitCode;
 
 #ifdef DEBUG_FP_LINUX
@@ -241,6 +243,10 @@ int main(int argc, char *argv[]) {
     goto err2;
   }
 
+  // the pages are processed in order, once each, so there's no need
+  // to keep them around
+  doc->setStreamingMode(gTrue);
+
   // check for copy permission
   if (!doc->okToCopy()) {
     error(errNotAllowed, -1,
@@ -311,6 +317,11 @@ int main(int argc, char *argv[]) {
     goto err3;
   }
   delete textOut;
+  if (globalParams->getPrintStatusInfo() &&
+      (peakMem = gMemPeakUsage()) > 0) {
+    printf("[peak memory usage: %.1f MB]\n",
+	   (double)peakMem / (1024 * 1024));
+  }
 
   exitCode = 0;
 
@@ -326,6 +337,7 @@ int main(int argc, char *argv[]) {
 
   // check for memory leaks
   Object::memCheck(stderr);
+  gArenaReport(stderr);
   gMemReport(stderr);
 
   return exitCode;